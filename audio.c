@@ -94,6 +94,8 @@
 #include "ringbuffer.h"
 #include "misc.h"
 #include "audio.h"
+#include "trace.h"
+#include "metrics.h"
 
 //----------------------------------------------------------------------------
 //	Declarations
@@ -146,6 +148,34 @@ static const int AudioBytesProSample = 2;	///< number of bytes per sample
 
 static int AudioBufferTime = 336;	///< audio buffer time in ms
 
+#define AUDIO_LATENCY_MIN	72	///< min. adapted buffer time in ms
+#define AUDIO_LATENCY_WINDOW	10000	///< ms stable, before shrinking
+#define AUDIO_LATENCY_DRAIN	200	///< skip 1 of n samples to drain
+#define AUDIO_VIDEO_FRAMES_MAX	15	///< video frames buffered at start
+
+static char AudioLowLatency;		///< flag adaptive low latency profile
+static int AudioLatencyTime = 336;	///< adapted buffer time in ms
+static int AudioLatencyMinFill = -1;	///< min. buffer fill in window in ms
+static uint32_t AudioLatencyTick;	///< start tick of stable window
+static int AudioLatencyDrain;		///< bytes left to skip after shrink
+static int AudioLatencyDrainRing;	///< ring buffer to drain
+static uint32_t AudioLatencyDrainTick;	///< tick of last drain skip
+
+    /// lock of underrun counters and video frames, used by the audio,
+    /// video and vdr threads
+static pthread_mutex_t AudioLatencyMutex = PTHREAD_MUTEX_INITIALIZER;
+static int AudioUnderruns;		///< number of audio underruns
+static int AudioVideoUnderruns;		///< number of video underruns
+static int AudioLatencyVideoUnderruns;	///< video underruns at window start
+
+    /// video frames buffered ahead of audio at start
+static int AudioVideoFrames = AUDIO_VIDEO_FRAMES_MAX;
+
+static volatile uint32_t AudioPlayTick;	///< ticks first sample played after flush
+
+    /// callback to notify the writer, that buffer space was freed
+static void (*AudioSpaceCallback)(void);
+
 #ifdef USE_AUDIO_THREAD
 static pthread_t AudioThread;		///< audio play thread
 static pthread_mutex_t AudioMutex;	///< audio condition mutex
@@ -646,6 +676,8 @@ static int AudioRingWrite;		///< audio ring write pointer
 static int AudioRingRead;		///< audio ring read pointer
 static atomic_t AudioRingFilled;	///< how many of the ring is used
 static unsigned AudioStartThreshold;	///< start play, if filled
+static unsigned AudioStartMinThreshold;	///< device minimum start threshold
+static int AudioStartExtraDelay;	///< device extra start delay in ms
 
 /**
 **	Add sample-rate, number of channels change to ring.
@@ -747,6 +779,171 @@ static void AudioRingExit(void)
     AudioRingWrite = 0;
 }
 
+//----------------------------------------------------------------------------
+//	Latency
+//----------------------------------------------------------------------------
+
+/**
+**	Get used audio buffer time.
+**
+**	@returns configured buffer time, or the adapted buffer time in the
+**	low latency profile.
+*/
+static int AudioGetBufferTime(void)
+{
+    if (AudioLowLatency && AudioLatencyTime < AudioBufferTime) {
+	return AudioLatencyTime;
+    }
+    return AudioBufferTime;
+}
+
+/**
+**	Set start threshold from the used audio buffer time.
+**
+**	Called by the setup of the device and when the low latency profile
+**	changed the buffer time, the next (re)start waits for the new fill.
+**
+**	@param sample_rate	hardware sample rate in Hz
+**	@param channels		hardware number of channels
+*/
+static void AudioSetStartThreshold(unsigned sample_rate, unsigned channels)
+{
+    unsigned threshold;
+    int delay;
+
+    // buffer time/delay in ms
+    delay = AudioGetBufferTime() + AudioStartExtraDelay;
+    if (VideoAudioDelay > 0) {
+	delay += VideoAudioDelay / 90;
+    }
+    threshold = (sample_rate * channels * AudioBytesProSample * delay) / 1000U;
+    if (threshold < AudioStartMinThreshold) {
+	threshold = AudioStartMinThreshold;
+    }
+    // no bigger, than 1/3 the buffer
+    if (threshold > AudioRingBufferSize / 3) {
+	threshold = AudioRingBufferSize / 3;
+    }
+    AudioStartThreshold = threshold;
+}
+
+#ifdef USE_AUDIO_THREAD
+
+/**
+**	Adapt buffering of the low latency profile.
+**
+**	Underruns grow the buffer time by 50%.  If the ring buffer never
+**	drained below half of the buffer time for a stable window, the
+**	buffer time is reduced by 1/8.  The excess pcm samples are drained
+**	slowly, by skipping a few of each #AUDIO_LATENCY_DRAIN samples, a
+**	single large skip is audible.  Video sync follows by dropping frames.
+**
+**	@param underrun	flag audio ring buffer ran empty
+*/
+static void AudioLatencyUpdate(int underrun)
+{
+    const AudioRingRing *ring;
+    uint32_t tick;
+    unsigned bytes_ms;
+    unsigned frame_size;
+    int fill;
+
+    if (!AudioLowLatency) {
+	return;
+    }
+    tick = GetMsTicks();
+    if (underrun) {
+	if (!AudioVideoIsReady) {	// stream start, no underrun
+	    return;
+	}
+	pthread_mutex_lock(&AudioLatencyMutex);
+	AudioUnderruns++;
+	pthread_mutex_unlock(&AudioLatencyMutex);
+	AudioLatencyTime += AudioLatencyTime / 2;
+	if (AudioLatencyTime > AudioBufferTime) {
+	    AudioLatencyTime = AudioBufferTime;
+	}
+	AudioLatencyDrain = 0;
+	AudioLatencyMinFill = -1;
+	AudioLatencyTick = tick;
+	// restart after the underrun waits for the grown buffer
+	ring = &AudioRing[AudioRingRead];
+	AudioSetStartThreshold(ring->HwSampleRate, ring->HwChannels);
+	Debug(3, "audio: underrun, latency buffer %dms\n", AudioLatencyTime);
+	return;
+    }
+
+    ring = &AudioRing[AudioRingRead];
+    bytes_ms = (ring->HwSampleRate * ring->HwChannels * AudioBytesProSample)
+	/ 1000;
+    if (!bytes_ms) {
+	return;
+    }
+    frame_size = ring->HwChannels * AudioBytesProSample;
+
+    // drain the excess of the last shrink
+    if (AudioLatencyDrain > 0) {
+	int skip;
+
+	if (AudioLatencyDrainRing != AudioRingRead) {	// new stream
+	    AudioLatencyDrain = 0;
+	}
+	skip = ((tick - AudioLatencyDrainTick) * bytes_ms) /
+	    AUDIO_LATENCY_DRAIN;
+	skip -= skip % frame_size;
+	if (skip > AudioLatencyDrain) {
+	    skip = AudioLatencyDrain;
+	}
+	if (skip > 0 && (size_t) skip < RingBufferUsedBytes(ring->RingBuffer)) {
+	    pthread_mutex_lock(&ReadAdvance_mutex);
+	    RingBufferReadAdvance(ring->RingBuffer, skip);
+	    pthread_mutex_unlock(&ReadAdvance_mutex);
+	    AudioLatencyDrain -= skip;
+	    AudioLatencyDrainTick = tick;
+	}
+    }
+
+    fill = RingBufferUsedBytes(ring->RingBuffer) / bytes_ms;
+    if (AudioLatencyMinFill < 0 || fill < AudioLatencyMinFill) {
+	AudioLatencyMinFill = fill;
+    }
+    if (tick - AudioLatencyTick < AUDIO_LATENCY_WINDOW) {
+	return;
+    }
+    // stable window: shrink buffer, drain the excess samples
+    if (AudioLatencyMinFill > AudioLatencyTime / 2
+	&& AudioLatencyTime > AUDIO_LATENCY_MIN) {
+	int skip;
+
+	skip = AudioLatencyTime / 8;
+	AudioLatencyTime -= skip;
+	if (AudioLatencyTime < AUDIO_LATENCY_MIN) {
+	    AudioLatencyTime = AUDIO_LATENCY_MIN;
+	}
+	// pass-through bursts can't be cut, they keep the buffer
+	if (!ring->Passthrough) {
+	    skip = skip * bytes_ms;
+	    AudioLatencyDrain += skip - skip % frame_size;
+	    AudioLatencyDrainRing = AudioRingRead;
+	    AudioLatencyDrainTick = tick;
+	}
+	AudioSetStartThreshold(ring->HwSampleRate, ring->HwChannels);
+	Debug(3, "audio: stable, latency buffer %dms\n", AudioLatencyTime);
+    }
+    // no video underruns in window: buffer less video at next start
+    pthread_mutex_lock(&AudioLatencyMutex);
+    if (AudioLatencyVideoUnderruns == AudioVideoUnderruns
+	&& AudioVideoFrames > 3) {
+	AudioVideoFrames--;
+    }
+    AudioLatencyVideoUnderruns = AudioVideoUnderruns;
+    pthread_mutex_unlock(&AudioLatencyMutex);
+    AudioLatencyMinFill = -1;
+    AudioLatencyTick = tick;
+}
+
+#endif
+
 #ifdef USE_ALSA
 
 //============================================================================
@@ -796,6 +993,7 @@ static int AlsaPlayRingbuffer(void)
 	    if (n == -EAGAIN) {
 		continue;
 	    }
+	    MetricsInc(METRIC_AUDIO_XRUNS);
 	    Warning(_("audio/alsa: avail underrun error? '%s'\n"),
 		snd_strerror(n));
 	    err = snd_pcm_recover(AlsaPCMHandle, n, 0);
@@ -881,6 +1079,7 @@ static int AlsaPlayRingbuffer(void)
 		       goto again;
 		       }
 		     */
+		    MetricsInc(METRIC_AUDIO_XRUNS);
 		    Warning(_("audio/alsa: writei underrun error? '%s'\n"),
 			snd_strerror(err));
 		    err = snd_pcm_recover(AlsaPCMHandle, err, 0);
@@ -899,6 +1098,10 @@ static int AlsaPlayRingbuffer(void)
 	}
 	RingBufferReadAdvance(AudioRing[AudioRingRead].RingBuffer, avail);
 	pthread_mutex_unlock(&ReadAdvance_mutex);
+	TraceMark(TRACE_AUDIO_WRITE, avail);
+	if (AudioSpaceCallback) {
+	    AudioSpaceCallback();
+	}
 	first = 0;
     }
 
@@ -957,6 +1160,7 @@ static int AlsaThread(void)
 	}
 	// wait for space in kernel buffers
 	if ((err = snd_pcm_wait(AlsaPCMHandle, 24)) < 0) {
+	    MetricsInc(METRIC_AUDIO_XRUNS);
 	    Warning(_("audio/alsa: wait underrun error? '%s'\n"),
 		snd_strerror(err));
 	    err = snd_pcm_recover(AlsaPCMHandle, err, 0);
@@ -1215,7 +1419,6 @@ static int AlsaSetup(int *freq, int *channels, int passthrough)
     snd_pcm_uframes_t buffer_size;
     snd_pcm_uframes_t period_size;
     int err;
-    int delay;
 
     if (!AlsaPCMHandle) {		// alsa not running yet
 	// FIXME: if open fails for fe. pass-through, we never recover
@@ -1317,21 +1520,10 @@ static int AlsaSetup(int *freq, int *channels, int passthrough)
     Debug(3, "audio/alsa: state %s\n",
 	snd_pcm_state_name(snd_pcm_state(AlsaPCMHandle)));
 
-    AudioStartThreshold = snd_pcm_frames_to_bytes(AlsaPCMHandle, period_size);
-    // buffer time/delay in ms
-    delay = AudioBufferTime;
-    if (VideoAudioDelay > 0) {
-	delay += VideoAudioDelay / 90;
-    }
-    if (AudioStartThreshold <
-	(*freq * *channels * AudioBytesProSample * delay) / 1000U) {
-	AudioStartThreshold =
-	    (*freq * *channels * AudioBytesProSample * delay) / 1000U;
-    }
-    // no bigger, than 1/3 the buffer
-    if (AudioStartThreshold > AudioRingBufferSize / 3) {
-	AudioStartThreshold = AudioRingBufferSize / 3;
-    }
+    AudioStartMinThreshold =
+	snd_pcm_frames_to_bytes(AlsaPCMHandle, period_size);
+    AudioStartExtraDelay = 0;
+    AudioSetStartThreshold(*freq, *channels);
     if (!AudioDoingInit) {
 	Info(_("audio/alsa: start delay %ums\n"), (AudioStartThreshold * 1000)
 	    / (*freq * *channels * AudioBytesProSample));
@@ -1523,6 +1715,10 @@ static int OssPlayRingbuffer(void)
 	}
 	// advance how many could written
 	RingBufferReadAdvance(AudioRing[AudioRingRead].RingBuffer, n);
+	TraceMark(TRACE_AUDIO_WRITE, n);
+	if (AudioSpaceCallback) {
+	    AudioSpaceCallback();
+	}
 	first = 0;
     }
 
@@ -1782,7 +1978,6 @@ static int OssSetup(int *sample_rate, int *channels, int passthrough)
 {
     int ret;
     int tmp;
-    int delay;
     audio_buf_info bi;
 
     if (OssPcmFildes == -1) {		// OSS not ready
@@ -1867,22 +2062,9 @@ static int OssSetup(int *sample_rate, int *channels, int passthrough)
 	OssFragmentTime);
 
     // start when enough bytes for initial write
-    AudioStartThreshold = (bi.fragsize - 1) * bi.fragstotal;
-
-    // buffer time/delay in ms
-    delay = AudioBufferTime + 300;
-    if (VideoAudioDelay > 0) {
-	delay += VideoAudioDelay / 90;
-    }
-    if (AudioStartThreshold <
-	(*sample_rate * *channels * AudioBytesProSample * delay) / 1000U) {
-	AudioStartThreshold =
-	    (*sample_rate * *channels * AudioBytesProSample * delay) / 1000U;
-    }
-    // no bigger, than 1/3 the buffer
-    if (AudioStartThreshold > AudioRingBufferSize / 3) {
-	AudioStartThreshold = AudioRingBufferSize / 3;
-    }
+    AudioStartMinThreshold = (bi.fragsize - 1) * bi.fragstotal;
+    AudioStartExtraDelay = 300;
+    AudioSetStartThreshold(*sample_rate, *channels);
 
     if (!AudioDoingInit) {
 	Info(_("audio/oss: delay %ums\n"), (AudioStartThreshold * 1000)
@@ -2136,6 +2318,12 @@ static void *AudioPlayHandlerThread(void *dummy)
 	    err = 0;
 	    if (RingBufferUsedBytes(AudioRing[AudioRingRead].RingBuffer)) {
 		err = AudioUsedModule->Thread();
+		if (err > 0) {
+		    if (!AudioPlayTick) {
+			AudioPlayTick = GetMsTicks() | 1;
+		    }
+		    AudioLatencyUpdate(0);
+		}
 	    }
 	    // underrun, check if new ring buffer is available
 	    if (!err) {
@@ -2148,6 +2336,12 @@ static void *AudioPlayHandlerThread(void *dummy)
 
 		// underrun, and no new ring buffer, goto sleep.
 		if (!atomic_read(&AudioRingFilled)) {
+		    if (!AudioPaused) {
+			if (AudioVideoIsReady) {
+			    MetricsInc(METRIC_AUDIO_UNDERRUNS);
+			}
+			AudioLatencyUpdate(1);
+		    }
 		    break;
 		}
 
@@ -2342,8 +2536,15 @@ void AudioEnqueue(const void *samples, int count)
         times_count++;
     }
     Dupped = 0;
+    TraceMark(TRACE_AUDIO_ENQUEUE, count);
+
+    MetricsSet(METRIC_AUDIO_BUFFERED,
+	(RingBufferUsedBytes(AudioRing[AudioRingWrite].RingBuffer) * 1000)
+	/ (AudioRing[AudioRingWrite].HwSampleRate *
+	    AudioRing[AudioRingWrite].HwChannels * AudioBytesProSample));
 
     if (n != (size_t) count) {
+	MetricsInc(METRIC_AUDIO_OVERFLOWS);
 	Error(_("audio: can't place %d samples in ring buffer\n"), count);
 	// too many bytes are lost
 	// FIXME: caller checks buffer full.
@@ -2436,13 +2637,18 @@ void AudioVideoReady(int64_t pts)
 	(int)(pts - audio_pts) / 90, AudioRunning ? "running" : "ready");
 
     if (!AudioRunning) {
+	int video_frames;
 	int skip;
 
-	// buffer ~15 video frames
+	pthread_mutex_lock(&AudioLatencyMutex);
+	video_frames = AudioVideoFrames;
+	pthread_mutex_unlock(&AudioLatencyMutex);
+
+	// buffer ~15 video frames, less in low latency profile
 	// FIXME: HDTV can use smaller video buffer
 	skip =
-	    pts - 15 * 20 * 90 - AudioBufferTime * 90 - audio_pts -
-	    VideoAudioDelay;
+	    pts - video_frames * 20 * 90 - AudioGetBufferTime() * 90 -
+	    audio_pts - VideoAudioDelay;
 #ifdef DEBUG
 	fprintf(stderr, "%dms %dms %dms\n", (int)(pts - audio_pts) / 90,
 	    VideoAudioDelay / 90, skip / 90);
@@ -2555,6 +2761,7 @@ void AudioFlushBuffers(void)
     Debug(3, "audio: reset video ready\n");
     AudioVideoIsReady = 0;
     AudioSkip = 0;
+    AudioPlayTick = 0;
 
     atomic_inc(&AudioRingFilled);
 
@@ -2644,6 +2851,16 @@ void AudioSetClock(int64_t pts)
     AudioRing[AudioRingWrite].PTS = pts;
 }
 
+/**
+**	Get time the first sample after the last flush was played.
+**
+**	@returns ms ticks of first played sample, 0 if none played yet.
+*/
+uint32_t AudioGetPlayTick(void)
+{
+    return AudioPlayTick;
+}
+
 /**
 **	Get current audio clock.
 **
@@ -2761,6 +2978,81 @@ void AudioSetBufferTime(int delay)
     AudioBufferTime = delay;
 }
 
+/**
+**	Set latency profile.
+**
+**	The low latency profile starts with small buffers and adapts them
+**	at runtime from audio ring fill and audio/video underruns.
+**
+**	@param onoff	true low latency profile, false conservative defaults
+*/
+void AudioSetLowLatency(int onoff)
+{
+    AudioLowLatency = onoff;
+    AudioLatencyTime = onoff ? AUDIO_LATENCY_MIN * 2 : AudioBufferTime;
+    pthread_mutex_lock(&AudioLatencyMutex);
+    AudioVideoFrames = onoff ? 5 : AUDIO_VIDEO_FRAMES_MAX;
+    pthread_mutex_unlock(&AudioLatencyMutex);
+    AudioLatencyDrain = 0;
+    AudioLatencyMinFill = -1;
+    AudioLatencyTick = GetMsTicks();
+}
+
+/**
+**	Set callback called by the audio thread, after it freed buffer space.
+**
+**	@param callback	function called without locks held, NULL disables
+*/
+void AudioSetSpaceCallback(void (*callback)(void))
+{
+    AudioSpaceCallback = callback;
+}
+
+/**
+**	Video output buffer ran empty.
+**
+**	Counted while audio plays.  The low latency profile buffers one
+**	video frame more at next start.
+*/
+void AudioVideoUnderrun(void)
+{
+    if (!AudioRunning || AudioPaused) {
+	return;
+    }
+    MetricsInc(METRIC_VIDEO_UNDERRUNS);
+    if (AudioLowLatency) {
+	pthread_mutex_lock(&AudioLatencyMutex);
+	AudioVideoUnderruns++;
+	if (AudioVideoFrames < AUDIO_VIDEO_FRAMES_MAX) {
+	    AudioVideoFrames++;
+	}
+	pthread_mutex_unlock(&AudioLatencyMutex);
+    }
+}
+
+/**
+**	Get latency statistics.
+**
+**	Video is synced to audio, the glass-to-glass delay is estimated from
+**	the buffered audio, the audio/video delay and one frame for decode
+**	and one frame for scan-out.
+**
+**	@param[out] buffer_time	used audio buffer time in ms
+**	@param[out] delay	estimated glass-to-glass delay in ms
+**	@param[out] underruns	number of audio + video underruns
+*/
+void AudioGetLatency(int *buffer_time, int *delay, int *underruns)
+{
+    *buffer_time = AudioGetBufferTime();
+    *delay = AudioGetDelay() / 90 + 2 * 20;
+    if (VideoAudioDelay > 0) {
+	*delay += VideoAudioDelay / 90;
+    }
+    pthread_mutex_lock(&AudioLatencyMutex);
+    *underruns = AudioUnderruns + AudioVideoUnderruns;
+    pthread_mutex_unlock(&AudioLatencyMutex);
+}
+
 /**
 **	Enable/disable software volume.
 **
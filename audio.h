@@ -35,6 +35,7 @@ extern int AudioUsedBytes(void);	///< used bytes in audio output
 extern int64_t AudioGetDelay(void);	///< get current audio delay
 extern void AudioSetClock(int64_t);	///< set audio clock base
 extern int64_t AudioGetClock();		///< get current audio clock
+extern uint32_t AudioGetPlayTick(void);	///< get first sample played ticks
 extern void AudioSetVolume(int);	///< set volume
 extern int AudioSetup(int *, int *, int);	///< setup audio output
 
@@ -42,6 +43,10 @@ extern void AudioPlay(void);		///< play audio
 extern void AudioPause(void);		///< pause audio
 
 extern void AudioSetBufferTime(int);	///< set audio buffer time
+extern void AudioSetLowLatency(int);	///< set low latency profile
+extern void AudioVideoUnderrun(void);	///< video output buffer empty
+extern void AudioSetSpaceCallback(void (*)(void));	///< space freed
+extern void AudioGetLatency(int *, int *, int *);	///< latency statistics
 extern void AudioSetSoftvol(int);	///< enable/disable softvol
 extern void AudioSetNormalize(int, int);	///< set normalize parameters
 extern void AudioSetCompression(int, int);	///< set compression parameters
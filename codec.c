@@ -80,6 +80,7 @@
 #include <libavresample/avresample.h>
 #endif
 #include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
 
 #if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58,7,100)
 #define CODEC_CAP_HWACCEL_VDPAU AV_CODEC_CAP_HWACCEL_VDPAU
@@ -98,6 +99,7 @@
 #include "video.h"
 #include "audio.h"
 #include "codec.h"
+#include "metrics.h"
 
 //----------------------------------------------------------------------------
 
@@ -164,6 +166,16 @@ static enum AVPixelFormat Codec_get_format(AVCodecContext * video_ctx,
     if (!video_ctx->width || !video_ctx->height) {
 	Error("codec/video: ffmpeg/libav buggy: width or height zero\n");
     }
+    // reused context: another size or profile needs a fresh decoder
+    if (decoder->Reused && (video_ctx->width != decoder->ReusedWidth
+	    || video_ctx->height != decoder->ReusedHeight
+	    || video_ctx->profile != decoder->ReusedProfile)) {
+	Debug(3, "codec: reused decoder %dx%d -> %dx%d, reopen\n",
+	    decoder->ReusedWidth, decoder->ReusedHeight, video_ctx->width,
+	    video_ctx->height);
+	decoder->Reopen = 1;
+	return AV_PIX_FMT_NONE;
+    }
 
     return Video_get_format(decoder->HwDecoder, video_ctx, fmt);
 }
@@ -377,7 +389,8 @@ VideoDecoder *CodecVideoNewDecoder(VideoHwDecoder * hw_decoder)
     VideoDecoder *decoder;
 
     if (!(decoder = calloc(1, sizeof(*decoder)))) {
-	Fatal(_("codec: can't allocate vodeo decoder\n"));
+	Error(_("codec: can't allocate vodeo decoder\n"));
+	return NULL;
     }
     decoder->HwDecoder = hw_decoder;
 
@@ -471,6 +484,13 @@ int CodecVideoOpen(VideoDecoder * decoder, int codec_id)
     if (strstr(decoder->VideoCodec->name, "cuvid"))
         av_opt_set_int(decoder->VideoCtx->priv_data, "surfaces", codec_id == AV_CODEC_ID_MPEG2VIDEO ? 10 : 13, 0);
 
+    // reduced cost: decode small software mpeg-2 pictures
+    if (decoder->Lowres && codec_id == AV_CODEC_ID_MPEG2VIDEO) {
+	decoder->VideoCtx->lowres =
+	    FFMIN(decoder->Lowres, video_codec->max_lowres);
+	Debug(3, "codec: video lowres %d\n", decoder->VideoCtx->lowres);
+    }
+
     pthread_mutex_lock(&CodecLockMutex);
 
 
@@ -579,9 +599,13 @@ int CodecVideoOpen(VideoDecoder * decoder, int codec_id)
 #endif
     // reset buggy ffmpeg/libav flag
     decoder->GetFormatDone = 0;
+    decoder->HardwareDecoder = VideoHardwareDecoder;
+    decoder->Reused = 0;
+    decoder->Reopen = 0;
 #ifdef FFMPEG_WORKAROUND_ARTIFACTS
     decoder->FirstKeyFrame = 1;
 #endif
+    VideoZapMark(decoder->HwDecoder, VIDEO_ZAP_CODEC);
     return 1;
 }
 
@@ -613,6 +637,90 @@ void CodecVideoClose(VideoDecoder * video_decoder)
     }
 }
 
+/**
+**	Open video decoder for a new stream.
+**
+**	A decoder still open with the same codec is flushed and reused, its
+**	context and the hardware surfaces are kept.  If the new stream has
+**	another size or profile, #CodecVideoDecode reopens it, when the
+**	codec asks for the pixel format.  Otherwise, or if the hw/sw
+**	decoder mode changed (f.e. for still pictures), the decoder is
+**	closed and opened again.
+**
+**	@param decoder	private video decoder
+**	@param codec_id	video codec id
+**
+**	@returns true, if the decoder is ready.
+*/
+int CodecVideoReopen(VideoDecoder * decoder, int codec_id)
+{
+    uint32_t tick;
+    int ret;
+
+    tick = GetUsTicks();
+    if (decoder->VideoCtx && decoder->VideoCodec && decoder->Frame
+	&& decoder->VideoCtx->codec_id == (enum AVCodecID)codec_id
+	&& decoder->HardwareDecoder == (int)VideoHardwareDecoder
+	&& !decoder->Reopen) {
+	Debug(3, "codec: reuse video codec %s\n", avcodec_get_name(codec_id));
+	avcodec_flush_buffers(decoder->VideoCtx);
+	decoder->Reused = 1;
+	decoder->ReusedWidth = decoder->VideoCtx->width;
+	decoder->ReusedHeight = decoder->VideoCtx->height;
+	decoder->ReusedProfile = decoder->VideoCtx->profile;
+#ifdef FFMPEG_WORKAROUND_ARTIFACTS
+	decoder->FirstKeyFrame = 1;
+#endif
+	VideoResetStart(decoder->HwDecoder);
+	VideoZapMark(decoder->HwDecoder, VIDEO_ZAP_CODEC);
+	VideoZapCodec(decoder->HwDecoder, 1, GetUsTicks() - tick);
+	return 1;
+    }
+    CodecVideoClose(decoder);
+    ret = CodecVideoOpen(decoder, codec_id);
+    VideoZapCodec(decoder->HwDecoder, 0, GetUsTicks() - tick);
+    return ret;
+}
+
+/**
+**	End video stream.
+**
+**	The codec is kept open for the next stream, unless the hw/sw
+**	decoder mode changed since it was opened (f.e. the still picture
+**	decoder was selected or restored), then it is closed.
+**
+**	@param decoder	private video decoder
+*/
+void CodecVideoEndStream(VideoDecoder * decoder)
+{
+    if (decoder->VideoCtx
+	&& decoder->HardwareDecoder != (int)VideoHardwareDecoder) {
+	Debug(3, "codec: decoder mode changed, close video codec\n");
+	CodecVideoClose(decoder);
+    }
+}
+
+/**
+**	Reopen a video decoder, which can't take the new stream or lowres.
+**
+**	@param decoder	private video decoder
+**
+**	@returns true, if the decoder is ready again.
+*/
+static int CodecVideoReopenReused(VideoDecoder * decoder)
+{
+    uint32_t tick;
+    int codec_id;
+    int ret;
+
+    tick = GetUsTicks();
+    codec_id = decoder->VideoCtx->codec_id;
+    CodecVideoClose(decoder);
+    ret = CodecVideoOpen(decoder, codec_id);
+    VideoZapCodec(decoder->HwDecoder, 0, GetUsTicks() - tick);
+    return ret;
+}
+
 #if 0
 
 /**
@@ -650,6 +758,165 @@ void DisplayPts(AVCodecContext * video_ctx, AVFrame * frame)
 
 #endif
 
+/**
+**	Set trick play decode mode.
+**
+**	Takes effect with the next decoded packet, the codec context is
+**	only changed by the decoder thread.
+**
+**	@param decoder	video decoder data
+**	@param mode	0 normal, 1 slow motion, 2 fast forward/rewind
+**
+**	In slow motion all frames are shown, only the non-reference
+**	frames are decoded without loop filter, the artifacts don't
+**	propagate.  In fast forward/rewind only reference frames are
+**	decoded and all without loop filter, each is shown only briefly.
+*/
+void CodecVideoSetTrickMode(VideoDecoder * decoder, int mode)
+{
+    decoder->TrickMode = mode;
+}
+
+    /// number of resolution classes, same as the video module
+#define CODEC_RESOLUTIONS 5
+
+    /// reduced cost decode modes of 576i, 720p, fake 1080i, 1080i, UHD
+static int CodecVideoReducedModes[CODEC_RESOLUTIONS] = { 0, 1, 1, 2, 3 };
+
+/**
+**	Set reduced cost decode modes per resolution class.
+**
+**	0 full quality, 1 without loop filter, 2 additional without
+**	B-frames and software mpeg-2 with lowres, 3 only reference frames.
+**
+**	@param modes	modes of 576i, 720p, fake 1080i, 1080i, UHD
+*/
+void CodecSetVideoReducedModes(const int *modes)
+{
+    int i;
+
+    for (i = 0; i < CODEC_RESOLUTIONS; ++i) {
+	CodecVideoReducedModes[i] = modes[i] < 0 ? 0 : modes[i] > 3 ? 3
+	    : modes[i];
+    }
+}
+
+/**
+**	Enable reduced cost decoding.
+**
+**	Used for small windows (pip), where the artifacts aren't visible.
+**	The mode is chosen by the resolution class of the stream.
+**
+**	@param decoder		video decoder data
+**	@param reduced		flag enable reduced cost decoding
+**	@param half_rate	flag render only every second frame
+*/
+void CodecVideoSetReduced(VideoDecoder * decoder, int reduced, int half_rate)
+{
+    if (decoder->Reduced != reduced || decoder->HalfRate != half_rate) {
+	Debug(3, "codec: reduced cost decoding %d half rate %d\n", reduced,
+	    half_rate);
+    }
+    decoder->Reduced = reduced;
+    decoder->HalfRate = reduced && half_rate;
+}
+
+/**
+**	Get resolution class of the decoded stream.
+**
+**	@param video_ctx	codec context
+*/
+static int CodecVideoResolution(const AVCodecContext * video_ctx)
+{
+    int width;
+    int height;
+
+    width = video_ctx->width << video_ctx->lowres;
+    height = video_ctx->height << video_ctx->lowres;
+    if (height == 2160) {
+	return 4;
+    }
+    if (height <= 576) {
+	return 0;
+    }
+    if (height <= 720) {
+	return 1;
+    }
+    if (height < 1080 || width < 1920) {
+	return 2;
+    }
+    return 3;
+}
+
+/**
+**	Apply trick play and reduced cost decode mode to the codec context.
+**
+**	The cheaper of both is used.  Changing lowres needs a reopen of the
+**	decoder, it is only changed for software decoding after the stream
+**	size is known.
+**
+**	@param decoder	video decoder data
+*/
+static void CodecVideoTrickMode(VideoDecoder * decoder)
+{
+    AVCodecContext *video_ctx;
+    enum AVDiscard skip_frame;
+    enum AVDiscard skip_loop_filter;
+    int reduced;
+
+    switch (decoder->TrickMode) {
+	case 1:
+	    skip_frame = AVDISCARD_DEFAULT;
+	    skip_loop_filter = AVDISCARD_NONREF;
+	    break;
+	case 2:
+	    skip_frame = AVDISCARD_NONREF;
+	    skip_loop_filter = AVDISCARD_ALL;
+	    break;
+	default:
+	    skip_frame = AVDISCARD_DEFAULT;
+	    skip_loop_filter = AVDISCARD_DEFAULT;
+	    break;
+    }
+    video_ctx = decoder->VideoCtx;
+
+    reduced = 0;
+    if (decoder->Reduced && video_ctx->height) {
+	reduced = CodecVideoReducedModes[CodecVideoResolution(video_ctx)];
+    }
+    if (reduced >= 1) {
+	skip_loop_filter = AVDISCARD_ALL;
+    }
+    if (reduced >= 2 && skip_frame < AVDISCARD_BIDIR) {
+	skip_frame = AVDISCARD_BIDIR;
+    }
+    if (reduced >= 3 && skip_frame < AVDISCARD_NONREF) {
+	skip_frame = AVDISCARD_NONREF;
+    }
+    if (video_ctx->skip_frame != skip_frame
+	|| video_ctx->skip_loop_filter != skip_loop_filter) {
+	Debug(3, "codec: trick mode %d skip frame %d loop filter %d\n",
+	    decoder->TrickMode, skip_frame, skip_loop_filter);
+	video_ctx->skip_frame = skip_frame;
+	video_ctx->skip_loop_filter = skip_loop_filter;
+    }
+    // lowres only for software mpeg-2
+    if (video_ctx->height && decoder->GetFormatDone
+	&& video_ctx->codec_id == AV_CODEC_ID_MPEG2VIDEO
+	&& decoder->VideoCodec->max_lowres) {
+	const AVPixFmtDescriptor *desc;
+	int lowres;
+
+	desc = av_pix_fmt_desc_get(video_ctx->pix_fmt);
+	lowres = reduced >= 2 && desc
+	    && !(desc->flags & AV_PIX_FMT_FLAG_HWACCEL);
+	if (lowres != decoder->Lowres) {
+	    decoder->Lowres = lowres;
+	    decoder->Reopen = 1;
+	}
+    }
+}
+
 /**
 **	Decode a video packet.
 **
@@ -669,29 +936,58 @@ void CodecVideoDecode(VideoDecoder * decoder, const AVPacket * avpkt)
     if (video_ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
 
     frame = decoder->Frame;
+    CodecVideoTrickMode(decoder);
+    if (decoder->Reopen) {		// lowres changed
+	goto reopen;
+    }
 
     *pkt = *avpkt;			// use copy
 
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57,37,100)
+  reopened:
     used = avcodec_send_packet(video_ctx, pkt);
-    if (used < 0 && used != AVERROR(EAGAIN) && used != AVERROR_EOF)
+    if (used < 0 && decoder->Reopen) {
+	goto reopen;
+    }
+    if (used < 0 && used != AVERROR(EAGAIN) && used != AVERROR_EOF) {
+	MetricsInc(METRIC_VIDEO_DECODE_ERRORS);
         return;
+    }
 
     while(!used) { //multiple frames
         used = avcodec_receive_frame(video_ctx, frame);
-        if (used < 0 && used != AVERROR(EAGAIN) && used != AVERROR_EOF)
+	if (used < 0 && decoder->Reopen) {
+	    goto reopen;
+	}
+        if (used < 0 && used != AVERROR(EAGAIN) && used != AVERROR_EOF) {
+	    MetricsInc(METRIC_VIDEO_DECODE_ERRORS);
             return;
+	}
         if (used>=0)
             got_frame = 1;
         else got_frame = 0;
 #else
+  reopened:
   next_part:
     used = avcodec_decode_video2(video_ctx, frame, &got_frame, pkt);
+    if (used < 0 && decoder->Reopen) {
+	goto reopen;
+    }
 #endif
     Debug(4, "%s: %p %d -> %d %d\n", __FUNCTION__, pkt->data, pkt->size, used,
 	got_frame);
+    if (got_frame) {
+	MetricsInc(METRIC_VIDEO_DECODED);
+    }
 
+    // small window: render only every second frame
+    if (got_frame && decoder->HalfRate && !decoder->FirstKeyFrame
+	&& (++decoder->FrameCounter & 1)) {
+	got_frame = 0;
+	decoder->Reused = 0;
+    }
     if (got_frame) {			// frame completed
+	decoder->Reused = 0;
 #ifdef FFMPEG_WORKAROUND_ARTIFACTS
 	if (!CodecUsePossibleDefectFrames && decoder->FirstKeyFrame) {
 	    decoder->FirstKeyFrame++;
@@ -699,6 +995,10 @@ void CodecVideoDecode(VideoDecoder * decoder, const AVPacket * avpkt)
 		Debug(3, "codec: key frame after %d frames\n",
 		    decoder->FirstKeyFrame);
 		decoder->FirstKeyFrame = 0;
+		// fast start: show the key frame itself at once
+		if (VideoFastStart) {
+		    VideoRenderFrame(decoder->HwDecoder, video_ctx, frame);
+		}
 	    }
 	} else {
 	    //DisplayPts(video_ctx, frame);
@@ -744,6 +1044,90 @@ void CodecVideoDecode(VideoDecoder * decoder, const AVPacket * avpkt)
     }
 #endif
     }
+    return;
+
+    // reused decoder got another size or profile or lowres changed,
+    // decode with a fresh one
+  reopen:
+    if (!CodecVideoReopenReused(decoder)) {
+	return;
+    }
+    video_ctx = decoder->VideoCtx;
+    frame = decoder->Frame;
+    CodecVideoTrickMode(decoder);
+    *pkt = *avpkt;
+    goto reopened;
+}
+
+/**
+**	Decode a still picture packet and drain the decoder.
+**
+**	The picture is decoded once, then all frames held back for
+**	reordering or by frame threads are received and rendered.  The
+**	decoder stays open for the following packets.
+**
+**	@param decoder	video decoder data
+**	@param avpkt	video packet with a single I-frame
+*/
+void CodecVideoDecodeStill(VideoDecoder * decoder, const AVPacket * avpkt)
+{
+    AVCodecContext *video_ctx;
+    AVFrame *frame;
+    int frames;
+
+    video_ctx = decoder->VideoCtx;
+    if (!video_ctx || !decoder->VideoCodec) {
+	return;
+    }
+    frame = decoder->Frame;
+    // a still picture is complete, it needs no key frame workaround
+    decoder->FirstKeyFrame = 0;
+
+    frames = 0;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57,37,100)
+    if (avcodec_send_packet(video_ctx, avpkt) == AVERROR(EAGAIN)) {
+	// decoder full, receive pending frames first
+	while (!avcodec_receive_frame(video_ctx, frame)) {
+	    VideoRenderFrame(decoder->HwDecoder, video_ctx, frame);
+	    av_frame_unref(frame);
+	}
+	avcodec_send_packet(video_ctx, avpkt);
+    }
+    avcodec_send_packet(video_ctx, NULL);	// enter draining mode
+    while (!avcodec_receive_frame(video_ctx, frame)) {
+	VideoRenderFrame(decoder->HwDecoder, video_ctx, frame);
+	av_frame_unref(frame);
+	++frames;
+    }
+#else
+    {
+	AVPacket pkt[1];
+	int got_frame;
+
+	*pkt = *avpkt;
+	// empty packets return the delayed frames
+	for (;;) {
+	    got_frame = 0;
+	    if (avcodec_decode_video2(video_ctx, frame, &got_frame, pkt) < 0) {
+		break;
+	    }
+	    if (got_frame) {
+		VideoRenderFrame(decoder->HwDecoder, video_ctx, frame);
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(56,28,1)
+		av_frame_unref(frame);
+#endif
+		++frames;
+	    } else if (!pkt->data) {	// drained
+		break;
+	    }
+	    pkt->data = NULL;
+	    pkt->size = 0;
+	}
+    }
+#endif
+    // leave draining mode, keep the codec open
+    avcodec_flush_buffers(video_ctx);
+    Debug(3, "codec: still picture %d frames\n", frames);
 }
 
 /**
@@ -2083,13 +2467,17 @@ void CodecAudioDecode(AudioDecoder * audio_decoder, const AVPacket * avpkt)
 //  Also now that it always consumes a whole buffer some code
 //  in the caller may be able to be optimized.
     ret = avcodec_send_packet(audio_ctx, avpkt);
-    if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+    if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+	MetricsInc(METRIC_AUDIO_DECODE_ERRORS);
         return;
+    }
 
     while (!ret) { //multiple frames
         ret = avcodec_receive_frame(audio_ctx,frame);
-        if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+        if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+	    MetricsInc(METRIC_AUDIO_DECODE_ERRORS);
             return;
+	}
         if (ret>=0)
             got_frame = 1;
         else got_frame = 0;
@@ -2099,6 +2487,7 @@ void CodecAudioDecode(AudioDecoder * audio_decoder, const AVPacket * avpkt)
     if (ret < 0) return;
 #endif
         if(got_frame) {
+            MetricsInc(METRIC_AUDIO_DECODED);
             // update audio clock
             if (avpkt->pts != (int64_t) AV_NOPTS_VALUE) {
                 CodecAudioSetClock(audio_decoder, avpkt->pts);
@@ -63,6 +63,17 @@ struct _video_decoder_
      AVCodecContext *VideoCtx;           ///< video codec context
      int FirstKeyFrame;                  ///< flag first frame
      AVFrame *Frame;                     ///< decoded video frame
+     volatile char TrickMode;            ///< trick play decode mode
+     volatile char Reduced;              ///< reduced cost decoding
+     volatile char HalfRate;             ///< render every second frame
+     char Lowres;                        ///< open mpeg-2 with lowres
+     unsigned FrameCounter;              ///< decoded frames for half rate
+     char Reused;                        ///< context reused, until first frame
+     char Reopen;                        ///< reused context needs reopen
+     int ReusedWidth;                    ///< width of the reused stream
+     int ReusedHeight;                   ///< height of the reused stream
+     int ReusedProfile;                  ///< profile of the reused stream
+     int HardwareDecoder;                ///< hw/sw decoder mode at open
 
      /* hwaccel options */
      enum HWAccelID hwaccel_id;
@@ -119,12 +130,30 @@ extern int CodecVideoOpen(VideoDecoder *, int);
     /// Close video codec.
 extern void CodecVideoClose(VideoDecoder *);
 
+    /// Open video codec for a new stream, reuse it if possible.
+extern int CodecVideoReopen(VideoDecoder *, int);
+
+    /// End video stream, keep codec open for reuse if possible.
+extern void CodecVideoEndStream(VideoDecoder *);
+
     /// Decode a video packet.
 extern void CodecVideoDecode(VideoDecoder *, const AVPacket *);
 
     /// Flush video buffers.
 extern void CodecVideoFlushBuffers(VideoDecoder *);
 
+    /// Decode still picture and drain decoder.
+extern void CodecVideoDecodeStill(VideoDecoder *, const AVPacket *);
+
+    /// Set trick play decode mode.
+extern void CodecVideoSetTrickMode(VideoDecoder *, int);
+
+    /// Set reduced cost decode modes per resolution class.
+extern void CodecSetVideoReducedModes(const int *);
+
+    /// Enable reduced cost decoding of a video decoder.
+extern void CodecVideoSetReduced(VideoDecoder *, int, int);
+
     /// Allocate a new audio decoder context.
 extern AudioDecoder *CodecAudioNewDecoder(void);
 
@@ -0,0 +1,550 @@
+///
+///	@file metrics.c	@brief Metrics registry module
+///
+///	Copyright (c) 2026 by the softhddevice contributors.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	@defgroup Metrics The metrics registry module.
+///
+///	Central registry of counters, gauges and histograms, fed from
+///	demuxer, codec, video sync, audio and osd.
+///
+///	Counters and histograms are kept in a block for each thread.  Only
+///	the owning thread writes its block, an update is a plain increment
+///	without lock.  The exporter sums the blocks of all threads.  When a
+///	thread exits, its block is kept with all values and handed to the
+///	next new thread, so counters never go backwards.  Threads which get
+///	no block update a shared block with atomic adds.
+///
+///	Gauges are single values, the last writer wins.
+///
+///	The metrics are exported in the prometheus text format.
+///
+///	Build the benchmark with 'make metrics_test'.
+///
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "metrics.h"
+
+#define METRICS_THREADS	32		///< maximal threads with own block
+#define METRICS_BUCKETS	11		///< maximal histogram buckets
+#define METRICS_PREFIX	"softhddevice_"	///< prefix of metric names
+
+    /// counters and histograms of one thread
+typedef struct _metrics_block_
+{
+    uint64_t Counters[METRIC_COUNTER_MAX];	///< counter values
+    /// observations <= bound, last bucket > all bounds
+    uint64_t Buckets[METRIC_HISTOGRAM_MAX][METRICS_BUCKETS + 1];
+    int64_t Sums[METRIC_HISTOGRAM_MAX];	///< sum of observations
+    char Free;				///< flag owner thread exited
+} MetricsBlock;
+
+    /// description of counter or gauge
+typedef struct _metrics_info_
+{
+    const char *Name;			///< name without prefix
+    const char *Help;			///< help text
+} MetricsInfo;
+
+    /// description of histogram
+typedef struct _metrics_histogram_info_
+{
+    const char *Name;			///< name without prefix
+    const char *Help;			///< help text
+    int Scale;				///< observed units per exported unit
+    int N;				///< number of bounds
+    int Bounds[METRICS_BUCKETS];	///< upper bounds, ascending
+} MetricsHistogramInfo;
+
+__thread uint64_t *MetricsThreadCounters;	///< counters of this thread
+volatile int MetricsGauges[METRIC_GAUGE_MAX];	///< gauge values
+
+static pthread_mutex_t MetricsMutex = PTHREAD_MUTEX_INITIALIZER;	///< block list lock
+static pthread_once_t MetricsOnce = PTHREAD_ONCE_INIT;	///< key init once
+static pthread_key_t MetricsKey;	///< key to release block at thread exit
+static MetricsBlock *MetricsBlocks[METRICS_THREADS];	///< blocks of all threads
+static int MetricsBlockN;		///< number of blocks
+static MetricsBlock MetricsShared;	///< block of threads without own
+static __thread MetricsBlock *MetricsThreadBlock;	///< block of this thread
+static __thread char MetricsThreadFull;	///< no block left for this thread
+
+    /// counter names and help
+static const MetricsInfo MetricsCounterInfos[METRIC_COUNTER_MAX] = {
+    {"video_packets_total", "Video packets queued for decoding."},
+    {"video_packets_dropped_total", "Video packets dropped, queue full."},
+    {"audio_packets_total", "Audio packets demuxed."},
+    {"demux_errors_total", "Invalid PES or TS packets."},
+    {"video_frames_decoded_total", "Video frames decoded."},
+    {"video_decode_errors_total", "Video decoder errors."},
+    {"audio_frames_decoded_total", "Audio frames decoded."},
+    {"audio_decode_errors_total", "Audio decoder errors."},
+    {"frames_displayed_total", "Output frames displayed."},
+    {"frames_missed_total", "Vsyncs missed by the display."},
+    {"frames_duped_total", "Video frames shown again."},
+    {"frames_dropped_total", "Video frames dropped."},
+    {"video_underruns_total", "Video output buffer ran empty."},
+    {"audio_underruns_total", "Audio ring buffer ran empty."},
+    {"audio_xruns_total", "Audio device under- or overruns."},
+    {"audio_overflows_total", "Audio samples lost, ring buffer full."},
+    {"osd_draws_total", "OSD draws of damaged areas."},
+    {"osd_flushes_total", "OSD flushes presented."},
+};
+
+    /// gauge names and help
+static const MetricsInfo MetricsGaugeInfos[METRIC_GAUGE_MAX] = {
+    {"video_packets_buffered", "Video packets waiting for the decoder."},
+    {"audio_buffered_seconds", "Audio buffered for output."},
+};
+
+    /// gauge observed units per exported unit
+static const int MetricsGaugeScales[METRIC_GAUGE_MAX] = { 1, 1000 };
+
+    /// histogram names, help and buckets
+static const MetricsHistogramInfo MetricsHistogramInfos[METRIC_HISTOGRAM_MAX]
+    = {
+    {"video_decode_seconds", "Time to decode one video packet.", 1000000,
+	9, {250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000}},
+    {"av_diff_seconds", "Video clock minus audio clock at vsync.", 1000,
+	11, {-200, -100, -50, -25, -10, 0, 10, 25, 50, 100, 200}},
+};
+
+///
+///	Release block of exiting thread for the next new thread.
+///
+///	@param block	block of exiting thread
+///
+static void MetricsThreadExit(void *block)
+{
+    pthread_mutex_lock(&MetricsMutex);
+    ((MetricsBlock *) block)->Free = 1;
+    pthread_mutex_unlock(&MetricsMutex);
+}
+
+///
+///	Create key to release blocks at thread exit.
+///
+static void MetricsKeyInit(void)
+{
+    pthread_key_create(&MetricsKey, MetricsThreadExit);
+}
+
+///
+///	Get block of calling thread, take a free or new one at first use.
+///
+///	@returns block, NULL if no block is left.
+///
+static MetricsBlock *MetricsBlockGet(void)
+{
+    MetricsBlock *block;
+    int i;
+
+    if ((block = MetricsThreadBlock) || MetricsThreadFull) {
+	return block;
+    }
+    pthread_once(&MetricsOnce, MetricsKeyInit);
+
+    pthread_mutex_lock(&MetricsMutex);
+    for (i = 0; i < MetricsBlockN; ++i) {
+	if (MetricsBlocks[i]->Free) {
+	    block = MetricsBlocks[i];
+	    block->Free = 0;
+	    break;
+	}
+    }
+    if (!block && MetricsBlockN < METRICS_THREADS
+	&& (block = calloc(1, sizeof(*block)))) {
+	MetricsBlocks[MetricsBlockN] = block;
+	__atomic_store_n(&MetricsBlockN, MetricsBlockN + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&MetricsMutex);
+
+    if (!block) {
+	MetricsThreadFull = 1;
+	return NULL;
+    }
+    pthread_setspecific(MetricsKey, block);
+    MetricsThreadBlock = block;
+    MetricsThreadCounters = block->Counters;
+
+    return block;
+}
+
+///
+///	Add to counter of calling thread, registers the thread.
+///
+///	Use #MetricsAdd and #MetricsInc, they update registered threads
+///	inline.
+///
+///	@param id	counter id (METRIC_...)
+///	@param n	value to add
+///
+void MetricsCount(int id, unsigned n)
+{
+    MetricsBlock *block;
+
+    if (!(block = MetricsBlockGet())) {
+	__atomic_fetch_add(&MetricsShared.Counters[id], n, __ATOMIC_RELAXED);
+	return;
+    }
+    __atomic_store_n(&block->Counters[id], block->Counters[id] + n,
+	__ATOMIC_RELAXED);
+}
+
+///
+///	Observe value of histogram.
+///
+///	@param id	histogram id (METRIC_...)
+///	@param value	observed value in histogram units
+///
+void MetricsObserve(int id, int value)
+{
+    const MetricsHistogramInfo *info;
+    MetricsBlock *block;
+    int i;
+
+    info = &MetricsHistogramInfos[id];
+    for (i = 0; i < info->N && value > info->Bounds[i]; ++i) {
+    }
+    if (!(block = MetricsBlockGet())) {
+	__atomic_fetch_add(&MetricsShared.Buckets[id][i], 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&MetricsShared.Sums[id], value, __ATOMIC_RELAXED);
+	return;
+    }
+    __atomic_store_n(&block->Buckets[id][i], block->Buckets[id][i] + 1,
+	__ATOMIC_RELAXED);
+    __atomic_store_n(&block->Sums[id], block->Sums[id] + value,
+	__ATOMIC_RELAXED);
+}
+
+    /// growing string buffer of the text export
+typedef struct _metrics_buffer_
+{
+    char *Data;				///< string, NULL out of memory
+    size_t Used;			///< used bytes without terminator
+    size_t Size;			///< allocated bytes
+} MetricsBuffer;
+
+///
+///	Append formatted text to export buffer.
+///
+///	@param buffer	export buffer
+///	@param fmt	printf format
+///
+static void MetricsPrintf(MetricsBuffer * buffer, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    if (!buffer->Data) {
+	return;
+    }
+    for (;;) {
+	va_start(ap, fmt);
+	n = vsnprintf(buffer->Data + buffer->Used, buffer->Size - buffer->Used,
+	    fmt, ap);
+	va_end(ap);
+	if (n < 0) {
+	    return;
+	}
+	if (buffer->Used + n < buffer->Size) {
+	    buffer->Used += n;
+	    return;
+	}
+	buffer->Size = (buffer->Used + n + 1) * 2;
+	if (!(buffer->Data = realloc(buffer->Data, buffer->Size))) {
+	    return;
+	}
+    }
+}
+
+///
+///	Add values of one block to the export sums.
+///
+///	@param[in,out] sum	sums of all blocks
+///	@param block		block of one thread
+///
+static void MetricsSum(MetricsBlock * sum, MetricsBlock * block)
+{
+    int i;
+    int j;
+
+    for (i = 0; i < METRIC_COUNTER_MAX; ++i) {
+	sum->Counters[i] +=
+	    __atomic_load_n(&block->Counters[i], __ATOMIC_RELAXED);
+    }
+    for (i = 0; i < METRIC_HISTOGRAM_MAX; ++i) {
+	for (j = 0; j <= METRICS_BUCKETS; ++j) {
+	    sum->Buckets[i][j] +=
+		__atomic_load_n(&block->Buckets[i][j], __ATOMIC_RELAXED);
+	}
+	sum->Sums[i] += __atomic_load_n(&block->Sums[i], __ATOMIC_RELAXED);
+    }
+}
+
+///
+///	Export all metrics in prometheus text format.
+///
+///	Can be called from any thread, while the metrics are updated.  A
+///	histogram can be off by the observations made while exporting.
+///
+///	@returns malloced text, must be freed by the caller, NULL if out
+///	of memory.
+///
+char *MetricsExport(void)
+{
+    MetricsBuffer buffer;
+    MetricsBlock *sum;
+    int n;
+    int i;
+    int j;
+
+    if (!(sum = calloc(1, sizeof(*sum)))) {
+	return NULL;
+    }
+    n = __atomic_load_n(&MetricsBlockN, __ATOMIC_ACQUIRE);
+    for (i = 0; i < n; ++i) {
+	MetricsSum(sum, MetricsBlocks[i]);
+    }
+    MetricsSum(sum, &MetricsShared);
+
+    buffer.Used = 0;
+    buffer.Size = 8 * 1024;
+    if ((buffer.Data = malloc(buffer.Size))) {
+	buffer.Data[0] = '\0';
+    }
+
+    for (i = 0; i < METRIC_COUNTER_MAX; ++i) {
+	const MetricsInfo *info;
+
+	info = &MetricsCounterInfos[i];
+	MetricsPrintf(&buffer,
+	    "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX
+	    "%s counter\n" METRICS_PREFIX "%s %" PRIu64 "\n", info->Name,
+	    info->Help, info->Name, info->Name, sum->Counters[i]);
+    }
+    for (i = 0; i < METRIC_GAUGE_MAX; ++i) {
+	const MetricsInfo *info;
+
+	info = &MetricsGaugeInfos[i];
+	MetricsPrintf(&buffer,
+	    "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX
+	    "%s gauge\n" METRICS_PREFIX "%s %g\n", info->Name, info->Help,
+	    info->Name, info->Name,
+	    (double)MetricsGauges[i] / MetricsGaugeScales[i]);
+    }
+    for (i = 0; i < METRIC_HISTOGRAM_MAX; ++i) {
+	const MetricsHistogramInfo *info;
+	uint64_t count;
+
+	info = &MetricsHistogramInfos[i];
+	MetricsPrintf(&buffer,
+	    "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX
+	    "%s histogram\n", info->Name, info->Help, info->Name);
+	count = 0;
+	for (j = 0; j < info->N; ++j) {
+	    count += sum->Buckets[i][j];
+	    MetricsPrintf(&buffer,
+		METRICS_PREFIX "%s_bucket{le=\"%g\"} %" PRIu64 "\n",
+		info->Name, (double)info->Bounds[j] / info->Scale, count);
+	}
+	count += sum->Buckets[i][j];
+	MetricsPrintf(&buffer,
+	    METRICS_PREFIX "%s_bucket{le=\"+Inf\"} %" PRIu64 "\n"
+	    METRICS_PREFIX "%s_sum %.6f\n" METRICS_PREFIX "%s_count %" PRIu64
+	    "\n", info->Name, count, info->Name,
+	    (double)sum->Sums[i] / info->Scale, info->Name, count);
+    }
+
+    free(sum);
+    return buffer.Data;
+}
+
+#ifdef METRICS_TEST
+
+//----------------------------------------------------------------------------
+//	Benchmark
+//----------------------------------------------------------------------------
+
+#include <getopt.h>
+#include <time.h>
+
+static int BenchUpdates;		///< updates per writer thread
+
+///
+///	Monotonic time in ns.
+///
+static int64_t BenchTime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+}
+
+///
+///	Writer thread, counts frames like the video thread.
+///
+static void *BenchWriter(void *arg)
+{
+    int i;
+
+    for (i = 0; i < BenchUpdates; ++i) {
+	MetricsInc(METRIC_FRAMES_DISPLAYED);
+    }
+    MetricsObserve(METRIC_AV_DIFF, -300);
+    return arg;
+}
+
+///
+///	Get exported value of metric.
+///
+static uint64_t BenchValue(const char *text, const char *name)
+{
+    char key[128];
+    const char *s;
+
+    snprintf(key, sizeof(key), "\n" METRICS_PREFIX "%s ", name);
+    if (!(s = strstr(text, key))) {
+	return 0;
+    }
+    return strtoull(s + strlen(key), NULL, 10);
+}
+
+///
+///	Print usage.
+///
+static void PrintUsage(void)
+{
+    printf("Usage: metrics_test [-?h] [-n updates] [-t threads]\n"
+	"\t-n updates\tupdates per thread (default 10000000)\n"
+	"\t-t threads\twriter threads, more than blocks use the shared one"
+	" (default 4)\n");
+}
+
+///
+///	Main entry point.
+///
+int main(int argc, char *const argv[])
+{
+    pthread_t threads[2 * METRICS_THREADS];
+    int64_t start;
+    int64_t t;
+    char *text;
+    uint64_t expected;
+    int thread_n;
+    int exports;
+    int failed;
+    int i;
+
+    BenchUpdates = 10000000;
+    thread_n = 4;
+    for (;;) {
+	switch (getopt(argc, argv, "hn:t:")) {
+	    case 'n':
+		BenchUpdates = strtol(optarg, NULL, 0);
+		continue;
+	    case 't':
+		thread_n = strtol(optarg, NULL, 0);
+		continue;
+	    case EOF:
+		break;
+	    case 'h':
+	    default:
+		PrintUsage();
+		return 0;
+	}
+	break;
+    }
+    if (thread_n < 1 || thread_n > 2 * METRICS_THREADS) {
+	thread_n = 4;
+    }
+    failed = 0;
+
+    start = BenchTime();
+    BenchWriter(NULL);
+    t = BenchTime() - start;
+    printf("%-10s %8.2f ns/update\n", "counter", t / (double)BenchUpdates);
+
+    start = BenchTime();
+    for (i = 0; i < BenchUpdates; ++i) {
+	MetricsObserve(METRIC_DECODE_TIME, i & 0xFFFF);
+    }
+    t = BenchTime() - start;
+    printf("%-10s %8.2f ns/update\n", "histogram", t / (double)BenchUpdates);
+
+    // concurrent writers while exporting, each round exits all threads
+    // and reuses their blocks
+    exports = 0;
+    start = BenchTime();
+    for (i = 0; i < thread_n; ++i) {
+	pthread_create(&threads[i], NULL, BenchWriter, NULL);
+    }
+    for (i = 0; i < 10; ++i) {
+	text = MetricsExport();
+	failed |= !text;
+	if (text) {
+	    ++exports;
+	    free(text);
+	}
+    }
+    for (i = 0; i < thread_n; ++i) {
+	pthread_join(threads[i], NULL);
+    }
+    for (i = 0; i < thread_n; ++i) {
+	pthread_create(&threads[i], NULL, BenchWriter, NULL);
+    }
+    for (i = 0; i < thread_n; ++i) {
+	pthread_join(threads[i], NULL);
+    }
+    t = BenchTime() - start;
+    printf("%-10s %8.2f ms for %d exports while %d threads write\n",
+	"export", t / 1000000.0, exports, thread_n);
+
+    text = MetricsExport();
+    expected = (uint64_t) BenchUpdates *(1 + 2 * thread_n);
+    if (!text || BenchValue(text, "frames_displayed_total") != expected) {
+	printf("export has %" PRIu64 " frames, expected %" PRIu64 "\n",
+	    text ? BenchValue(text, "frames_displayed_total") : 0, expected);
+	failed = 1;
+    }
+    if (!text || BenchValue(text, "av_diff_seconds_count") != 1 + 2 * (uint64_t)
+	thread_n) {
+	printf("export has wrong histogram count\n");
+	failed = 1;
+    }
+    if (thread_n <= 4 && text) {
+	fputs(text, stdout);
+    }
+    free(text);
+    printf("%d blocks\n", MetricsBlockN);
+
+    return failed;
+}
+
+#endif
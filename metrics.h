@@ -0,0 +1,123 @@
+///
+///	@file metrics.h	@brief Metrics registry module header file
+///
+///	Copyright (c) 2026 by the softhddevice contributors.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+/// @addtogroup Metrics
+/// @{
+
+    /// counters, only increase
+enum MetricCounters
+{
+    METRIC_VIDEO_PACKETS,		///< video packets queued for decoding
+    METRIC_VIDEO_PACKETS_DROPPED,	///< video packets dropped, queue full
+    METRIC_AUDIO_PACKETS,		///< audio packets demuxed
+    METRIC_DEMUX_ERRORS,		///< invalid pes or ts packets
+    METRIC_VIDEO_DECODED,		///< video frames decoded
+    METRIC_VIDEO_DECODE_ERRORS,		///< video decoder errors
+    METRIC_AUDIO_DECODED,		///< audio frames decoded
+    METRIC_AUDIO_DECODE_ERRORS,		///< audio decoder errors
+    METRIC_FRAMES_DISPLAYED,		///< output frames displayed
+    METRIC_FRAMES_MISSED,		///< vsyncs missed by the display
+    METRIC_FRAMES_DUPED,		///< video frames shown again
+    METRIC_FRAMES_DROPPED,		///< video frames dropped
+    METRIC_VIDEO_UNDERRUNS,		///< video output buffer ran empty
+    METRIC_AUDIO_UNDERRUNS,		///< audio ring buffer ran empty
+    METRIC_AUDIO_XRUNS,			///< audio device under- or overruns
+    METRIC_AUDIO_OVERFLOWS,		///< audio samples lost, ring full
+    METRIC_OSD_DRAWS,			///< osd draws of damaged areas
+    METRIC_OSD_FLUSHES,			///< osd flushes presented
+    METRIC_COUNTER_MAX
+};
+
+    /// gauges, last set value
+enum MetricGauges
+{
+    METRIC_VIDEO_PACKETS_BUFFERED,	///< video packets waiting for decoder
+    METRIC_AUDIO_BUFFERED,		///< audio buffered in ms
+    METRIC_GAUGE_MAX
+};
+
+    /// histograms, distribution of observed values
+enum MetricHistograms
+{
+    METRIC_DECODE_TIME,			///< video packet decode time in us
+    METRIC_AV_DIFF,			///< video - audio clock in ms
+    METRIC_HISTOGRAM_MAX
+};
+
+    /// counters of this thread, NULL not yet registered
+extern __thread uint64_t *MetricsThreadCounters;
+
+    /// gauge values
+extern volatile int MetricsGauges[METRIC_GAUGE_MAX];
+
+    /// add to counter of calling thread, registers the thread
+extern void MetricsCount(int, unsigned);
+
+    /// observe value of histogram
+extern void MetricsObserve(int, int);
+
+    /// export all metrics in prometheus text format
+extern char *MetricsExport(void);
+
+///
+///	Add to counter.
+///
+///	Only the calling thread writes its counters, no lock or atomic
+///	read-modify-write is needed.
+///
+///	@param id	counter id (METRIC_...)
+///	@param n	value to add
+///
+static inline void MetricsAdd(int id, unsigned n)
+{
+    uint64_t *counters;
+
+    if ((counters = MetricsThreadCounters)) {
+	// relaxed store: the exporter can't see torn values
+	__atomic_store_n(&counters[id], counters[id] + n, __ATOMIC_RELAXED);
+	return;
+    }
+    MetricsCount(id, n);
+}
+
+///
+///	Increment counter.
+///
+///	@param id	counter id (METRIC_...)
+///
+static inline void MetricsInc(int id)
+{
+    MetricsAdd(id, 1);
+}
+
+///
+///	Set gauge.
+///
+///	@param id	gauge id (METRIC_...)
+///	@param value	new value
+///
+static inline void MetricsSet(int id, int value)
+{
+    MetricsGauges[id] = value;
+}
+
+/// @}
@@ -1,6 +1,7 @@
 #define __STL_CONFIG_H
 #include <algorithm>
 #include "openglosd.h"
+#include "softhddevice.h"
 
 extern "C"
 {
@@ -27,8 +28,8 @@ const char *rectVertexShader =
 "#version 330 core \n\
 \
 layout (location = 0) in vec2 position; \
+layout (location = 1) in vec4 inColor; \
 out vec4 rectCol; \
-uniform vec4 inColor; \
 uniform mat4 projection; \
 \
 void main() \
@@ -234,7 +235,6 @@ bool cShader::CheckCompileErrors(GLuint object, bool program) {
     return true;
 }
 
-#define KERNING_UNKNOWN  (-10000)
 /****************************************************************************************
 * cOglGlyph
 ****************************************************************************************/
@@ -245,52 +245,20 @@ cOglGlyph::cOglGlyph(uint charCode, FT_BitmapGlyph ftGlyph) {
     width = ftGlyph->bitmap.width;
     height = ftGlyph->bitmap.rows;
     advanceX = ftGlyph->root.advance.x >> 16;   //value in 1/2^16 pixel
-    LoadTexture(ftGlyph);
+    page = -1;
+    texX1 = texY1 = texX2 = texY2 = 0.0f;
 }
 
 cOglGlyph::~cOglGlyph(void) {
 
 }
 
-int cOglGlyph::GetKerningCache(uint prevSym) {
-    for (int i = kerningCache.Size(); --i > 0; ) {
-        if (kerningCache[i].prevSym == prevSym)
-            return kerningCache[i].kerning;
-    }
-    return KERNING_UNKNOWN;
-}
-
-void cOglGlyph::SetKerningCache(uint prevSym, int kerning) {
-    kerningCache.Append(tKerning(prevSym, kerning));
-}
-
-void cOglGlyph::BindTexture(void) {
-    glBindTexture(GL_TEXTURE_2D, texture);
-}
-
-void cOglGlyph::LoadTexture(FT_BitmapGlyph ftGlyph) {
-    // Disable byte-alignment restriction
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RED,
-        ftGlyph->bitmap.width,
-        ftGlyph->bitmap.rows,
-        0,
-        GL_RED,
-        GL_UNSIGNED_BYTE,
-        ftGlyph->bitmap.buffer
-    );
-    // Set texture options
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+void cOglGlyph::SetAtlas(int page, GLfloat x1, GLfloat y1, GLfloat x2, GLfloat y2) {
+    this->page = page;
+    texX1 = x1;
+    texY1 = y1;
+    texX2 = x2;
+    texY2 = y2;
 }
 
 
@@ -305,6 +273,9 @@ cOglFont::cOglFont(const char *fontName, int charHeight) : name(fontName) {
     size = charHeight;
     height = 0;
     bottom = 0;
+    atlasX = 0;
+    atlasY = 0;
+    atlasRowHeight = 0;
 
     int error = FT_New_Face(ftLib, fontName, 0, &face);
     if (error)
@@ -317,6 +288,8 @@ cOglFont::cOglFont(const char *fontName, int charHeight) : name(fontName) {
 
 cOglFont::~cOglFont(void) {
     FT_Done_Face(face);
+    if (!atlasPages.empty())
+        glDeleteTextures(atlasPages.size(), &atlasPages[0]);
 }
 
 cOglFont *cOglFont::Get(const char *name, int charHeight) {
@@ -359,11 +332,9 @@ cOglGlyph* cOglFont::Glyph(uint charCode) const {
         charCode = 0x20;
 
     // Lookup in cache:
-    for (cOglGlyph *g = glyphCache.First(); g; g = glyphCache.Next(g)) {
-        if (g->CharCode() == charCode) {
-            return g;
-        }
-    }
+    std::unordered_map<uint, cOglGlyph *>::const_iterator it = glyphIndex.find(charCode);
+    if (it != glyphIndex.end())
+        return it->second;
 
     FT_UInt glyph_index = FT_Get_Char_Index(face, charCode);
 
@@ -410,24 +381,84 @@ cOglGlyph* cOglFont::Glyph(uint charCode) const {
     }
 
     cOglGlyph *Glyph = new cOglGlyph(charCode, (FT_BitmapGlyph)ftGlyph);
+    AddToAtlas(Glyph, (FT_BitmapGlyph)ftGlyph);
     glyphCache.Add(Glyph);
+    glyphIndex[charCode] = Glyph;
     FT_Done_Glyph(ftGlyph);
 
     return Glyph;
 }
 
+void cOglFont::AddToAtlas(cOglGlyph *glyph, FT_BitmapGlyph ftGlyph) const {
+    int w = ftGlyph->bitmap.width;
+    int h = ftGlyph->bitmap.rows;
+
+    if (!w || !h)   // blank, nothing to draw
+        return;
+    // one texel gap against bleeding of the linear filter
+    if (w + 1 >= OGL_ATLAS_SIZE || h + 1 >= OGL_ATLAS_SIZE) {
+        esyslog("[softhddev]ERROR: glyph %x too big for atlas", glyph->CharCode());
+        return;
+    }
+    if (atlasX + w + 1 > OGL_ATLAS_SIZE) {  // next row
+        atlasX = 0;
+        atlasY += atlasRowHeight;
+        atlasRowHeight = 0;
+    }
+    if (atlasPages.empty() || atlasY + h + 1 > OGL_ATLAS_SIZE) {  // next page
+        GLuint texture;
+        void *zero = calloc(OGL_ATLAS_SIZE, OGL_ATLAS_SIZE);
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, OGL_ATLAS_SIZE, OGL_ATLAS_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, zero);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        free(zero);
+        atlasPages.push_back(texture);
+        atlasX = 0;
+        atlasY = 0;
+        atlasRowHeight = 0;
+    } else {
+        glBindTexture(GL_TEXTURE_2D, atlasPages.back());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, ftGlyph->bitmap.pitch);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, atlasX, atlasY, w, h, GL_RED, GL_UNSIGNED_BYTE, ftGlyph->bitmap.buffer);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glyph->SetAtlas(atlasPages.size() - 1,
+                    (GLfloat)atlasX / OGL_ATLAS_SIZE, (GLfloat)atlasY / OGL_ATLAS_SIZE,
+                    (GLfloat)(atlasX + w) / OGL_ATLAS_SIZE, (GLfloat)(atlasY + h) / OGL_ATLAS_SIZE);
+    atlasX += w + 1;
+    if (h + 1 > atlasRowHeight)
+        atlasRowHeight = h + 1;
+}
+
+void cOglFont::BindAtlas(int page) const {
+    glBindTexture(GL_TEXTURE_2D, atlasPages[page]);
+}
+
 int cOglFont::Kerning(cOglGlyph *glyph, uint prevSym) const {
     int kerning = 0;
     if (glyph && prevSym) {
-        kerning = glyph->GetKerningCache(prevSym);
-        if (kerning == KERNING_UNKNOWN) {
-            FT_Vector delta;
-            FT_UInt glyph_index = FT_Get_Char_Index(face, glyph->CharCode());
-            FT_UInt glyph_index_prev = FT_Get_Char_Index(face, prevSym);
-            FT_Get_Kerning(face, glyph_index_prev, glyph_index, FT_KERNING_DEFAULT, &delta);
-            kerning = delta.x / 64;
-            glyph->SetKerningCache(prevSym, kerning);
-        }
+        uint64_t key = ((uint64_t)prevSym << 32) | glyph->CharCode();
+        std::unordered_map<uint64_t, int>::const_iterator it = kerningCache.find(key);
+        if (it != kerningCache.end())
+            return it->second;
+
+        FT_Vector delta;
+        FT_UInt glyph_index = FT_Get_Char_Index(face, glyph->CharCode());
+        FT_UInt glyph_index_prev = FT_Get_Char_Index(face, prevSym);
+        FT_Get_Kerning(face, glyph_index_prev, glyph_index, FT_KERNING_DEFAULT, &delta);
+        kerning = delta.x / 64;
+        kerningCache[key] = kerning;
     }
     return kerning;
 }
@@ -610,6 +641,7 @@ cOglVb::cOglVb(int type) {
     sizeVertex1 = 0;
     sizeVertex2 = 0;
     numVertices = 0;
+    maxVertices = 0;
     drawMode = 0;
 }
 
@@ -626,25 +658,11 @@ bool cOglVb::Init(void) {
         drawMode = GL_TRIANGLES;
         shader = stTexture;
     } else if (type == vbRect) {
-        //Rectangle VBO definition
+        //Rectangle, ellipse and slope VBO definition, position and color
         sizeVertex1 = 2;
-        sizeVertex2 = 0;
-        numVertices = 4;
-        drawMode = GL_TRIANGLE_FAN;
-        shader = stRect;
-    } else if (type == vbEllipse) {
-        //Ellipse VBO definition
-        sizeVertex1 = 2;
-        sizeVertex2 = 0;
-        numVertices = 182;
-        drawMode = GL_TRIANGLE_FAN;
-        shader = stRect;
-    } else if (type == vbSlope) {
-        //Slope VBO definition
-        sizeVertex1 = 2;
-        sizeVertex2 = 0;
-        numVertices = 102;
-        drawMode = GL_TRIANGLE_FAN;
+        sizeVertex2 = 4;
+        numVertices = 1024;
+        drawMode = GL_TRIANGLES;
         shader = stRect;
     } else if (type == vbText) {
         //Text VBO definition
@@ -660,6 +678,7 @@ bool cOglVb::Init(void) {
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
     glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * (sizeVertex1 + sizeVertex2) * numVertices, NULL, GL_DYNAMIC_DRAW);
+    maxVertices = numVertices;
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, sizeVertex1, GL_FLOAT, GL_FALSE, (sizeVertex1 + sizeVertex2) * sizeof(GLfloat), (GLvoid*)0);
@@ -714,7 +733,11 @@ void cOglVb::SetVertexData(GLfloat *vertices, int count) {
     if (count == 0)
         count = numVertices;
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLfloat) * (sizeVertex1 + sizeVertex2) * count, vertices);
+    if (count > maxVertices) {  // grow buffer, f.e. for batched text
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * (sizeVertex1 + sizeVertex2) * count, vertices, GL_DYNAMIC_DRAW);
+        maxVertices = count;
+    } else
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLfloat) * (sizeVertex1 + sizeVertex2) * count, vertices);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
@@ -726,6 +749,265 @@ void cOglVb::DrawArrays(int count) {
 }
 
 
+/****************************************************************************************
+* cOglPrimitives
+****************************************************************************************/
+#define OGL_MAX_TESSELLATIONS 1024
+#define OGL_PRIMITIVE_FLOATS 6          // x, y, r, g, b, a
+
+enum ePrimitiveKind {
+    pkEllipse,
+    pkSlope
+};
+
+cOglFb *cOglPrimitives::fb = NULL;
+std::vector<GLfloat> cOglPrimitives::vertices;
+std::unordered_map<uint64_t, std::vector<GLfloat>> cOglPrimitives::tessellations;
+unsigned int cOglPrimitives::primitives = 0;
+unsigned int cOglPrimitives::batches = 0;
+
+// triangle fan, first vertex is the center, relative to the left top corner
+static void EllipseFan(std::vector<GLfloat> &fan, GLint width, GLint height, GLint quadrants) {
+    GLfloat radiusX = (GLfloat)width;
+    GLfloat radiusY = (GLfloat)height;
+    GLfloat centerX = 0.0f;
+    GLfloat centerY = 0.0f;
+    GLfloat transX = 0.0f;
+    GLfloat transY = 0.0f;
+    GLint startAngle = 0;
+    int steps = 45;
+
+    switch (quadrants) {
+        case 0:
+            radiusX = (GLfloat)width / 2;
+            radiusY = (GLfloat)height / 2;
+            centerX = transX = radiusX;
+            centerY = transY = radiusY;
+            steps = 180;
+            break;
+        case 1:
+            centerY = height;
+            transY = radiusY;
+            break;
+        case 2:
+            centerX = width;
+            centerY = height;
+            transX = radiusX;
+            transY = radiusY;
+            startAngle = 90;
+            break;
+        case 3:
+            centerX = width;
+            transX = radiusX;
+            startAngle = 180;
+            break;
+        case 4:
+            startAngle = 270;
+            break;
+        case -1:
+            centerX = width;
+            transY = radiusY;
+            break;
+        case -2:
+            transX = radiusX;
+            transY = radiusY;
+            startAngle = 90;
+            break;
+        case -3:
+            centerY = height;
+            transX = radiusX;
+            startAngle = 180;
+            break;
+        case -4:
+            centerX = width;
+            centerY = height;
+            startAngle = 270;
+            break;
+        case 5:
+            radiusY = (GLfloat)height / 2;
+            centerY = transY = radiusY;
+            startAngle = 270;
+            steps = 90;
+            break;
+        case 6:
+            radiusX = (GLfloat)width / 2;
+            centerX = transX = radiusX;
+            centerY = transY = radiusY;
+            steps = 90;
+            break;
+        case 7:
+            radiusY = (GLfloat)height / 2;
+            centerX = transX = radiusX;
+            centerY = transY = radiusY;
+            startAngle = 90;
+            steps = 90;
+            break;
+        case 8:
+            radiusX = (GLfloat)width / 2;
+            centerX = transX = radiusX;
+            startAngle = 180;
+            steps = 90;
+            break;
+        default:
+            return;
+    }
+    fan.push_back(centerX);
+    fan.push_back(centerY);
+    for (int i = 0; i <= steps; i++) {
+        fan.push_back(transX + (GLfloat)cos((2*i + startAngle) * M_PI / 180.0f) * radiusX);
+        fan.push_back(transY - (GLfloat)sin((2*i + startAngle) * M_PI / 180.0f) * radiusY);
+    }
+}
+
+///type:
+///< 0: horizontal, rising,  lower
+///< 1: horizontal, rising,  upper
+///< 2: horizontal, falling, lower
+///< 3: horizontal, falling, upper
+///< 4: vertical,   rising,  lower
+///< 5: vertical,   rising,  upper
+///< 6: vertical,   falling, lower
+///< 7: vertical,   falling, upper
+static void SlopeFan(std::vector<GLfloat> &fan, GLint width, GLint height, GLint type) {
+    bool falling  = type & 0x02;
+    bool vertical = type & 0x04;
+
+    int steps = 100;
+    if (width < 100)
+        steps = 25;
+
+    switch (type) {
+        case 0: case 4:
+            fan.push_back((GLfloat)width);
+            fan.push_back((GLfloat)height);
+            break;
+        case 1: case 5:
+            fan.push_back(0.0f);
+            fan.push_back(0.0f);
+            break;
+        case 2: case 6:
+            fan.push_back(0.0f);
+            fan.push_back((GLfloat)height);
+            break;
+        case 3: case 7:
+            fan.push_back((GLfloat)width);
+            fan.push_back(0.0f);
+            break;
+        default:
+            fan.push_back(0.0f);
+            fan.push_back(0.0f);
+            break;
+    }
+
+    for (int i = 0; i <= steps; i++) {
+        GLfloat c = cos(i * M_PI / steps);
+        if (falling)
+            c = -c;
+        if (vertical) {
+            fan.push_back((GLfloat)width / 2.0f + (GLfloat)width * c / 2.0f);
+            fan.push_back((GLfloat)i * ((GLfloat)height) / steps);
+        } else {
+            fan.push_back((GLfloat)i * ((GLfloat)width) / steps);
+            fan.push_back((GLfloat)height / 2.0f + (GLfloat)height * c / 2.0f);
+        }
+    }
+}
+
+// cached triangle list of a shape, relative to its left top corner
+const std::vector<GLfloat> &cOglPrimitives::Tessellation(int kind, GLint width, GLint height, GLint param) {
+    uint64_t key = (uint64_t)kind << 56 | (uint64_t)(param & 0xFF) << 48
+        | (uint64_t)(width & 0xFFFFFF) << 24 | (uint64_t)(height & 0xFFFFFF);
+
+    auto it = tessellations.find(key);
+    if (it != tessellations.end())
+        return it->second;
+
+    if (tessellations.size() >= OGL_MAX_TESSELLATIONS)
+        tessellations.clear();
+
+    std::vector<GLfloat> fan;
+    if (kind == pkEllipse)
+        EllipseFan(fan, width, height, param);
+    else
+        SlopeFan(fan, width, height, param);
+
+    //triangle fans can't be concatenated, convert to a triangle list
+    std::vector<GLfloat> &triangles = tessellations[key];
+    int n = fan.size() / 2;
+    for (int i = 1; i + 1 < n; i++) {
+        triangles.insert(triangles.end(), fan.begin(), fan.begin() + 2);
+        triangles.insert(triangles.end(), fan.begin() + 2 * i, fan.begin() + 2 * i + 4);
+    }
+    return triangles;
+}
+
+void cOglPrimitives::Add(cOglFb *fb, const std::vector<GLfloat> &triangles, GLfloat x, GLfloat y, GLint color) {
+    if (fb != cOglPrimitives::fb)
+        Flush();
+    cOglPrimitives::fb = fb;
+
+    glm::vec4 col;
+    ConvertColor(color, col);
+    for (size_t i = 0; i + 1 < triangles.size(); i += 2) {
+        GLfloat vertex[OGL_PRIMITIVE_FLOATS] = { x + triangles[i], y + triangles[i + 1], col.r, col.g, col.b, col.a };
+        vertices.insert(vertices.end(), vertex, vertex + OGL_PRIMITIVE_FLOATS);
+    }
+    primitives++;
+}
+
+void cOglPrimitives::AddRectangle(cOglFb *fb, GLint x, GLint y, GLint width, GLint height, GLint color) {
+    GLfloat x2 = width;
+    GLfloat y2 = height;
+    const std::vector<GLfloat> triangles = {
+        0.0f, 0.0f,    //left top
+        x2, 0.0f,      //right top
+        x2, y2,        //right bottom
+
+        0.0f, 0.0f,    //left top
+        x2, y2,        //right bottom
+        0.0f, y2       //left bottom
+    };
+    Add(fb, triangles, x, y, color);
+}
+
+void cOglPrimitives::AddEllipse(cOglFb *fb, GLint x, GLint y, GLint width, GLint height, GLint color, GLint quadrants) {
+    Add(fb, Tessellation(pkEllipse, width, height, quadrants), x, y, color);
+}
+
+void cOglPrimitives::AddSlope(cOglFb *fb, GLint x, GLint y, GLint width, GLint height, GLint color, GLint type) {
+    Add(fb, Tessellation(pkSlope, width, height, type), x, y, color);
+}
+
+// draw the collected primitives, called before any other command is executed
+void cOglPrimitives::Flush(void) {
+    if (!fb)
+        return;
+    int count = vertices.size() / OGL_PRIMITIVE_FLOATS;
+    if (count) {
+        VertexBuffers[vbRect]->ActivateShader();
+        VertexBuffers[vbRect]->SetShaderProjectionMatrix(fb->Width(), fb->Height());
+
+        //not antialiased
+        fb->Bind();
+        VertexBuffers[vbRect]->DisableBlending();
+        VertexBuffers[vbRect]->Bind();
+        VertexBuffers[vbRect]->SetVertexData(vertices.data(), count);
+        VertexBuffers[vbRect]->DrawArrays(count);
+        VertexBuffers[vbRect]->Unbind();
+        VertexBuffers[vbRect]->EnableBlending();
+        fb->Unbind();
+        batches++;
+    }
+    vertices.clear();
+    fb = NULL;
+}
+
+void cOglPrimitives::Cleanup(void) {
+    vertices.clear();
+    fb = NULL;
+    tessellations.clear();
+}
+
 /****************************************************************************************
 * cOpenGLCmd
 ****************************************************************************************/
@@ -763,13 +1045,18 @@ bool cOglCmdDeleteFb::Execute(void) {
 }
 
 //------------------ cOglCmdRenderFbToBufferFb --------------------
-cOglCmdRenderFbToBufferFb::cOglCmdRenderFbToBufferFb(cOglFb *fb, cOglFb *buffer, GLint x, GLint y, GLint transparency, GLint drawPortX, GLint drawPortY) : cOglCmd(fb) {
+cOglCmdRenderFbToBufferFb::cOglCmdRenderFbToBufferFb(cOglFb *fb, cOglFb *buffer, GLint x, GLint y, GLint transparency, GLint drawPortX, GLint drawPortY,
+                                                     GLint clipX, GLint clipY, GLint clipWidth, GLint clipHeight) : cOglCmd(fb) {
     this->buffer = buffer;
     this->x = (GLfloat)x;
     this->y = (GLfloat)y;
     this->drawPortX = (GLfloat)drawPortX;
     this->drawPortY = (GLfloat)drawPortY;
     this->transparency = transparency;
+    this->clipX = clipX;
+    this->clipY = clipY;
+    this->clipWidth = clipWidth;
+    this->clipHeight = clipHeight;
 }
 
 bool cOglCmdRenderFbToBufferFb::Execute(void) {
@@ -789,15 +1076,39 @@ bool cOglCmdRenderFbToBufferFb::Execute(void) {
         texY2 = texY1 + pageHeight;
     }
 
+    GLfloat x1 = x;
+    GLfloat y1 = y;
+    //only render the part inside the clip area, texture coordinates are linear
+    if (clipWidth > 0 && clipHeight > 0) {
+        GLfloat cx1 = std::max(x1, (GLfloat)clipX);
+        GLfloat cy1 = std::max(y1, (GLfloat)clipY);
+        GLfloat cx2 = std::min(x2, (GLfloat)(clipX + clipWidth));
+        GLfloat cy2 = std::min(y2, (GLfloat)(clipY + clipHeight));
+        if (cx1 >= cx2 || cy1 >= cy2)
+            return true;
+        GLfloat tx1 = texX1 + (cx1 - x1) / (x2 - x1) * (texX2 - texX1);
+        GLfloat tx2 = texX1 + (cx2 - x1) / (x2 - x1) * (texX2 - texX1);
+        GLfloat ty2 = texY2 + (cy1 - y1) / (y2 - y1) * (texY1 - texY2);
+        GLfloat ty1 = texY2 + (cy2 - y1) / (y2 - y1) * (texY1 - texY2);
+        x1 = cx1;
+        y1 = cy1;
+        x2 = cx2;
+        y2 = cy2;
+        texX1 = tx1;
+        texX2 = tx2;
+        texY1 = ty1;
+        texY2 = ty2;
+    }
+
     GLfloat quadVertices[] = {
         // Pos    // TexCoords
-        x ,  y ,  texX1, texY2,          //left top
-        x ,  y2,  texX1, texY1,          //left bottom
+        x1,  y1,  texX1, texY2,          //left top
+        x1,  y2,  texX1, texY1,          //left bottom
         x2,  y2,  texX2, texY1,          //right bottom
 
-        x ,  y ,  texX1, texY2,          //left top
+        x1,  y1,  texX1, texY2,          //left top
         x2,  y2,  texX2, texY1,          //right bottom
-        x2,  y ,  texX2, texY2           //right top
+        x2,  y1,  texX2, texY2           //right top
     };
 
     VertexBuffers[vbTexture]->ActivateShader();
@@ -816,25 +1127,158 @@ bool cOglCmdRenderFbToBufferFb::Execute(void) {
     return true;
 }
 
+//------------------ cOglCmdCopyFb --------------------
+cOglFb *cOglCmdCopyFb::scratch = NULL;
+
+cOglCmdCopyFb::cOglCmdCopyFb(cOglFb *fb, cOglFb *source, GLint sx, GLint sy, GLint width, GLint height, GLint dx, GLint dy, GLint alpha) : cOglCmd(fb) {
+    this->source = source;
+    this->sx = sx;
+    this->sy = sy;
+    this->width = width;
+    this->height = height;
+    this->dx = dx;
+    this->dy = dy;
+    this->alpha = alpha;
+}
+
+cOglFb *cOglCmdCopyFb::Scratch(GLint width, GLint height) {
+    if (scratch) {
+        if (scratch->Width() >= width && scratch->Height() >= height)
+            return scratch;
+        width = std::max(width, scratch->Width());
+        height = std::max(height, scratch->Height());
+        delete scratch;
+    }
+    scratch = new cOglFb(width, height, width, height);
+    if (!scratch->Init()) {
+        delete scratch;
+        scratch = NULL;
+    }
+    return scratch;
+}
+
+void cOglCmdCopyFb::Cleanup(void) {
+    delete scratch;
+    scratch = NULL;
+}
+
+//pixmap coordinates are top down, framebuffer rows bottom up
+void cOglCmdCopyFb::BlitRect(cOglFb *src, GLint srcX, GLint srcY, cOglFb *dst, GLint dstX, GLint dstY) {
+    src->Bind();
+    dst->Bind();
+    src->BindRead();
+    dst->BindWrite();
+    glBlitFramebuffer(srcX, src->Height() - srcY - height, srcX + width, src->Height() - srcY,
+                      dstX, dst->Height() - dstY - height, dstX + width, dst->Height() - dstY,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    dst->Unbind();
+}
+
+bool cOglCmdCopyFb::Execute(void) {
+    cOglFb *src = source;
+    GLint x = sx;
+    GLint y = sy;
+
+    if (!src->Initiated()) {
+        //nothing was ever drawn, source is fully transparent
+        if (alpha >= 0)
+            return true;
+        fb->Bind();
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(dx, fb->Height() - dy - height, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+        fb->Unbind();
+        return true;
+    }
+    //blits with overlapping source and destination are undefined,
+    //bounce them through the scratch framebuffer
+    if (src == fb) {
+        cOglFb *tmp = Scratch(width, height);
+        if (!tmp)
+            return false;
+        BlitRect(src, x, y, tmp, 0, 0);
+        src = tmp;
+        x = 0;
+        y = 0;
+    }
+    if (alpha < 0) {
+        BlitRect(src, x, y, fb, dx, dy);
+        return true;
+    }
+
+    GLfloat x1 = dx;
+    GLfloat y1 = dy;
+    GLfloat x2 = dx + width;
+    GLfloat y2 = dy + height;
+
+    GLfloat texX1 = (GLfloat)x / (GLfloat)src->Width();
+    GLfloat texX2 = (GLfloat)(x + width) / (GLfloat)src->Width();
+    GLfloat texY1 = 1.0f - (GLfloat)(y + height) / (GLfloat)src->Height();
+    GLfloat texY2 = 1.0f - (GLfloat)y / (GLfloat)src->Height();
+
+    GLfloat quadVertices[] = {
+        // Pos    // TexCoords
+        x1,  y1,  texX1, texY2,          //left top
+        x1,  y2,  texX1, texY1,          //left bottom
+        x2,  y2,  texX2, texY1,          //right bottom
+
+        x1,  y1,  texX1, texY2,          //left top
+        x2,  y2,  texX2, texY1,          //right bottom
+        x2,  y1,  texX2, texY2           //right top
+    };
+
+    VertexBuffers[vbTexture]->ActivateShader();
+    VertexBuffers[vbTexture]->SetShaderAlpha(alpha);
+    VertexBuffers[vbTexture]->SetShaderProjectionMatrix(fb->Width(), fb->Height());
+
+    fb->Bind();
+    src->BindTexture();
+    VertexBuffers[vbTexture]->Bind();
+    VertexBuffers[vbTexture]->SetVertexData(quadVertices);
+    VertexBuffers[vbTexture]->DrawArrays();
+    VertexBuffers[vbTexture]->Unbind();
+    fb->Unbind();
+
+    return true;
+}
+
 //------------------ cOglCmdCopyBufferToOutputFb --------------------
-cOglCmdCopyBufferToOutputFb::cOglCmdCopyBufferToOutputFb(cOglFb *fb, cOglOutputFb *oFb, GLint x, GLint y) : cOglCmd(fb) {
+cOglCmdCopyBufferToOutputFb::cOglCmdCopyBufferToOutputFb(cOglFb *fb, cOglOutputFb *oFb, GLint x, GLint y,
+                                                         GLint areaX, GLint areaY, GLint areaWidth, GLint areaHeight) : cOglCmd(fb) {
     this->oFb = oFb;
     this->x = x;
     this->y = y;
+    this->areaX = areaX;
+    this->areaY = areaY;
+    this->areaWidth = areaWidth;
+    this->areaHeight = areaHeight;
 }
 
 bool cOglCmdCopyBufferToOutputFb::Execute(void) {
     fb->BindRead();
     oFb->BindWrite();
-    fb->Blit(x, y + fb->Height(), x + fb->Width(), y);
+    if (areaWidth > 0 && areaHeight > 0) {
+        //buffer rows are bottom up, output top down
+        glBlitFramebuffer(areaX, fb->Height() - areaY - areaHeight, areaX + areaWidth, fb->Height() - areaY,
+                          x + areaX, y + areaY + areaHeight, x + areaX + areaWidth, y + areaY,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glFlush();
+    } else
+        fb->Blit(x, y + fb->Height(), x + fb->Width(), y);
     oFb->Unbind();
     ActivateOsd();
     return true;
 }
 
 //------------------ cOglCmdFill --------------------
-cOglCmdFill::cOglCmdFill(cOglFb *fb, GLint color) : cOglCmd(fb) {
+cOglCmdFill::cOglCmdFill(cOglFb *fb, GLint color, GLint x, GLint y, GLint width, GLint height) : cOglCmd(fb) {
     this->color = color;
+    this->x = x;
+    this->y = y;
+    this->width = width;
+    this->height = height;
 }
 
 bool cOglCmdFill::Execute(void) {
@@ -842,7 +1286,13 @@ bool cOglCmdFill::Execute(void) {
     ConvertColor(color, col);
     fb->Bind();
     glClearColor(col.r, col.g, col.b, col.a);
-    glClear(GL_COLOR_BUFFER_BIT);
+    if (width > 0 && height > 0) {
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(x, fb->Height() - y - height, width, height);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+    } else
+        glClear(GL_COLOR_BUFFER_BIT);
     fb->Unbind();
     return true;
 }
@@ -857,31 +1307,7 @@ cOglCmdDrawRectangle::cOglCmdDrawRectangle( cOglFb *fb, GLint x, GLint y, GLint
 }
 
 bool cOglCmdDrawRectangle::Execute(void) {
-    GLfloat x1 = x;
-    GLfloat y1 = y;
-    GLfloat x2 = x + width;
-    GLfloat y2 = y + height;
-
-    GLfloat vertices[] = {
-        x1, y1,    //left top
-        x2, y1,    //right top
-        x2, y2,    //right bottom
-        x1, y2     //left bottom
-    };
-
-    VertexBuffers[vbRect]->ActivateShader();
-    VertexBuffers[vbRect]->SetShaderColor(color);
-    VertexBuffers[vbRect]->SetShaderProjectionMatrix(fb->Width(), fb->Height());
-
-    fb->Bind();
-    VertexBuffers[vbRect]->DisableBlending();
-    VertexBuffers[vbRect]->Bind();
-    VertexBuffers[vbRect]->SetVertexData(vertices);
-    VertexBuffers[vbRect]->DrawArrays();
-    VertexBuffers[vbRect]->Unbind();
-    VertexBuffers[vbRect]->EnableBlending();
-    fb->Unbind();
-
+    cOglPrimitives::AddRectangle(fb, x, y, width, height, color);
     return true;
 }
 
@@ -901,186 +1327,11 @@ cOglCmdDrawEllipse::cOglCmdDrawEllipse( cOglFb *fb, GLint x, GLint y, GLint widt
 }
 
 bool cOglCmdDrawEllipse::Execute(void) {
-    int numVertices = 0;
-    GLfloat *vertices = NULL;
-
-    switch (quadrants) {
-        case 0:
-            vertices = CreateVerticesFull(numVertices);
-            break;
-        case 1: case 2: case 3: case 4: case -1: case -2: case -3: case -4:
-            vertices = CreateVerticesQuadrant(numVertices);
-            break;
-        case 5: case 6: case 7: case 8:
-            vertices = CreateVerticesHalf(numVertices);
-            break;
-        default:
-            break;
-    }
-
-    VertexBuffers[vbEllipse]->ActivateShader();
-    VertexBuffers[vbEllipse]->SetShaderColor(color);
-    VertexBuffers[vbEllipse]->SetShaderProjectionMatrix(fb->Width(), fb->Height());
-
-    //not antialiased
-    fb->Bind();
-    VertexBuffers[vbEllipse]->DisableBlending();
-    VertexBuffers[vbEllipse]->Bind();
-    VertexBuffers[vbEllipse]->SetVertexData(vertices, numVertices);
-    VertexBuffers[vbEllipse]->DrawArrays(numVertices);
-    VertexBuffers[vbEllipse]->Unbind();
-    VertexBuffers[vbEllipse]->EnableBlending();
-    fb->Unbind();
-
-    delete[] vertices;
+    cOglPrimitives::AddEllipse(fb, x, y, width, height, color, quadrants);
     return true;
 }
 
-GLfloat *cOglCmdDrawEllipse::CreateVerticesFull(int &numVertices) {
-    int size = 364;
-    numVertices = size/2;
-    GLfloat radiusX = (GLfloat)width/2;
-    GLfloat radiusY = (GLfloat)height/2;
-    GLfloat *vertices = new GLfloat[size];
-    vertices[0] = x + radiusX;
-    vertices[1] = y + radiusY;
-    for (int i=0; i <= 180; i++) {
-        vertices[2*i+2] = x + radiusX + (GLfloat)cos(2*i * M_PI / 180.0f)*radiusX;
-        vertices[2*i+3] = y + radiusY - (GLfloat)sin(2*i * M_PI / 180.0f)*radiusY;
-    }
-    return vertices;
-}
-
-GLfloat *cOglCmdDrawEllipse::CreateVerticesQuadrant(int &numVertices) {
-    int size = 94;
-    numVertices = size/2;
-    GLfloat radiusX = (GLfloat)width;
-    GLfloat radiusY = (GLfloat)height;
-    GLint transX = 0;
-    GLint transY = 0;
-    GLint startAngle = 0;
-    GLfloat *vertices = new GLfloat[size];
-    switch (quadrants) {
-        case 1:
-            vertices[0] = x;
-            vertices[1] = y + height;
-            transY = radiusY;
-            break;
-        case 2:
-            vertices[0] = x + width;
-            vertices[1] = y + height;
-            transX = radiusX;
-            transY = radiusY;
-            startAngle = 90;
-            break;
-        case 3:
-            vertices[0] = x + width;
-            vertices[1] = y;
-            transX = radiusX;
-            startAngle = 180;
-            break;
-        case 4:
-            vertices[0] = x;
-            vertices[1] = y;
-            startAngle = 270;
-            break;
-        case -1:
-            vertices[0] = x + width;
-            vertices[1] = y;
-            transY = radiusY;
-            break;
-        case -2:
-            vertices[0] = x;
-            vertices[1] = y;
-            transX = radiusX;
-            transY = radiusY;
-            startAngle = 90;
-            break;
-        case -3:
-            vertices[0] = x;
-            vertices[1] = y + height;
-            transX = radiusX;
-            startAngle = 180;
-            break;
-        case -4:
-            vertices[0] = x + width;
-            vertices[1] = y + height;
-            startAngle = 270;
-            break;
-        default:
-            break;
-    }
-    for (int i=0; i <= 45; i++) {
-        vertices[2*i+2] = x + transX + (GLfloat)cos((2*i + startAngle) * M_PI / 180.0f)*radiusX;
-        vertices[2*i+3] = y + transY - (GLfloat)sin((2*i + startAngle) * M_PI / 180.0f)*radiusY;
-    }
-    return vertices;
-}
-
-GLfloat *cOglCmdDrawEllipse::CreateVerticesHalf(int &numVertices) {
-    int size = 184;
-    numVertices = size/2;
-    GLfloat radiusX = 0.0f;
-    GLfloat radiusY = 0.0f;
-    GLint transX = 0;
-    GLint transY = 0;
-    GLint startAngle = 0;    
-    GLfloat *vertices = new GLfloat[size];
-    switch (quadrants) {
-        case 5:
-            radiusX = (GLfloat)width;
-            radiusY = (GLfloat)height/2;
-            vertices[0] = x;
-            vertices[1] = y + radiusY;
-            startAngle = 270;
-            transY = radiusY;
-            break;
-        case 6:
-            radiusX = (GLfloat)width/2;
-            radiusY = (GLfloat)height;
-            vertices[0] = x + radiusX;
-            vertices[1] = y + radiusY;
-            startAngle = 0;
-            transX = radiusX;
-            transY = radiusY;
-            break;
-        case 7:
-            radiusX = (GLfloat)width;
-            radiusY = (GLfloat)height/2;
-            vertices[0] = x + radiusX;
-            vertices[1] = y + radiusY;
-            startAngle = 90;
-            transX = radiusX;
-            transY = radiusY;
-            break;
-        case 8:
-            radiusX = (GLfloat)width/2;
-            radiusY = (GLfloat)height;
-            vertices[0] = x + radiusX;
-            vertices[1] = y;
-            startAngle = 180;
-            transX = radiusX;
-            break;
-        default:
-            break;
-    }
-    for (int i=0; i <= 90; i++) {
-        vertices[2*i+2] = x + transX + (GLfloat)cos((2*i + startAngle) * M_PI / 180.0f)*radiusX;
-        vertices[2*i+3] = y + transY - (GLfloat)sin((2*i + startAngle) * M_PI / 180.0f)*radiusY;
-    }
-    return vertices;
-}
-
 //------------------ cOglCmdDrawSlope --------------------
-///type:
-///< 0: horizontal, rising,  lower
-///< 1: horizontal, rising,  upper
-///< 2: horizontal, falling, lower
-///< 3: horizontal, falling, upper
-///< 4: vertical,   rising,  lower
-///< 5: vertical,   rising,  upper
-///< 6: vertical,   falling, lower
-///< 7: vertical,   falling, upper
 cOglCmdDrawSlope::cOglCmdDrawSlope( cOglFb *fb, GLint x, GLint y, GLint width, GLint height, GLint color, GLint type)  : cOglCmd(fb) {
     this->x = x;
     this->y = y;
@@ -1091,66 +1342,7 @@ cOglCmdDrawSlope::cOglCmdDrawSlope( cOglFb *fb, GLint x, GLint y, GLint width, G
 }
 
 bool cOglCmdDrawSlope::Execute(void) {
-    bool falling  = type & 0x02;
-    bool vertical = type & 0x04;
-
-    int steps = 100;
-    if (width < 100)
-        steps = 25;
-    int numVertices = steps + 2;
-    GLfloat *vertices = new GLfloat[numVertices*2];
-
-    switch (type) {
-        case 0: case 4:
-            vertices[0] = (GLfloat)(x + width);
-            vertices[1] = (GLfloat)(y + height);
-            break;
-        case 1: case 5:
-            vertices[0] = (GLfloat)x;
-            vertices[1] = (GLfloat)y;
-            break;
-        case 2: case 6:
-            vertices[0] = (GLfloat)x;
-            vertices[1] = (GLfloat)(y + height);
-            break;
-        case 3: case 7:
-            vertices[0] = (GLfloat)(x + width);
-            vertices[1] = (GLfloat)y;
-            break;
-        default:
-            vertices[0] = (GLfloat)(x);
-            vertices[1] = (GLfloat)(y);
-            break;
-    }
-
-    for (int i = 0; i <= steps; i++) {
-        GLfloat c = cos(i * M_PI / steps);
-        if (falling)
-            c = -c;
-        if (vertical) {
-            vertices[2*i+2] = (GLfloat)x + (GLfloat)width / 2.0f + (GLfloat)width * c / 2.0f;
-            vertices[2*i+3] = (GLfloat)y + (GLfloat)i * ((GLfloat)height) / steps ;
-        } else {
-            vertices[2*i+2] = (GLfloat)x + (GLfloat)i * ((GLfloat)width) / steps ;
-            vertices[2*i+3] = (GLfloat)y + (GLfloat)height / 2.0f + (GLfloat)height * c / 2.0f;
-        }
-    }
-
-    VertexBuffers[vbSlope]->ActivateShader();
-    VertexBuffers[vbSlope]->SetShaderColor(color);
-    VertexBuffers[vbSlope]->SetShaderProjectionMatrix(fb->Width(), fb->Height());
-
-    //not antialiased
-    fb->Bind();
-    VertexBuffers[vbSlope]->DisableBlending();
-    VertexBuffers[vbSlope]->Bind();
-    VertexBuffers[vbSlope]->SetVertexData(vertices, numVertices);
-    VertexBuffers[vbSlope]->DrawArrays(numVertices);
-    VertexBuffers[vbSlope]->Unbind();
-    VertexBuffers[vbSlope]->EnableBlending();
-    fb->Unbind();
-
-    delete[] vertices;
+    cOglPrimitives::AddSlope(fb, x, y, width, height, color, type);
     return true;
 }
 
@@ -1187,12 +1379,16 @@ bool cOglCmdDrawText::Execute(void) {
     uint sym = 0;
     uint prevSym = 0;
     int kerning = 0;
+    int page = -1;
+    std::vector<GLfloat> vertices;
 
+    // all glyphs of an atlas page are drawn with one call
     for (int i = 0; symbols[i]; i++) {
         sym = symbols[i];
         cOglGlyph *g = f->Glyph(sym);
         if (!g) {
             esyslog("[softhddev]ERROR: could not load glyph %x", sym);
+            continue;
         }
 
         if ( limitX && xGlyph + g->AdvanceX() > limitX )
@@ -1201,30 +1397,35 @@ bool cOglCmdDrawText::Execute(void) {
         kerning = f->Kerning(g, prevSym);
         prevSym = sym;
 
-        GLfloat x1 = xGlyph + kerning + g->BearingLeft();          //left
-        GLfloat y1 = y + (fontHeight - bottom - g->BearingTop());  //top
-        GLfloat x2 = x1 + g->Width();                              //right
-        GLfloat y2 = y1 + g->Height();                             //bottom
-
-        GLfloat vertices[] = {
-            x1, y2,   0.0, 1.0,     // left bottom
-            x1, y1,   0.0, 0.0,     // left top
-            x2, y1,   1.0, 0.0,     // right top
-
-            x1, y2,   0.0, 1.0,     // left bottom
-            x2, y1,   1.0, 0.0,     // right top
-            x2, y2,   1.0, 1.0      // right bottom
-        };
+        if (g->Page() >= 0) {
+            if (g->Page() != page) {
+                DrawVertices(f, page, vertices);
+                page = g->Page();
+            }
 
-        g->BindTexture();
-        VertexBuffers[vbText]->SetVertexData(vertices);
-        VertexBuffers[vbText]->DrawArrays();
+            GLfloat x1 = xGlyph + kerning + g->BearingLeft();          //left
+            GLfloat y1 = y + (fontHeight - bottom - g->BearingTop());  //top
+            GLfloat x2 = x1 + g->Width();                              //right
+            GLfloat y2 = y1 + g->Height();                             //bottom
+
+            GLfloat quad[] = {
+                x1, y2,   g->TexX1(), g->TexY2(),     // left bottom
+                x1, y1,   g->TexX1(), g->TexY1(),     // left top
+                x2, y1,   g->TexX2(), g->TexY1(),     // right top
+
+                x1, y2,   g->TexX1(), g->TexY2(),     // left bottom
+                x2, y1,   g->TexX2(), g->TexY1(),     // right top
+                x2, y2,   g->TexX2(), g->TexY2()      // right bottom
+            };
+            vertices.insert(vertices.end(), quad, quad + sizeof(quad) / sizeof(*quad));
+        }
 
         xGlyph += kerning + g->AdvanceX();
 
         if ( xGlyph > fb->Width() - 1 )
             break;
     }
+    DrawVertices(f, page, vertices);
 
     glBindTexture(GL_TEXTURE_2D, 0);
     VertexBuffers[vbText]->Unbind();
@@ -1232,6 +1433,17 @@ bool cOglCmdDrawText::Execute(void) {
     return true;
 }
 
+void cOglCmdDrawText::DrawVertices(cOglFont *f, int page, std::vector<GLfloat> &vertices) {
+    if (vertices.empty())
+        return;
+    int count = vertices.size() / 4;
+
+    f->BindAtlas(page);
+    VertexBuffers[vbText]->SetVertexData(&vertices[0], count);
+    VertexBuffers[vbText]->DrawArrays(count);
+    vertices.clear();
+}
+
 //------------------ cOglCmdDrawImage --------------------
 cOglCmdDrawImage::cOglCmdDrawImage(cOglFb *fb, tColor *argb, GLint width, GLint height, GLint x, GLint y, bool overlay, double scaleX, double scaleY): cOglCmd(fb) {
     this->argb = argb;
@@ -1314,6 +1526,8 @@ cOglCmdDrawTexture::cOglCmdDrawTexture(cOglFb *fb, sOglImage *imageRef, GLint x,
 }
 
 bool cOglCmdDrawTexture::Execute(void) {
+    if (imageRef->texture == GL_NONE)  // store failed
+        return false;
     GLfloat x1 = x;                    //top
     GLfloat y1 = y;                    //left
     GLfloat x2 = x + imageRef->width;  //right
@@ -1347,17 +1561,24 @@ bool cOglCmdDrawTexture::Execute(void) {
 
 
 //------------------ cOglCmdStoreImage --------------------
-cOglCmdStoreImage::cOglCmdStoreImage(sOglImage *imageRef, tColor *argb) : cOglCmd(NULL) {
+// the pixels belong to the cache entry, they are freed by the drop command
+cOglCmdStoreImage::cOglCmdStoreImage(sOglImage *imageRef, tColor *argb, GLint width, GLint height) : cOglCmd(NULL) {
     this->imageRef = imageRef;
     data = argb;
-}
-
-cOglCmdStoreImage::~cOglCmdStoreImage(void) {
-    free(data);
+    this->width = width;
+    this->height = height;
 }
 
 bool cOglCmdStoreImage::Execute(void) {
+    imageRef->width = width;
+    imageRef->height = height;
+    imageRef->texture = GL_NONE;
     glGenTextures(1, &imageRef->texture);
+    if (imageRef->texture == GL_NONE) {
+        esyslog("[softhddev]ERROR::cOglCmdStoreImage: error generate texture %x\n", glGetError());
+        __atomic_store_n(&imageRef->failedData, data, __ATOMIC_RELEASE);
+        return false;
+    }
     glBindTexture(GL_TEXTURE_2D, imageRef->texture);
     glTexImage2D(
         GL_TEXTURE_2D,
@@ -1370,6 +1591,15 @@ bool cOglCmdStoreImage::Execute(void) {
         GL_UNSIGNED_INT_8_8_8_8_REV,
         data
     );
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        esyslog("[softhddev]ERROR::cOglCmdStoreImage: error store image %dx%d %x\n", width, height, err);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDeleteTextures(1, &imageRef->texture);
+        imageRef->texture = GL_NONE;
+        __atomic_store_n(&imageRef->failedData, data, __ATOMIC_RELEASE);
+        return false;
+    }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -1379,15 +1609,22 @@ bool cOglCmdStoreImage::Execute(void) {
 }
 
 //------------------ cOglCmdDropImage --------------------
-cOglCmdDropImage::cOglCmdDropImage(sOglImage *imageRef, cCondWait *wait) : cOglCmd(NULL) {
+cOglCmdDropImage::cOglCmdDropImage(sOglImage *imageRef, tColor *data) : cOglCmd(NULL) {
     this->imageRef = imageRef;
-    this->wait = wait;
+    this->data = data;
 }
 
+// also deleted unexecuted when the thread stops, the pixels are freed here
+cOglCmdDropImage::~cOglCmdDropImage(void) {
+    free(data);
+}
+
+// clears the failure before the pixels are freed, a later image can't get their address
 bool cOglCmdDropImage::Execute(void) {
     if (imageRef->texture != GL_NONE)
         glDeleteTextures(1, &imageRef->texture);
-    wait->Signal();
+    imageRef->texture = GL_NONE;
+    __atomic_store_n(&imageRef->failedData, (tColor *)NULL, __ATOMIC_RELEASE);
     return true;
 }
 
@@ -1395,56 +1632,177 @@ bool cOglCmdDropImage::Execute(void) {
 * cOglThread
 ******************************************************************************/
 cOglThread::cOglThread(cCondWait *startWait, int maxCacheSize) : cThread("oglThread") {
-    stalled = false;
     memCached = 0;
-    this->maxCacheSize = maxCacheSize * 1024 * 1024;
+    this->maxCacheSize = maxCacheSize * 1024L * 1024L;
+    imageTick = 0;
+    imageHits = 0;
+    imageMisses = 0;
+    imageEvictions = 0;
+    imageFailures = 0;
     this->startWait = startWait;
-    wait = new cCondWait();
+    for (int i = 0; i < OGL_CMDQUEUE_SIZE; i++) {
+        slots[i].seq = i;
+        slots[i].pos = i;
+        slots[i].cmd = NULL;
+        slots[i].inlined = false;
+    }
+    enqueuePos = 0;
+    dequeuePos = 0;
+    consumerSleeping = false;
+    producersWaiting = false;
+    memset(depthHistogram, 0, sizeof(depthHistogram));
+    memset(timeHistogram, 0, sizeof(timeHistogram));
     maxTextureSize = 0;
     for (int i = 0; i < OGL_MAX_OSDIMAGES; i++) {
         imageCache[i].used = false;
         imageCache[i].texture = GL_NONE;
         imageCache[i].width = 0;
         imageCache[i].height = 0;
+        imageCache[i].refs = 0;
+        imageCache[i].hash = 0;
+        imageCache[i].lastUse = 0;
+        imageCache[i].size = 0;
+        imageCache[i].data = NULL;
+        imageCache[i].failedData = NULL;
     }
 
     Start();
 }
 
 cOglThread::~cOglThread() {
-    delete wait;
-    wait = NULL;
+    // drop commands not executed anymore
+    sOglCmdSlot *slot;
+    while ((slot = FilledSlot()))
+        ReleaseSlot(slot);
 }
 
 void cOglThread::Stop(void) {
+    Lock();
     for (int i = 0; i < OGL_MAX_OSDIMAGES; i++) {
-        if (imageCache[i].used) {
-            DropImageData(i);
-        }
+        if (imageCache[i].used)
+            FreeImage(i);
     }
+    Unlock();
+    Cancel(-1);
+    dataWait.Signal();
     Cancel(2);
-    stalled = false;
+    spaceWait.Signal();
+}
+
+// bucket 0: 0, bucket i: 2^(i-1) .. 2^i - 1, last bucket open ended
+static int Log2Bucket(uint64_t value) {
+    int bucket = 0;
+    while (value && bucket < OGL_HISTOGRAM_SIZE - 1) {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static uint64_t NowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// claim the next free slot of the ring, multiple producers
+sOglCmdSlot *cOglThread::ClaimSlot(void) {
+    for (;;) {
+        unsigned int pos = __atomic_load_n(&enqueuePos, __ATOMIC_RELAXED);
+        sOglCmdSlot *slot = &slots[pos & (OGL_CMDQUEUE_SIZE - 1)];
+        int diff = (int)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&enqueuePos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                slot->pos = pos;
+                return slot;
+            }
+        } else if (diff < 0) {  // full, wait until the thread releases a slot
+            if (!Active())
+                return NULL;
+            __atomic_store_n(&producersWaiting, true, __ATOMIC_SEQ_CST);
+            if ((int)(__atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) - pos) < 0)
+                spaceWait.Wait(10);
+        }
+    }
+}
+
+// make a claimed slot visible to the thread, wakeup the thread if sleeping
+void cOglThread::PublishSlot(sOglCmdSlot *slot) {
+    unsigned int depth = slot->pos - __atomic_load_n(&dequeuePos, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&depthHistogram[Log2Bucket(depth)], 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, slot->pos + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&consumerSleeping, __ATOMIC_SEQ_CST))
+        dataWait.Signal();
 }
 
-void cOglThread::DoCmd(cOglCmd* cmd) {
-    while (stalled)
-        cCondWait::SleepMs(10);
+// next filled slot in order, single consumer
+sOglCmdSlot *cOglThread::FilledSlot(void) {
+    sOglCmdSlot *slot = &slots[dequeuePos & (OGL_CMDQUEUE_SIZE - 1)];
 
-    bool doSignal = false;
+    if (__atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) != dequeuePos + 1)
+        return NULL;
+    return slot;
+}
+
+// destroy the command of a slot and give the slot back to the producers
+void cOglThread::ReleaseSlot(sOglCmdSlot *slot) {
+    if (slot->inlined)
+        slot->cmd->~cOglCmd();
+    else
+        delete slot->cmd;
+    slot->cmd = NULL;
+    __atomic_store_n(&slot->seq, dequeuePos + OGL_CMDQUEUE_SIZE, __ATOMIC_RELEASE);
+    __atomic_store_n(&dequeuePos, dequeuePos + 1, __ATOMIC_RELAXED);
+    if (__atomic_exchange_n(&producersWaiting, false, __ATOMIC_SEQ_CST))
+        spaceWait.Signal();
+}
+
+cString cOglThread::Stats(void) {
+    cString depth = "queue depth";
+    cString time = "execution us";
+
+    for (int i = 0; i < OGL_HISTOGRAM_SIZE - 1; i++) {
+        depth = cString::sprintf("%s <%u:%u", *depth, 1U << i, depthHistogram[i]);
+        time = cString::sprintf("%s <%u:%u", *time, 1U << i, timeHistogram[i]);
+    }
+    depth = cString::sprintf("%s >=%u:%u", *depth, 1U << (OGL_HISTOGRAM_SIZE - 2), depthHistogram[OGL_HISTOGRAM_SIZE - 1]);
+    time = cString::sprintf("%s >=%u:%u", *time, 1U << (OGL_HISTOGRAM_SIZE - 2), timeHistogram[OGL_HISTOGRAM_SIZE - 1]);
+
+    int images = 0;
+    int referenced = 0;
+    int failed = 0;
     Lock();
-    if (commands.size() == 0)
-        doSignal = true;
-    commands.push(cmd);
+    for (int i = 0; i < OGL_MAX_OSDIMAGES; i++) {
+        if (imageCache[i].used) {
+            images++;
+            if (imageCache[i].refs)
+                referenced++;
+            if (StoreFailed(i))
+                failed++;
+        }
+    }
+    cString cache = cString::sprintf("image cache images(%d) referenced(%d) failed(%d) used(%ldKiB) max(%ldKiB) hits(%u) misses(%u) evictions(%u) store errors(%u)",
+        images, referenced, failed, memCached / 1024, maxCacheSize / 1024, imageHits, imageMisses, imageEvictions, imageFailures);
     Unlock();
+    cString batch = cString::sprintf("primitives(%u) batches(%u)", cOglPrimitives::Primitives(), cOglPrimitives::Batches());
+    return cString::sprintf("%s\n%s\n%s\n%s", *depth, *time, *cache, *batch);
+}
 
-    if (commands.size() > OGL_CMDQUEUE_SIZE) {
-        stalled = true;
-    }
+// FNV-1a over the pixels, seeded with the image size
+static uint64_t ImageHash(const cImage &image) {
+    const tColor *data = image.Data();
+    int n = image.Width() * image.Height();
+    uint64_t hash = 14695981039346656037ULL ^ ((uint64_t)image.Width() << 32 | (uint32_t)image.Height());
 
-    if (doSignal || stalled)
-        wait->Signal();
+    for (int i = 0; i < n; i++)
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    return hash;
 }
 
+// returns a handle at once, the texture is created when the thread reaches
+// the store command, commands drawing the image are always queued behind it
 int cOglThread::StoreImage(const cImage &image) {
     if (image.Width() > maxTextureSize || image.Height() > maxTextureSize) {
         esyslog("[softhddev] cannot store image of %dpx x %dpx "
@@ -1456,89 +1814,140 @@ int cOglThread::StoreImage(const cImage &image) {
     }
 
     int imgSize = image.Width() * image.Height();
-    int newMemUsed = imgSize * sizeof(tColor) + memCached;
-    if (newMemUsed > maxCacheSize) {
+    long size = imgSize * sizeof(tColor);
+    uint64_t hash = ImageHash(image);
+
+    Lock();
+    int i = FindImage(hash, image);
+    if (i >= 0) {
+        imageCache[i].refs++;
+        imageCache[i].lastUse = ++imageTick;
+        imageHits++;
+        Unlock();
+        return -i - 1;
+    }
+    imageMisses++;
+
+    if (!EvictImages(size)) {
         float cachedMB = memCached / 1024.0f / 1024.0f;
         float maxMB = maxCacheSize / 1024.0f / 1024.0f;
         esyslog("[softhddev]Maximum size for GPU cache reached. Used: %.2fMB Max: %.2fMB", cachedMB, maxMB);
+        Unlock();
         return 0;
     }
-
-    int slot = GetFreeSlot();
-    if (!slot)
-        return 0;
+    for (i = 0; i < OGL_MAX_OSDIMAGES && imageCache[i].used; i++)
+        ;
 
     tColor *argb = MALLOC(tColor, imgSize);
     if (!argb) {
-        esyslog("[softhddev]memory allocation of %ld kb for OSD image failed", imgSize  * sizeof(tColor) / 1024);
-        ClearSlot(slot);
-        slot = 0;
+        esyslog("[softhddev]memory allocation of %ld kb for OSD image failed", size / 1024);
+        Unlock();
         return 0;
     }
+    memcpy(argb, image.Data(), size);
+
+    imageCache[i].used = true;
+    imageCache[i].refs = 1;
+    imageCache[i].imageSize.Set(image.Width(), image.Height());
+    imageCache[i].hash = hash;
+    imageCache[i].lastUse = ++imageTick;
+    imageCache[i].size = size;
+    imageCache[i].data = argb;
+    memCached += size;
+    DoCmd<cOglCmdStoreImage>(&imageCache[i], argb, image.Width(), image.Height());
+    Unlock();
 
-    memcpy(argb, image.Data(), sizeof(tColor) * imgSize);
+    return -i - 1;
+}
 
-    sOglImage *imageRef = GetImageRef(slot);
-    imageRef->width = image.Width();
-    imageRef->height = image.Height();
-    DoCmd(new cOglCmdStoreImage(imageRef, argb));
+// the thread marks a failed store with its pixels, the slot may already hold
+// a newer image; the texture memory is released from the cache at first sight
+bool cOglThread::StoreFailed(int i) {
+    if (!imageCache[i].data
+        || __atomic_load_n(&imageCache[i].failedData, __ATOMIC_ACQUIRE) != imageCache[i].data)
+        return false;
+    if (imageCache[i].size) {
+        memCached -= imageCache[i].size;
+        imageCache[i].size = 0;
+        imageFailures++;
+    }
+    return true;
+}
 
-    cTimeMs timer(5000);
-    while (imageRef->used && imageRef->texture == 0 && !timer.TimedOut())
-        cCondWait::SleepMs(2);
+// cached image with the same content, referenced or not, failed stores never match
+int cOglThread::FindImage(uint64_t hash, const cImage &image) {
+    long size = image.Width() * image.Height() * sizeof(tColor);
 
-    if (imageRef->texture == GL_NONE) {
-        esyslog("[softhddev]failed to store OSD image texture! (%s)", timer.TimedOut() ? "timed out" : "allocation failed");
-        DropImageData(slot);
-        slot = 0;
+    for (int i = 0; i < OGL_MAX_OSDIMAGES; i++) {
+        if (imageCache[i].used && !StoreFailed(i) && imageCache[i].hash == hash
+            && imageCache[i].size == size && !memcmp(imageCache[i].data, image.Data(), size))
+            return i;
     }
-
-    memCached += imgSize  * sizeof(tColor);
-    return slot;
+    return -1;
 }
 
-int cOglThread::GetFreeSlot(void) {
-    Lock();
-    int slot = 0;
-    for (int i = 0; i < OGL_MAX_OSDIMAGES && !slot; i++) {
-        if (!imageCache[i].used) {
-            imageCache[i].used = true;
-            slot = -i - 1;
+// drop least recently used unreferenced images until size fits and a slot is free
+bool cOglThread::EvictImages(long size) {
+    for (;;) {
+        bool slotFree = false;
+        int lru = -1;
+
+        for (int i = 0; i < OGL_MAX_OSDIMAGES; i++) {
+            if (!imageCache[i].used) {
+                slotFree = true;
+                continue;
+            }
+            if (!imageCache[i].refs && (lru < 0 || imageCache[i].lastUse < imageCache[lru].lastUse))
+                lru = i;
         }
+        if (slotFree && memCached + size <= maxCacheSize)
+            return true;
+        if (lru < 0)
+            return false;
+        FreeImage(lru);
+        imageEvictions++;
     }
-    Unlock();
-    return slot;
 }
 
-void cOglThread::ClearSlot(int slot) {
+// the slot can be reused at once, a new store command is queued behind the drop
+void cOglThread::FreeImage(int i) {
+    StoreFailed(i);
+    DoCmd<cOglCmdDropImage>(&imageCache[i], imageCache[i].data);
+    memCached -= imageCache[i].size;
+    imageCache[i].used = false;
+    imageCache[i].refs = 0;
+    imageCache[i].hash = 0;
+    imageCache[i].size = 0;
+    imageCache[i].data = NULL;
+}
+
+sOglImage *cOglThread::GetImageRef(int slot, cSize &size) {
     int i = -slot - 1;
-    if (i >= 0 && i < OGL_MAX_OSDIMAGES) {
+    sOglImage *imageRef = NULL;
+
+    if (0 <= i && i < OGL_MAX_OSDIMAGES) {
         Lock();
-        imageCache[i].used = false;
-        imageCache[i].texture = GL_NONE;
-        imageCache[i].width = 0;
-        imageCache[i].height = 0;
+        if (imageCache[i].used && imageCache[i].refs) {
+            imageRef = &imageCache[i];
+            size = imageCache[i].imageSize;
+        }
         Unlock();
     }
+    return imageRef;
 }
 
-sOglImage *cOglThread::GetImageRef(int slot) {
-    int i = -slot - 1;
-    if (0 <= i && i < OGL_MAX_OSDIMAGES)
-        return &imageCache[i];
-    return 0;
-}
-
+// the texture stays cached until evicted, storing the same image again is a hit
 void cOglThread::DropImageData(int imageHandle) {
-    sOglImage *imageRef = GetImageRef(imageHandle);
-    if (!imageRef)
+    int i = -imageHandle - 1;
+
+    if (i < 0 || i >= OGL_MAX_OSDIMAGES)
         return;
-    int imgSize = imageRef->width * imageRef->height * sizeof(tColor);
-    memCached -= imgSize;
-    cCondWait dropWait;
-    DoCmd(new cOglCmdDropImage(imageRef, &dropWait));
-    dropWait.Wait();
-    ClearSlot(imageHandle);
+    Lock();
+    if (imageCache[i].used && imageCache[i].refs) {
+        imageCache[i].refs--;
+        imageCache[i].lastUse = ++imageTick;
+    }
+    Unlock();
 }
 
 
@@ -1583,23 +1992,23 @@ void cOglThread::Action(void) {
 
     //now Thread is ready to do his job
     startWait->Signal();
-    stalled = false;
 
     while(Running()) {
-      if (commands.empty()) {
-            wait->Wait(20);
+        sOglCmdSlot *slot = FilledSlot();
+        if (!slot) {
+            cOglPrimitives::Flush();
+            __atomic_store_n(&consumerSleeping, true, __ATOMIC_SEQ_CST);
+            if (!FilledSlot())
+                dataWait.Wait(100);
+            __atomic_store_n(&consumerSleeping, false, __ATOMIC_SEQ_CST);
             continue;
         }
-        Lock();
-        cOglCmd* cmd = commands.front();
-        commands.pop();
-        Unlock();
-        //uint64_t start = cTimeMs::Now();
-        cmd->Execute();
-        //esyslog("[softhddev]\"%s\", %dms, %d commands left, time %" PRIu64 "", cmd->Description(), (int)(cTimeMs::Now() - start), commands.size(), cTimeMs::Now());
-        delete cmd;
-        if (stalled && commands.size() < OGL_CMDQUEUE_SIZE / 2)
-            stalled = false;
+        uint64_t start = NowUs();
+        if (!slot->cmd->Batched())
+            cOglPrimitives::Flush();
+        slot->cmd->Execute();
+        timeHistogram[Log2Bucket(NowUs() - start)]++;
+        ReleaseSlot(slot);
     }
     dsyslog("[softhddev]Cleaning up OpenGL stuff");
     Cleanup();
@@ -1694,9 +2103,11 @@ void cOglThread::DeleteVertexBuffers(void) {
 }
 
 void cOglThread::Cleanup(void) {
+    cOglPrimitives::Cleanup();
     DeleteVertexBuffers();
     delete cOglOsd::oFb;
     cOglOsd::oFb = NULL;
+    cOglCmdCopyFb::Cleanup();
     DeleteShaders();
     cOglFont::Cleanup();
 #ifdef USE_VDPAU
@@ -1717,54 +2128,85 @@ cOglPixmap::cOglPixmap(std::shared_ptr<cOglThread> oglThread, int Layer, const c
     int height = DrawPort.IsEmpty() ? ViewPort.Height() : DrawPort.Height();
     fb = new cOglFb(width, height, ViewPort.Width(), ViewPort.Height());
     dirty = true; 
+    Damage(ViewPort);
 }
 
 cOglPixmap::~cOglPixmap(void) {
     if (!oglThread->Active())
         return;
-    oglThread->DoCmd(new cOglCmdDeleteFb(fb));
+    oglThread->DoCmd<cOglCmdDeleteFb>(fb);
+}
+
+// area of the osd to recompose at the next flush, hidden pixmaps show nothing
+void cOglPixmap::Damage(const cRect &Rect) {
+    if (Layer() >= 0)
+        damage.Combine(Rect);
+}
+
+// hides cPixmap::MarkDrawPortDirty() to also track the damaged osd area
+void cOglPixmap::MarkDrawPortDirty(const cRect &Rect) {
+    cPixmap::MarkDrawPortDirty(Rect);
+    if (Tile())
+        Damage(ViewPort());
+    else
+        Damage(Rect.Shifted(DrawPort().Point()).Shifted(ViewPort().Point()).Intersected(ViewPort()));
+}
+
+void cOglPixmap::SetLayer(int Layer) {
+    if (Layer != cPixmap::Layer()) {
+        Damage(ViewPort());
+        cPixmap::SetLayer(Layer);
+        Damage(ViewPort());
+        SetDirty();
+    }
 }
 
 void cOglPixmap::SetAlpha(int Alpha) {
     Alpha = constrain(Alpha, ALPHA_TRANSPARENT, ALPHA_OPAQUE);
     if (Alpha != cPixmap::Alpha()) {
         cPixmap::SetAlpha(Alpha);
+        Damage(ViewPort());
         SetDirty();
     }
 }
 
 void cOglPixmap::SetTile(bool Tile) {
     cPixmap::SetTile(Tile);
+    Damage(ViewPort());
     SetDirty();
 }
 
 void cOglPixmap::SetViewPort(const cRect &Rect) {
+    Damage(ViewPort());
     cPixmap::SetViewPort(Rect);
+    Damage(ViewPort());
     SetDirty();
 }
 
 void cOglPixmap::SetDrawPortPoint(const cPoint &Point, bool Dirty) {
     cPixmap::SetDrawPortPoint(Point, Dirty);
-    if (Dirty)
+    if (Dirty) {
+        Damage(ViewPort());
         SetDirty();
+    }
 }
 
 void cOglPixmap::Clear(void) {
     if (!oglThread->Active())
         return;
     LOCK_PIXMAPS;
-    oglThread->DoCmd(new cOglCmdFill(fb, clrTransparent));
+    oglThread->DoCmd<cOglCmdFill>(fb, clrTransparent);
     SetDirty();
-    MarkDrawPortDirty(DrawPort());
+    MarkDrawPortDirty(cRect(cPoint(0, 0), DrawPort().Size()));
 }
 
 void cOglPixmap::Fill(tColor Color) {
     if (!oglThread->Active())
         return;
     LOCK_PIXMAPS;
-    oglThread->DoCmd(new cOglCmdFill(fb, Color));
+    oglThread->DoCmd<cOglCmdFill>(fb, Color);
     SetDirty();
-    MarkDrawPortDirty(DrawPort());
+    MarkDrawPortDirty(cRect(cPoint(0, 0), DrawPort().Size()));
 }
 
 void cOglPixmap::DrawImage(const cPoint &Point, const cImage &Image) {
@@ -1775,7 +2217,7 @@ void cOglPixmap::DrawImage(const cPoint &Point, const cImage &Image) {
         return;
     memcpy(argb, Image.Data(), sizeof(tColor) * Image.Width() * Image.Height());
 
-    oglThread->DoCmd(new cOglCmdDrawImage(fb, argb, Image.Width(), Image.Height(), Point.X(), Point.Y()));
+    oglThread->DoCmd<cOglCmdDrawImage>(fb, argb, Image.Width(), Image.Height(), Point.X(), Point.Y());
 
     SetDirty();
     MarkDrawPortDirty(cRect(Point, cSize(Image.Width(), Image.Height())).Intersected(DrawPort().Size()));
@@ -1784,10 +2226,11 @@ void cOglPixmap::DrawImage(const cPoint &Point, const cImage &Image) {
 void cOglPixmap::DrawImage(const cPoint &Point, int ImageHandle) {
     if (!oglThread->Active())
         return;
-    if (ImageHandle < 0 && oglThread->GetImageRef(ImageHandle)) {
-            sOglImage *img = oglThread->GetImageRef(ImageHandle);
-            oglThread->DoCmd(new cOglCmdDrawTexture(fb, img, Point.X(), Point.Y()));
-    }
+    cSize size;
+    sOglImage *img = ImageHandle < 0 ? oglThread->GetImageRef(ImageHandle, size) : NULL;
+    if (!img)
+        return;
+    oglThread->DoCmd<cOglCmdDrawTexture>(fb, img, Point.X(), Point.Y());
     /*
     Fallback to VDR implementation, needs to separate cSoftOsdProvider from softhddevice.cpp 
     else {
@@ -1796,12 +2239,12 @@ void cOglPixmap::DrawImage(const cPoint &Point, int ImageHandle) {
     }
     */
     SetDirty();
-    MarkDrawPortDirty(DrawPort());
+    MarkDrawPortDirty(cRect(Point, size).Intersected(DrawPort().Size()));
 }
 
 void cOglPixmap::DrawPixel(const cPoint &Point, tColor Color) {
     cRect r(Point.X(), Point.Y(), 1, 1);
-    oglThread->DoCmd(new cOglCmdDrawRectangle(fb, r.X(), r.Y(), r.Width(), r.Height(), Color));
+    oglThread->DoCmd<cOglCmdDrawRectangle>(fb, r.X(), r.Y(), r.Width(), r.Height(), Color);
     SetDirty();
     MarkDrawPortDirty(r);
 }
@@ -1831,7 +2274,7 @@ void cOglPixmap::DrawBitmap(const cPoint &Point, const cBitmap &Bitmap, tColor C
         xNew -= ViewPort().X();
         yNew -= ViewPort().Y();
     }
-    oglThread->DoCmd(new cOglCmdDrawImage(fb, argb, Bitmap.Width(), Bitmap.Height(), xNew, yNew, Overlay));
+    oglThread->DoCmd<cOglCmdDrawImage>(fb, argb, Bitmap.Width(), Bitmap.Height(), xNew, yNew, Overlay);
     SetDirty();
     MarkDrawPortDirty(cRect(cPoint(xNew,yNew), cSize(Bitmap.Width(), Bitmap.Height())).Intersected(DrawPort().Size()));
 }
@@ -1863,7 +2306,7 @@ void cOglPixmap::DrawText(const cPoint &Point, const char *s, tColor ColorFg, tC
     cRect r(x, y, cw, ch);
 
     if (ColorBg != clrTransparent)
-        oglThread->DoCmd(new cOglCmdDrawRectangle(fb, r.X(), r.Y(), r.Width(), r.Height(), ColorBg));
+        oglThread->DoCmd<cOglCmdDrawRectangle>(fb, r.X(), r.Y(), r.Width(), r.Height(), ColorBg);
 
     if (Width || Height) {
         limitX = x + cw;
@@ -1894,7 +2337,7 @@ void cOglPixmap::DrawText(const cPoint &Point, const char *s, tColor ColorFg, tC
             }
         }
     }
-    oglThread->DoCmd(new cOglCmdDrawText(fb, x, y, symbols, limitX, Font->FontName(), Font->Size(), ColorFg));
+    oglThread->DoCmd<cOglCmdDrawText>(fb, x, y, symbols, limitX, Font->FontName(), Font->Size(), ColorFg);
 
     SetDirty();
     MarkDrawPortDirty(r);
@@ -1919,7 +2362,7 @@ void cOglPixmap::DrawRectangle(const cRect &Rect, tColor Color) {
     }
 
     LOCK_PIXMAPS;
-    oglThread->DoCmd(new cOglCmdDrawRectangle(fb, xNew, yNew, wNew, hNew, Color));
+    oglThread->DoCmd<cOglCmdDrawRectangle>(fb, xNew, yNew, wNew, hNew, Color);
     SetDirty();
     MarkDrawPortDirty(Rect);
 }
@@ -1943,7 +2386,7 @@ void cOglPixmap::DrawEllipse(const cRect &Rect, tColor Color, int Quadrants) {
     }
 
     LOCK_PIXMAPS;
-    oglThread->DoCmd(new cOglCmdDrawEllipse(fb, xNew, yNew, wNew, hNew, Color, Quadrants));
+    oglThread->DoCmd<cOglCmdDrawEllipse>(fb, xNew, yNew, wNew, hNew, Color, Quadrants);
     SetDirty();
     MarkDrawPortDirty(Rect);
 }
@@ -1967,25 +2410,96 @@ void cOglPixmap::DrawSlope(const cRect &Rect, tColor Color, int Type) {
     }
 
     LOCK_PIXMAPS;
-    oglThread->DoCmd(new cOglCmdDrawSlope(fb, xNew, yNew, wNew, hNew, Color, Type));
+    oglThread->DoCmd<cOglCmdDrawSlope>(fb, xNew, yNew, wNew, hNew, Color, Type);
     SetDirty();
     MarkDrawPortDirty(Rect);
 }
 
 void cOglPixmap::Render(const cPixmap *Pixmap, const cRect &Source, const cPoint &Dest) {
-    esyslog("[softhddev] Render %d %d %d not implemented in OpenGl OSD", Pixmap->ViewPort().X(), Source.X(), Dest.X());
+    if (!oglThread->Active())
+        return;
+    const cOglPixmap *pm = dynamic_cast<const cOglPixmap *>(Pixmap);
+    if (!pm)
+        return;
+    LOCK_PIXMAPS;
+    cRect s = Source.Intersected(Pixmap->DrawPort().Size());
+    if (s.IsEmpty())
+        return;
+    cPoint v = Dest - Source.Point();
+    cRect d = s.Shifted(v).Intersected(DrawPort().Size());
+    if (d.IsEmpty())
+        return;
+    s = d.Shifted(-v);
+    oglThread->DoCmd<cOglCmdCopyFb>(fb, pm->fb, s.X(), s.Y(), d.Width(), d.Height(), d.X(), d.Y(), Pixmap->Alpha());
+    SetDirty();
+    MarkDrawPortDirty(d);
 }
 
 void cOglPixmap::Copy(const cPixmap *Pixmap, const cRect &Source, const cPoint &Dest) {
-    esyslog("[softhddev] Copy %d %d %d not implemented in OpenGl OSD", Pixmap->ViewPort().X(), Source.X(), Dest.X());
+    if (!oglThread->Active())
+        return;
+    const cOglPixmap *pm = dynamic_cast<const cOglPixmap *>(Pixmap);
+    if (!pm)
+        return;
+    LOCK_PIXMAPS;
+    cRect s = Source.Intersected(Pixmap->DrawPort().Size());
+    if (s.IsEmpty())
+        return;
+    cPoint v = Dest - Source.Point();
+    cRect d = s.Shifted(v).Intersected(DrawPort().Size());
+    if (d.IsEmpty())
+        return;
+    s = d.Shifted(-v);
+    oglThread->DoCmd<cOglCmdCopyFb>(fb, pm->fb, s.X(), s.Y(), d.Width(), d.Height(), d.X(), d.Y());
+    SetDirty();
+    MarkDrawPortDirty(d);
 }
 
 void cOglPixmap::Scroll(const cPoint &Dest, const cRect &Source) {
-    esyslog("[softhddev] Scroll %d %d not implemented in OpenGl OSD", Source.X(), Dest.X());
+    if (!oglThread->Active())
+        return;
+    LOCK_PIXMAPS;
+    cRect s;
+    if (&Source == &cRect::Null)
+        s = DrawPort().Size();
+    else
+        s = Source.Intersected(DrawPort().Size());
+    if (s.IsEmpty())
+        return;
+    cPoint v = Dest - Source.Point();
+    cRect d = s.Shifted(v).Intersected(DrawPort().Size());
+    if (d.IsEmpty())
+        return;
+    s = d.Shifted(-v);
+    if (d.Point() == s.Point())
+        return;
+    oglThread->DoCmd<cOglCmdCopyFb>(fb, fb, s.X(), s.Y(), d.Width(), d.Height(), d.X(), d.Y());
+    SetDirty();
+    MarkDrawPortDirty(d);
 }
 
 void cOglPixmap::Pan(const cPoint &Dest, const cRect &Source) {
-    esyslog("[softhddev] Pan %d %d not implemented in OpenGl OSD", Source.X(), Dest.X());
+    if (!oglThread->Active())
+        return;
+    LOCK_PIXMAPS;
+    cRect s;
+    if (&Source == &cRect::Null)
+        s = DrawPort().Size();
+    else
+        s = Source.Intersected(DrawPort().Size());
+    if (s.IsEmpty())
+        return;
+    cPoint v = Dest - Source.Point();
+    cRect d = s.Shifted(v).Intersected(DrawPort().Size());
+    if (d.IsEmpty())
+        return;
+    s = d.Shifted(-v);
+    if (d.Point() == s.Point())
+        return;
+    oglThread->DoCmd<cOglCmdCopyFb>(fb, fb, s.X(), s.Y(), d.Width(), d.Height(), d.X(), d.Y());
+    SetDirty();
+    //move the draw port along, so the view port shows the same content
+    SetDrawPortPoint(DrawPort().Point().Shifted(-v), false);
 }
 
 /******************************************************************************
@@ -2006,22 +2520,26 @@ cOglOsd::cOglOsd(int Left, int Top, uint Level, std::shared_ptr<cOglThread> oglT
     //create output framebuffer
     if (!oFb) {
         oFb = new cOglOutputFb(osdWidth, osdHeight);
-        oglThread->DoCmd(new cOglCmdInitOutputFb(oFb));
-        oglThread->DoCmd(new cOglCmdFill(oFb, clrTransparent));
+        oglThread->DoCmd<cOglCmdInitOutputFb>(oFb);
+        oglThread->DoCmd<cOglCmdFill>(oFb, clrTransparent);
     }
 }
 
 cOglOsd::~cOglOsd() {
+    cOsdFlushPacer::Forget(this);
     if (!bFb) return;
-    oglThread->DoCmd(new cOglCmdFill(bFb, clrTransparent));
-    oglThread->DoCmd(new cOglCmdCopyBufferToOutputFb(bFb, oFb, Left() + (isSubtitleOsd ? oglPixmaps[0]->ViewPort().X() : 0),
-        Top() + (isSubtitleOsd ? oglPixmaps[0]->ViewPort().Y() : 0)));
+    oglThread->DoCmd<cOglCmdFill>(bFb, clrTransparent);
+    oglThread->DoCmd<cOglCmdCopyBufferToOutputFb>(bFb, oFb, Left() + (isSubtitleOsd ? oglPixmaps[0]->ViewPort().X() : 0),
+        Top() + (isSubtitleOsd ? oglPixmaps[0]->ViewPort().Y() : 0));
     OsdClose();
     SetActive(false);
-    oglThread->DoCmd(new cOglCmdDeleteFb(bFb));
+    oglThread->DoCmd<cOglCmdDeleteFb>(bFb);
 }
 
 eOsdError cOglOsd::SetAreas(const tArea *Areas, int NumAreas) {
+    //no deferred flush of the old areas, the pacer must not see bFb replaced
+    cOsdFlushPacer::Forget(this);
+    LOCK_PIXMAPS;
     cRect r;
     if (NumAreas > 1)
         isSubtitleOsd = true;
@@ -2034,12 +2552,13 @@ eOsdError cOglOsd::SetAreas(const tArea *Areas, int NumAreas) {
 
     //now we know the actuaL osd size, create double buffer frame buffer
     if (bFb) {
-        oglThread->DoCmd(new cOglCmdDeleteFb(bFb));
+        oglThread->DoCmd<cOglCmdDeleteFb>(bFb);
         DestroyPixmap(oglPixmaps[0]);
     }
     bFb = new cOglFb(r.Width(), r.Height(), r.Width(), r.Height());
+    damage = cRect(0, 0, r.Width(), r.Height());
     cCondWait initiated;
-    oglThread->DoCmd(new cOglCmdInitFb(bFb, &initiated));
+    oglThread->DoCmd<cOglCmdInitFb>(bFb, &initiated);
     initiated.Wait();
 
     return cOsd::SetAreas(&area, 1);
@@ -2085,8 +2604,10 @@ void cOglOsd::DestroyPixmap(cPixmap *Pixmap) {
         start = 0;
     for (int i = start; i < oglPixmaps.Size(); i++) {
         if (oglPixmaps[i] == Pixmap) {
-            if (Pixmap->Layer() >= 0)
+            if (Pixmap->Layer() >= 0) {
                 oglPixmaps[0]->SetDirty();
+                damage.Combine(Pixmap->ViewPort());
+            }
             oglPixmaps[i] = NULL;
             cOsd::DestroyPixmap(Pixmap);
             return;
@@ -2097,39 +2618,64 @@ void cOglOsd::DestroyPixmap(cPixmap *Pixmap) {
 void cOglOsd::Flush(void) {
     if (!oglThread->Active())
         return;
+    //at most one presentation per display frame, the damage stays pending
+    if (cOsdFlushPacer::Defer(this))
+        return;
     LOCK_PIXMAPS;
-    //check if any pixmap is dirty
+    //check if any pixmap is dirty and collect the damaged osd area
     bool dirty = false;
-    for (int i = 0; i < oglPixmaps.Size() && !dirty; i++)
-        if (oglPixmaps[i] && oglPixmaps[i]->Layer() >= 0 && oglPixmaps[i]->IsDirty())
-            dirty = true;
-    if (!dirty)
+    cRect area = damage;
+    for (int i = 0; i < oglPixmaps.Size(); i++) {
+        if (oglPixmaps[i]) {
+            if (oglPixmaps[i]->Layer() >= 0 && oglPixmaps[i]->IsDirty())
+                dirty = true;
+            area.Combine(oglPixmaps[i]->Damaged());
+        }
+    }
+    //subtitle pixmaps are all rendered at the buffer origin, always recompose everything
+    if (isSubtitleOsd) {
+        if (!dirty && area.IsEmpty())
+            return;
+        area = cRect(0, 0, bFb->Width(), bFb->Height());
+    } else
+        area = area.Intersected(cRect(0, 0, bFb->Width(), bFb->Height()));
+    damage = cRect();
+    if (area.IsEmpty()) {
+        for (int i = 0; i < oglPixmaps.Size(); i++)
+            if (oglPixmaps[i])
+                oglPixmaps[i]->SetDirty(false);
         return;
-    //clear buffer
+    }
+    //clear damaged area of buffer
     //uint64_t start = cTimeMs::Now();
     //dsyslog("[softhddev]Start Flush at %" PRIu64 "", cTimeMs::Now());
-    oglThread->DoCmd(new cOglCmdFill(bFb, clrTransparent));
+    oglThread->DoCmd<cOglCmdFill>(bFb, clrTransparent, area.X(), area.Y(), area.Width(), area.Height());
 
-    //render pixmap textures blended to buffer
+    //render the damaged parts of the pixmap textures blended to buffer
     for (int layer = 0; layer < MAXPIXMAPLAYERS; layer++) {
         for (int i = 0; i < oglPixmaps.Size(); i++) {
             if (oglPixmaps[i]) {
                 if (oglPixmaps[i]->Layer() == layer) {
-                    oglThread->DoCmd(new cOglCmdRenderFbToBufferFb( oglPixmaps[i]->Fb(),
-                                                                    bFb,
-                                                                    isSubtitleOsd ? 0 : oglPixmaps[i]->ViewPort().X(),
-                                                                    isSubtitleOsd ? 0 : oglPixmaps[i]->ViewPort().Y(),
-                                                                    oglPixmaps[i]->Alpha(),
-                                                                    oglPixmaps[i]->DrawPort().X(),
-                                                                    oglPixmaps[i]->DrawPort().Y()));
-                    oglPixmaps[i]->SetDirty(false);
+                    if (isSubtitleOsd || !oglPixmaps[i]->ViewPort().Intersected(area).IsEmpty())
+                        oglThread->DoCmd<cOglCmdRenderFbToBufferFb>( oglPixmaps[i]->Fb(),
+                                                                        bFb,
+                                                                        isSubtitleOsd ? 0 : oglPixmaps[i]->ViewPort().X(),
+                                                                        isSubtitleOsd ? 0 : oglPixmaps[i]->ViewPort().Y(),
+                                                                        oglPixmaps[i]->Alpha(),
+                                                                        oglPixmaps[i]->DrawPort().X(),
+                                                                        oglPixmaps[i]->DrawPort().Y(),
+                                                                        area.X(), area.Y(), area.Width(), area.Height());
                 }
             }
         }
     }
-    //copy buffer to output framebuffer
-    oglThread->DoCmd(new cOglCmdCopyBufferToOutputFb(bFb, oFb, Left() + (isSubtitleOsd ? oglPixmaps[0]->ViewPort().X() : 0),
-        Top() + (isSubtitleOsd ? oglPixmaps[0]->ViewPort().Y() : 0)));
+    for (int i = 0; i < oglPixmaps.Size(); i++)
+        if (oglPixmaps[i])
+            oglPixmaps[i]->SetDirty(false);
+    //copy damaged area of buffer to output framebuffer
+    oglThread->DoCmd<cOglCmdCopyBufferToOutputFb>(bFb, oFb, Left() + (isSubtitleOsd ? oglPixmaps[0]->ViewPort().X() : 0),
+        Top() + (isSubtitleOsd ? oglPixmaps[0]->ViewPort().Y() : 0), area.X(), area.Y(), area.Width(), area.Height());
+    OsdFlushPresented();
     //dsyslog("[softhddev]End Flush at %" PRIu64 ", duration %d", cTimeMs::Now(), (int)(cTimeMs::Now()-start));
 }
 
@@ -27,7 +27,10 @@ const struct {
 
 
 #include <memory>
-#include <queue>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <unordered_map>
 
 //#include <vdr/plugin.h>
 #include <vdr/osd.h>
@@ -46,10 +49,17 @@ extern "C"
 }
 
 struct sOglImage {
-    GLuint texture;
+    GLuint texture;             // texture and size are written by the thread only
     GLint width;
     GLint height;
-    bool used;
+    bool used;                  // cache bookkeeping, guarded by the cOglThread lock
+    int refs;                   // handles given out by StoreImage()
+    cSize imageSize;            // size of the stored image, known before the texture
+    uint64_t hash;              // content hash for deduplication
+    uint64_t lastUse;           // lru tick of the last store or drop
+    long size;                  // texture memory in bytes, 0 when the store failed
+    tColor *data;               // pixels compared on a hash match, freed by the drop
+    tColor *failedData;         // pixels of a failed store, written by the thread only
 };
 
 /****************************************************************************************
@@ -92,24 +102,14 @@ public:
 ****************************************************************************************/
 class cOglGlyph : public cListObject {
 private:
-    struct tKerning {
-        public:
-            tKerning(uint prevSym, GLfloat kerning = 0.0f)  {
-                this->prevSym = prevSym;
-                this->kerning = kerning;
-            }
-            uint prevSym;
-            GLfloat kerning;
-    };
     uint charCode;
     int bearingLeft;
     int bearingTop;
     int width;
     int height;
-    int advanceX;      
-    cVector<tKerning> kerningCache;
-    GLuint texture;
-    void LoadTexture(FT_BitmapGlyph ftGlyph);
+    int advanceX;
+    int page;
+    GLfloat texX1, texY1, texX2, texY2;
 public:
     cOglGlyph(uint charCode, FT_BitmapGlyph ftGlyph);
     virtual ~cOglGlyph();
@@ -119,14 +119,20 @@ public:
     int BearingTop(void) const { return bearingTop; }
     int Width(void) const { return width; }
     int Height(void) const { return height; }
-    int GetKerningCache(uint prevSym);
-    void SetKerningCache(uint prevSym, int kerning);
-    void BindTexture(void);
+    void SetAtlas(int page, GLfloat x1, GLfloat y1, GLfloat x2, GLfloat y2);
+    int Page(void) const { return page; }
+    GLfloat TexX1(void) const { return texX1; }
+    GLfloat TexY1(void) const { return texY1; }
+    GLfloat TexX2(void) const { return texX2; }
+    GLfloat TexY2(void) const { return texY2; }
 };
 
 /****************************************************************************************
 * cOglFont
+* glyphs of a font are packed into rows of atlas textures (pages)
 ****************************************************************************************/
+#define OGL_ATLAS_SIZE 1024
+
 class cOglFont : public cListObject {
 private:
     static bool initiated;
@@ -138,8 +144,13 @@ private:
     FT_Face face;
     static cList<cOglFont> *fonts;
     mutable cList<cOglGlyph> glyphCache;
+    mutable std::unordered_map<uint, cOglGlyph *> glyphIndex;
+    mutable std::unordered_map<uint64_t, int> kerningCache;
+    mutable std::vector<GLuint> atlasPages;
+    mutable int atlasX, atlasY, atlasRowHeight;
     cOglFont(const char *fontName, int charHeight);
     static void Init(void);
+    void AddToAtlas(cOglGlyph *glyph, FT_BitmapGlyph ftGlyph) const;
 public:
     virtual ~cOglFont(void);
     static cOglFont *Get(const char *name, int charHeight);
@@ -150,6 +161,7 @@ public:
     int Height(void) {return height; };
     cOglGlyph* Glyph(uint charCode) const;
     int Kerning(cOglGlyph *glyph, uint prevSym) const;
+    void BindAtlas(int page) const;
 };
 
 /****************************************************************************************
@@ -205,8 +217,6 @@ public:
 ****************************************************************************************/
 enum eVertexBufferType {
     vbRect,
-    vbEllipse,
-    vbSlope,
     vbTexture,
     vbText,
     vbCount
@@ -221,6 +231,7 @@ private:
     int sizeVertex1;
     int sizeVertex2;
     int numVertices;
+    int maxVertices;
     GLuint drawMode;
 public:
     cOglVb(int type);
@@ -238,6 +249,30 @@ public:
     void DrawArrays(int count = 0);
 };
 
+/****************************************************************************************
+* cOglPrimitives
+* Batches consecutive rectangles, ellipses and slopes of one framebuffer
+* into a single triangle list, tessellations are cached by shape
+****************************************************************************************/
+class cOglPrimitives {
+private:
+    static cOglFb *fb;
+    static std::vector<GLfloat> vertices;
+    static std::unordered_map<uint64_t, std::vector<GLfloat>> tessellations;
+    static unsigned int primitives;
+    static unsigned int batches;
+    static const std::vector<GLfloat> &Tessellation(int kind, GLint width, GLint height, GLint param);
+    static void Add(cOglFb *fb, const std::vector<GLfloat> &triangles, GLfloat x, GLfloat y, GLint color);
+public:
+    static void AddRectangle(cOglFb *fb, GLint x, GLint y, GLint width, GLint height, GLint color);
+    static void AddEllipse(cOglFb *fb, GLint x, GLint y, GLint width, GLint height, GLint color, GLint quadrants);
+    static void AddSlope(cOglFb *fb, GLint x, GLint y, GLint width, GLint height, GLint color, GLint type);
+    static void Flush(void);
+    static void Cleanup(void);
+    static unsigned int Primitives(void) { return primitives; };
+    static unsigned int Batches(void) { return batches; };
+};
+
 /****************************************************************************************
 * cOpenGLCmd
 ****************************************************************************************/
@@ -249,6 +284,7 @@ public:
     virtual ~cOglCmd(void) {};
     virtual const char* Description(void) = 0;
     virtual bool Execute(void) = 0;
+    virtual bool Batched(void) { return false; };
 };
 
 class cOglCmdInitOutputFb : public cOglCmd {
@@ -285,19 +321,43 @@ private:
     GLfloat x, y;
     GLfloat drawPortX, drawPortY;
     GLint transparency;
+    GLint clipX, clipY;
+    GLint clipWidth, clipHeight;
 public:
-    cOglCmdRenderFbToBufferFb(cOglFb *fb, cOglFb *buffer, GLint x, GLint y, GLint transparency, GLint drawPortX, GLint drawPortY);
+    cOglCmdRenderFbToBufferFb(cOglFb *fb, cOglFb *buffer, GLint x, GLint y, GLint transparency, GLint drawPortX, GLint drawPortY,
+                              GLint clipX = 0, GLint clipY = 0, GLint clipWidth = 0, GLint clipHeight = 0);
     virtual ~cOglCmdRenderFbToBufferFb(void) {};
     virtual const char* Description(void) { return "Render Framebuffer to Buffer"; }
     virtual bool Execute(void);
 };
 
+class cOglCmdCopyFb : public cOglCmd {
+private:
+    static cOglFb *scratch;
+    cOglFb *source;
+    GLint sx, sy;
+    GLint width, height;
+    GLint dx, dy;
+    GLint alpha;
+    static cOglFb *Scratch(GLint width, GLint height);
+    void BlitRect(cOglFb *src, GLint srcX, GLint srcY, cOglFb *dst, GLint dstX, GLint dstY);
+public:
+    cOglCmdCopyFb(cOglFb *fb, cOglFb *source, GLint sx, GLint sy, GLint width, GLint height, GLint dx, GLint dy, GLint alpha = -1);
+    virtual ~cOglCmdCopyFb(void) {};
+    virtual const char* Description(void) { return alpha < 0 ? "Copy Framebuffer" : "Render Framebuffer"; }
+    virtual bool Execute(void);
+    static void Cleanup(void);
+};
+
 class cOglCmdCopyBufferToOutputFb : public cOglCmd {
 private:
     cOglOutputFb *oFb;
     GLint x, y;
+    GLint areaX, areaY;
+    GLint areaWidth, areaHeight;
 public:
-    cOglCmdCopyBufferToOutputFb(cOglFb *fb, cOglOutputFb *oFb, GLint x, GLint y);
+    cOglCmdCopyBufferToOutputFb(cOglFb *fb, cOglOutputFb *oFb, GLint x, GLint y,
+                                GLint areaX = 0, GLint areaY = 0, GLint areaWidth = 0, GLint areaHeight = 0);
     virtual ~cOglCmdCopyBufferToOutputFb(void) {};
     virtual const char* Description(void) { return "Copy buffer to OutputFramebuffer"; }
     virtual bool Execute(void);
@@ -306,8 +366,10 @@ public:
 class cOglCmdFill : public cOglCmd {
 private:
     GLint color;
+    GLint x, y;
+    GLint width, height;
 public:
-    cOglCmdFill(cOglFb *fb, GLint color);
+    cOglCmdFill(cOglFb *fb, GLint color, GLint x = 0, GLint y = 0, GLint width = 0, GLint height = 0);
     virtual ~cOglCmdFill(void) {};
     virtual const char* Description(void) { return "Fill"; }
     virtual bool Execute(void);
@@ -323,6 +385,7 @@ public:
     virtual ~cOglCmdDrawRectangle(void) {};
     virtual const char* Description(void) { return "DrawRectangle"; }
     virtual bool Execute(void);
+    virtual bool Batched(void) { return true; };
 };
 
 class cOglCmdDrawEllipse : public cOglCmd {
@@ -331,14 +394,12 @@ private:
     GLint width, height;
     GLint color;
     GLint quadrants;
-    GLfloat *CreateVerticesFull(int &numVertices);
-    GLfloat *CreateVerticesQuadrant(int &numVertices);
-    GLfloat *CreateVerticesHalf(int &numVertices); 
 public:
     cOglCmdDrawEllipse(cOglFb *fb, GLint x, GLint y, GLint width, GLint height, GLint color, GLint quadrants);
     virtual ~cOglCmdDrawEllipse(void) {};
     virtual const char* Description(void) { return "DrawEllipse"; }
     virtual bool Execute(void);
+    virtual bool Batched(void) { return true; };
 };
 
 class cOglCmdDrawSlope : public cOglCmd {
@@ -352,6 +413,7 @@ public:
     virtual ~cOglCmdDrawSlope(void) {};
     virtual const char* Description(void) { return "DrawSlope"; }
     virtual bool Execute(void);
+    virtual bool Batched(void) { return true; };
 };
 
 class cOglCmdDrawText : public cOglCmd {
@@ -362,6 +424,7 @@ private:
     cString fontName;
     int fontSize;
     unsigned int *symbols;
+    void DrawVertices(cOglFont *f, int page, std::vector<GLfloat> &vertices);
 public:
     cOglCmdDrawText(cOglFb *fb, GLint x, GLint y, unsigned int *symbols, GLint limitX, const char *name, int fontSize, tColor colorText);
     virtual ~cOglCmdDrawText(void);
@@ -397,9 +460,10 @@ class cOglCmdStoreImage : public cOglCmd {
 private:
     sOglImage *imageRef;
     tColor *data;
+    GLint width, height;
 public:
-    cOglCmdStoreImage(sOglImage *imageRef, tColor *argb);
-    virtual ~cOglCmdStoreImage(void);
+    cOglCmdStoreImage(sOglImage *imageRef, tColor *argb, GLint width, GLint height);
+    virtual ~cOglCmdStoreImage(void) {};
     virtual const char* Description(void) { return "Store Image"; }
     virtual bool Execute(void);
 };
@@ -407,10 +471,10 @@ public:
 class cOglCmdDropImage : public cOglCmd {
 private:
     sOglImage *imageRef;
-    cCondWait *wait;
+    tColor *data;
 public:
-    cOglCmdDropImage(sOglImage *imageRef, cCondWait *wait);
-    virtual ~cOglCmdDropImage(void) {};
+    cOglCmdDropImage(sOglImage *imageRef, tColor *data);
+    virtual ~cOglCmdDropImage(void);
     virtual const char* Description(void) { return "Drop Image"; }
     virtual bool Execute(void);
 };
@@ -419,18 +483,40 @@ public:
 * cOglThread
 ******************************************************************************/
 #define OGL_MAX_OSDIMAGES 256
-#define OGL_CMDQUEUE_SIZE 100
+#define OGL_CMDQUEUE_SIZE 256           // power of 2
+#define OGL_CMD_INLINE_SIZE 128         // commands constructed inside the slot
+#define OGL_HISTOGRAM_SIZE 16           // log2 buckets
+
+// slot of the bounded command ring, seq == pos: free, seq == pos + 1: filled
+struct sOglCmdSlot {
+    unsigned int seq;
+    unsigned int pos;
+    cOglCmd *cmd;
+    bool inlined;
+    alignas(16) char storage[OGL_CMD_INLINE_SIZE];
+};
 
 class cOglThread : public cThread {
 private:
     cCondWait *startWait;
-    cCondWait *wait;
-    bool stalled;
-    std::queue<cOglCmd*> commands;
+    cCondWait dataWait;
+    cCondWait spaceWait;
+    sOglCmdSlot slots[OGL_CMDQUEUE_SIZE];
+    unsigned int enqueuePos;
+    unsigned int dequeuePos;
+    bool consumerSleeping;
+    bool producersWaiting;
+    unsigned int depthHistogram[OGL_HISTOGRAM_SIZE];
+    unsigned int timeHistogram[OGL_HISTOGRAM_SIZE];
     GLint maxTextureSize;
     sOglImage imageCache[OGL_MAX_OSDIMAGES];
     long memCached;
     long maxCacheSize;
+    uint64_t imageTick;
+    unsigned int imageHits;
+    unsigned int imageMisses;
+    unsigned int imageEvictions;
+    unsigned int imageFailures;
     bool InitOpenGL(void);
     bool InitShaders(void);
     void DeleteShaders(void);
@@ -438,19 +524,43 @@ private:
     bool InitVertexBuffers(void);
     void DeleteVertexBuffers(void);
     void Cleanup(void);
-    int GetFreeSlot(void);
-    void ClearSlot(int slot);
+    bool StoreFailed(int i);
+    int FindImage(uint64_t hash, const cImage &image);
+    bool EvictImages(long size);
+    void FreeImage(int i);
+    sOglCmdSlot *ClaimSlot(void);
+    void PublishSlot(sOglCmdSlot *slot);
+    sOglCmdSlot *FilledSlot(void);
+    void ReleaseSlot(sOglCmdSlot *slot);
+    template<class T, typename... Args> static cOglCmd *NewCmd(std::true_type, void *storage, Args... args) {
+        return new (storage) T(args...);
+    }
+    template<class T, typename... Args> static cOglCmd *NewCmd(std::false_type, void *, Args... args) {
+        return new T(args...);
+    }
 protected:
     virtual void Action(void);
 public:
     cOglThread(cCondWait *startWait, int maxCacheSize);
     virtual ~cOglThread();
     void Stop(void);
-    void DoCmd(cOglCmd* cmd);
+    // construct command T(args) in the command ring, blocks while full
+    template<class T, typename... Args> void DoCmd(Args... args) {
+        sOglCmdSlot *slot = ClaimSlot();
+        if (!slot) {    // thread gone, drop command and the data it owns
+            T *cmd = new T(args...);
+            delete cmd;
+            return;
+        }
+        slot->inlined = sizeof(T) <= sizeof(slot->storage);
+        slot->cmd = NewCmd<T>(std::integral_constant<bool, sizeof(T) <= OGL_CMD_INLINE_SIZE>(), slot->storage, args...);
+        PublishSlot(slot);
+    }
     int StoreImage(const cImage &image);
     void DropImageData(int imageHandle);
-    sOglImage *GetImageRef(int slot);
+    sOglImage *GetImageRef(int slot, cSize &size);
     int MaxTextureSize(void) { return maxTextureSize; };
+    cString Stats(void);
 };
 
 /****************************************************************************************
@@ -461,6 +571,9 @@ private:
     cOglFb *fb;
     std::shared_ptr<cOglThread> oglThread;
     bool dirty;
+    cRect damage;
+protected:
+    void MarkDrawPortDirty(const cRect &Rect);
 public:
     cOglPixmap(std::shared_ptr<cOglThread> oglThread, int Layer, const cRect &ViewPort, const cRect &DrawPort = cRect::Null);
     virtual ~cOglPixmap(void);
@@ -468,7 +581,10 @@ public:
     int X(void) { return ViewPort().X(); };
     int Y(void) { return ViewPort().Y(); };
     virtual bool IsDirty(void) { return dirty; }
-    virtual void SetDirty(bool dirty = true) { this->dirty = dirty; }
+    virtual void SetDirty(bool dirty = true) { this->dirty = dirty; if (!dirty) damage = cRect(); }
+    void Damage(const cRect &Rect);
+    const cRect &Damaged(void) { return damage; };
+    virtual void SetLayer(int Layer);
     virtual void SetAlpha(int Alpha);
     virtual void SetTile(bool Tile);
     virtual void SetViewPort(const cRect &Rect);
@@ -498,6 +614,7 @@ private:
     std::shared_ptr<cOglThread> oglThread;
     cVector<cOglPixmap *> oglPixmaps;
     bool isSubtitleOsd;
+    cRect damage;
 protected:
 public:
     cOglOsd(int Left, int Top, uint Level, std::shared_ptr<cOglThread> oglThread);
@@ -0,0 +1,1078 @@
+///
+///	@file osdrender.c	@brief CPU OSD renderer module
+///
+///	Copyright (c) 2026 by the softhddevice contributors.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	@defgroup OsdRender The CPU OSD renderer module.
+///
+///	Software implementation of the OpenGL OSD command set: fill,
+///	rectangle, ellipse, slope, glyph masks, images and pixmap blends.
+///
+///	Surfaces hold premultiplied ARGB, all drawing is blended source
+///	over destination like the OpenGL OSD does.  The blend kernels are
+///	available as scalar reference and as SSE2, AVX2 or NEON version,
+///	all of them round the same way (x * a / 255 exact) and produce
+///	identical pixels.
+///
+///	The module is a test harness, it isn't linked into the plugin.
+///	Without a GL context VDR's cPixmapMemory still renders the OSD.
+///	Build the benchmark with 'make osdrender_test' to time typical
+///	skin workloads and to check the simd kernels against the scalar
+///	reference.  The GL path isn't compared against it.
+///
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "osdrender.h"
+
+#define OSD_RENDER_LINE_MAX	4096	///< max. width of an image line
+
+int OsdRenderSimd = 1;			///< use simd kernels
+
+//----------------------------------------------------------------------------
+//	Pixel arithmetic
+//----------------------------------------------------------------------------
+
+///
+///	Multiply the four channels of a pixel with a (0 .. 255).
+///
+///	Red/blue and alpha/green are calculated as pairs of 16bit lanes,
+///	each channel is rounded exact to (x * a) / 255.
+///
+static inline uint32_t OsdPixelMul(uint32_t p, uint32_t a)
+{
+    uint32_t rb;
+    uint32_t ag;
+
+    rb = (p & 0x00FF00FF) * a + 0x00800080;
+    ag = ((p >> 8) & 0x00FF00FF) * a + 0x00800080;
+    rb = ((rb + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    ag = (ag + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+    return rb | ag;
+}
+
+///
+///	Premultiplied source over destination.
+///
+static inline uint32_t OsdPixelOver(uint32_t d, uint32_t s)
+{
+    return s + OsdPixelMul(d, 255 - (s >> 24));
+}
+
+///
+///	Premultiply a straight VDR color.
+///
+///	@param argb	color 0xAARRGGBB
+///
+uint32_t OsdPremultiply(uint32_t argb)
+{
+    uint32_t a;
+
+    a = argb >> 24;
+    return (OsdPixelMul(argb, a) & 0x00FFFFFF) | (a << 24);
+}
+
+//----------------------------------------------------------------------------
+//	Scalar kernels
+//----------------------------------------------------------------------------
+
+///
+///	Blend span of premultiplied pixels, scalar reference.
+///
+static void OsdBlendSpanC(uint32_t * dst, const uint32_t * src, int n,
+    int alpha)
+{
+    int i;
+
+    if (alpha == 255) {
+	for (i = 0; i < n; ++i) {
+	    dst[i] = OsdPixelOver(dst[i], src[i]);
+	}
+	return;
+    }
+    for (i = 0; i < n; ++i) {
+	dst[i] = OsdPixelOver(dst[i], OsdPixelMul(src[i], alpha));
+    }
+}
+
+///
+///	Blend span of one premultiplied color, scalar reference.
+///
+static void OsdColorSpanC(uint32_t * dst, uint32_t color, int n)
+{
+    int i;
+
+    for (i = 0; i < n; ++i) {
+	dst[i] = OsdPixelOver(dst[i], color);
+    }
+}
+
+//----------------------------------------------------------------------------
+//	SIMD kernels
+//----------------------------------------------------------------------------
+
+#if defined(__SSE2__)
+
+///
+///	Multiply 16bit lanes, rounded exact to (x * a) / 255.
+///
+static inline __m128i OsdMulSSE2(__m128i x, __m128i a)
+{
+    __m128i t;
+
+    t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+///
+///	Premultiplied source over destination, four pixels.
+///
+static inline __m128i OsdOverSSE2(__m128i d, __m128i s, __m128i alpha,
+    int modulate)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ff = _mm_set1_epi16(255);
+    __m128i slo;
+    __m128i shi;
+    __m128i alo;
+    __m128i ahi;
+    __m128i dlo;
+    __m128i dhi;
+
+    slo = _mm_unpacklo_epi8(s, zero);
+    shi = _mm_unpackhi_epi8(s, zero);
+    if (modulate) {
+	slo = OsdMulSSE2(slo, alpha);
+	shi = OsdMulSSE2(shi, alpha);
+    }
+    // broadcast alpha lane of each pixel
+    alo = _mm_sub_epi16(ff, _mm_shufflehi_epi16(_mm_shufflelo_epi16(slo,
+		0xFF), 0xFF));
+    ahi = _mm_sub_epi16(ff, _mm_shufflehi_epi16(_mm_shufflelo_epi16(shi,
+		0xFF), 0xFF));
+    dlo = OsdMulSSE2(_mm_unpacklo_epi8(d, zero), alo);
+    dhi = OsdMulSSE2(_mm_unpackhi_epi8(d, zero), ahi);
+
+    return _mm_add_epi8(_mm_packus_epi16(slo, shi), _mm_packus_epi16(dlo,
+	    dhi));
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+///
+///	Multiply 16bit lanes, rounded exact to (x * a) / 255.
+///
+static inline __m256i OsdMulAVX2(__m256i x, __m256i a)
+{
+    __m256i t;
+
+    t = _mm256_add_epi16(_mm256_mullo_epi16(x, a), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)),
+	8);
+}
+
+///
+///	Premultiplied source over destination, eight pixels.
+///
+///	Unpack and pack work inside the 128bit lanes, the pixel order is
+///	kept.
+///
+static inline __m256i OsdOverAVX2(__m256i d, __m256i s, __m256i alpha,
+    int modulate)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ff = _mm256_set1_epi16(255);
+    __m256i slo;
+    __m256i shi;
+    __m256i alo;
+    __m256i ahi;
+    __m256i dlo;
+    __m256i dhi;
+
+    slo = _mm256_unpacklo_epi8(s, zero);
+    shi = _mm256_unpackhi_epi8(s, zero);
+    if (modulate) {
+	slo = OsdMulAVX2(slo, alpha);
+	shi = OsdMulAVX2(shi, alpha);
+    }
+    alo = _mm256_sub_epi16(ff,
+	_mm256_shufflehi_epi16(_mm256_shufflelo_epi16(slo, 0xFF), 0xFF));
+    ahi = _mm256_sub_epi16(ff,
+	_mm256_shufflehi_epi16(_mm256_shufflelo_epi16(shi, 0xFF), 0xFF));
+    dlo = OsdMulAVX2(_mm256_unpacklo_epi8(d, zero), alo);
+    dhi = OsdMulAVX2(_mm256_unpackhi_epi8(d, zero), ahi);
+
+    return _mm256_add_epi8(_mm256_packus_epi16(slo, shi),
+	_mm256_packus_epi16(dlo, dhi));
+}
+
+#endif
+
+#if defined(__ARM_NEON)
+
+///
+///	Multiply 8bit lanes, rounded exact to (x * a) / 255.
+///
+static inline uint8x16_t OsdMulNEON(uint8x16_t x, uint8x16_t a)
+{
+    uint16x8_t lo;
+    uint16x8_t hi;
+
+    lo = vaddq_u16(vmull_u8(vget_low_u8(x), vget_low_u8(a)),
+	vdupq_n_u16(128));
+    hi = vaddq_u16(vmull_u8(vget_high_u8(x), vget_high_u8(a)),
+	vdupq_n_u16(128));
+    return vcombine_u8(vshrn_n_u16(vsraq_n_u16(lo, lo, 8), 8),
+	vshrn_n_u16(vsraq_n_u16(hi, hi, 8), 8));
+}
+
+///
+///	Premultiplied source over destination, sixteen pixels.
+///
+///	The pixels are loaded deinterleaved, one vector per channel.
+///
+static inline uint8x16x4_t OsdOverNEON(uint8x16x4_t d, uint8x16x4_t s,
+    uint8x16_t alpha, int modulate)
+{
+    uint8x16_t ia;
+    int c;
+
+    if (modulate) {
+	for (c = 0; c < 4; ++c) {
+	    s.val[c] = OsdMulNEON(s.val[c], alpha);
+	}
+    }
+    ia = vmvnq_u8(s.val[3]);
+    for (c = 0; c < 4; ++c) {
+	d.val[c] = vaddq_u8(s.val[c], OsdMulNEON(d.val[c], ia));
+    }
+    return d;
+}
+
+#endif
+
+///
+///	Blend span of premultiplied pixels.
+///
+///	@param dst	destination pixels
+///	@param src	premultiplied source pixels
+///	@param n	number of pixels
+///	@param alpha	global alpha of source (0 .. 255)
+///
+static void OsdBlendSpan(uint32_t * dst, const uint32_t * src, int n,
+    int alpha)
+{
+    int i;
+
+    i = 0;
+    if (OsdRenderSimd) {
+#if defined(__AVX2__)
+	{
+	    __m256i a8;
+
+	    a8 = _mm256_set1_epi16(alpha);
+	    for (; i + 8 <= n; i += 8) {
+		__m256i d;
+		__m256i s;
+
+		d = _mm256_loadu_si256((const __m256i *)(dst + i));
+		s = _mm256_loadu_si256((const __m256i *)(src + i));
+		_mm256_storeu_si256((__m256i *) (dst + i), OsdOverAVX2(d, s, a8,
+			alpha != 255));
+	    }
+	}
+#endif
+#if defined(__SSE2__)
+	{
+	    __m128i a4;
+
+	    a4 = _mm_set1_epi16(alpha);
+	    for (; i + 4 <= n; i += 4) {
+		__m128i d;
+		__m128i s;
+
+		d = _mm_loadu_si128((const __m128i *)(dst + i));
+		s = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *) (dst + i), OsdOverSSE2(d, s, a4,
+			alpha != 255));
+	    }
+	}
+#endif
+#if defined(__ARM_NEON)
+	{
+	    uint8x16_t a16;
+
+	    a16 = vdupq_n_u8(alpha);
+	    for (; i + 16 <= n; i += 16) {
+		uint8x16x4_t d;
+		uint8x16x4_t s;
+
+		d = vld4q_u8((const uint8_t *)(dst + i));
+		s = vld4q_u8((const uint8_t *)(src + i));
+		vst4q_u8((uint8_t *) (dst + i), OsdOverNEON(d, s, a16,
+			alpha != 255));
+	    }
+	}
+#endif
+    }
+    OsdBlendSpanC(dst + i, src + i, n - i, alpha);
+}
+
+///
+///	Blend span of one premultiplied color.
+///
+///	@param dst	destination pixels
+///	@param color	premultiplied color
+///	@param n	number of pixels
+///
+static void OsdColorSpan(uint32_t * dst, uint32_t color, int n)
+{
+    int i;
+
+    if (n <= 0) {
+	return;
+    }
+    if ((color >> 24) == 0xFF) {	// opaque, plain store
+	for (i = 0; i < n; ++i) {
+	    dst[i] = color;
+	}
+	return;
+    }
+    if (!color) {			// transparent, nothing to blend
+	return;
+    }
+    i = 0;
+    if (OsdRenderSimd) {
+#if defined(__AVX2__)
+	{
+	    __m256i s8;
+
+	    s8 = _mm256_set1_epi32(color);
+	    for (; i + 8 <= n; i += 8) {
+		__m256i d;
+
+		d = _mm256_loadu_si256((const __m256i *)(dst + i));
+		_mm256_storeu_si256((__m256i *) (dst + i), OsdOverAVX2(d, s8,
+			s8, 0));
+	    }
+	}
+#endif
+#if defined(__SSE2__)
+	{
+	    __m128i s4;
+
+	    s4 = _mm_set1_epi32(color);
+	    for (; i + 4 <= n; i += 4) {
+		__m128i d;
+
+		d = _mm_loadu_si128((const __m128i *)(dst + i));
+		_mm_storeu_si128((__m128i *) (dst + i), OsdOverSSE2(d, s4, s4,
+			0));
+	    }
+	}
+#endif
+#if defined(__ARM_NEON)
+	{
+	    uint8x16x4_t s16;
+
+	    s16.val[0] = vdupq_n_u8(color);
+	    s16.val[1] = vdupq_n_u8(color >> 8);
+	    s16.val[2] = vdupq_n_u8(color >> 16);
+	    s16.val[3] = vdupq_n_u8(color >> 24);
+	    for (; i + 16 <= n; i += 16) {
+		uint8x16x4_t d;
+
+		d = vld4q_u8((const uint8_t *)(dst + i));
+		vst4q_u8((uint8_t *) (dst + i), OsdOverNEON(d, s16, s16.val[3],
+			0));
+	    }
+	}
+#endif
+    }
+    OsdColorSpanC(dst + i, color, n - i);
+}
+
+//----------------------------------------------------------------------------
+//	Primitives
+//----------------------------------------------------------------------------
+
+///
+///	Blend color span of one line, clipped to the surface.
+///
+static void OsdRenderRow(OsdSurface * surface, int x1, int x2, int y,
+    uint32_t color)
+{
+    if (y < 0 || y >= surface->Height) {
+	return;
+    }
+    if (x1 < 0) {
+	x1 = 0;
+    }
+    if (x2 > surface->Width) {
+	x2 = surface->Width;
+    }
+    if (x1 < x2) {
+	OsdColorSpan(surface->Data + y * surface->Pitch + x1, color,
+	    x2 - x1);
+    }
+}
+
+///
+///	Fill whole surface with color, no blending.
+///
+///	@param surface	render target
+///	@param color	straight VDR color
+///
+void OsdRenderFill(OsdSurface * surface, uint32_t color)
+{
+    uint32_t *p;
+    int x;
+    int y;
+
+    color = OsdPremultiply(color);
+    for (y = 0; y < surface->Height; ++y) {
+	p = surface->Data + y * surface->Pitch;
+	for (x = 0; x < surface->Width; ++x) {
+	    p[x] = color;
+	}
+    }
+}
+
+///
+///	Blend rectangle.
+///
+///	@param surface	render target
+///	@param x	left position
+///	@param y	top position
+///	@param width	width of rectangle
+///	@param height	height of rectangle
+///	@param color	straight VDR color
+///
+void OsdRenderRectangle(OsdSurface * surface, int x, int y, int width,
+    int height, uint32_t color)
+{
+    int i;
+
+    color = OsdPremultiply(color);
+    for (i = 0; i < height; ++i) {
+	OsdRenderRow(surface, x, x + width, y + i, color);
+    }
+}
+
+///
+///	Blend ellipse or quadrants of it.
+///
+///	@param surface	render target
+///	@param x	left position
+///	@param y	top position
+///	@param width	width of bounding rectangle
+///	@param height	height of bounding rectangle
+///	@param color	straight VDR color
+///	@param quadrants	like cPixmap::DrawEllipse, 0 full, 1-4
+///	quadrant, 5-8 half, negative the inverted part
+///
+///	A pixel belongs to the ellipse, if its center is inside.
+///
+void OsdRenderEllipse(OsdSurface * surface, int x, int y, int width,
+    int height, uint32_t color, int quadrants)
+{
+    double cx;
+    double cy;
+    double rx;
+    double ry;
+    int inverted;
+    int i;
+
+    if (width <= 0 || height <= 0) {
+	return;
+    }
+    color = OsdPremultiply(color);
+    inverted = quadrants < 0;
+    if (inverted) {
+	quadrants = -quadrants;
+    }
+    // center and radii, the rectangle holds the given part of the ellipse
+    cx = x + width / 2.0;
+    cy = y + height / 2.0;
+    rx = width / 2.0;
+    ry = height / 2.0;
+    switch (quadrants) {
+	case 1:			// upper right
+	    cx = x;
+	    cy = y + height;
+	    rx = width;
+	    ry = height;
+	    break;
+	case 2:			// upper left
+	    cx = x + width;
+	    cy = y + height;
+	    rx = width;
+	    ry = height;
+	    break;
+	case 3:			// lower left
+	    cx = x + width;
+	    cy = y;
+	    rx = width;
+	    ry = height;
+	    break;
+	case 4:			// lower right
+	    cx = x;
+	    cy = y;
+	    rx = width;
+	    ry = height;
+	    break;
+	case 5:			// right half
+	    cx = x;
+	    rx = width;
+	    break;
+	case 6:			// top half
+	    cy = y + height;
+	    ry = height;
+	    break;
+	case 7:			// left half
+	    cx = x + width;
+	    rx = width;
+	    break;
+	case 8:			// bottom half
+	    cy = y;
+	    ry = height;
+	    break;
+	default:
+	    break;
+    }
+
+    for (i = 0; i < height; ++i) {
+	double dy;
+	double dx;
+	int x1;
+	int x2;
+
+	dy = (y + i + 0.5 - cy) / ry;
+	if (dy * dy >= 1.0) {
+	    x1 = x2 = x;
+	} else {
+	    dx = rx * sqrt(1.0 - dy * dy);
+	    // first and behind last pixel with center inside
+	    x1 = (int)ceil(cx - dx - 0.5);
+	    x2 = (int)floor(cx + dx - 0.5) + 1;
+	    if (x1 < x) {
+		x1 = x;
+	    }
+	    if (x2 > x + width) {
+		x2 = x + width;
+	    }
+	    if (x2 < x1) {
+		x2 = x1;
+	    }
+	}
+	if (inverted) {
+	    OsdRenderRow(surface, x, x1, y + i, color);
+	    OsdRenderRow(surface, x2, x + width, y + i, color);
+	} else {
+	    OsdRenderRow(surface, x1, x2, y + i, color);
+	}
+    }
+}
+
+///
+///	Blend slope.
+///
+///	@param surface	render target
+///	@param x	left position
+///	@param y	top position
+///	@param width	width of bounding rectangle
+///	@param height	height of bounding rectangle
+///	@param color	straight VDR color
+///	@param type	like cPixmap::DrawSlope, bit 0 upper, bit 1 falling,
+///	bit 2 vertical
+///
+void OsdRenderSlope(OsdSurface * surface, int x, int y, int width,
+    int height, uint32_t color, int type)
+{
+    int upper;
+    int falling;
+    int i;
+
+    if (width <= 0 || height <= 0) {
+	return;
+    }
+    color = OsdPremultiply(color);
+    upper = type & 0x01;
+    falling = type & 0x02;
+
+    if (type & 0x04) {			// vertical
+	for (i = 0; i < height; ++i) {
+	    double c;
+	    int m;
+
+	    c = cos(i * M_PI / height);
+	    if (falling) {
+		c = -c;
+	    }
+	    m = x + (width - 1) / 2 + (int)(width * c / 2);
+	    if ((upper && !falling) || (!upper && falling)) {
+		OsdRenderRow(surface, x, m + 1, y + i, color);
+	    } else {
+		OsdRenderRow(surface, m, x + width, y + i, color);
+	    }
+	}
+	return;
+    }
+    for (i = 0; i < width; ++i) {
+	double c;
+	int m;
+	int j;
+
+	c = cos(i * M_PI / width);
+	if (falling) {
+	    c = -c;
+	}
+	m = y + (height - 1) / 2 + (int)(height * c / 2);
+	if (upper) {
+	    for (j = y; j <= m && j < y + height; ++j) {
+		OsdRenderRow(surface, x + i, x + i + 1, j, color);
+	    }
+	} else {
+	    for (j = m < y ? y : m; j < y + height; ++j) {
+		OsdRenderRow(surface, x + i, x + i + 1, j, color);
+	    }
+	}
+    }
+}
+
+///
+///	Blend color through 8bit coverage mask.
+///
+///	@param surface	render target
+///	@param x	left position
+///	@param y	top position
+///	@param mask	coverage 0 .. 255, like a freetype glyph bitmap
+///	@param pitch	bytes from mask line to line
+///	@param width	width of mask
+///	@param height	height of mask
+///	@param color	straight VDR color
+///
+void OsdRenderMask(OsdSurface * surface, int x, int y, const uint8_t * mask,
+    int pitch, int width, int height, uint32_t color)
+{
+    int i;
+    int j;
+    int j1;
+    int j2;
+
+    color = OsdPremultiply(color);
+    j1 = x < 0 ? -x : 0;
+    j2 = x + width > surface->Width ? surface->Width - x : width;
+    for (i = 0; i < height; ++i) {
+	const uint8_t *m;
+	uint32_t *p;
+
+	if (y + i < 0 || y + i >= surface->Height) {
+	    continue;
+	}
+	m = mask + i * pitch;
+	p = surface->Data + (y + i) * surface->Pitch + x;
+	for (j = j1; j < j2; ++j) {
+	    if (m[j] == 0xFF) {
+		p[j] = OsdPixelOver(p[j], color);
+	    } else if (m[j]) {
+		p[j] = OsdPixelOver(p[j], OsdPixelMul(color, m[j]));
+	    }
+	}
+    }
+}
+
+///
+///	Blend straight ARGB image.
+///
+///	@param surface	render target
+///	@param x	left position
+///	@param y	top position
+///	@param argb	image pixels, straight VDR colors
+///	@param width	width of image
+///	@param height	height of image
+///
+void OsdRenderImage(OsdSurface * surface, int x, int y,
+    const uint32_t * argb, int width, int height)
+{
+    uint32_t line[OSD_RENDER_LINE_MAX];
+    int i;
+    int j;
+    int j1;
+    int j2;
+
+    j1 = x < 0 ? -x : 0;
+    j2 = x + width > surface->Width ? surface->Width - x : width;
+    if (j2 - j1 > OSD_RENDER_LINE_MAX) {
+	j2 = j1 + OSD_RENDER_LINE_MAX;
+    }
+    if (j1 >= j2) {
+	return;
+    }
+    for (i = 0; i < height; ++i) {
+	const uint32_t *s;
+
+	if (y + i < 0 || y + i >= surface->Height) {
+	    continue;
+	}
+	s = argb + i * width;
+	for (j = j1; j < j2; ++j) {
+	    line[j - j1] = OsdPremultiply(s[j]);
+	}
+	OsdBlendSpan(surface->Data + (y + i) * surface->Pitch + x + j1, line,
+	    j2 - j1, 255);
+    }
+}
+
+///
+///	Blend surface with alpha.
+///
+///	@param dst	render target
+///	@param x	left destination position
+///	@param y	top destination position
+///	@param src	premultiplied source surface
+///	@param sx	left source position
+///	@param sy	top source position
+///	@param width	width of area
+///	@param height	height of area
+///	@param alpha	global alpha of source (0 .. 255)
+///
+void OsdRenderBlend(OsdSurface * dst, int x, int y, const OsdSurface * src,
+    int sx, int sy, int width, int height, int alpha)
+{
+    int i;
+
+    if (alpha <= 0) {
+	return;
+    }
+    if (alpha > 255) {
+	alpha = 255;
+    }
+    // clip to source and destination
+    if (sx < 0) {
+	x -= sx;
+	width += sx;
+	sx = 0;
+    }
+    if (sy < 0) {
+	y -= sy;
+	height += sy;
+	sy = 0;
+    }
+    if (x < 0) {
+	sx -= x;
+	width += x;
+	x = 0;
+    }
+    if (y < 0) {
+	sy -= y;
+	height += y;
+	y = 0;
+    }
+    if (sx + width > src->Width) {
+	width = src->Width - sx;
+    }
+    if (sy + height > src->Height) {
+	height = src->Height - sy;
+    }
+    if (x + width > dst->Width) {
+	width = dst->Width - x;
+    }
+    if (y + height > dst->Height) {
+	height = dst->Height - y;
+    }
+    if (width <= 0 || height <= 0) {
+	return;
+    }
+
+    for (i = 0; i < height; ++i) {
+	OsdBlendSpan(dst->Data + (y + i) * dst->Pitch + x,
+	    src->Data + (sy + i) * src->Pitch + sx, width, alpha);
+    }
+}
+
+#ifdef OSDRENDER_TEST
+
+//----------------------------------------------------------------------------
+//	Benchmark
+//----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <time.h>
+
+#define BENCH_WIDTH	1920		///< osd width
+#define BENCH_HEIGHT	1080		///< osd height
+
+static OsdSurface BenchSurface;		///< render target
+static OsdSurface BenchLayer;		///< pixmap blended to target
+static uint8_t BenchGlyph[24 * 16];	///< antialiased glyph mask
+static uint32_t BenchLogo[220 * 164];	///< channel logo image
+
+///
+///	Simple deterministic random numbers.
+///
+///	@returns random number 0 .. 65535
+///
+static unsigned BenchRandom(void)
+{
+    static uint32_t seed = 0x1234567;
+
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) & 0xFFFF;
+}
+
+///
+///	Monotonic time in us.
+///
+static int64_t BenchTime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+}
+
+///
+///	Allocate surface.
+///
+static void BenchAlloc(OsdSurface * surface)
+{
+    surface->Width = BENCH_WIDTH;
+    surface->Height = BENCH_HEIGHT;
+    surface->Pitch = BENCH_WIDTH;
+    surface->Data = calloc(BENCH_WIDTH * BENCH_HEIGHT, sizeof(uint32_t));
+    if (!surface->Data) {
+	fprintf(stderr, "out of memory\n");
+	exit(1);
+    }
+}
+
+///
+///	Menu page of a rounded corner skin.
+///
+static void BenchMenu(OsdSurface * surface)
+{
+    int i;
+
+    OsdRenderRectangle(surface, 80, 60, 1760, 960, 0xC0202838);
+    for (i = 0; i < 200; ++i) {
+	int x;
+	int y;
+	uint32_t color;
+
+	x = 100 + (i % 4) * 430;
+	y = 80 + (i / 4) * 18;
+	color = i & 1 ? 0xE0405070 : 0x80506080;
+	OsdRenderRectangle(surface, x + 8, y, 400 - 16, 16, color);
+	OsdRenderEllipse(surface, x, y, 8, 8, color, 2);
+	OsdRenderEllipse(surface, x + 392, y, 8, 8, color, 1);
+	OsdRenderEllipse(surface, x, y + 8, 8, 8, color, 3);
+	OsdRenderEllipse(surface, x + 392, y + 8, 8, 8, color, 4);
+	OsdRenderSlope(surface, x + 200, y, 32, 16, color, i & 7);
+    }
+}
+
+///
+///	Text lines of antialiased glyphs.
+///
+static void BenchText(OsdSurface * surface)
+{
+    int l;
+    int c;
+
+    for (l = 0; l < 40; ++l) {
+	for (c = 0; c < 100; ++c) {
+	    OsdRenderMask(surface, 100 + c * 16, 60 + l * 24, BenchGlyph, 16,
+		16, 24, 0xFFE0E0E0);
+	}
+    }
+}
+
+///
+///	Channel logos with transparent edges.
+///
+static void BenchImages(OsdSurface * surface)
+{
+    int i;
+
+    for (i = 0; i < 20; ++i) {
+	OsdRenderImage(surface, 60 + (i % 8) * 230, 100 + (i / 8) * 300,
+	    BenchLogo, 220, 164);
+    }
+}
+
+///
+///	Full screen pixmap layers.
+///
+static void BenchBlend(OsdSurface * surface)
+{
+    OsdRenderBlend(surface, 0, 0, &BenchLayer, 0, 0, BENCH_WIDTH,
+	BENCH_HEIGHT, 255);
+    OsdRenderBlend(surface, 0, 0, &BenchLayer, 0, 0, BENCH_WIDTH,
+	BENCH_HEIGHT, 200);
+}
+
+    /// workloads of the benchmark
+static const struct
+{
+    const char *Name;			///< name of workload
+    void (*Render) (OsdSurface *);	///< render function
+} BenchWorkloads[] = {
+    {"menu", BenchMenu},
+    {"text", BenchText},
+    {"images", BenchImages},
+    {"blend", BenchBlend},
+};
+
+#define BENCH_WORKLOADS	(sizeof(BenchWorkloads) / sizeof(*BenchWorkloads))
+
+///
+///	Run one workload, returns us per run.
+///
+static int64_t BenchRun(int w, int loops, uint32_t * result)
+{
+    int64_t start;
+    int64_t best;
+    int i;
+
+    best = INT64_MAX;
+    for (i = 0; i < loops; ++i) {
+	int64_t t;
+
+	OsdRenderFill(&BenchSurface, 0x40102030);
+	start = BenchTime();
+	BenchWorkloads[w].Render(&BenchSurface);
+	t = BenchTime() - start;
+	if (t < best) {
+	    best = t;
+	}
+    }
+    memcpy(result, BenchSurface.Data,
+	BENCH_WIDTH * BENCH_HEIGHT * sizeof(uint32_t));
+    return best;
+}
+
+///
+///	Print usage.
+///
+static void PrintUsage(void)
+{
+    printf("Usage: osdrender_test [-?h] [-l loops]\n"
+	"\t-l loops\tbest of loops runs (default 10)\n");
+}
+
+///
+///	Main entry point.
+///
+int main(int argc, char *const argv[])
+{
+    uint32_t *reference;
+    uint32_t *result;
+    int loops;
+    int failed;
+    unsigned w;
+    int i;
+
+    loops = 10;
+    for (;;) {
+	switch (getopt(argc, argv, "hl:")) {
+	    case 'l':
+		loops = atoi(optarg);
+		continue;
+	    case EOF:
+		break;
+	    case 'h':
+	    default:
+		PrintUsage();
+		return 0;
+	}
+	break;
+    }
+    if (loops < 1) {
+	loops = 1;
+    }
+
+    BenchAlloc(&BenchSurface);
+    BenchAlloc(&BenchLayer);
+    reference = malloc(BENCH_WIDTH * BENCH_HEIGHT * sizeof(uint32_t));
+    result = malloc(BENCH_WIDTH * BENCH_HEIGHT * sizeof(uint32_t));
+    if (!reference || !result) {
+	fprintf(stderr, "out of memory\n");
+	return 1;
+    }
+    // glyph with soft edges, logo and layer with varying alpha
+    for (i = 0; i < 24 * 16; ++i) {
+	BenchGlyph[i] = (i % 16) * 17 ^ (i / 16) * 11;
+    }
+    for (i = 0; i < 220 * 164; ++i) {
+	BenchLogo[i] = (BenchRandom() << 16 | BenchRandom()) | (i % 220 < 20
+	    ? 0x40000000 : 0xFF000000);
+    }
+    for (i = 0; i < BENCH_WIDTH * BENCH_HEIGHT; ++i) {
+	BenchLayer.Data[i] = OsdPremultiply(BenchRandom() << 16 | BenchRandom());
+    }
+
+    printf("%-8s %12s %12s\n", "workload", "scalar us", "simd us");
+    failed = 0;
+    for (w = 0; w < BENCH_WORKLOADS; ++w) {
+	int64_t scalar;
+	int64_t simd;
+
+	OsdRenderSimd = 0;
+	scalar = BenchRun(w, loops, reference);
+	OsdRenderSimd = 1;
+	simd = BenchRun(w, loops, result);
+	if (memcmp(reference, result,
+		BENCH_WIDTH * BENCH_HEIGHT * sizeof(uint32_t))) {
+	    printf("%s: simd differs from scalar reference\n",
+		BenchWorkloads[w].Name);
+	    failed = 1;
+	}
+	printf("%-8s %12" PRId64 " %12" PRId64 "\n", BenchWorkloads[w].Name,
+	    scalar, simd);
+    }
+
+    free(result);
+    free(reference);
+    free(BenchLayer.Data);
+    free(BenchSurface.Data);
+
+    return failed;
+}
+
+#endif
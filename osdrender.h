@@ -0,0 +1,66 @@
+///
+///	@file osdrender.h	@brief CPU OSD renderer module header file
+///
+///	Copyright (c) 2026 by the softhddevice contributors.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+/// @addtogroup OsdRender
+/// @{
+
+    /// render target, premultiplied ARGB
+typedef struct _osd_surface_
+{
+    uint32_t *Data;			///< pixels, 0xAARRGGBB premultiplied
+    int Width;				///< width in pixels
+    int Height;				///< height in pixels
+    int Pitch;				///< pixels from line to line
+} OsdSurface;
+
+    /// flag use simd kernels, 0 selects the scalar reference
+extern int OsdRenderSimd;
+
+    /// premultiply a straight VDR color
+extern uint32_t OsdPremultiply(uint32_t);
+
+    /// fill whole surface with color, no blending
+extern void OsdRenderFill(OsdSurface *, uint32_t);
+
+    /// blend rectangle
+extern void OsdRenderRectangle(OsdSurface *, int, int, int, int, uint32_t);
+
+    /// blend ellipse or quadrants of it
+extern void OsdRenderEllipse(OsdSurface *, int, int, int, int, uint32_t,
+    int);
+
+    /// blend slope
+extern void OsdRenderSlope(OsdSurface *, int, int, int, int, uint32_t, int);
+
+    /// blend color through 8bit coverage mask (glyphs)
+extern void OsdRenderMask(OsdSurface *, int, int, const uint8_t *, int, int,
+    int, uint32_t);
+
+    /// blend straight ARGB image
+extern void OsdRenderImage(OsdSurface *, int, int, const uint32_t *, int,
+    int);
+
+    /// blend surface with alpha
+extern void OsdRenderBlend(OsdSurface *, int, int, const OsdSurface *, int,
+    int, int, int, int);
+
+/// @}
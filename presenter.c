@@ -0,0 +1,758 @@
+///
+///	@file presenter.c	@brief Frame presenter module
+///
+///	Copyright (c) 2026 by the softhddevice contributors.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	@defgroup Presenter The frame presenter module.
+///
+///	Schedules decoded frames against predicted vsync times.
+///
+///	The display clock is fitted from the times of the displayed
+///	vsyncs, the source frame duration is detected from the pts of the
+///	queued frames.  A phase accumulator advances by one vsync period
+///	each vsync and by one frame duration each shown frame, this gives a
+///	stable cadence (2:2 for 25p on 50Hz, 3:2 for 24p on 60Hz, ...).
+///	The phase is slowly pulled to the audio clock, only big errors
+///	resync it at once.
+///
+///	The module has no hardware dependencies, build the simulator with
+///	'make presenter_test' to replay pts traces against a virtual vsync.
+///
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "presenter.h"
+
+    /// no pts value, same as AV_NOPTS_VALUE
+#define PRESENTER_NOPTS	((int64_t) INT64_C(0x8000000000000000))
+
+#define PRESENTER_PERIOD	20000000	///< default vsync period in ns
+#define PRESENTER_LATENCY	2	///< vsyncs from next vsync to visible
+#define PRESENTER_GAIN	16		///< phase correction divider
+#define PRESENTER_FIT_MAX	64	///< vsync fit running mean length
+#define PRESENTER_FIT_START	8	///< vsyncs before missed are detected
+
+///
+///	Convert ns into fixed point 1/90000s.
+///
+static inline int64_t PresenterNsToFrac(int64_t ns)
+{
+    return ns * 90 * PRESENTER_FRAC / 1000000;
+}
+
+///
+///	Reset presenter for new stream.
+///
+///	The fitted display clock is kept, only the display changes it.
+///
+///	@param presenter	frame presenter
+///
+void PresenterReset(VideoPresenter * presenter)
+{
+    presenter->LastPTS = PRESENTER_NOPTS;
+    presenter->FrameDuration = 0;
+    presenter->DurationChanges = 0;
+    presenter->Phase = 0;
+    presenter->Threshold = 0;
+    presenter->Locked = 0;
+    presenter->Shown = 0;
+    presenter->CadenceMin = 0;
+    presenter->CadenceMax = 0;
+    presenter->Starved = 0;
+    presenter->Frames = 0;
+    presenter->Judder = 0;
+    presenter->Drops = 0;
+    presenter->Resyncs = 0;
+}
+
+///
+///	Initialize presenter.
+///
+///	@param presenter	frame presenter
+///
+void PresenterInit(VideoPresenter * presenter)
+{
+    memset(presenter, 0, sizeof(*presenter));
+    presenter->VsyncPeriod = PRESENTER_PERIOD;
+    PresenterReset(presenter);
+}
+
+///
+///	New frame queued for display.
+///
+///	Single outliers (missing or broken pts) are ignored, a changed
+///	frame rate is taken after some frames.
+///
+///	@param presenter	frame presenter
+///	@param pts		presentation time stamp of the frame
+///
+void PresenterFrame(VideoPresenter * presenter, int64_t pts)
+{
+    int64_t delta;
+
+    if (pts == PRESENTER_NOPTS) {
+	return;
+    }
+    if (presenter->LastPTS != PRESENTER_NOPTS) {
+	delta = (pts - presenter->LastPTS) * PRESENTER_FRAC;
+	// 10 - 200 frames/s, else stream jump
+	if (delta >= 5 * 90 * PRESENTER_FRAC
+	    && delta <= 100 * 90 * PRESENTER_FRAC) {
+	    if (!presenter->FrameDuration
+		|| presenter->DurationChanges >= 3) {
+		presenter->FrameDuration = delta;
+		presenter->DurationChanges = 0;
+	    } else if (llabs(delta - presenter->FrameDuration) >
+		presenter->FrameDuration / 8) {
+		presenter->DurationChanges++;
+	    } else {
+		presenter->FrameDuration +=
+		    (delta - presenter->FrameDuration) / 16;
+		presenter->DurationChanges = 0;
+	    }
+	}
+    }
+    presenter->LastPTS = pts;
+}
+
+///
+///	Feed time of a displayed vsync.
+///
+///	The display loop calls this after each swap.  Late swaps and
+///	missed vsyncs are detected against the fitted period.
+///
+///	@param presenter	frame presenter
+///	@param time		monotonic time of the vsync in ns
+///
+///	@returns number of vsyncs since the last call.
+///
+int PresenterVsync(VideoPresenter * presenter, int64_t time)
+{
+    int64_t delta;
+    int64_t period;
+    int64_t predicted;
+    int64_t err;
+    int n;
+
+    if (!presenter->VsyncTime) {
+	presenter->VsyncTime = time;
+	return presenter->Vsyncs = 0;
+    }
+    delta = time - presenter->VsyncTime;
+    period = presenter->VsyncPeriod;
+    if (delta < period / 2) {		// same vsync
+	return presenter->Vsyncs = 0;
+    }
+    // start: each call is one vsync, take the running mean
+    if (presenter->VsyncCount < PRESENTER_FIT_START) {
+	if (presenter->VsyncCount && delta > period + period / 2) {
+	    presenter->VsyncTime = time;	// missed one, ignore
+	    return presenter->Vsyncs = 2;
+	}
+	presenter->VsyncCount++;
+	presenter->VsyncPeriod += (delta - period) / presenter->VsyncCount;
+	presenter->VsyncTime = time;
+	return presenter->Vsyncs = 1;
+    }
+
+    n = (delta + period / 2) / period;
+    predicted = presenter->VsyncTime + n * period;
+    err = time - predicted;
+    if (n > 4 || llabs(err) > period / 4) {
+	// display loop stalled or display mode changed
+	presenter->VsyncTime = time;
+	if (n == 1) {
+	    presenter->VsyncCount = 0;
+	}
+	return presenter->Vsyncs = n;
+    }
+    if (presenter->VsyncCount < PRESENTER_FIT_MAX) {
+	presenter->VsyncCount++;
+    }
+    presenter->VsyncPeriod += err / n / presenter->VsyncCount;
+    // swap returns late with jitter, smooth the vsync time
+    presenter->VsyncTime = predicted + err / 4;
+
+    return presenter->Vsyncs = n;
+}
+
+///
+///	Update cadence from frame duration and vsync period.
+///
+///	@param presenter	frame presenter
+///	@param period		vsync period (frac)
+///
+static void PresenterUpdateCadence(VideoPresenter * presenter, int64_t period)
+{
+    int64_t ratio;
+
+    // vsyncs per frame in 1/64
+    ratio = (presenter->FrameDuration * 64 + period / 2) / period;
+    presenter->CadenceMin = ratio / 64;
+    presenter->CadenceMax = (ratio + 63) / 64;
+    if (ratio % 64 == 1) {
+	presenter->CadenceMax = presenter->CadenceMin;
+    } else if (ratio % 64 == 63) {
+	presenter->CadenceMin = presenter->CadenceMax;
+    }
+}
+
+///
+///	Decide number of frames to advance for the next vsync.
+///
+///	Called once per vsync after PresenterVsync().
+///
+///	@param presenter	frame presenter
+///	@param now		monotonic time in ns
+///	@param audio_pts	audio clock incl. audio/video delay
+///	@param filled		number of queued frames incl. shown frame
+///
+///	@returns number of frames to advance, -1 if the presenter can't
+///	decide yet (no frame rate, display clock or audio clock).
+///
+int PresenterDecide(VideoPresenter * presenter, int64_t now,
+    int64_t audio_pts, int filled)
+{
+    int64_t duration;
+    int64_t period;
+    int64_t shown_pts;
+    int64_t ahead;
+    int64_t offset;
+    int64_t err;
+    int64_t center;
+    int n;
+
+    presenter->Starved = 0;
+    duration = presenter->FrameDuration;
+    if (!duration || presenter->VsyncCount < PRESENTER_FIT_START
+	|| presenter->LastPTS == PRESENTER_NOPTS || filled < 1
+	|| audio_pts == PRESENTER_NOPTS) {
+	presenter->Locked = 0;
+	return -1;
+    }
+    period = PresenterNsToFrac(presenter->VsyncPeriod);
+    PresenterUpdateCadence(presenter, period);
+
+    // measured offset of the target vsync into the shown frame
+    shown_pts = presenter->LastPTS - ((filled - 1) * duration) / PRESENTER_FRAC;
+    ahead = presenter->VsyncTime + (1 + PRESENTER_LATENCY)
+	* presenter->VsyncPeriod - now;
+    offset = (audio_pts - shown_pts) * PRESENTER_FRAC
+	+ PresenterNsToFrac(ahead);
+
+    presenter->Phase += presenter->Vsyncs * period;
+    presenter->Shown += presenter->Vsyncs > 1 ? presenter->Vsyncs - 1 : 0;
+    err = offset - presenter->Phase;
+    if (!presenter->Locked || llabs(err) > 2 * duration) {
+	presenter->Phase = offset;
+	presenter->Threshold = duration / 2;
+	presenter->Locked = 1;
+	presenter->Resyncs++;
+    } else {
+	presenter->Phase += err / PRESENTER_GAIN;
+    }
+
+    // show the frame nearest to the target vsync
+    n = 0;
+    while (presenter->Phase >= presenter->Threshold) {
+	if (n >= filled - 1) {
+	    presenter->Starved = 1;
+	    break;
+	}
+	presenter->Phase -= duration;
+	++n;
+    }
+
+    if (n) {
+	// keep the phase of a new frame centered between the thresholds,
+	// jitter can't flip the cadence then.  Limited to half a vsync, a
+	// real drift still gives a dup or drop.
+	center = presenter->Threshold - duration + period / 2;
+	presenter->Threshold += (presenter->Phase - center) / 32;
+	if (presenter->Threshold > duration / 2 + period / 2) {
+	    presenter->Threshold = duration / 2 + period / 2;
+	} else if (presenter->Threshold < duration / 2 - period / 2) {
+	    presenter->Threshold = duration / 2 - period / 2;
+	}
+
+	if (presenter->Shown && (presenter->Shown < presenter->CadenceMin
+		|| presenter->Shown > presenter->CadenceMax)) {
+	    presenter->Judder++;
+	}
+	presenter->Drops += n - 1;
+	presenter->Frames += n;
+	presenter->Shown = 1;
+    } else {
+	presenter->Shown++;
+    }
+    return n;
+}
+
+///
+///	Get name of detected cadence.
+///
+///	@param presenter	frame presenter
+///
+const char *PresenterCadence(const VideoPresenter * presenter)
+{
+    static const char *const even[] = { "1:1", "2:2", "3:3", "4:4" };
+    int64_t ratio;
+
+    if (!presenter->CadenceMax) {
+	return "-";
+    }
+    if (!presenter->CadenceMin) {	// more frames than vsyncs
+	return "skip";
+    }
+    if (presenter->CadenceMin == presenter->CadenceMax) {
+	return presenter->CadenceMin <= 4 ? even[presenter->CadenceMin - 1]
+	    : "n:n";
+    }
+    // alternating pattern: 1.5 or 2.5 vsyncs per frame
+    ratio = (presenter->FrameDuration * 64)
+	/ PresenterNsToFrac(presenter->VsyncPeriod);
+    if (ratio % 64 >= 31 && ratio % 64 <= 33) {
+	return presenter->CadenceMin == 2 ? "3:2" : "2:1";
+    }
+    return "mixed";
+}
+
+#ifdef PRESENTER_TEST
+
+//----------------------------------------------------------------------------
+//	Simulator
+//----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <getopt.h>
+#include <math.h>
+
+#define SIM_SURFACES	3		///< queued frames, like the decoders
+#define SIM_FRAMES_MAX	(1 << 20)	///< max. frames of a trace
+#define SIM_PHASES	1024		///< fitted phases of the ideal cadence
+
+static int64_t *SimPTS;			///< pts of all frames
+static int SimFrames;			///< number of frames
+static int SimVerbose;			///< print each vsync
+
+///
+///	Simple deterministic random numbers.
+///
+///	@returns random number 0 .. 65535
+///
+static unsigned SimRandom(void)
+{
+    static uint32_t seed = 0x1234567;
+
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) & 0xFFFF;
+}
+
+///
+///	Random jitter.
+///
+///	@param ns	max. jitter in ns
+///
+static int64_t SimJitter(int64_t ns)
+{
+    return (ns * (int64_t) SimRandom()) / 65536;
+}
+
+///
+///	Load pts trace, one pts in 1/90000s per line.
+///
+///	@param name	file name, "-" for stdin
+///
+static int SimLoadTrace(const char *name)
+{
+    FILE *fp;
+    char line[256];
+
+    fp = strcmp(name, "-") ? fopen(name, "r") : stdin;
+    if (!fp) {
+	perror(name);
+	return -1;
+    }
+    SimFrames = 0;
+    while (SimFrames < SIM_FRAMES_MAX && fgets(line, sizeof(line), fp)) {
+	if (line[0] == '#' || line[0] == '\n') {
+	    continue;
+	}
+	SimPTS[SimFrames++] = strtoll(line, NULL, 0);
+    }
+    if (fp != stdin) {
+	fclose(fp);
+    }
+    return SimFrames > 1 ? 0 : -1;
+}
+
+///
+///	Generate pts of a constant frame rate.
+///
+///	@param fps	frames per second
+///	@param seconds	length of the stream
+///
+static void SimGenerate(double fps, int seconds)
+{
+    int i;
+
+    SimFrames = fps * seconds;
+    if (SimFrames > SIM_FRAMES_MAX) {
+	SimFrames = SIM_FRAMES_MAX;
+    }
+    for (i = 0; i < SimFrames; ++i) {
+	SimPTS[i] = 0x100000 + (int64_t) (i * 90000.0 / fps);
+    }
+}
+
+///
+///	Old fixed threshold sync, for comparison.
+///
+///	@param diff[in,out]	smoothed audio/video difference
+///	@param sync[in,out]	sync counter
+///	@param last_pts		pts of last queued frame
+///	@param audio_pts	audio clock
+///	@param filled		queued frames incl. shown frame
+///
+static int SimLegacyDecide(int *diff, int *sync, int64_t last_pts,
+    int64_t audio_pts, int filled)
+{
+    int d;
+
+    if (*sync && (*sync)--) {
+	return 1;
+    }
+    // see VaapiGetClock: 20ms per buffered frame
+    d = last_pts - 20 * 90 * (filled + 2) - audio_pts;
+    d = (*diff + d) / 2;
+    *diff = d;
+    if (d > 100 * 90) {
+	return 0;
+    }
+    if (d > 55 * 90) {
+	*sync = 1;
+	return 0;
+    }
+    if (d < -25 * 90 && filled > 1) {
+	*sync = 1;
+	return 2;
+    }
+    return 1;
+}
+
+///
+///	Count frames off an even cadence.
+///
+///	An exact phase accumulator shows frame i at vsync floor((pts(i) -
+///	pts(0)) / period + phase).  The phases which give the same runs as
+///	the shown frames are kept.  A frame judders, if no kept phase gives
+///	its run, the phase is fitted again from this run.  A slow walk of
+///	the phase isn't counted, each slip of the cadence is.
+///
+///	@param visible	visible time of each frame in ns, -1 dropped
+///	@param first	first frame counted
+///	@param last	last frame counted (excluded)
+///	@param period	vsync period in ns
+///
+///	@returns frames off an even cadence.
+///
+static int SimJudder(const int64_t * visible, int first, int last,
+    int64_t period)
+{
+    static char fit[SIM_PHASES];
+    static char ok[SIM_PHASES];
+    double last_pos;
+    int64_t last_vsync;
+    int judder;
+    int i;
+    int p;
+
+    memset(fit, 1, sizeof(fit));
+    last_pos = 0.0;
+    last_vsync = -1;
+    judder = 0;
+    for (i = first; i < last; ++i) {
+	double pos;
+	int64_t vsync;
+	int hits;
+
+	if (visible[i] < 0) {
+	    continue;
+	}
+	pos = (SimPTS[i] - SimPTS[0]) * 1000000000.0 / 90000 / period;
+	vsync = visible[i] / period;
+	if (last_vsync >= 0) {
+	    hits = 0;
+	    for (p = 0; p < SIM_PHASES; ++p) {
+		double phase;
+
+		phase = (double)p / SIM_PHASES;
+		ok[p] = floor(pos + phase) - floor(last_pos + phase)
+		    == vsync - last_vsync;
+		hits += fit[p] && ok[p];
+	    }
+	    if (!hits) {
+		++judder;
+	    }
+	    for (p = 0; p < SIM_PHASES; ++p) {
+		fit[p] = hits ? fit[p] && ok[p] : ok[p];
+	    }
+	}
+	last_pos = pos;
+	last_vsync = vsync;
+    }
+    return judder;
+}
+
+///
+///	Run the simulation.
+///
+///	@param refresh		display refresh rate in Hz
+///	@param vsync_jitter	max. late swap in ns
+///	@param audio_jitter	max. audio clock jitter in ns
+///	@param legacy		use old threshold sync
+///
+static void SimRun(double refresh, int64_t vsync_jitter,
+    int64_t audio_jitter, int legacy)
+{
+    VideoPresenter presenter[1];
+    int64_t period;
+    int64_t t0;
+    int64_t *visible;
+    int shown;
+    int queued;
+    int vsync;
+    int diff;
+    int sync;
+    int runs;
+    int judder;
+    int drops;
+    int dups;
+    int i;
+    double err;
+    double sum;
+    double sum2;
+    double max;
+
+    PresenterInit(presenter);
+    visible = calloc(SimFrames, sizeof(*visible));
+    period = 1000000000.0 / refresh;
+    // audio clock: first frame due after the pipeline latency
+    t0 = (1 + PRESENTER_LATENCY) * period + 100 * 1000000;
+
+    shown = 0;
+    queued = 0;
+    diff = 0;
+    sync = 0;
+    dups = 0;
+    for (vsync = 1; shown < SimFrames - 1; ++vsync) {
+	int64_t t;
+	int64_t now;
+	int64_t audio_pts;
+	int filled;
+	int n;
+
+	t = vsync * period;
+	// frames chosen now are visible after next vsync + latency
+	while (queued < SimFrames && queued - shown < SIM_SURFACES) {
+	    PresenterFrame(presenter, SimPTS[queued++]);
+	}
+	filled = queued - shown;
+	if (!visible[shown]) {
+	    visible[shown] = t + (1 + PRESENTER_LATENCY) * period;
+	}
+
+	now = t + SimJitter(vsync_jitter);
+	PresenterVsync(presenter, now);
+	now += 1000000;			// sync after display
+	audio_pts = SimPTS[0] + ((now - t0) * 90) / 1000000
+	    + (SimJitter(2 * audio_jitter) - audio_jitter) * 90 / 1000000;
+
+	if (legacy) {
+	    n = SimLegacyDecide(&diff, &sync, SimPTS[queued - 1], audio_pts,
+		filled);
+	    if (n > filled - 1) {
+		n = filled - 1;
+	    }
+	} else {
+	    n = PresenterDecide(presenter, now, audio_pts, filled);
+	    if (n < 0) {		// not yet decided, show frames
+		n = filled > 1;
+	    }
+	}
+	if (!n) {
+	    ++dups;
+	}
+	if (SimVerbose) {
+	    printf("vsync %6d frame %6d filled %d advance %d phase %+6.2fms\n",
+		vsync, shown, filled, n, presenter->Phase / (90.0 *
+		    PRESENTER_FRAC));
+	}
+	while (n--) {
+	    ++shown;
+	    visible[shown] = (vsync + 1 + PRESENTER_LATENCY) * period;
+	    // mark frames dropped by a multiple advance
+	    if (n) {
+		visible[shown] = -1;
+	    }
+	}
+    }
+
+    //
+    //	Statistics: error against ideal time and the even cadence
+    //
+    sum = 0.0;
+    sum2 = 0.0;
+    max = 0.0;
+    drops = 0;
+    runs = 0;
+    for (i = SimFrames / 10; i < shown - 1; ++i) {
+	if (visible[i] < 0) {
+	    ++drops;
+	    continue;
+	}
+	err = (visible[i] - t0 - (SimPTS[i] - SimPTS[0]) * 1000000.0 / 90)
+	    / 1000000.0;
+	sum += err;
+	sum2 += err * err;
+	if (fabs(err) > max) {
+	    max = fabs(err);
+	}
+	++runs;
+    }
+    judder = SimJudder(visible, SimFrames / 10, shown - 1, period);
+    if (!runs) {
+	runs = 1;
+    }
+    printf("%s: %.3fHz display, %d frames, %d vsyncs, cadence %s\n",
+	legacy ? "legacy" : "presenter", refresh, SimFrames, vsync,
+	legacy ? "-" : PresenterCadence(presenter));
+    printf("\trepeated vsyncs %d, dropped frames %d, judder frames %d (%.2f%%)\n",
+	dups, drops, judder, (100.0 * judder) / runs);
+    printf("\ta/v error mean %+.2fms rms %.2fms max %.2fms, resyncs %d\n",
+	sum / runs, sqrt(sum2 / runs), max, presenter->Resyncs);
+    free(visible);
+}
+
+///
+///	Print usage.
+///
+static void PrintUsage(void)
+{
+    printf("Usage: presenter_test [-?hlv] [-f fps] [-r hz] [-s seconds]\n"
+	"\t[-j ms] [-a ms] [-t trace]\n"
+	"\t-f fps\tframe rate of generated stream (default 23.976)\n"
+	"\t-r hz\tdisplay refresh rate (default 50)\n"
+	"\t-s sec\tlength of generated stream (default 60)\n"
+	"\t-j ms\tmax. late vsync time stamp (default 1)\n"
+	"\t-a ms\tmax. audio clock jitter (default 2)\n"
+	"\t-t file\tpts trace, one pts (1/90000s) per line, - for stdin\n"
+	"\t-l\tuse old fixed threshold sync for comparison\n"
+	"\t-v\tprint each vsync\n" "\t-? -h\tdisplay this message\n");
+}
+
+///
+///	Main entry point.
+///
+///	@param argc	number of arguments
+///	@param argv	arguments vector
+///
+///	@returns -1 on failures, 0 clean exit.
+///
+int main(int argc, char *const argv[])
+{
+    double fps;
+    double refresh;
+    int seconds;
+    double vsync_jitter;
+    double audio_jitter;
+    const char *trace;
+    int legacy;
+
+    fps = 23.976;
+    refresh = 50.0;
+    seconds = 60;
+    vsync_jitter = 1.0;
+    audio_jitter = 2.0;
+    trace = NULL;
+    legacy = 0;
+
+    for (;;) {
+	switch (getopt(argc, argv, "hlv?a:f:j:r:s:t:")) {
+	    case 'a':
+		audio_jitter = atof(optarg);
+		continue;
+	    case 'f':
+		fps = atof(optarg);
+		continue;
+	    case 'j':
+		vsync_jitter = atof(optarg);
+		continue;
+	    case 'r':
+		refresh = atof(optarg);
+		continue;
+	    case 's':
+		seconds = atoi(optarg);
+		continue;
+	    case 't':
+		trace = optarg;
+		continue;
+	    case 'l':
+		legacy = 1;
+		continue;
+	    case 'v':
+		SimVerbose = 1;
+		continue;
+	    case EOF:
+		break;
+	    case '?':
+	    case 'h':
+		PrintUsage();
+		return 0;
+	    default:
+		PrintUsage();
+		return -1;
+	}
+	break;
+    }
+    if (fps < 1.0 || refresh < 1.0 || seconds < 1) {
+	PrintUsage();
+	return -1;
+    }
+
+    SimPTS = malloc(SIM_FRAMES_MAX * sizeof(*SimPTS));
+    if (trace) {
+	if (SimLoadTrace(trace)) {
+	    fprintf(stderr, "presenter_test: can't load trace '%s'\n", trace);
+	    return -1;
+	}
+    } else {
+	SimGenerate(fps, seconds);
+    }
+    SimRun(refresh, vsync_jitter * 1000000, audio_jitter * 1000000, legacy);
+    free(SimPTS);
+
+    return 0;
+}
+
+#endif
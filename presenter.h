@@ -0,0 +1,73 @@
+///
+///	@file presenter.h	@brief Frame presenter module header file
+///
+///	Copyright (c) 2026 by the softhddevice contributors.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+/// @addtogroup Presenter
+/// @{
+
+    /// fixed point fraction of frame durations and phase (1/90000s)
+#define PRESENTER_FRAC	256
+
+    /// presenter state, embedded into each video decoder
+typedef struct _video_presenter_
+{
+    int64_t VsyncTime;			///< fitted time of last vsync in ns
+    int64_t VsyncPeriod;		///< fitted vsync period in ns
+    int VsyncCount;			///< number of vsync intervals fitted
+    int Vsyncs;				///< vsyncs since last decision
+
+    int64_t LastPTS;			///< pts of last queued frame
+    int64_t FrameDuration;		///< source frame duration (frac)
+    int DurationChanges;		///< successive off duration deltas
+
+    int64_t Phase;			///< offset of next vsync into frame
+    int64_t Threshold;			///< phase to advance to next frame
+    int Locked;				///< flag phase locked to audio
+    int Shown;				///< vsyncs the current frame is shown
+    int CadenceMin;			///< min. vsyncs per frame of cadence
+    int CadenceMax;			///< max. vsyncs per frame of cadence
+    int Starved;			///< flag no frame for next vsync
+
+    int Frames;				///< number of presented frames
+    int Judder;				///< frames shown outside of cadence
+    int Drops;				///< frames skipped
+    int Resyncs;			///< number of phase resyncs
+} VideoPresenter;
+
+    /// initialize presenter
+extern void PresenterInit(VideoPresenter *);
+
+    /// reset presenter for new stream, keeps display fit
+extern void PresenterReset(VideoPresenter *);
+
+    /// new frame queued for display
+extern void PresenterFrame(VideoPresenter *, int64_t);
+
+    /// feed time of a displayed vsync
+extern int PresenterVsync(VideoPresenter *, int64_t);
+
+    /// decide number of frames to advance for the next vsync
+extern int PresenterDecide(VideoPresenter *, int64_t, int64_t, int);
+
+    /// get name of detected cadence
+extern const char *PresenterCadence(const VideoPresenter *);
+
+/// @}
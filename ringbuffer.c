@@ -25,28 +25,64 @@
 ///
 ///	Lock free ring buffer with only one writer and one reader.
 ///
+///	The buffer memory is mapped twice back to back, if the kernel
+///	supports memfd.  Then any span of the buffer is contiguous and
+///	reads and writes need no split at the end of the buffer.
+///
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
-#include "iatomic.h"
 #include "ringbuffer.h"
 
+#define RING_CACHE_LINE 64		///< keep reader and writer apart
+
     /// ring buffer structure
 struct _ring_buffer_
 {
     char *Buffer;			///< ring buffer data
     const char *BufferEnd;		///< end of buffer
     size_t Size;			///< bytes in buffer (for faster calc)
+    int Mirrored;			///< buffer mapped twice, no splits
 
-    const char *ReadPointer;		///< only used by reader
+    /// only modified by writer
+    size_t Written __attribute__ ((aligned(RING_CACHE_LINE)));
     char *WritePointer;			///< only used by writer
 
-    /// The only thing modified by both
-    atomic_t Filled;			///< how many of the buffer is used
+    /// only modified by reader
+    size_t Read __attribute__ ((aligned(RING_CACHE_LINE)));
+    const char *ReadPointer;		///< only used by reader
 };
 
+int RingBufferMirror = 1;		///< flag use mirrored memory
+
+/**
+**	Get free bytes, seen by the writer.
+**
+**	Acquire pairs with the release of the reader, the freed bytes are
+**	no longer accessed by the reader.
+*/
+static inline size_t RingBufferFree(const RingBuffer * rb)
+{
+    return rb->Size - (rb->Written - __atomic_load_n(&rb->Read,
+	    __ATOMIC_ACQUIRE));
+}
+
+/**
+**	Get used bytes, seen by the reader.
+**
+**	Acquire pairs with the release of the writer, the written bytes
+**	are visible to the reader.
+*/
+static inline size_t RingBufferFilled(const RingBuffer * rb)
+{
+    return __atomic_load_n(&rb->Written, __ATOMIC_ACQUIRE) - rb->Read;
+}
+
 /**
 **	Reset ring buffer pointers.
 **
@@ -56,12 +92,60 @@ void RingBufferReset(RingBuffer * rb)
 {
     rb->ReadPointer = rb->Buffer;
     rb->WritePointer = rb->Buffer;
-    atomic_set(&rb->Filled, 0);
+    __atomic_store_n(&rb->Read, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&rb->Written, 0, __ATOMIC_RELEASE);
+}
+
+/**
+**	Map buffer memory twice back to back.
+**
+**	@param size	Size of the buffer, multiple of the page size.
+**
+**	@returns	Mapped buffer of @p size bytes followed by its
+**			mirror, NULL if not supported.
+*/
+static char *RingBufferMapMirror(size_t size)
+{
+#ifdef MFD_CLOEXEC
+    char *buf;
+    int fd;
+
+    if ((fd = memfd_create("softhddev-ringbuffer", MFD_CLOEXEC)) < 0) {
+	return NULL;
+    }
+    if (ftruncate(fd, size)) {
+	close(fd);
+	return NULL;
+    }
+    // reserve the address range, then map the file twice into it
+    buf = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+	0);
+    if (buf == MAP_FAILED) {
+	close(fd);
+	return NULL;
+    }
+    if (mmap(buf, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+	    0) == MAP_FAILED
+	|| mmap(buf + size, size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+	munmap(buf, 2 * size);
+	close(fd);
+	return NULL;
+    }
+    close(fd);				// mappings keep the memory
+
+    return buf;
+#else
+    (void)size;
+    return NULL;
+#endif
 }
 
 /**
 **	Allocate a new ring buffer.
 **
+**	A mirrored ring buffer is rounded up to the page size.
+**
 **	@param size	Size of the ring buffer.
 **
 **	@returns	Allocated ring buffer, must be freed with
@@ -74,7 +158,19 @@ RingBuffer *RingBufferNew(size_t size)
     if (!(rb = malloc(sizeof(*rb)))) {	// allocate structure
 	return rb;
     }
-    if (!(rb->Buffer = malloc(size))) {	// allocate buffer
+    rb->Mirrored = 0;
+    if (RingBufferMirror) {
+	size_t page;
+	size_t mirror_size;
+
+	page = sysconf(_SC_PAGESIZE);
+	mirror_size = (size + page - 1) / page * page;
+	if ((rb->Buffer = RingBufferMapMirror(mirror_size))) {
+	    rb->Mirrored = 1;
+	    size = mirror_size;
+	}
+    }
+    if (!rb->Mirrored && !(rb->Buffer = malloc(size))) {
 	free(rb);
 	return NULL;
     }
@@ -91,7 +187,11 @@ RingBuffer *RingBufferNew(size_t size)
 */
 void RingBufferDel(RingBuffer * rb)
 {
-    free(rb->Buffer);
+    if (rb->Mirrored) {
+	munmap(rb->Buffer, 2 * rb->Size);
+    } else {
+	free(rb->Buffer);
+    }
     free(rb);
 }
 
@@ -107,28 +207,21 @@ size_t RingBufferWriteAdvance(RingBuffer * rb, size_t cnt)
 {
     size_t n;
 
-    n = rb->Size - atomic_read(&rb->Filled);
+    n = RingBufferFree(rb);
     if (cnt > n) {			// not enough space
 	cnt = n;
     }
     //
     //	Hitting end of buffer?
     //
-    n = rb->BufferEnd - rb->WritePointer;
-    if (n > cnt) {			// don't cross the end
-	rb->WritePointer += cnt;
-    } else {				// reached or cross the end
-	rb->WritePointer = rb->Buffer;
-	if (n < cnt) {
-	    n = cnt - n;
-	    rb->WritePointer += n;
-	}
+    rb->WritePointer += cnt;
+    if (rb->WritePointer >= rb->BufferEnd) {
+	rb->WritePointer -= rb->Size;
     }
-
     //
-    //	Only atomic modification!
+    //	Only shared modification, publishes the written bytes
     //
-    atomic_add(cnt, &rb->Filled);
+    __atomic_store_n(&rb->Written, rb->Written + cnt, __ATOMIC_RELEASE);
     return cnt;
 }
 
@@ -146,7 +239,7 @@ size_t RingBufferWrite(RingBuffer * rb, const void *buf, size_t cnt)
 {
     size_t n;
 
-    n = rb->Size - atomic_read(&rb->Filled);
+    n = RingBufferFree(rb);
     if (cnt > n) {			// not enough space
 	cnt = n;
     }
@@ -154,25 +247,14 @@ size_t RingBufferWrite(RingBuffer * rb, const void *buf, size_t cnt)
     //	Hitting end of buffer?
     //
     n = rb->BufferEnd - rb->WritePointer;
-    if (n > cnt) {			// don't cross the end
+    if (rb->Mirrored || n >= cnt) {	// don't cross the end
 	memcpy(rb->WritePointer, buf, cnt);
-	rb->WritePointer += cnt;
-    } else {				// reached or cross the end
+    } else {				// cross the end
 	memcpy(rb->WritePointer, buf, n);
-	rb->WritePointer = rb->Buffer;
-	if (n < cnt) {
-	    buf += n;
-	    n = cnt - n;
-	    memcpy(rb->WritePointer, buf, n);
-	    rb->WritePointer += n;
-	}
+	memcpy(rb->Buffer, (const char *)buf + n, cnt - n);
     }
 
-    //
-    //	Only atomic modification!
-    //
-    atomic_add(cnt, &rb->Filled);
-    return cnt;
+    return RingBufferWriteAdvance(rb, cnt);
 }
 
 /**
@@ -190,10 +272,12 @@ size_t RingBufferGetWritePointer(RingBuffer * rb, void **wp)
     size_t cnt;
 
     //	Total free bytes available in ring buffer
-    cnt = rb->Size - atomic_read(&rb->Filled);
+    cnt = RingBufferFree(rb);
 
     *wp = rb->WritePointer;
-
+    if (rb->Mirrored) {			// mirror continues after the end
+	return cnt;
+    }
     //
     //	Hitting end of buffer?
     //
@@ -216,28 +300,21 @@ size_t RingBufferReadAdvance(RingBuffer * rb, size_t cnt)
 {
     size_t n;
 
-    n = atomic_read(&rb->Filled);
+    n = RingBufferFilled(rb);
     if (cnt > n) {			// not enough filled
 	cnt = n;
     }
     //
     //	Hitting end of buffer?
     //
-    n = rb->BufferEnd - rb->ReadPointer;
-    if (n > cnt) {			// don't cross the end
-	rb->ReadPointer += cnt;
-    } else {				// reached or cross the end
-	rb->ReadPointer = rb->Buffer;
-	if (n < cnt) {
-	    n = cnt - n;
-	    rb->ReadPointer += n;
-	}
+    rb->ReadPointer += cnt;
+    if (rb->ReadPointer >= rb->BufferEnd) {
+	rb->ReadPointer -= rb->Size;
     }
-
     //
-    //	Only atomic modification!
+    //	Only shared modification, releases the read bytes
     //
-    atomic_sub(cnt, &rb->Filled);
+    __atomic_store_n(&rb->Read, rb->Read + cnt, __ATOMIC_RELEASE);
     return cnt;
 }
 
@@ -254,7 +331,7 @@ size_t RingBufferRead(RingBuffer * rb, void *buf, size_t cnt)
 {
     size_t n;
 
-    n = atomic_read(&rb->Filled);
+    n = RingBufferFilled(rb);
     if (cnt > n) {			// not enough filled
 	cnt = n;
     }
@@ -262,25 +339,14 @@ size_t RingBufferRead(RingBuffer * rb, void *buf, size_t cnt)
     //	Hitting end of buffer?
     //
     n = rb->BufferEnd - rb->ReadPointer;
-    if (n > cnt) {			// don't cross the end
+    if (rb->Mirrored || n >= cnt) {	// don't cross the end
 	memcpy(buf, rb->ReadPointer, cnt);
-	rb->ReadPointer += cnt;
-    } else {				// reached or cross the end
+    } else {				// cross the end
 	memcpy(buf, rb->ReadPointer, n);
-	rb->ReadPointer = rb->Buffer;
-	if (n < cnt) {
-	    buf += n;
-	    n = cnt - n;
-	    memcpy(buf, rb->ReadPointer, n);
-	    rb->ReadPointer += n;
-	}
+	memcpy((char *)buf + n, rb->Buffer, cnt - n);
     }
 
-    //
-    //	Only atomic modification!
-    //
-    atomic_sub(cnt, &rb->Filled);
-    return cnt;
+    return RingBufferReadAdvance(rb, cnt);
 }
 
 /**
@@ -298,10 +364,12 @@ size_t RingBufferGetReadPointer(RingBuffer * rb, const void **rp)
     size_t cnt;
 
     //	Total used bytes in ring buffer
-    cnt = atomic_read(&rb->Filled);
+    cnt = RingBufferFilled(rb);
 
     *rp = rb->ReadPointer;
-
+    if (rb->Mirrored) {			// mirror continues after the end
+	return cnt;
+    }
     //
     //	Hitting end of buffer?
     //
@@ -312,6 +380,24 @@ size_t RingBufferGetReadPointer(RingBuffer * rb, const void **rp)
     return cnt;
 }
 
+/**
+**	Get used bytes, seen by any thread.
+**
+**	Read is loaded first, so the later written count can't be behind.
+*/
+static size_t RingBufferUsed(const RingBuffer * rb)
+{
+    size_t read;
+    size_t used;
+
+    read = __atomic_load_n(&rb->Read, __ATOMIC_ACQUIRE);
+    used = __atomic_load_n(&rb->Written, __ATOMIC_ACQUIRE) - read;
+    if (used > rb->Size) {		// writer went on meanwhile
+	used = rb->Size;
+    }
+    return used;
+}
+
 /**
 **	Get free bytes in ring buffer.
 **
@@ -321,7 +407,7 @@ size_t RingBufferGetReadPointer(RingBuffer * rb, const void **rp)
 */
 size_t RingBufferFreeBytes(RingBuffer * rb)
 {
-    return rb->Size - atomic_read(&rb->Filled);
+    return rb->Size - RingBufferUsed(rb);
 }
 
 /**
@@ -333,5 +419,308 @@ size_t RingBufferFreeBytes(RingBuffer * rb)
 */
 size_t RingBufferUsedBytes(RingBuffer * rb)
 {
-    return atomic_read(&rb->Filled);
+    return RingBufferUsed(rb);
+}
+
+#ifdef RINGBUFFER_TEST
+
+//----------------------------------------------------------------------------
+//	Benchmark
+//----------------------------------------------------------------------------
+
+#include <inttypes.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "iatomic.h"
+
+//
+//	Previous ring buffer with sequential consistent fill counter,
+//	kept as reference.
+//
+typedef struct _legacy_ring_buffer_
+{
+    char *Buffer;			///< ring buffer data
+    const char *BufferEnd;		///< end of buffer
+    size_t Size;			///< bytes in buffer
+    const char *ReadPointer;		///< only used by reader
+    char *WritePointer;			///< only used by writer
+    atomic_t Filled;			///< how many of the buffer is used
+} LegacyRingBuffer;
+
+///
+///	Write to legacy ring buffer.
+///
+static size_t LegacyWrite(LegacyRingBuffer * rb, const void *buf, size_t cnt)
+{
+    size_t n;
+
+    n = rb->Size - atomic_read(&rb->Filled);
+    if (cnt > n) {
+	cnt = n;
+    }
+    n = rb->BufferEnd - rb->WritePointer;
+    if (n > cnt) {
+	memcpy(rb->WritePointer, buf, cnt);
+	rb->WritePointer += cnt;
+    } else {
+	memcpy(rb->WritePointer, buf, n);
+	rb->WritePointer = rb->Buffer;
+	if (n < cnt) {
+	    memcpy(rb->WritePointer, (const char *)buf + n, cnt - n);
+	    rb->WritePointer += cnt - n;
+	}
+    }
+    atomic_add(cnt, &rb->Filled);
+    return cnt;
+}
+
+///
+///	Get read pointer of legacy ring buffer.
+///
+static size_t LegacyGetReadPointer(LegacyRingBuffer * rb, const void **rp)
+{
+    size_t n;
+    size_t cnt;
+
+    cnt = atomic_read(&rb->Filled);
+    *rp = rb->ReadPointer;
+    n = rb->BufferEnd - rb->ReadPointer;
+    if (n <= cnt) {
+	return n;
+    }
+    return cnt;
+}
+
+///
+///	Advance read pointer of legacy ring buffer.
+///
+static size_t LegacyReadAdvance(LegacyRingBuffer * rb, size_t cnt)
+{
+    size_t n;
+
+    n = atomic_read(&rb->Filled);
+    if (cnt > n) {
+	cnt = n;
+    }
+    n = rb->BufferEnd - rb->ReadPointer;
+    if (n > cnt) {
+	rb->ReadPointer += cnt;
+    } else {
+	rb->ReadPointer = rb->Buffer + cnt - n;
+    }
+    atomic_sub(cnt, &rb->Filled);
+    return cnt;
+}
+
+static LegacyRingBuffer *BenchLegacy;	///< legacy ring, if benched
+static RingBuffer *BenchRing;		///< ring buffer, if benched
+static size_t BenchChunk;		///< bytes per write and read
+static size_t BenchTotal;		///< bytes to transfer
+static uint8_t *BenchPattern;		///< stream content, repeats
+static int BenchCorrupted;		///< read bytes differ from written
+static int BenchSplits;			///< reads split by the buffer end
+
+    /// stream period, prime that it doesn't align with the buffer size
+#define BENCH_PERIOD 65521
+
+///
+///	Monotonic time in us.
+///
+static int64_t BenchTime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+}
+
+///
+///	Producer thread, writes chunks like the audio decoder.
+///
+static void *BenchProducer(void *dummy)
+{
+    size_t done;
+
+    for (done = 0; done < BenchTotal;) {
+	const uint8_t *chunk;
+	size_t n;
+
+	n = BenchTotal - done;
+	if (n > BenchChunk) {
+	    n = BenchChunk;
+	}
+	chunk = BenchPattern + done % BENCH_PERIOD;
+	if (BenchLegacy) {
+	    n = LegacyWrite(BenchLegacy, chunk, n);
+	} else {
+	    n = RingBufferWrite(BenchRing, chunk, n);
+	}
+	if (!n) {
+	    sched_yield();
+	    continue;
+	}
+	done += n;
+    }
+    return dummy;
+}
+
+///
+///	Consumer, reads spans in place like the alsa output.
+///
+static void BenchConsumer(void)
+{
+    size_t done;
+
+    for (done = 0; done < BenchTotal;) {
+	const void *p;
+	size_t n;
+
+	if (BenchLegacy) {
+	    n = LegacyGetReadPointer(BenchLegacy, &p);
+	} else {
+	    n = RingBufferGetReadPointer(BenchRing, &p);
+	}
+	if (!n) {
+	    sched_yield();
+	    continue;
+	}
+	if (n > BenchChunk) {
+	    n = BenchChunk;
+	}
+	// a span shorter than a chunk, which isn't the rest, was split
+	if (n < BenchChunk && n < BenchTotal - done
+	    && (BenchLegacy ? (size_t) atomic_read(&BenchLegacy->Filled) :
+		RingBufferUsedBytes(BenchRing)) > n) {
+	    ++BenchSplits;
+	}
+	if (memcmp(p, BenchPattern + done % BENCH_PERIOD, n)) {
+	    BenchCorrupted = 1;
+	}
+	if (BenchLegacy) {
+	    LegacyReadAdvance(BenchLegacy, n);
+	} else {
+	    RingBufferReadAdvance(BenchRing, n);
+	}
+	done += n;
+    }
 }
+
+///
+///	Transfer all bytes from producer thread to consumer.
+///
+///	@returns throughput in MiB/s, -1 if the data was corrupted.
+///
+static int BenchRun(void)
+{
+    pthread_t thread;
+    int64_t start;
+    int64_t t;
+
+    BenchCorrupted = 0;
+    BenchSplits = 0;
+    start = BenchTime();
+    pthread_create(&thread, NULL, BenchProducer, NULL);
+    BenchConsumer();
+    pthread_join(thread, NULL);
+    t = BenchTime() - start;
+
+    if (BenchCorrupted) {
+	return -1;
+    }
+    return t ? (int64_t) BenchTotal * 1000000 / t / (1024 * 1024) : 0;
+}
+
+///
+///	Print usage.
+///
+static void PrintUsage(void)
+{
+    printf("Usage: ringbuffer_test [-?h] [-c chunk] [-n MiB] [-s size]\n"
+	"\t-c chunk\tbytes per write and read (default 4608)\n"
+	"\t-n MiB\t\tMiB to transfer per run (default 1024)\n"
+	"\t-s size\t\tring buffer size (default 1680000, audio ring)\n");
+}
+
+///
+///	Main entry point.
+///
+int main(int argc, char *const argv[])
+{
+    LegacyRingBuffer legacy;
+    size_t size;
+    size_t i;
+    int rate;
+    int failed;
+
+    size = 3 * 5 * 7 * 8 * 2 * 1000;
+    BenchChunk = 1152 * 2 * 2;		// ac3 frame stereo s16
+    BenchTotal = 1024 * 1024 * 1024;
+    for (;;) {
+	switch (getopt(argc, argv, "hc:n:s:")) {
+	    case 'c':
+		BenchChunk = strtoul(optarg, NULL, 0);
+		continue;
+	    case 'n':
+		BenchTotal = strtoul(optarg, NULL, 0) * 1024 * 1024;
+		continue;
+	    case 's':
+		size = strtoul(optarg, NULL, 0);
+		continue;
+	    case EOF:
+		break;
+	    case 'h':
+	    default:
+		PrintUsage();
+		return 0;
+	}
+	break;
+    }
+    if (!BenchChunk || BenchChunk > size) {
+	BenchChunk = size;
+    }
+    BenchPattern = malloc(BENCH_PERIOD + BenchChunk);
+    for (i = 0; i < BENCH_PERIOD + BenchChunk; ++i) {
+	BenchPattern[i] = (i % BENCH_PERIOD) * 7 + (i % BENCH_PERIOD) / 256;
+    }
+
+    failed = 0;
+    printf("%-8s %10s %8s\n", "ring", "MiB/s", "splits");
+
+    legacy.Buffer = malloc(size);
+    legacy.BufferEnd = legacy.Buffer + size;
+    legacy.Size = size;
+    legacy.ReadPointer = legacy.Buffer;
+    legacy.WritePointer = legacy.Buffer;
+    atomic_set(&legacy.Filled, 0);
+    BenchLegacy = &legacy;
+    rate = BenchRun();
+    printf("%-8s %10d %8d\n", "legacy", rate, BenchSplits);
+    failed |= rate < 0;
+    BenchLegacy = NULL;
+    free(legacy.Buffer);
+
+    RingBufferMirror = 0;
+    BenchRing = RingBufferNew(size);
+    rate = BenchRun();
+    printf("%-8s %10d %8d\n", "plain", rate, BenchSplits);
+    failed |= rate < 0;
+    RingBufferDel(BenchRing);
+
+    RingBufferMirror = 1;
+    BenchRing = RingBufferNew(size);
+    if (!BenchRing->Mirrored) {
+	printf("%-8s %10s\n", "mirrored", "n/a");
+    } else {
+	rate = BenchRun();
+	printf("%-8s %10d %8d\n", "mirrored", rate, BenchSplits);
+	failed |= rate < 0;
+    }
+    RingBufferDel(BenchRing);
+    free(BenchPattern);
+
+    return failed;
+}
+
+#endif
@@ -26,6 +26,9 @@
     /// ring buffer typedef
 typedef struct _ring_buffer_ RingBuffer;
 
+    /// flag map new ring buffers mirrored, 0 selects plain memory
+extern int RingBufferMirror;
+
     /// reset ring buffer pointers
 extern void RingBufferReset(RingBuffer *);
 
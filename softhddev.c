@@ -37,6 +37,8 @@
 #include <inttypes.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
 
 #include <libintl.h>
 #define _(str) gettext(str)		///< gettext shortcut
@@ -71,6 +73,8 @@
 #include "audio.h"
 #include "video.h"
 #include "codec.h"
+#include "trace.h"
+#include "metrics.h"
 
 #ifdef noDEBUG
 static int DumpH264(const uint8_t * data, int size);
@@ -578,6 +582,8 @@ struct __video_stream__
     VideoHwDecoder *HwDecoder;		///< video hardware decoder
     VideoDecoder *Decoder;		///< video decoder
     pthread_mutex_t DecoderLockMutex;	///< video decoder lock mutex
+    pthread_cond_t StillCond;		///< still picture decoded
+    volatile int StillDone;		///< counter of decoded still pictures
 
     enum AVCodecID CodecID;		///< current codec id
     enum AVCodecID LastCodecID;		///< last codec id
@@ -588,13 +594,16 @@ struct __video_stream__
     volatile char Freezed;		///< stream freezed
 
     volatile char TrickSpeed;		///< current trick speed
+    volatile char TrickSkip;		///< drop non-reference frames
     volatile char Close;		///< command close video stream
     volatile char ClearBuffers;		///< command clear video buffers
     volatile char ClearClose;		///< clear video buffers for close
+    volatile char Priority;		///< decode priority, 0 = normal
 
     int InvalidPesCounter;		///< counter of invalid PES packets
 
     enum AVCodecID CodecIDRb[VIDEO_PACKET_MAX];	///< codec ids in ring buffer
+    char StillRb[VIDEO_PACKET_MAX];	///< still picture flags in ring buffer
     AVPacket PacketRb[VIDEO_PACKET_MAX];	///< PES packet ring buffer
     int StartCodeState;			///< last three bytes start code state
 
@@ -607,6 +616,7 @@ static VideoStream MyVideoStream[1];	///< normal video stream
 
 #ifdef USE_PIP
 static VideoStream PipVideoStream[1];	///< pip video stream
+static VideoStream MosaicStreams[MOSAIC_TILES_MAX];	///< mosaic streams
 #endif
 
 #ifdef DEBUG
@@ -620,14 +630,120 @@ static char InStillPicture;		///< flag still picture
 const char *X11DisplayName;		///< x11 display name
 static volatile char Usr1Signal;	///< true got usr1 signal
 
+//////////////////////////////////////////////////////////////////////////////
+
+    /// video packets filled, replay becomes busy
+#define VIDEO_PACKET_HIGH (VIDEO_PACKET_MAX - 10)
+    /// video packets filled, busy replay becomes ready again
+#define VIDEO_PACKET_LOW (VIDEO_PACKET_MAX * 3 / 4)
+    /// audio bytes free, busy replay becomes ready again
+#define AUDIO_LOW_BUFFER_FREE (AUDIO_MIN_BUFFER_FREE * 2)
+
+static pthread_mutex_t BufferSpaceMutex;	///< buffer space mutex
+static pthread_cond_t BufferSpaceCond;	///< buffer space available
+static char BufferSpaceWaiting;		///< Poll or Flush is waiting
+static char BufferBusy;			///< replay reported busy
+
+/**
+**	Check if replay buffers drained below the low watermarks.
+**
+**	@param filled	video packets filled
+*/
+static int BuffersDrained(int filled)
+{
+    return (AudioUsedBytes() <= AUDIO_MIN_BUFFER_FREE * 3 / 4 || filled <= 2)
+	&& AudioFreeBytes() >= AUDIO_LOW_BUFFER_FREE
+	&& filled <= VIDEO_PACKET_LOW;
+}
+
+/**
+**	Check if replay buffers are full.
+**
+**	Busy above the high watermarks, stays busy until the buffers are
+**	drained below the low watermarks.  Only called by the vdr thread.
+*/
+static int BuffersFull(void)
+{
+    int filled;
+
+    // FIXME: no video!
+    filled = atomic_read(&MyVideoStream->PacketsFilled);
+    if (BufferBusy) {
+	BufferBusy = !BuffersDrained(filled);
+    } else {
+	// soft limit + hard limit
+	BufferBusy = (AudioUsedBytes() > AUDIO_MIN_BUFFER_FREE && filled > 3)
+	    || AudioFreeBytes() < AUDIO_MIN_BUFFER_FREE
+	    || filled >= VIDEO_PACKET_HIGH;
+    }
+    return BufferBusy;
+}
+
+/**
+**	Signal buffer space available.
+**
+**	Called by the decoder and audio thread, after they consumed data.
+**	Wakes Poll at the low watermarks and Flush, if video is empty.
+*/
+static void BufferSpaceSignal(void)
+{
+    int filled;
+
+    if (!__atomic_load_n(&BufferSpaceWaiting, __ATOMIC_SEQ_CST)) {
+	return;				// fast path, nobody waits
+    }
+    filled = atomic_read(&MyVideoStream->PacketsFilled);
+    if (filled && !BuffersDrained(filled)) {
+	return;
+    }
+    pthread_mutex_lock(&BufferSpaceMutex);
+    __atomic_store_n(&BufferSpaceWaiting, 0, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&BufferSpaceCond);
+    pthread_mutex_unlock(&BufferSpaceMutex);
+}
+
+/**
+**	Wait for buffer space signal.
+**
+**	@param abstime	absolute timeout
+**	@param ready	check called with mutex held, before waiting
+**
+**	@retval true	ready
+**	@retval false	timeout
+*/
+static int BufferSpaceWait(const struct timespec *abstime,
+    int (*ready) (void))
+{
+    int ret;
+
+    pthread_mutex_lock(&BufferSpaceMutex);
+    for (;;) {
+	// set flag before checking, the consumer can't miss us
+	__atomic_store_n(&BufferSpaceWaiting, 1, __ATOMIC_SEQ_CST);
+	if ((ret = ready())) {
+	    break;
+	}
+	if (pthread_cond_timedwait(&BufferSpaceCond, &BufferSpaceMutex,
+		abstime) == ETIMEDOUT) {
+	    ret = ready();
+	    break;
+	}
+    }
+    pthread_mutex_unlock(&BufferSpaceMutex);
+
+    return ret;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 /**
 **	Initialize video packet ringbuffer.
 **
 **	@param stream	video stream
+**
+**	@returns 0 if ok, -1 out of memory, no packet is allocated.
 */
-static void VideoPacketInit(VideoStream * stream)
+static int VideoPacketInit(VideoStream * stream)
 {
     int i;
 
@@ -637,12 +753,21 @@ static void VideoPacketInit(VideoStream * stream)
 	avpkt = &stream->PacketRb[i];
 	// build a clean ffmpeg av packet
 	if (av_new_packet(avpkt, VIDEO_BUFFER_SIZE)) {
-	    Fatal(_("[softhddev] out of memory\n"));
+	    Error(_("[softhddev] out of memory\n"));
+	    while (--i >= 0) {
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(56,28,1)
+		av_free_packet(&stream->PacketRb[i]);
+#else
+		av_packet_unref(&stream->PacketRb[i]);
+#endif
+	    }
+	    return -1;
 	}
     }
 
     atomic_set(&stream->PacketsFilled, 0);
     stream->PacketRead = stream->PacketWrite = 0;
+    return 0;
 }
 
 /**
@@ -725,12 +850,64 @@ static void VideoResetPacket(VideoStream * stream)
     stream->StartCodeState = 0;		// reset start code state
 
     stream->CodecIDRb[stream->PacketWrite] = AV_CODEC_ID_NONE;
+    stream->StillRb[stream->PacketWrite] = 0;
     avpkt = &stream->PacketRb[stream->PacketWrite];
     avpkt->stream_index = 0;
     avpkt->pts = AV_NOPTS_VALUE;
     avpkt->dts = AV_NOPTS_VALUE;
 }
 
+/**
+**	Check if a video packet holds a non-reference picture.
+**
+**	Looks only at the first picture (slice) header of the packet.
+**
+**	@param data	packet data
+**	@param size	packet size
+**	@param codec_id	codec id of packet
+**
+**	@returns true, if no other picture references this picture.
+*/
+static int VideoNonReference(const uint8_t * data, int size, int codec_id)
+{
+    int i;
+
+    for (i = 0; i + 5 < size; ++i) {
+	if (data[i] || data[i + 1] || data[i + 2] != 0x01) {
+	    continue;
+	}
+	switch (codec_id) {
+	    case AV_CODEC_ID_MPEG2VIDEO:
+		if (!data[i + 3]) {	// picture start code
+		    // picture coding type 3 = B-picture
+		    return ((data[i + 5] >> 3) & 0x07) == 3;
+		}
+		break;
+	    case AV_CODEC_ID_H264:
+		// 1 = slice, 5 = IDR slice, nal_ref_idc 0 = not referenced
+		if ((data[i + 3] & 0x1F) == 1) {
+		    return !(data[i + 3] & 0x60);
+		}
+		if ((data[i + 3] & 0x1F) == 5) {
+		    return 0;
+		}
+		break;
+	    case AV_CODEC_ID_HEVC:
+		// VCL NAL types 0..31, even types upto 14 are sub-layer
+		// non-reference pictures (TRAIL_N, TSA_N, ..., RASL_N)
+		if (((data[i + 3] >> 1) & 0x3F) < 32) {
+		    return ((data[i + 3] >> 1) & 0x3F) <= 14
+			&& !((data[i + 3] >> 1) & 0x01);
+		}
+		break;
+	    default:
+		return 0;
+	}
+	i += 2;
+    }
+    return 0;
+}
+
 /**
 **	Finish current packet advance to next.
 **
@@ -749,10 +926,20 @@ static void VideoNextPacket(VideoStream * stream, int codec_id)
 	Debug(3, "video: possible stream change loss\n");
     }
 
+    // fast trick speed: reference frames are enough, don't queue others
+    if (stream->TrickSkip && codec_id != AV_CODEC_ID_NONE
+	&& !stream->StillRb[stream->PacketWrite]
+	&& VideoNonReference(avpkt->data, avpkt->stream_index, codec_id)) {
+	avpkt->stream_index = 0;
+	return;
+    }
+
     if (atomic_read(&stream->PacketsFilled) >= VIDEO_PACKET_MAX - 1) {
 	// no free slot available drop last packet
+	MetricsInc(METRIC_VIDEO_PACKETS_DROPPED);
 	Error(_("video: no empty slot in packet ringbuffer\n"));
 	avpkt->stream_index = 0;
+	stream->StillRb[stream->PacketWrite] = 0;
 	if (codec_id == AV_CODEC_ID_NONE) {
 	    Debug(3, "video: possible stream change loss\n");
 	}
@@ -767,6 +954,12 @@ static void VideoNextPacket(VideoStream * stream, int codec_id)
     // advance packet write
     stream->PacketWrite = (stream->PacketWrite + 1) % VIDEO_PACKET_MAX;
     atomic_inc(&stream->PacketsFilled);
+    TraceMark(TRACE_PACKET, atomic_read(&stream->PacketsFilled));
+    MetricsInc(METRIC_VIDEO_PACKETS);
+    if (stream == MyVideoStream) {
+	MetricsSet(METRIC_VIDEO_PACKETS_BUFFERED,
+	    atomic_read(&stream->PacketsFilled));
+    }
 
     VideoDisplayWakeup();
 
@@ -1010,6 +1203,9 @@ static void FixPacketForFFMpeg(VideoDecoder * vdecoder, AVPacket * avpkt)
 /**
 **	Open video stream.
 **
+**	Without free hardware decoder or memory, the stream stays closed
+**	(->HwDecoder is NULL).
+**
 **	@param stream	video stream
 */
 static void VideoStreamOpen(VideoStream * stream)
@@ -1019,8 +1215,16 @@ static void VideoStreamOpen(VideoStream * stream)
     stream->LastCodecID = AV_CODEC_ID_NONE;
 
     if ((stream->HwDecoder = VideoNewHwDecoder(stream))) {
-	stream->Decoder = CodecVideoNewDecoder(stream->HwDecoder);
-	VideoPacketInit(stream);
+	if (!(stream->Decoder = CodecVideoNewDecoder(stream->HwDecoder))
+	    || VideoPacketInit(stream)) {
+	    if (stream->Decoder) {
+		CodecVideoDelDecoder(stream->Decoder);
+		stream->Decoder = NULL;
+	    }
+	    VideoDelHwDecoder(stream->HwDecoder);
+	    stream->HwDecoder = NULL;
+	    return;
+	}
 	stream->SkipStream = 0;
     }
 }
@@ -1116,6 +1320,7 @@ int VideoDecodeInput(VideoStream * stream)
     int filled;
     AVPacket *avpkt;
     int saved_size;
+    uint32_t start;
 
     if (!stream->Decoder) {		// closing
 #ifdef DEBUG
@@ -1181,8 +1386,9 @@ int VideoDecodeInput(VideoStream * stream)
 	case AV_CODEC_ID_NONE:
 	    stream->ClosingStream = 0;
 	    if (stream->LastCodecID != AV_CODEC_ID_NONE) {
+		// keep decoder open, next stream can reuse it
 		stream->LastCodecID = AV_CODEC_ID_NONE;
-		CodecVideoClose(stream->Decoder);
+		CodecVideoEndStream(stream->Decoder);
 		goto skip;
 	    }
 	    // FIXME: look if more close are in the queue
@@ -1191,28 +1397,28 @@ int VideoDecodeInput(VideoStream * stream)
 	case AV_CODEC_ID_MPEG2VIDEO:
 	    if (stream->LastCodecID != AV_CODEC_ID_MPEG2VIDEO) {
 		stream->LastCodecID = AV_CODEC_ID_MPEG2VIDEO;
-		if (!CodecVideoOpen(stream->Decoder, AV_CODEC_ID_MPEG2VIDEO))
+		if (!CodecVideoReopen(stream->Decoder, AV_CODEC_ID_MPEG2VIDEO))
 		    goto skip;
 	    }
 	    break;
 	case AV_CODEC_ID_H264:
 	    if (stream->LastCodecID != AV_CODEC_ID_H264) {
 		stream->LastCodecID = AV_CODEC_ID_H264;
-		if (!CodecVideoOpen(stream->Decoder, AV_CODEC_ID_H264))
+		if (!CodecVideoReopen(stream->Decoder, AV_CODEC_ID_H264))
 		    goto skip;
 	    }
 	    break;
         case AV_CODEC_ID_HEVC:
             if (stream->LastCodecID != AV_CODEC_ID_HEVC) {
                 stream->LastCodecID = AV_CODEC_ID_HEVC;
-                if (!CodecVideoOpen(stream->Decoder, AV_CODEC_ID_HEVC))
+                if (!CodecVideoReopen(stream->Decoder, AV_CODEC_ID_HEVC))
 		    goto skip;
             }
             break;
         case AV_CODEC_ID_CAVS:
             if (stream->LastCodecID != AV_CODEC_ID_CAVS) {
                 stream->LastCodecID = AV_CODEC_ID_CAVS;
-                if (!CodecVideoOpen(stream->Decoder, AV_CODEC_ID_CAVS))
+                if (!CodecVideoReopen(stream->Decoder, AV_CODEC_ID_CAVS))
 		    goto skip;
             }
             break;
@@ -1220,7 +1426,7 @@ int VideoDecodeInput(VideoStream * stream)
         case AV_CODEC_ID_AVS2:
             if (stream->LastCodecID != AV_CODEC_ID_AVS2) {
                 stream->LastCodecID = AV_CODEC_ID_AVS2;
-                if (!CodecVideoOpen(stream->Decoder, AV_CODEC_ID_AVS2))
+                if (!CodecVideoReopen(stream->Decoder, AV_CODEC_ID_AVS2))
 		    goto skip;
             }
             break;
@@ -1233,6 +1439,8 @@ int VideoDecodeInput(VideoStream * stream)
     avpkt->size = avpkt->stream_index;
     avpkt->stream_index = 0;
 
+    TraceBegin(TRACE_DECODE, filled);
+    start = GetUsTicks();
 #ifdef USE_PIP
     //fprintf(stderr, "[");
     //DumpMpeg(avpkt->data, avpkt->size);
@@ -1244,24 +1452,43 @@ int VideoDecodeInput(VideoStream * stream)
     // lock decoder against close
     pthread_mutex_lock(&stream->DecoderLockMutex);
     if (stream->Decoder) {
-	CodecVideoDecode(stream->Decoder, avpkt);
+	if (stream->StillRb[stream->PacketRead]) {
+	    CodecVideoDecodeStill(stream->Decoder, avpkt);
+	} else {
+	    CodecVideoDecode(stream->Decoder, avpkt);
+	}
     }
     pthread_mutex_unlock(&stream->DecoderLockMutex);
     //fprintf(stderr, "]\n");
 #else
     // old version
-    if (stream->LastCodecID == AV_CODEC_ID_MPEG2VIDEO) {
+    if (stream->StillRb[stream->PacketRead]) {
+	CodecVideoDecodeStill(stream->Decoder, avpkt);
+    } else if (stream->LastCodecID == AV_CODEC_ID_MPEG2VIDEO) {
 	FixPacketForFFMpeg(stream->Decoder, avpkt);
     } else {
 	CodecVideoDecode(stream->Decoder, avpkt);
     }
 #endif
+    MetricsObserve(METRIC_DECODE_TIME, GetUsTicks() - start);
+    TraceEnd(TRACE_DECODE, filled);
     avpkt->size = saved_size;
 
   skip:
+    if (stream->StillRb[stream->PacketRead]) {	// wakeup StillPicture
+	pthread_mutex_lock(&stream->DecoderLockMutex);
+	++stream->StillDone;
+	pthread_cond_broadcast(&stream->StillCond);
+	pthread_mutex_unlock(&stream->DecoderLockMutex);
+    }
     // advance packet read
     stream->PacketRead = (stream->PacketRead + 1) % VIDEO_PACKET_MAX;
     atomic_dec(&stream->PacketsFilled);
+    if (stream == MyVideoStream) {
+	MetricsSet(METRIC_VIDEO_PACKETS_BUFFERED,
+	    atomic_read(&stream->PacketsFilled));
+	BufferSpaceSignal();
+    }
 
     return 0;
 }
@@ -1276,6 +1503,18 @@ int VideoGetBuffers(const VideoStream * stream)
     return atomic_read(&stream->PacketsFilled);
 }
 
+/**
+**	Get decode priority of video stream.
+**
+**	@param stream	video stream
+**
+**	@returns number of packets to decode each round of the decoder thread.
+*/
+int VideoGetPriority(const VideoStream * stream)
+{
+    return stream->Priority > 1 ? stream->Priority : 1;
+}
+
 /**
 **	Try video start.
 **
@@ -1545,6 +1784,9 @@ static void PesParse(PesDemux * pesdx, const uint8_t * data, int size,
     const uint8_t *q;
 
     if (is_start) {			// start of pes packet
+	if (av == TS_PES_AUDIO) {
+	    MetricsInc(METRIC_AUDIO_PACKETS);
+	}
 	if (pesdx->Index && pesdx->Skip) {
 	    // copy remaining bytes down
 	    pesdx->Index -= pesdx->Skip;
@@ -2097,12 +2339,14 @@ static int TsDemuxer(TsDemux * tsdx, const uint8_t * data, int size, int av)
 	int payload;
 
 	if (p[0] != TS_PACKET_SYNC) {
+	    MetricsInc(METRIC_DEMUX_ERRORS);
 	    Error(_("tsdemux: transport stream out of sync\n"));
 	    // FIXME: kill all buffers
 	    return size;
 	}
 	++tsdx->Packets;
 	if (p[1] & 0x80) {		// error indicator
+	    MetricsInc(METRIC_DEMUX_ERRORS);
 	    Debug(3, "tsdemux: transport error\n");
 	    // FIXME: kill all buffers
 	    goto next_packet;
@@ -2204,6 +2448,7 @@ int PlayAudio(const uint8_t * data, int size, uint8_t id)
 
     // must be a PES start code
     if (size < 9 || !data || data[0] || data[1] || data[2] != 0x01) {
+	MetricsInc(METRIC_DEMUX_ERRORS);
 	Error(_("[softhddev] invalid PES audio packet\n"));
 	return size;
     }
@@ -2213,10 +2458,12 @@ int PlayAudio(const uint8_t * data, int size, uint8_t id)
 	if (size == 9 + n) {
 	    Warning(_("[softhddev] empty audio packet\n"));
 	} else {
+	    MetricsInc(METRIC_DEMUX_ERRORS);
 	    Error(_("[softhddev] invalid audio packet %d bytes\n"), size);
 	}
 	return size;
     }
+    MetricsInc(METRIC_AUDIO_PACKETS);
 
     if (data[7] & 0x80 && n >= 5) {
 	AudioAvPkt->pts =
@@ -2481,6 +2728,7 @@ int PlayVideo3(VideoStream * stream, const uint8_t * data, int size)
     // must be a PES start code
     // FIXME: Valgrind-3.8.1 has a problem with this code
     if (size < 9 || !data || data[0] || data[1] || data[2] != 0x01) {
+	MetricsInc(METRIC_DEMUX_ERRORS);
 	if (!stream->InvalidPesCounter++) {
 	    Error(_("[softhddev] invalid PES video packet\n"));
 	}
@@ -2497,12 +2745,14 @@ int PlayVideo3(VideoStream * stream, const uint8_t * data, int size)
     if (data[3] == PES_PADDING_STREAM) {	// from DVD plugin
 	return size;
     }
+    VideoZapMark(stream->HwDecoder, VIDEO_ZAP_PES);
 
     n = data[8];			// header size
     if (size <= 9 + n) {		// wrong size
 	if (size == 9 + n) {
 	    Warning(_("[softhddev] empty video packet\n"));
 	} else {
+	    MetricsInc(METRIC_DEMUX_ERRORS);
 	    Error(_("[softhddev] invalid video packet %d/%d bytes\n"), 9 + n,
 		size);
 	}
@@ -2729,6 +2979,7 @@ int PlayTsVideo(const uint8_t * data, int size)
     if (StreamFreezed) {		// stream freezed
 	return 0;
     }
+    VideoZapMark(MyVideoStream->HwDecoder, VIDEO_ZAP_TS);
     if (MyVideoStream->NewStream) {// channel switched
 	Debug(3, "video: new stream %dms\n", GetMsTicks() - VideoSwitch);
 	if (atomic_read(&MyVideoStream->PacketsFilled) >= VIDEO_PACKET_MAX - 1) {
@@ -2847,166 +3098,759 @@ uint8_t *GrabImage(int *size, int jpeg, int quality, int width, int height)
 }
 
 //////////////////////////////////////////////////////////////////////////////
+//	Preview stream
+//////////////////////////////////////////////////////////////////////////////
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+
+#define PREVIEW_CLIENTS_MAX	8	///< maximal preview stream clients
+#define PREVIEW_JPEG_QUALITY	70	///< jpeg quality of mjpeg stream
+#define PREVIEW_BOUNDARY	"softhddevice"	///< mjpeg multipart boundary
+#define PREVIEW_REQUEST_TIME	200	///< ms to wait for client request
+
+///
+///	Preview stream client.
+///
+typedef struct _preview_client_
+{
+    int Fd;				///< client socket
+    char Pending;			///< flag request not yet handled
+    char Raw;				///< flag client wants raw yuv stream
+    char Fresh;				///< flag client got no frame yet
+    uint32_t Accepted;			///< ms ticks client was accepted
+    int Width;				///< raw stream width
+    int Height;				///< raw stream height
+} PreviewClient;
+
+static const char *PreviewEndpoint;	///< preview socket path or port
+static int PreviewRate = 5;		///< preview frames per second
+static int PreviewWidth = 320;		///< preview image width
+
+static int PreviewFd = -1;		///< preview listen socket
+static PreviewClient PreviewClients[PREVIEW_CLIENTS_MAX];	///< clients
+static int PreviewClientsN;		///< number of preview clients
+static uint32_t PreviewLastHash;	///< hash of last sent image
+
+static pthread_t PreviewThread;		///< preview stream thread
+static volatile char PreviewThreadStop;	///< flag stop preview thread
 
 /**
-**	Set play mode, called on channel switch.
+**	Send complete buffer to preview client.
 **
-**	@param play_mode	play mode (none, video+audio, audio-only, ...)
+**	@param fd	client socket
+**	@param data	data to send
+**	@param size	number of bytes to send
+**
+**	@returns true if all data could be sent.
 */
-int SetPlayMode(int play_mode)
+static int PreviewSend(int fd, const void *data, int size)
 {
-    switch (play_mode) {
-	case 0:			// audio/video from decoder
-	    // tell video parser we get new stream
-	    if (MyVideoStream->Decoder && !MyVideoStream->SkipStream) {
-		// clear buffers on close configured always or replay only
-		if (ConfigVideoClearOnSwitch || MyVideoStream->ClearClose) {
-		    Clear();		// flush all buffers
-		    MyVideoStream->ClearClose = 0;
-		}
-		if (MyVideoStream->CodecID != AV_CODEC_ID_NONE) {
-		    MyVideoStream->NewStream = 1;
-		    MyVideoStream->InvalidPesCounter = 0;
-		    // tell hw decoder we are closing stream
-		    VideoSetClosing(MyVideoStream->HwDecoder);
-		    VideoResetStart(MyVideoStream->HwDecoder);
-#ifdef DEBUG
-		    VideoSwitch = GetMsTicks();
-		    Debug(3, "video: new stream start\n");
-#endif
-		}
-	    }
-	    if (MyAudioDecoder) {	// tell audio parser we have new stream
-		if (AudioCodecID != AV_CODEC_ID_NONE) {
-		    NewAudioStream = 1;
-		}
-	    }
-	    break;
-	case 1:			// audio/video from player
-	    VideoDisplayWakeup();
-	    Play();
-	    break;
-	case 2:			// audio only from player, video from decoder
-	case 3:			// audio only from player, no video (black screen)
-	    Debug(3, "softhddev: FIXME: audio only, silence video errors\n");
-	    VideoDisplayWakeup();
-	    Play();
-	    break;
-	case 4:			// video only from player, audio from decoder
-	    VideoDisplayWakeup();
-	    Play();
-	    break;
+    const uint8_t *p;
+
+    p = data;
+    while (size > 0) {
+	ssize_t n;
+
+	n = send(fd, p, size, MSG_NOSIGNAL);
+	if (n <= 0) {
+	    return 0;
+	}
+	p += n;
+	size -= n;
     }
     return 1;
 }
 
 /**
-**	Gets the current System Time Counter, which can be used to
-**	synchronize audio, video and subtitles.
+**	Remove preview client.
+**
+**	@param i	index of client
 */
-int64_t GetSTC(void)
+static void PreviewDelClient(int i)
 {
-    if (MyVideoStream->HwDecoder) {
-	return VideoGetClock(MyVideoStream->HwDecoder);
-    }
-    // could happen during dettached
-    Warning(_("softhddev: %s called without hw decoder\n"), __FUNCTION__);
-    return AV_NOPTS_VALUE;
+    Debug(3, "[softhddev]preview: client %d closed\n", PreviewClients[i].Fd);
+    close(PreviewClients[i].Fd);
+    PreviewClients[i] = PreviewClients[--PreviewClientsN];
 }
 
 /**
-**	Get video stream size and aspect.
+**	Send metrics in prometheus text format to http client.
 **
-**	@param width[OUT]	width of video stream
-**	@param height[OUT]	height of video stream
-**	@param aspect[OUT]	aspect ratio (4/3, 16/9, ...) of video stream
+**	@param fd	client socket
 */
-void GetVideoSize(int *width, int *height, double *aspect)
+static void PreviewSendMetrics(int fd)
 {
-#ifdef DEBUG
-    static int done_width;
-    static int done_height;
-#endif
-    int aspect_num;
-    int aspect_den;
+    char header[128];
+    char *text;
+    int n;
 
-    if (MyVideoStream->HwDecoder) {
-	VideoGetVideoSize(MyVideoStream->HwDecoder, width, height, &aspect_num,
-	    &aspect_den);
-	*aspect = (double)aspect_num / (double)aspect_den;
-    } else {
-	*width = 0;
-	*height = 0;
-	*aspect = 1.0;			// like default cDevice::GetVideoSize
+    if (!(text = MetricsExport())) {
+	return;
     }
-
-#ifdef DEBUG
-    if (done_width != *width || done_height != *height) {
-	Debug(3, "[softhddev]%s: %dx%d %g\n", __FUNCTION__, *width, *height,
-	    *aspect);
-	done_width = *width;
-	done_height = *height;
+    n = snprintf(header, sizeof(header),
+	"HTTP/1.0 200 OK\r\nCache-Control: no-cache\r\n"
+	"Content-Type: text/plain; version=0.0.4\r\n"
+	"Content-Length: %zu\r\n\r\n", strlen(text));
+    if (PreviewSend(fd, header, n)) {
+	PreviewSend(fd, text, strlen(text));
     }
-#endif
+    free(text);
 }
 
 /**
-**	Set trick play speed.
+**	Accept new preview client.
 **
-**	Every single frame shall then be displayed the given number of
-**	times.
-**
-**	@param speed	trick speed
+**	The listen socket is non-blocking, the request of the client is
+**	handled by PreviewClientRequest(), when it arrived.
 */
-void TrickSpeed(int speed)
+static void PreviewAddClient(void)
 {
-    MyVideoStream->TrickSpeed = speed;
-    if (MyVideoStream->HwDecoder) {
-	VideoSetTrickSpeed(MyVideoStream->HwDecoder, speed);
-    } else {
-	// can happen, during startup
-	Debug(3, "softhddev: %s called without hw decoder\n", __FUNCTION__);
+    PreviewClient *client;
+    struct timeval tv;
+    int fd;
+
+    if ((fd = accept(PreviewFd, NULL, NULL)) < 0) {
+	return;				// client gone or no client
     }
-    StreamFreezed = 0;
-    MyVideoStream->Freezed = 0;
+    if (PreviewClientsN >= PREVIEW_CLIENTS_MAX) {
+	Warning(_("[softhddev]preview: too many clients\n"));
+	close(fd);
+	return;
+    }
+    // slow clients can't block the stream thread
+    tv.tv_sec = 1;
+    tv.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    client = &PreviewClients[PreviewClientsN++];
+    memset(client, 0, sizeof(*client));
+    client->Fd = fd;
+    client->Pending = 1;
+    client->Accepted = GetMsTicks();
 }
 
 /**
-**	Clears all video and audio data from the device.
+**	Handle request of new preview client.
+**
+**	A request containing "yuv" or "y4m" (f.e. "GET /preview.y4m") selects
+**	the raw yuv4mpeg stream, everything else gets multipart mjpeg.
+**	"GET /metrics" is answered with the metrics and closed.  Raw clients
+**	may send nothing, they are handled after #PREVIEW_REQUEST_TIME.
+**
+**	@param i	index of client
+**
+**	@returns true if the client was removed.
 */
-void Clear(void)
+static int PreviewClientRequest(int i)
 {
-    int i;
+    PreviewClient *client;
+    char buf[256];
+    int n;
 
-    VideoResetPacket(MyVideoStream);	// terminate work
-    MyVideoStream->ClearBuffers = 1;
-    if (!SkipAudio) {
-	AudioFlushBuffers();
-	//NewAudioStream = 1;
-    }
-    // FIXME: audio avcodec_flush_buffers, video is done by VideoClearBuffers
+    client = &PreviewClients[i];
+    n = recv(client->Fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+    buf[n > 0 ? n : 0] = '\0';
 
-    // wait for empty buffers
-    // FIXME: without softstart sync VideoDecode isn't called.
-    for (i = 0; MyVideoStream->ClearBuffers && i < 20; ++i) {
-	usleep(1 * 1000);
+    if (!strncmp(buf, "GET /metrics", 12)) {
+	PreviewSendMetrics(client->Fd);
+	PreviewDelClient(i);
+	return 1;
     }
-    Debug(3, "[softhddev]%s: %dms buffers %d\n", __FUNCTION__, i,
-	VideoGetBuffers(MyVideoStream));
+    client->Pending = 0;
+    client->Fresh = 1;
+    client->Raw = strstr(buf, "yuv") || strstr(buf, "y4m");
+
+    if (!strncmp(buf, "GET ", 4)) {
+	n = snprintf(buf, sizeof(buf),
+	    "HTTP/1.0 200 OK\r\nCache-Control: no-cache\r\n"
+	    "Content-Type: %s\r\n\r\n",
+	    client->Raw ? "video/x-yuv4mpeg" :
+	    "multipart/x-mixed-replace; boundary=" PREVIEW_BOUNDARY);
+	if (!PreviewSend(client->Fd, buf, n)) {
+	    PreviewDelClient(i);
+	    return 1;
+	}
+    }
+    Debug(3, "[softhddev]preview: new %s client %d\n",
+	client->Raw ? "raw" : "mjpeg", client->Fd);
+    return 0;
 }
 
 /**
-**	Sets the device into play mode.
+**	Convert RGB image to planar YUV 4:2:0 (BT.601 full range).
+**
+**	@param yuv[out]	Y, U, V planes, width * height * 3 / 2 bytes
+**	@param rgb	RGB image
+**	@param width	image width (even)
+**	@param height	image height (even)
 */
-void Play(void)
+static void PreviewRgbToYuv(uint8_t * yuv, const uint8_t * rgb, int width,
+    int height)
 {
-    TrickSpeed(0);			// normal play
-    SkipAudio = 0;
-    AudioPlay();
+    uint8_t *u;
+    uint8_t *v;
+    int x;
+    int y;
+
+    u = yuv + width * height;
+    v = u + (width / 2) * (height / 2);
+    for (y = 0; y < height; ++y) {
+	const uint8_t *s;
+
+	s = rgb + y * width * 3;
+	for (x = 0; x < width; ++x) {
+	    yuv[y * width + x] =
+		(77 * s[x * 3 + 0] + 150 * s[x * 3 + 1] +
+		29 * s[x * 3 + 2]) >> 8;
+	}
+    }
+    for (y = 0; y < height; y += 2) {
+	const uint8_t *s0;
+	const uint8_t *s1;
+
+	s0 = rgb + y * width * 3;
+	s1 = s0 + width * 3;
+	for (x = 0; x < width; x += 2) {
+	    int r;
+	    int g;
+	    int b;
+
+	    // average 2x2 block
+	    r = (s0[x * 3 + 0] + s0[x * 3 + 3] + s1[x * 3 + 0] +
+		s1[x * 3 + 3]) >> 2;
+	    g = (s0[x * 3 + 1] + s0[x * 3 + 4] + s1[x * 3 + 1] +
+		s1[x * 3 + 4]) >> 2;
+	    b = (s0[x * 3 + 2] + s0[x * 3 + 5] + s1[x * 3 + 2] +
+		s1[x * 3 + 5]) >> 2;
+	    *u++ = ((-43 * r - 85 * g + 128 * b) >> 8) + 128;
+	    *v++ = ((128 * r - 107 * g - 21 * b) >> 8) + 128;
+	}
+    }
 }
 
 /**
-**	Sets the device into "freeze frame" mode.
+**	Grab, encode and send one preview frame to all clients.
+**
+**	Frames unchanged since the last sent frame are only sent to new
+**	clients.
+*/
+static void PreviewSendFrame(void)
+{
+    uint8_t *rgb;
+    uint8_t *jpg;
+    uint8_t *yuv;
+    uint32_t hash;
+    int size;
+    int width;
+    int height;
+    int jpg_size;
+    int fresh;
+    int video_width;
+    int video_height;
+    double aspect;
+    int i;
+
+    // keep the aspect ratio of the video, 16:9 without video
+    GetVideoSize(&video_width, &video_height, &aspect);
+    if (!video_width || aspect < 0.5 || aspect > 4.0) {
+	aspect = 16.0 / 9.0;
+    }
+    width = PreviewWidth & ~1;
+    height = (int)(width / aspect + 0.5) & ~1;
+    // served from the grab ring, if enabled and big enough
+    if (!(rgb = VideoGrab(&size, &width, &height, 0))) {
+	return;
+    }
+    // grab not scaled to odd size, yuv 4:2:0 needs even: crop last
+    // column and row
+    if (width & 1 || height & 1) {
+	int y;
+
+	for (y = 1; y < (height & ~1); ++y) {
+	    memmove(rgb + y * (width & ~1) * 3, rgb + y * width * 3,
+		(width & ~1) * 3);
+	}
+	width &= ~1;
+	height &= ~1;
+	size = width * height * 3;
+	if (!size) {
+	    free(rgb);
+	    return;
+	}
+    }
+    // FNV-1a hash to detect unchanged frames
+    hash = 2166136261U;
+    for (i = 0; i < size; ++i) {
+	hash = (hash ^ rgb[i]) * 16777619U;
+    }
+    fresh = 0;
+    for (i = 0; i < PreviewClientsN; ++i) {
+	fresh |= PreviewClients[i].Fresh && !PreviewClients[i].Pending;
+    }
+    if (hash == PreviewLastHash && !fresh) {
+	free(rgb);
+	return;
+    }
+
+    jpg = NULL;
+    jpg_size = 0;
+    yuv = NULL;
+    for (i = 0; i < PreviewClientsN; ++i) {
+	PreviewClient *client;
+	char buf[128];
+	int n;
+
+	client = &PreviewClients[i];
+	if (client->Pending || (hash == PreviewLastHash && !client->Fresh)) {
+	    continue;
+	}
+	if (client->Raw) {
+	    if (!yuv) {
+		if (!(yuv = malloc(width * height * 3 / 2))) {
+		    Error(_("[softhddev]preview: out of memory\n"));
+		    break;
+		}
+		PreviewRgbToYuv(yuv, rgb, width, height);
+	    }
+	    if (client->Fresh) {
+		client->Width = width;
+		client->Height = height;
+		n = snprintf(buf, sizeof(buf),
+		    "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width,
+		    height, PreviewRate);
+		if (!PreviewSend(client->Fd, buf, n)) {
+		    PreviewDelClient(i--);
+		    continue;
+		}
+	    }
+	    // yuv4mpeg can't change size
+	    if (client->Width != width || client->Height != height) {
+		PreviewDelClient(i--);
+		continue;
+	    }
+	    if (!PreviewSend(client->Fd, "FRAME\n", 6)
+		|| !PreviewSend(client->Fd, yuv, width * height * 3 / 2)) {
+		PreviewDelClient(i--);
+		continue;
+	    }
+	} else {
+	    if (!jpg) {
+		jpg_size = width * height * 3;
+		if (!(jpg =
+			CreateJpeg(rgb, &jpg_size, PREVIEW_JPEG_QUALITY,
+			    width, height))) {
+		    break;
+		}
+	    }
+	    n = snprintf(buf, sizeof(buf),
+		"--" PREVIEW_BOUNDARY "\r\nContent-Type: image/jpeg\r\n"
+		"Content-Length: %d\r\n\r\n", jpg_size);
+	    if (!PreviewSend(client->Fd, buf, n)
+		|| !PreviewSend(client->Fd, jpg, jpg_size)
+		|| !PreviewSend(client->Fd, "\r\n", 2)) {
+		PreviewDelClient(i--);
+		continue;
+	    }
+	}
+	client->Fresh = 0;
+    }
+    PreviewLastHash = hash;
+
+    free(yuv);
+    free(jpg);
+    free(rgb);
+}
+
+/**
+**	Preview stream thread.
+**
+**	Polls the listen socket and the requests of new clients without
+**	blocking, grabs/encodes frames with the configured rate.
+*/
+static void *PreviewHandlerThread(void *dummy)
+{
+    uint32_t next;
+
+    Debug(3, "[softhddev]preview: thread started\n");
+
+    next = GetMsTicks();
+    while (!PreviewThreadStop) {
+	struct pollfd pfds[1 + PREVIEW_CLIENTS_MAX];
+	int timeout;
+	int streaming;
+	int n;
+	int i;
+
+	// wait for next frame, new client or request of new client
+	streaming = 0;
+	timeout = 200;
+	pfds[0].fd = PreviewFd;
+	pfds[0].events = POLLIN;
+	n = 1;
+	for (i = 0; i < PreviewClientsN; ++i) {
+	    if (PreviewClients[i].Pending) {
+		int t;
+
+		t = PreviewClients[i].Accepted + PREVIEW_REQUEST_TIME -
+		    GetMsTicks();
+		if (t < timeout) {
+		    timeout = t < 0 ? 0 : t;
+		}
+		pfds[n].fd = PreviewClients[i].Fd;
+		pfds[n].events = POLLIN;
+		++n;
+	    } else {
+		streaming = 1;
+	    }
+	}
+	if (streaming) {
+	    int t;
+
+	    t = next - GetMsTicks();
+	    if (t < timeout) {
+		timeout = t < 0 ? 0 : t;
+	    }
+	}
+	if (poll(pfds, n, timeout) > 0 && pfds[0].revents) {
+	    PreviewAddClient();
+	}
+	// handle requests, which arrived or timed out
+	for (i = 0; i < PreviewClientsN; ++i) {
+	    PreviewClient *client;
+	    int j;
+
+	    client = &PreviewClients[i];
+	    if (!client->Pending) {
+		continue;
+	    }
+	    for (j = 1; j < n && pfds[j].fd != client->Fd; ++j) {
+	    }
+	    if ((j < n && pfds[j].revents)
+		|| (int32_t) (GetMsTicks() - client->Accepted) >=
+		PREVIEW_REQUEST_TIME) {
+		if (PreviewClientRequest(i)) {
+		    --i;
+		}
+	    }
+	}
+
+	if (!streaming || (int32_t) (next - GetMsTicks()) > 0) {
+	    continue;
+	}
+	next = GetMsTicks() + 1000 / PreviewRate;
+	PreviewSendFrame();
+    }
+
+    while (PreviewClientsN) {
+	PreviewDelClient(0);
+    }
+    Debug(3, "[softhddev]preview: thread stopped\n");
+    return dummy;
+}
+
+/**
+**	Set preview stream rate and image width.
+**
+**	@param rate	frames per second
+**	@param width	image width
+*/
+void PreviewSetRate(int rate, int width)
+{
+    PreviewRate = rate < 1 ? 1 : rate > 25 ? 25 : rate;
+    PreviewWidth = width < 64 ? 64 : width > 1920 ? 1920 : width;
+}
+
+/**
+**	Open preview stream socket and start stream thread.
+**
+**	The endpoint is an unix socket path (starting with '/') or a tcp
+**	"[address:]port", address defaults to localhost.
+*/
+static void PreviewInit(void)
+{
+    const char *endpoint;
+
+    if (!(endpoint = PreviewEndpoint)) {
+	return;
+    }
+    if (*endpoint == '/') {
+	struct sockaddr_un sun;
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_UNIX;
+	strncpy(sun.sun_path, endpoint, sizeof(sun.sun_path) - 1);
+	unlink(sun.sun_path);
+	PreviewFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (PreviewFd >= 0
+	    && bind(PreviewFd, (struct sockaddr *)&sun, sizeof(sun))) {
+	    close(PreviewFd);
+	    PreviewFd = -1;
+	}
+    } else {
+	struct sockaddr_in sin;
+	const char *s;
+	char addr[64];
+	int on;
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if ((s = strrchr(endpoint, ':'))) {
+	    snprintf(addr, sizeof(addr), "%.*s", (int)(s - endpoint),
+		endpoint);
+	    if (inet_pton(AF_INET, addr, &sin.sin_addr) != 1) {
+		Error(_("[softhddev]preview: invalid address '%s'\n"), addr);
+		return;
+	    }
+	    endpoint = s + 1;
+	}
+	sin.sin_port = htons(atoi(endpoint));
+	PreviewFd = socket(AF_INET, SOCK_STREAM, 0);
+	on = 1;
+	if (PreviewFd >= 0) {
+	    setsockopt(PreviewFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	    if (bind(PreviewFd, (struct sockaddr *)&sin, sizeof(sin))) {
+		close(PreviewFd);
+		PreviewFd = -1;
+	    }
+	}
+    }
+    if (PreviewFd < 0 || listen(PreviewFd, 4)
+	|| fcntl(PreviewFd, F_SETFL, fcntl(PreviewFd, F_GETFL) | O_NONBLOCK)) {
+	Error(_("[softhddev]preview: can't open socket '%s'\n"),
+	    PreviewEndpoint);
+	if (PreviewFd >= 0) {
+	    close(PreviewFd);
+	    PreviewFd = -1;
+	}
+	return;
+    }
+
+    PreviewThreadStop = 0;
+    pthread_create(&PreviewThread, NULL, PreviewHandlerThread, NULL);
+    pthread_setname_np(PreviewThread, "softhddev preview");
+    Info(_("[softhddev]preview: streaming on '%s'\n"), PreviewEndpoint);
+}
+
+/**
+**	Stop preview stream thread and close socket.
+*/
+static void PreviewExit(void)
+{
+    if (PreviewThread) {
+	PreviewThreadStop = 1;
+	pthread_join(PreviewThread, NULL);
+	PreviewThread = 0;
+    }
+    if (PreviewFd >= 0) {
+	close(PreviewFd);
+	PreviewFd = -1;
+	if (*PreviewEndpoint == '/') {
+	    unlink(PreviewEndpoint);
+	}
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int StillHardwareDecoder = -1;	///< decoder mode before still pictures
+
+/**
+**	Restore the video decoder after still pictures.
+**
+**	The still picture decoder is kept open for a series of still
+**	pictures (f.e. jumping through cutting marks) and is replaced,
+**	when normal replay continues.
+*/
+static void StillPictureDone(void)
+{
+    if (StillHardwareDecoder >= 0) {
+	VideoHardwareDecoder = StillHardwareDecoder;
+	StillHardwareDecoder = -1;
+	VideoNextPacket(MyVideoStream, AV_CODEC_ID_NONE);	// close last stream
+    }
+}
+
+/**
+**	Set play mode, called on channel switch.
+**
+**	@param play_mode	play mode (none, video+audio, audio-only, ...)
+*/
+int SetPlayMode(int play_mode)
+{
+    switch (play_mode) {
+	case 0:			// audio/video from decoder
+	    StillPictureDone();
+	    VideoZapStart(MyVideoStream->HwDecoder);
+	    // tell video parser we get new stream
+	    if (MyVideoStream->Decoder && !MyVideoStream->SkipStream) {
+		// clear buffers on close configured always or replay only
+		if (ConfigVideoClearOnSwitch || MyVideoStream->ClearClose) {
+		    Clear();		// flush all buffers
+		    MyVideoStream->ClearClose = 0;
+		}
+		if (MyVideoStream->CodecID != AV_CODEC_ID_NONE) {
+		    MyVideoStream->NewStream = 1;
+		    MyVideoStream->InvalidPesCounter = 0;
+		    // tell hw decoder we are closing stream
+		    VideoSetClosing(MyVideoStream->HwDecoder);
+		    VideoResetStart(MyVideoStream->HwDecoder);
+#ifdef DEBUG
+		    VideoSwitch = GetMsTicks();
+		    Debug(3, "video: new stream start\n");
+#endif
+		}
+	    }
+	    if (MyAudioDecoder) {	// tell audio parser we have new stream
+		if (AudioCodecID != AV_CODEC_ID_NONE) {
+		    NewAudioStream = 1;
+		}
+	    }
+	    break;
+	case 1:			// audio/video from player
+	    VideoDisplayWakeup();
+	    Play();
+	    break;
+	case 2:			// audio only from player, video from decoder
+	case 3:			// audio only from player, no video (black screen)
+	    Debug(3, "softhddev: FIXME: audio only, silence video errors\n");
+	    VideoDisplayWakeup();
+	    Play();
+	    break;
+	case 4:			// video only from player, audio from decoder
+	    VideoDisplayWakeup();
+	    Play();
+	    break;
+    }
+    return 1;
+}
+
+/**
+**	Gets the current System Time Counter, which can be used to
+**	synchronize audio, video and subtitles.
+*/
+int64_t GetSTC(void)
+{
+    if (MyVideoStream->HwDecoder) {
+	return VideoGetClock(MyVideoStream->HwDecoder);
+    }
+    // could happen during dettached
+    Warning(_("softhddev: %s called without hw decoder\n"), __FUNCTION__);
+    return AV_NOPTS_VALUE;
+}
+
+/**
+**	Get video stream size and aspect.
+**
+**	@param width[OUT]	width of video stream
+**	@param height[OUT]	height of video stream
+**	@param aspect[OUT]	aspect ratio (4/3, 16/9, ...) of video stream
+*/
+void GetVideoSize(int *width, int *height, double *aspect)
+{
+#ifdef DEBUG
+    static int done_width;
+    static int done_height;
+#endif
+    int aspect_num;
+    int aspect_den;
+
+    if (MyVideoStream->HwDecoder) {
+	VideoGetVideoSize(MyVideoStream->HwDecoder, width, height, &aspect_num,
+	    &aspect_den);
+	*aspect = (double)aspect_num / (double)aspect_den;
+    } else {
+	*width = 0;
+	*height = 0;
+	*aspect = 1.0;			// like default cDevice::GetVideoSize
+    }
+
+#ifdef DEBUG
+    if (done_width != *width || done_height != *height) {
+	Debug(3, "[softhddev]%s: %dx%d %g\n", __FUNCTION__, *width, *height,
+	    *aspect);
+	done_width = *width;
+	done_height = *height;
+    }
+#endif
+}
+
+/**
+**	Set trick play speed.
+**
+**	Every single frame shall then be displayed the given number of
+**	times.
+**
+**	VDR uses 8, 4, 2 for slow forward, 63, 48, 24 for slow reverse and
+**	6, 3, 1 for fast forward and rewind.  Only slow forward feeds all
+**	frames, all others only I-frames.  Outside slow forward the
+**	decoder needs only reference frames.
+**
+**	@param speed	trick speed
+**	@param forward	flag forward direction
+*/
+void TrickSpeed(int speed, int forward)
+{
+    int slow;
+
+    StillPictureDone();
+    slow = forward && (speed == 2 || speed == 4 || speed == 8);
+    MyVideoStream->TrickSpeed = speed;
+    MyVideoStream->TrickSkip = speed && !slow;
+    if (MyVideoStream->Decoder) {
+	CodecVideoSetTrickMode(MyVideoStream->Decoder,
+	    speed ? slow ? 1 : 2 : 0);
+    }
+    if (MyVideoStream->HwDecoder) {
+	VideoSetTrickSpeed(MyVideoStream->HwDecoder, speed);
+    } else {
+	// can happen, during startup
+	Debug(3, "softhddev: %s called without hw decoder\n", __FUNCTION__);
+    }
+    StreamFreezed = 0;
+    MyVideoStream->Freezed = 0;
+}
+
+/**
+**	Clears all video and audio data from the device.
+*/
+void Clear(void)
+{
+    int i;
+
+    VideoResetPacket(MyVideoStream);	// terminate work
+    MyVideoStream->ClearBuffers = 1;
+    if (!SkipAudio) {
+	AudioFlushBuffers();
+	//NewAudioStream = 1;
+    }
+    // FIXME: audio avcodec_flush_buffers, video is done by VideoClearBuffers
+
+    // wait for empty buffers
+    // FIXME: without softstart sync VideoDecode isn't called.
+    for (i = 0; MyVideoStream->ClearBuffers && i < 20; ++i) {
+	usleep(1 * 1000);
+    }
+    Debug(3, "[softhddev]%s: %dms buffers %d\n", __FUNCTION__, i,
+	VideoGetBuffers(MyVideoStream));
+}
+
+/**
+**	Sets the device into play mode.
+*/
+void Play(void)
+{
+    TrickSpeed(0, 1);			// normal play
+    SkipAudio = 0;
+    AudioPlay();
+}
+
+/**
+**	Sets the device into "freeze frame" mode.
 */
 void Freeze(void)
 {
@@ -3028,18 +3872,17 @@ void Mute(void)
 /**
 **	Display the given I-frame as a still picture.
 **
+**	The frame is queued once and decoded with an explicit drain of
+**	the decoder, the decoder thread signals when it is done.
+**
 **	@param data	pes frame data
 **	@param size	number of bytes in frame
 */
 void StillPicture(const uint8_t * data, int size)
 {
-    static uint8_t seq_end_mpeg[] = { 0x00, 0x00, 0x01, 0xB7 };
-    // H264 NAL End of Sequence
-    static uint8_t seq_end_h264[] = { 0x00, 0x00, 0x00, 0x01, 0x0A };
-    // H265 NAL End of Sequence
-    static uint8_t seq_end_h265[] = { 0x00, 0x00, 0x00, 0x01, 0x48, 0x01 }; //0x48 = end of seq   0x4a = end of stream
-    int i;
-    unsigned int old_video_hardware_decoder;
+    struct timespec abstime;
+    int done;
+    int err;
 
     // might be called in Suspended Mode
     if (!MyVideoStream->Decoder || MyVideoStream->SkipStream) {
@@ -3059,9 +3902,11 @@ void StillPicture(const uint8_t * data, int size)
     }
     VideoSetTrickSpeed(MyVideoStream->HwDecoder, 1);
     VideoResetPacket(MyVideoStream);
-    old_video_hardware_decoder = VideoHardwareDecoder;
-    // enable/disable hardware decoder for still picture
+    // enable/disable hardware decoder for still picture, kept until play
     if (VideoHardwareDecoder != ConfigStillDecoder) {
+	if (StillHardwareDecoder < 0) {
+	    StillHardwareDecoder = VideoHardwareDecoder;
+	}
 	VideoHardwareDecoder = ConfigStillDecoder;
 	VideoNextPacket(MyVideoStream, AV_CODEC_ID_NONE);	// close last stream
     }
@@ -3069,95 +3914,128 @@ void StillPicture(const uint8_t * data, int size)
 	// FIXME: should detect codec, see PlayVideo
 	Error(_("[softhddev] no codec known for still picture\n"));
     }
-
-    // FIXME: can check video backend, if a frame was produced.
-    // output for max reference frames
 #ifdef STILL_DEBUG
     fprintf(stderr, "still-picture\n");
 #endif
-    for (i = 0; i < (MyVideoStream->CodecID == AV_CODEC_ID_HEVC ? 10 : 8);
-	++i) {
+
+    // FIXME: vdr pes recordings sends mixed audio/video
+    if ((data[3] & 0xF0) == 0xE0) {	// PES packet
 	const uint8_t *split;
 	int n;
 
-	// FIXME: vdr pes recordings sends mixed audio/video
-	if ((data[3] & 0xF0) == 0xE0) {	// PES packet
-            Debug(3, "[softhddev]%s: receive PES\n", __FUNCTION__);
-	    split = data;
-	    n = size;
-	    // split the I-frame into single pes packets
-	    do {
-		int len;
+	Debug(3, "[softhddev]%s: receive PES\n", __FUNCTION__);
+	split = data;
+	n = size;
+	// split the I-frame into single pes packets
+	do {
+	    int len;
 
 #ifdef DEBUG
-		if (split[0] || split[1] || split[2] != 0x01) {
-		    Error(_("[softhddev] invalid still video packet\n"));
-		    break;
-		}
+	    if (split[0] || split[1] || split[2] != 0x01) {
+		Error(_("[softhddev] invalid still video packet\n"));
+		break;
+	    }
 #endif
 
-		len = (split[4] << 8) + split[5];
-		if (!len || len + 6 > n) {
-		    if ((split[3] & 0xF0) == 0xE0) {
-			// video only
-			while (!PlayVideo3(MyVideoStream, split, n)) {	// feed remaining bytes
-			}
-		    }
-		    break;
-		}
+	    len = (split[4] << 8) + split[5];
+	    if (!len || len + 6 > n) {
 		if ((split[3] & 0xF0) == 0xE0) {
 		    // video only
-		    while (!PlayVideo3(MyVideoStream, split, len + 6)) {	// feed it
+		    while (!PlayVideo3(MyVideoStream, split, n)) {	// feed remaining bytes
 		    }
 		}
-		split += 6 + len;
-		n -= 6 + len;
-	    } while (n > 6);
-
-	    VideoNextPacket(MyVideoStream, MyVideoStream->CodecID);	// terminate last packet
-	} else {			// ES packet
-            Debug(3, "[softhddev]%s: receive ES\n", __FUNCTION__);
-	    if (MyVideoStream->CodecID != AV_CODEC_ID_MPEG2VIDEO) {
-		VideoNextPacket(MyVideoStream, AV_CODEC_ID_NONE);	// close last stream
-		MyVideoStream->CodecID = AV_CODEC_ID_MPEG2VIDEO;
+		break;
 	    }
-	    VideoEnqueue(MyVideoStream, AV_NOPTS_VALUE, data, size);
-	}
-	if (MyVideoStream->CodecID == AV_CODEC_ID_H264) {
-	    VideoEnqueue(MyVideoStream, AV_NOPTS_VALUE, seq_end_h264,
-		sizeof(seq_end_h264));
-	} else if (MyVideoStream->CodecID == AV_CODEC_ID_HEVC) {
-	    VideoEnqueue(MyVideoStream, AV_NOPTS_VALUE, seq_end_h265,
-		sizeof(seq_end_h265));
-	} else {
-	    VideoEnqueue(MyVideoStream, AV_NOPTS_VALUE, seq_end_mpeg,
-		sizeof(seq_end_mpeg));
+	    if ((split[3] & 0xF0) == 0xE0) {
+		// video only
+		while (!PlayVideo3(MyVideoStream, split, len + 6)) {	// feed it
+		}
+	    }
+	    split += 6 + len;
+	    n -= 6 + len;
+	} while (n > 6);
+    } else {				// ES packet
+	Debug(3, "[softhddev]%s: receive ES\n", __FUNCTION__);
+	if (MyVideoStream->CodecID != AV_CODEC_ID_MPEG2VIDEO) {
+	    VideoNextPacket(MyVideoStream, AV_CODEC_ID_NONE);	// close last stream
+	    MyVideoStream->CodecID = AV_CODEC_ID_MPEG2VIDEO;
 	}
-	VideoNextPacket(MyVideoStream, MyVideoStream->CodecID);	// terminate last packet
+	VideoEnqueue(MyVideoStream, AV_NOPTS_VALUE, data, size);
     }
 
-    // wait for empty buffers
-    for (i = 0; VideoGetBuffers(MyVideoStream) && i < 100; ++i) {
-	usleep(10 * 1000);
+    // the last packet holds the picture, decode and drain it
+    if (!MyVideoStream->PacketRb[MyVideoStream->PacketWrite].stream_index) {
+	Debug(3, "[softhddev]%s: no picture\n", __FUNCTION__);
+#ifdef STILL_DEBUG
+	InStillPicture = 0;
+#endif
+	return;
     }
-    Debug(3, "[softhddev]%s: buffers %d %dms\n", __FUNCTION__,
-	VideoGetBuffers(MyVideoStream), i * 10);
+    pthread_mutex_lock(&MyVideoStream->DecoderLockMutex);
+    done = MyVideoStream->StillDone;
+    pthread_mutex_unlock(&MyVideoStream->DecoderLockMutex);
+    MyVideoStream->StillRb[MyVideoStream->PacketWrite] = 1;
+    VideoNextPacket(MyVideoStream, MyVideoStream->CodecID);	// terminate last packet
+
+    // wait until decoded, at most 1s (cond uses monotonic clock)
+    clock_gettime(CLOCK_MONOTONIC, &abstime);
+    abstime.tv_sec += 1;
+    err = 0;
+    pthread_mutex_lock(&MyVideoStream->DecoderLockMutex);
+    while (MyVideoStream->StillDone == done && err != ETIMEDOUT) {
+	err = pthread_cond_timedwait(&MyVideoStream->StillCond,
+	    &MyVideoStream->DecoderLockMutex, &abstime);
+    }
+    pthread_mutex_unlock(&MyVideoStream->DecoderLockMutex);
+    Debug(3, "[softhddev]%s: %s buffers %d\n", __FUNCTION__,
+	err == ETIMEDOUT ? "timeout" : "decoded",
+	VideoGetBuffers(MyVideoStream));
 #ifdef STILL_DEBUG
     InStillPicture = 0;
 #endif
-    if (VideoHardwareDecoder != old_video_hardware_decoder) {
-	VideoHardwareDecoder = old_video_hardware_decoder;
-	VideoNextPacket(MyVideoStream, AV_CODEC_ID_NONE);	// close last stream
+}
+
+/**
+**	Ready check for Poll.
+*/
+static int PollReady(void)
+{
+    return !BuffersFull();
+}
+
+/**
+**	Ready check for Flush.
+*/
+static int FlushReady(void)
+{
+    return !atomic_read(&MyVideoStream->PacketsFilled);
+}
+
+/**
+**	Calculate absolute timeout for the buffer space condition.
+**
+**	The condition uses the monotonic clock.
+**
+**	@param abstime[OUT]	absolute time
+**	@param timeout		timeout in ms
+*/
+static void BufferSpaceTimeout(struct timespec *abstime, int timeout)
+{
+    clock_gettime(CLOCK_MONOTONIC, abstime);
+    abstime->tv_sec += timeout / 1000;
+    abstime->tv_nsec += (timeout % 1000) * 1000 * 1000;
+    if (abstime->tv_nsec >= 1000 * 1000 * 1000) {
+	abstime->tv_nsec -= 1000 * 1000 * 1000;
+	abstime->tv_sec++;
     }
 }
 
 /**
 **	Poll if device is ready.  Called by replay.
 **
-**	This function is useless, the return value is ignored and
-**	all buffers are overrun by vdr.
-**
-**	The dvd plugin is using this correct.
+**	Busy is reported above the high watermarks and kept until the
+**	buffers are drained below the low watermarks, so vdr refills in
+**	bursts.  Waits for the decoder and audio thread to signal space.
 **
 **	@param timeout	timeout to become ready in ms
 **
@@ -3166,33 +4044,19 @@ void StillPicture(const uint8_t * data, int size)
 */
 int Poll(int timeout)
 {
+    struct timespec abstime;
+
     // poll is only called during replay, flush buffers after replay
     MyVideoStream->ClearClose = 1;
-    for (;;) {
-	int full;
-	int t;
-	int used;
-	int filled;
-
-	used = AudioUsedBytes();
-	// FIXME: no video!
-	filled = atomic_read(&MyVideoStream->PacketsFilled);
-	// soft limit + hard limit
-	full = (used > AUDIO_MIN_BUFFER_FREE && filled > 3)
-	    || AudioFreeBytes() < AUDIO_MIN_BUFFER_FREE
-	    || filled >= VIDEO_PACKET_MAX - 10;
 
-	if (!full || !timeout) {
-	    return !full;
-	}
-
-	t = 15;
-	if (timeout < t) {
-	    t = timeout;
-	}
-	usleep(t * 1000);		// let display thread work
-	timeout -= t;
+    if (PollReady()) {
+	return 1;
+    }
+    if (timeout <= 0) {
+	return 0;
     }
+    BufferSpaceTimeout(&abstime, timeout);
+    return BufferSpaceWait(&abstime, PollReady);
 }
 
 /**
@@ -3202,13 +4066,16 @@ int Poll(int timeout)
 */
 int Flush(int timeout)
 {
-    if (atomic_read(&MyVideoStream->PacketsFilled)) {
-	if (timeout) {			// let display thread work
-	    usleep(timeout * 1000);
-	}
-	return !atomic_read(&MyVideoStream->PacketsFilled);
+    struct timespec abstime;
+
+    if (FlushReady()) {
+	return 1;
     }
-    return 1;
+    if (timeout <= 0) {
+	return 0;
+    }
+    BufferSpaceTimeout(&abstime, timeout);
+    return BufferSpaceWait(&abstime, FlushReady);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -3270,6 +4137,136 @@ void OsdDrawARGB(int xi, int yi, int height, int width, int pitch,
     VideoOsdDrawARGB(xi, yi, height, width, pitch, argb, x, y);
 }
 
+/**
+**	Draw the damaged OSD areas of one flush.
+**
+**	@param rects	damaged areas with their ARGB image data
+**	@param n	number of areas
+*/
+void OsdDrawRects(const VideoOsdRect * rects, int n)
+{
+    // wakeup display for showing remote learning dialog
+    VideoDisplayWakeup();
+    TraceBegin(TRACE_OSD_DRAW, n);
+    VideoOsdDrawRects(rects, n);
+    TraceEnd(TRACE_OSD_DRAW, n);
+    MetricsInc(METRIC_OSD_DRAWS);
+}
+
+static pthread_mutex_t OsdFlushMutex = PTHREAD_MUTEX_INITIALIZER;	///< flush pacing lock
+static uint32_t OsdFlushLast;		///< ticks of last presented flush
+static uint32_t OsdFlushWindow;		///< start ticks of rate window
+static int OsdFlushRequests;		///< flushes requested in window
+static int OsdFlushPresents;		///< flushes presented in window
+static int OsdFlushRequestRate;		///< requested flushes per second
+static int OsdFlushPresentRate;		///< presented flushes per second
+
+/**
+**	Get the display frame period, OSD flushes are paced to.
+**
+**	@returns frame period in us, fitted vsync period of the presenter
+**	or 50Hz.
+*/
+static int OsdFramePeriod(void)
+{
+    const char *cadence;
+    int period;
+    int judder;
+    int resyncs;
+
+    if (GetPresenterStats(&cadence, &period, &judder, &resyncs)
+	&& period > 0) {
+	return period;
+    }
+    return 1000000 / 50;
+}
+
+/**
+**	Update the flush rates, once the rate window is a second old.
+**
+**	Must be called with OsdFlushMutex held.
+**
+**	@param now	current ticks in us
+*/
+static void OsdFlushRates(uint32_t now)
+{
+    int32_t elapsed;
+
+    elapsed = now - OsdFlushWindow;
+    if (elapsed < 1000000) {
+	return;
+    }
+    if (elapsed < 2 * 1000000) {
+	OsdFlushRequestRate =
+	    (int64_t) OsdFlushRequests * 1000000 / elapsed;
+	OsdFlushPresentRate =
+	    (int64_t) OsdFlushPresents * 1000000 / elapsed;
+    } else {				// idle
+	OsdFlushRequestRate = 0;
+	OsdFlushPresentRate = 0;
+    }
+    OsdFlushWindow = now;
+    OsdFlushRequests = 0;
+    OsdFlushPresents = 0;
+}
+
+/**
+**	Request an OSD flush.
+**
+**	Flushes are coalesced to at most one presentation per display
+**	frame.  Until then the damage stays pending in the OSD.
+**
+**	@returns time in us until the flush can be presented, 0 present
+**	now.
+*/
+int OsdFlushPace(void)
+{
+    uint32_t now;
+    int32_t wait;
+    int period;
+
+    period = OsdFramePeriod();
+    pthread_mutex_lock(&OsdFlushMutex);
+    now = GetUsTicks();
+    OsdFlushRates(now);
+    ++OsdFlushRequests;
+
+    wait = OsdFlushLast + period - now;
+    pthread_mutex_unlock(&OsdFlushMutex);
+    if (wait <= 0 || wait > 1000000) {	// due or clock jumped
+	return 0;
+    }
+    return wait;
+}
+
+/**
+**	Note that an OSD flush was presented.
+*/
+void OsdFlushPresented(void)
+{
+    pthread_mutex_lock(&OsdFlushMutex);
+    OsdFlushLast = GetUsTicks();
+    ++OsdFlushPresents;
+    pthread_mutex_unlock(&OsdFlushMutex);
+    TraceMark(TRACE_OSD_FLUSH, 0);
+    MetricsInc(METRIC_OSD_FLUSHES);
+}
+
+/**
+**	Get OSD flush rates.
+**
+**	@param[out] requested	flushes per second requested by skins
+**	@param[out] presented	flushes per second presented
+*/
+void OsdGetFlushRates(int *requested, int *presented)
+{
+    pthread_mutex_lock(&OsdFlushMutex);
+    OsdFlushRates(GetUsTicks());
+    *requested = OsdFlushRequestRate;
+    *presented = OsdFlushPresentRate;
+    pthread_mutex_unlock(&OsdFlushMutex);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -3299,6 +4296,9 @@ const char *CommandLineHelp(void)
 	"\tignore-repeat-pict\tdisable repeat pict message\n"
 	"\tuse-possible-defect-frames prefer faster channel switch\n"
 	"\tdisable-ogl-osd disable openGL osd\n"
+	"\tgrab-test\tnoop video driver fills grab ring with test bars\n"
+	"\tnoop-decode\tnoop video driver decodes in software\n"
+	"  -S socket\tpreview stream on unix socket path or tcp [addr:]port\n"
 	"  -D\t\tstart in detached mode\n";
 }
 
@@ -3323,7 +4323,7 @@ int ProcessArgs(int argc, char *const argv[])
     LogLevel = SysLogLevel; // default is the global log level
 
     for (;;) {
-	switch (getopt(argc, argv, "-a:c:d:fg:l:p:sv:w:xDX:")) {
+	switch (getopt(argc, argv, "-a:c:d:fg:l:p:sv:w:xDS:X:")) {
 	    case 'a':			// audio device for pcm
 		AudioSetDevice(optarg);
 		continue;
@@ -3365,6 +4365,9 @@ int ProcessArgs(int argc, char *const argv[])
 	    case 'D':			// start in detached mode
 		ConfigStartSuspended = -1;
 		continue;
+	    case 'S':			// preview stream socket
+		PreviewEndpoint = optarg;
+		continue;
 	    case 'w':			// workarounds
 		if (!strcasecmp("no-hw-decoder", optarg)) {
 		    VideoHardwareDecoder = HWOff;
@@ -3391,6 +4394,10 @@ int ProcessArgs(int argc, char *const argv[])
 		    CodecUsePossibleDefectFrames = 1;
 		} else if (!strcasecmp("disable-ogl-osd", optarg)) {
 		    DisableOglOsd = 1;
+		} else if (!strcasecmp("grab-test", optarg)) {
+		    VideoGrabTest = 1;
+		} else if (!strcasecmp("noop-decode", optarg)) {
+		    VideoNoopDecode = 1;
 		} else {
 		    fprintf(stderr, _("Workaround '%s' unsupported\n"),
 			optarg);
@@ -3537,8 +4544,13 @@ static void StartXServer(void)
 */
 void SoftHdDeviceExit(void)
 {
+#ifdef USE_PIP
+    int i;
+#endif
+
     // lets hope that vdr does a good thread cleanup
 
+    PreviewExit();
     AudioExit();
     if (MyAudioDecoder) {
 	CodecAudioClose(MyAudioDecoder);
@@ -3593,8 +4605,15 @@ void SoftHdDeviceExit(void)
     pthread_mutex_destroy(&SuspendLockMutex);
 #ifdef USE_PIP
     pthread_mutex_destroy(&PipVideoStream->DecoderLockMutex);
+    for (i = 0; i < MOSAIC_TILES_MAX; ++i) {
+	pthread_mutex_destroy(&MosaicStreams[i].DecoderLockMutex);
+    }
 #endif
     pthread_mutex_destroy(&MyVideoStream->DecoderLockMutex);
+    pthread_cond_destroy(&MyVideoStream->StillCond);
+    pthread_cond_destroy(&BufferSpaceCond);
+    pthread_mutex_destroy(&BufferSpaceMutex);
+    TraceEnable(0);
 }
 
 /**
@@ -3606,14 +4625,31 @@ void SoftHdDeviceExit(void)
 */
 int Start(void)
 {
+    pthread_condattr_t condattr;
+
+#ifdef USE_PIP
+    int i;
+#endif
+
     if (ConfigStartX11Server) {
 	StartXServer();
     }
     CodecInit();
 
     pthread_mutex_init(&MyVideoStream->DecoderLockMutex, NULL);
+    // timed waits must not jump with the wall clock
+    pthread_condattr_init(&condattr);
+    pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&MyVideoStream->StillCond, &condattr);
+    pthread_mutex_init(&BufferSpaceMutex, NULL);
+    pthread_cond_init(&BufferSpaceCond, &condattr);
+    pthread_condattr_destroy(&condattr);
+    AudioSetSpaceCallback(BufferSpaceSignal);
 #ifdef USE_PIP
     pthread_mutex_init(&PipVideoStream->DecoderLockMutex, NULL);
+    for (i = 0; i < MOSAIC_TILES_MAX; ++i) {
+	pthread_mutex_init(&MosaicStreams[i].DecoderLockMutex, NULL);
+    }
 #endif
     pthread_mutex_init(&SuspendLockMutex, NULL);
 
@@ -3640,6 +4676,7 @@ int Start(void)
     Info(_("[softhddev] ready%s\n"),
 	ConfigStartSuspended ? ConfigStartSuspended ==
 	-1 ? " detached" : " suspended" : "");
+    PreviewInit();
 
     return ConfigStartSuspended;
 }
@@ -3708,6 +4745,8 @@ void MainThreadHook(void)
 
     /// call VDR support function
 extern void DelPip(void);
+    /// call VDR support function
+extern void DelMosaic(void);
 
 /**
 **	Suspend plugin.
@@ -3728,6 +4767,7 @@ void Suspend(int video, int audio, int dox11)
 
 #ifdef USE_PIP
     DelPip();				// must stop PIP
+    DelMosaic();			// must stop mosaic
 #endif
 
     // FIXME: should not be correct, if not both are suspended!
@@ -3814,6 +4854,26 @@ void GetStats(int *missed, int *duped, int *dropped, int *counter)
     }
 }
 
+/**
+**	Get frame presenter statistics.
+**
+**	@param[out] cadence	detected cadence
+**	@param[out] period	fitted vsync period in us
+**	@param[out] judder	frames shown outside of the cadence
+**	@param[out] resyncs	number of phase resyncs
+**
+**	@returns false, if the presenter isn't used.
+*/
+int GetPresenterStats(const char **cadence, int *period, int *judder,
+    int *resyncs)
+{
+    if (MyVideoStream->HwDecoder) {
+	return VideoGetPresenterStats(MyVideoStream->HwDecoder, cadence,
+	    period, judder, resyncs);
+    }
+    return 0;
+}
+
 /**
 **	Scale the currently shown video.
 **
@@ -3835,9 +4895,25 @@ void ScaleVideo(int x, int y, int width, int height)
 
 #ifdef USE_PIP
 
+    /// pip windows narrower than this % of the osd get half frame rate
+static int PipLowRateWidth = 25;
+
+/**
+**	Set PIP half frame rate threshold.
+**
+**	@param width	pip window width in % of the osd, 0 disables
+*/
+void PipSetLowRate(int width)
+{
+    PipLowRateWidth = width < 0 ? 0 : width > 100 ? 100 : width;
+}
+
 /**
 **	Set PIP position.
 **
+**	Pip windows up to half of the osd width are decoded with reduced
+**	cost, smaller than #PipLowRateWidth get only every second frame.
+**
 **	@param x		video window x coordinate OSD relative
 **	@param y		video window y coordinate OSD relative
 **	@param width		video window width OSD relative
@@ -3860,6 +4936,15 @@ void PipSetPosition(int x, int y, int width, int height, int pip_x, int pip_y,
     }
     VideoSetOutputPosition(PipVideoStream->HwDecoder, pip_x, pip_y, pip_width,
 	pip_height);
+    if (PipVideoStream->Decoder) {
+	int osd_width;
+	int osd_height;
+
+	VideoGetOsdSize(&osd_width, &osd_height);
+	CodecVideoSetReduced(PipVideoStream->Decoder,
+	    pip_width * 2 <= osd_width,
+	    pip_width * 100 < PipLowRateWidth * osd_width);
+    }
 }
 
 /**
@@ -3920,6 +5005,161 @@ int PipPlayVideo(const uint8_t * data, int size)
     return PlayVideo3(PipVideoStream, data, size);
 }
 
+//////////////////////////////////////////////////////////////////////////////
+//	Mosaic
+//////////////////////////////////////////////////////////////////////////////
+
+    /// packets the focused mosaic tile decodes for each packet of the others
+#define MOSAIC_FOCUS_PRIORITY 4
+
+static int MosaicTileN;			///< number of mosaic tiles
+static int MosaicFocus;			///< focused mosaic tile
+
+/**
+**	Place mosaic tiles and set their decode cost.
+**
+**	The tiles are placed in a grid over the osd.  Only the focused tile
+**	is decoded in full, all others with reduced cost and half frame rate.
+**	The focused tile also gets more packets each round of the decoder
+**	thread.
+*/
+static void MosaicLayout(void)
+{
+    int osd_width;
+    int osd_height;
+    int columns;
+    int rows;
+    int i;
+
+    if (!MosaicTileN) {
+	return;
+    }
+    VideoGetOsdSize(&osd_width, &osd_height);
+    columns = 1;
+    while (columns * columns < MosaicTileN) {
+	++columns;
+    }
+    rows = (MosaicTileN + columns - 1) / columns;
+
+    for (i = 0; i < MosaicTileN; ++i) {
+	VideoStream *stream;
+	int focused;
+
+	stream = &MosaicStreams[i];
+	if (!stream->HwDecoder) {	// tile not running
+	    continue;
+	}
+	focused = i == MosaicFocus;
+	stream->Priority = focused ? MOSAIC_FOCUS_PRIORITY : 0;
+	VideoSetOutputPosition(stream->HwDecoder,
+	    ((i % columns) * osd_width) / columns,
+	    ((i / columns) * osd_height) / rows, osd_width / columns,
+	    osd_height / rows);
+	if (stream->Decoder) {
+	    CodecVideoSetReduced(stream->Decoder, !focused, !focused);
+	}
+    }
+}
+
+/**
+**	Start mosaic streams.
+**
+**	The video backend limits the number of concurrent decoders, the
+**	tiles without decoder are dropped.
+**
+**	@param n	number of tiles (1 .. #MOSAIC_TILES_MAX)
+**
+**	@returns number of tiles with running decoder.
+*/
+int MosaicStart(int n)
+{
+    int i;
+
+    if (!MyVideoStream->HwDecoder) {	// video not running
+	return 0;
+    }
+    if (n > MOSAIC_TILES_MAX) {
+	n = MOSAIC_TILES_MAX;
+    }
+
+    for (i = 0; i < n; ++i) {
+	if (!MosaicStreams[i].Decoder) {
+	    VideoStreamOpen(&MosaicStreams[i]);
+	}
+	if (!MosaicStreams[i].HwDecoder) {	// out of decoders
+	    break;
+	}
+    }
+    MosaicTileN = i;
+    if (MosaicFocus >= MosaicTileN) {
+	MosaicFocus = 0;
+    }
+    MosaicLayout();
+
+    Info("[softhddev]%s: %d of %d mosaic tiles running\n", __FUNCTION__,
+	MosaicTileN, n);
+    return MosaicTileN;
+}
+
+/**
+**	Stop mosaic streams.
+*/
+void MosaicStop(void)
+{
+    int i;
+    int j;
+
+    for (i = 0; i < MosaicTileN; ++i) {
+	VideoStream *stream;
+
+	stream = &MosaicStreams[i];
+	stream->Priority = 0;
+	if (!stream->Decoder) {
+	    continue;
+	}
+	stream->Close = 1;
+	for (j = 0; stream->Close && j < 50; ++j) {
+	    usleep(1 * 1000);
+	}
+	Debug(3, "[softhddev]%s: tile %d close %dms\n", __FUNCTION__, i, j);
+    }
+    MosaicTileN = 0;
+}
+
+/**
+**	Set focused mosaic tile.
+**
+**	@param tile	tile number (0 .. number of tiles - 1)
+**
+**	@returns 0 if ok, -1 no such tile.
+*/
+int MosaicSetFocus(int tile)
+{
+    if (tile < 0 || tile >= MosaicTileN) {
+	return -1;
+    }
+    MosaicFocus = tile;
+    MosaicLayout();
+    return 0;
+}
+
+/**
+**	Mosaic play video packet.
+**
+**	@param tile	tile number
+**	@param data	data of exactly one complete PES packet
+**	@param size	size of PES packet
+**
+**	@return number of bytes used, 0 if internal buffer are full.
+*/
+int MosaicPlayVideo(int tile, const uint8_t * data, int size)
+{
+    if (tile < 0 || tile >= MosaicTileN) {
+	return size;			// drop packets of unknown tiles
+    }
+    return PlayVideo3(&MosaicStreams[tile], data, size);
+}
+
 #endif
 
 int IsReplay(void)
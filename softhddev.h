@@ -36,6 +36,15 @@ extern "C"
     /// C plugin draw osd pixmap
     extern void OsdDrawARGB(int, int, int, int, int, const uint8_t *, int,
 	int);
+    struct _video_osd_rect_;
+    /// C plugin draw damaged osd areas of one flush
+    extern void OsdDrawRects(const struct _video_osd_rect_ *, int);
+    /// C plugin pace osd flush to the display frame rate
+    extern int OsdFlushPace(void);
+    /// C plugin osd flush was presented
+    extern void OsdFlushPresented(void);
+    /// C plugin get requested and presented osd flush rates
+    extern void OsdGetFlushRates(int *, int *);
 
     /// C plugin play audio packet
     extern int PlayAudio(const uint8_t *, int, uint8_t);
@@ -52,6 +61,8 @@ extern "C"
     extern int PlayTsVideo(const uint8_t *, int);
     /// C plugin grab an image
     extern uint8_t *GrabImage(int *, int, int, int, int);
+    /// C plugin set preview stream rate and width
+    extern void PreviewSetRate(int, int);
 
     /// C plugin set play mode
     extern int SetPlayMode(int);
@@ -60,7 +71,7 @@ extern "C"
     /// C plugin get video stream size and aspect
     extern void GetVideoSize(int *, int *, double *);
     /// C plugin set trick speed
-    extern void TrickSpeed(int);
+    extern void TrickSpeed(int, int);
     /// C plugin clears all video and audio data from the device
     extern void Clear(void);
     /// C plugin sets the device into play mode
@@ -99,6 +110,8 @@ extern "C"
 
     /// Get decoder statistics
     extern void GetStats(int *, int *, int *, int *);
+    /// Get frame presenter statistics
+    extern int GetPresenterStats(const char **, int *, int *, int *);
     /// C plugin scale video
     extern void ScaleVideo(int, int, int, int);
 
@@ -110,6 +123,19 @@ extern "C"
     extern void PipStop(void);
     /// Pip play video packet
     extern int PipPlayVideo(const uint8_t *, int);
+    /// Pip set half frame rate threshold
+    extern void PipSetLowRate(int);
+
+    /// Mosaic maximal number of tiles
+#define MOSAIC_TILES_MAX 9
+    /// Mosaic start
+    extern int MosaicStart(int);
+    /// Mosaic stop
+    extern void MosaicStop(void);
+    /// Mosaic set focused tile
+    extern int MosaicSetFocus(int);
+    /// Mosaic play video packet
+    extern int MosaicPlayVideo(int, const uint8_t *, int);
 
     extern const char *X11DisplayName;	///< x11 display name
 #ifdef __cplusplus
@@ -50,6 +50,8 @@ extern "C"
 #include "video.h"
 #include "codec.h"
 #include "misc.h"
+#include "trace.h"
+#include "metrics.h"
 }
 
 #if APIVERSNUM >= 20301
@@ -103,6 +105,8 @@ static int ConfigOsdHeight;		///< config OSD height
 static char ConfigVideoStudioLevels;	///< config use studio levels
 static char ConfigVideo60HzMode;	///< config use 60Hz display mode
 static char ConfigVideoSoftStartSync;	///< config use softstart sync
+static char ConfigVideoFastStart;	///< config fast start of new streams
+static char ConfigVideoPresenter;	///< config pts scheduled presenter
 static char ConfigVideoBlackPicture;	///< config enable black picture mode
 char ConfigVideoClearOnSwitch;		///< config enable Clear on channel switch
 
@@ -145,6 +149,11 @@ static int ConfigAutoCropInterval;	///< auto crop detection interval
 static int ConfigAutoCropDelay;		///< auto crop detection delay
 static int ConfigAutoCropTolerance;	///< auto crop detection tolerance
 
+static int ConfigGrabRate;		///< grab ring rate in Hz
+static int ConfigGrabWidth = 512;	///< grab ring image width
+static int ConfigPreviewRate = 5;	///< preview stream frames per second
+static int ConfigPreviewWidth = 320;	///< preview stream image width
+
 static int ConfigVideoAudioDelay;	///< config audio delay
 static char ConfigAudioDrift;		///< config audio drift
 static char ConfigAudioPassthrough;	///< config audio pass-through mask
@@ -159,6 +168,7 @@ static int ConfigAudioStereoDescent;	///< config reduce stereo loudness
 int ConfigAudioBufferTime;		///< config size ms of audio buffer
 int DisableOglOsd;			///< flag to disable openGL osd
 static int ConfigAudioAutoAES;		///< config automatic AES handling
+static int ConfigLowLatency;		///< config low latency profile
 
 static char *ConfigX11Display;		///< config x11 display
 static char *ConfigAudioDevice;		///< config audio stereo device
@@ -181,6 +191,9 @@ static int ConfigPipAltVideoX;		///< config pip alt. video x in %
 static int ConfigPipAltVideoY;		///< config pip alt. video y in %
 static int ConfigPipAltVideoWidth;	///< config pip alt. video width in %
 static int ConfigPipAltVideoHeight = 50;	///< config pip alt. video height in %
+    /// config pip reduced cost decode modes
+static int ConfigPipDecode[RESOLUTIONS] = { 0, 1, 1, 2, 3 };
+static int ConfigPipLowRateWidth = 25;	///< config pip half rate below width %
 #endif
 
 #ifdef USE_SCREENSAVER
@@ -351,6 +364,152 @@ extern "C" void FeedKeyPress(const char *keymap, const char *key, int repeat,
 //	OSD
 //////////////////////////////////////////////////////////////////////////////
 
+cOsdFlushPacer *cOsdFlushPacer::Pacer;	///< single pacer
+
+/**
+**	OSD flush pacer constructor.
+*/
+cOsdFlushPacer::cOsdFlushPacer(void)
+:cThread("softhddev osd pacer")
+{
+    due = 0;
+    threadId = 0;
+    Pacer = this;
+    Start();
+}
+
+/**
+**	OSD flush pacer destructor.
+*/
+cOsdFlushPacer::~cOsdFlushPacer(void)
+{
+    Pacer = NULL;
+    {
+	cMutexLock MutexLock(&mutex);
+
+	pending.Clear();
+	wakeup.Broadcast();
+    }
+    cThread::Cancel(3);
+}
+
+/**
+**	Defer an OSD flush.
+**
+**	Called by the OSD before composing.  Further flushes only merge
+**	their damage into the still pending one.  The deferred flush done
+**	by the pacer itself is due and isn't counted as requested.
+**
+**	@param osd	osd requesting the flush
+**
+**	@returns true, if the flush is deferred to the next frame.
+*/
+bool cOsdFlushPacer::Defer(cOsd * osd)
+{
+    cOsdFlushPacer *pacer;
+    int wait;
+    int i;
+
+    if (!(pacer = Pacer)) {
+	OsdFlushPace();
+	return false;
+    }
+    if (cThread::ThreadId() == pacer->threadId) {
+	return false;
+    }
+    cMutexLock MutexLock(&pacer->mutex);
+
+    wait = OsdFlushPace();
+    for (i = 0; i < pacer->pending.Size(); ++i) {
+	if (pacer->pending[i] == osd) {
+	    if (!wait) {
+		pacer->pending.Remove(i);
+	    }
+	    return wait != 0;
+	}
+    }
+    if (!wait) {
+	return false;
+    }
+    if (!pacer->pending.Size()) {
+	pacer->due = GetUsTicks() + wait;
+    }
+    pacer->pending.Append(osd);
+    pacer->wakeup.Broadcast();
+    return true;
+}
+
+/**
+**	Forget the deferred flush of an OSD.
+**
+**	Must be called, before the OSD is destroyed.  Waits until the
+**	pacer is done with a running flush.
+**
+**	@param osd	osd to be destroyed
+*/
+void cOsdFlushPacer::Forget(cOsd * osd)
+{
+    cOsdFlushPacer *pacer;
+    int i;
+
+    if (!(pacer = Pacer)) {
+	return;
+    }
+    cMutexLock FlushLock(&pacer->flushMutex);
+    cMutexLock MutexLock(&pacer->mutex);
+
+    for (i = 0; i < pacer->pending.Size(); ++i) {
+	if (pacer->pending[i] == osd) {
+	    pacer->pending.Remove(i);
+	    break;
+	}
+    }
+}
+
+/**
+**	OSD flush pacer thread.
+**
+**	Flushes the deferred OSDs, when the next frame is due.
+*/
+void cOsdFlushPacer::Action(void)
+{
+    threadId = cThread::ThreadId();
+    while (Running()) {
+	cOsd *osd;
+	int32_t wait;
+
+	mutex.Lock();
+	if (!pending.Size()) {
+	    wakeup.TimedWait(mutex, 100);
+	    mutex.Unlock();
+	    continue;
+	}
+	wait = due - GetUsTicks();
+	if (wait > 0) {
+	    wakeup.TimedWait(mutex, (wait + 999) / 1000);
+	    mutex.Unlock();
+	    continue;
+	}
+	mutex.Unlock();
+
+	// flushMutex keeps the osd alive, Defer reschedules if needed
+	cMutexLock FlushLock(&flushMutex);
+	mutex.Lock();
+	osd = NULL;
+	if (pending.Size()) {
+	    osd = pending[0];
+	    pending.Remove(0);
+	    due = GetUsTicks();		// remaining osds are due too
+	}
+	mutex.Unlock();
+	if (osd) {
+	    osd->Flush();
+	}
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 /**
 **	Soft device plugin OSD class.
 */
@@ -359,6 +518,14 @@ class cSoftOsd:public cOsd
   public:
     static volatile char Dirty;		///< flag force redraw everything
     int OsdLevel;			///< current osd level FIXME: remove
+  private:
+    uint32_t *Argb;			///< staging buffer of bitmap flush
+    int ArgbSize;			///< pixels in staging buffer
+
+    void FlushBitmaps(void);		///< commits all bitmaps
+    /// uploads damaged pixmap areas
+    int FlushRects(cPixmapMemory **, const VideoOsdRect *, int);
+  public:
 
      cSoftOsd(int, int, uint);		///< osd constructor
      virtual ~ cSoftOsd(void);		///< osd destructor
@@ -420,6 +587,8 @@ cSoftOsd::cSoftOsd(int left, int top, uint level)
 #endif
 
     OsdLevel = level;
+    Argb = NULL;
+    ArgbSize = 0;
 }
 
 /**
@@ -433,8 +602,10 @@ cSoftOsd::~cSoftOsd(void)
     Debug(3, "[softhddev]%s: level %d\n", __FUNCTION__, OsdLevel);
 #endif
 
+    cOsdFlushPacer::Forget(this);
     SetActive(false);
     // done by SetActive: OsdClose();
+    free(Argb);
 
 #ifdef USE_YAEPG
     // support yaepghd, video window
@@ -468,6 +639,9 @@ eOsdError cSoftOsd::SetAreas(const tArea * areas, int n)
 	    bitmap->Clean();
 	}
     }
+    // no deferred flush of the old areas
+    cOsdFlushPacer::Forget(this);
+    LOCK_PIXMAPS;
     if (Active()) {
 	VideoOsdClear();
 	Dirty = 1;
@@ -475,12 +649,245 @@ eOsdError cSoftOsd::SetAreas(const tArea * areas, int n)
     return cOsd::SetAreas(areas, n);
 }
 
+/**
+**	Expand palette indices to ARGB.
+**
+**	@param dst	ARGB output pixels
+**	@param src	palette indices of the bitmap
+**	@param n	number of pixels
+**	@param lut	palette lookup table with 256 entries
+**
+**	Bitmaps of all depths (1/2/4/8 bpp) store one index per pixel,
+**	the lookup table covers unused indices with transparent black.
+*/
+static void OsdIndexToArgb(uint32_t * dst, const tIndex * src, int n,
+    const uint32_t * lut)
+{
+    while (n >= 4) {
+	uint32_t c0;
+	uint32_t c1;
+	uint32_t c2;
+	uint32_t c3;
+
+	// independent loads let the cpu overlap the table lookups
+	c0 = lut[src[0]];
+	c1 = lut[src[1]];
+	c2 = lut[src[2]];
+	c3 = lut[src[3]];
+	dst[0] = c0;
+	dst[1] = c1;
+	dst[2] = c2;
+	dst[3] = c3;
+	src += 4;
+	dst += 4;
+	n -= 4;
+    }
+    while (n-- > 0) {
+	*dst++ = lut[*src++];
+    }
+}
+
+/**
+**	Commits all dirty bitmaps of a non-truecolor OSD.
+**
+**	The dirty areas of bitmaps, which are adjacent on screen, are
+**	converted into the staging buffer and uploaded with a single
+**	OsdDrawARGB call.
+*/
+void cSoftOsd::FlushBitmaps(void)
+{
+    struct
+    {
+	cBitmap *Bitmap;		// bitmap of the dirty area
+	int X1;				// dirty area in bitmap
+	int Y1;
+	int X;				// dirty area on screen
+	int Y;
+	int W;
+	int H;
+    } areas[MAXOSDAREAS];
+    cBitmap *bitmap;
+    int width;
+    int height;
+    double video_aspect;
+    int n;
+    int i;
+
+    ::GetOsdSize(&width, &height, &video_aspect);
+
+    // collect visible dirty areas
+    n = 0;
+    for (i = 0; n < MAXOSDAREAS && (bitmap = GetBitmap(i)); ++i) {
+	int xs;
+	int ys;
+	int w;
+	int h;
+	int x1;
+	int y1;
+	int x2;
+	int y2;
+
+	// get dirty bounding box
+	if (Dirty) {			// forced complete update
+	    x1 = 0;
+	    y1 = 0;
+	    x2 = bitmap->Width() - 1;
+	    y2 = bitmap->Height() - 1;
+	} else if (!bitmap->Dirty(x1, y1, x2, y2)) {
+	    continue;			// nothing dirty continue
+	}
+	// convert and upload only visible dirty areas
+	xs = bitmap->X0() + Left();
+	ys = bitmap->Y0() + Top();
+	w = x2 - x1 + 1;
+	h = y2 - y1 + 1;
+	// clip to screen
+	if (xs + x1 < 0) {
+	    w += xs + x1;
+	    x1 = -xs;
+	}
+	if (ys + y1 < 0) {
+	    h += ys + y1;
+	    y1 = -ys;
+	}
+	if (w > width - xs - x1) {
+	    w = width - xs - x1;
+	}
+	if (h > height - ys - y1) {
+	    h = height - ys - y1;
+	}
+	if (w <= 0 || h <= 0) {
+	    continue;
+	}
+#ifdef DEBUG
+	if (w > bitmap->Width() || h > bitmap->Height()) {
+	    Error(tr("[softhddev]: dirty area too big\n"));
+	    abort();
+	}
+#endif
+	areas[n].Bitmap = bitmap;
+	areas[n].X1 = x1;
+	areas[n].Y1 = y1;
+	areas[n].X = xs + x1;
+	areas[n].Y = ys + y1;
+	areas[n].W = w;
+	areas[n].H = h;
+	++n;
+    }
+
+    for (i = 0; i < n;) {
+	int bx;
+	int by;
+	int bw;
+	int bh;
+	int j;
+	int k;
+
+	// extend batch with the following adjacent areas
+	bx = areas[i].X;
+	by = areas[i].Y;
+	bw = areas[i].W;
+	bh = areas[i].H;
+	for (j = i + 1; j < n; ++j) {
+	    if (areas[j].X == bx && areas[j].W == bw
+		&& areas[j].Y == by + bh) {
+		bh += areas[j].H;	// below
+	    } else if (areas[j].Y == by && areas[j].H == bh
+		&& areas[j].X == bx + bw) {
+		bw += areas[j].W;	// right of
+	    } else {
+		break;
+	    }
+	}
+
+	if (bw * bh > ArgbSize) {
+	    free(Argb);
+	    ArgbSize = bw * bh;
+	    Argb = (uint32_t *) malloc(ArgbSize * sizeof(uint32_t));
+	    if (!Argb) {
+		Error(tr("[softhddev]: out of memory\n"));
+		ArgbSize = 0;
+		return;
+	    }
+	}
+
+	for (k = i; k < j; ++k) {
+	    uint32_t lut[256];
+	    uint32_t *dst;
+	    int colors;
+	    int c;
+	    int y;
+
+	    bitmap = areas[k].Bitmap;
+	    colors = 1 << bitmap->Bpp();
+	    for (c = 0; c < colors; ++c) {
+		lut[c] = bitmap->Color(c);
+	    }
+	    for (; c < 256; ++c) {
+		lut[c] = 0;
+	    }
+	    dst = Argb + (areas[k].Y - by) * bw + areas[k].X - bx;
+	    for (y = 0; y < areas[k].H; ++y) {
+		OsdIndexToArgb(dst + y * bw, bitmap->Data(areas[k].X1,
+			areas[k].Y1 + y), areas[k].W, lut);
+	    }
+	    bitmap->Clean();
+	}
+#ifdef OSD_DEBUG
+	Debug(3, "[softhddev]%s: draw %dx%d%+d%+d %d bm\n", __FUNCTION__, bw,
+	    bh, bx, by, j - i);
+#endif
+	OsdDrawARGB(0, 0, bw, bh, bw * sizeof(uint32_t), (uint8_t *) Argb, bx,
+	    by);
+	i = j;
+    }
+}
+
+/**
+**	Upload the damaged areas of rendered pixmaps and free the pixmaps.
+**
+**	@param pms	rendered pixmaps
+**	@param rects	visible damaged areas of the pixmaps
+**	@param n	number of pixmaps
+**
+**	@returns number of uploaded bytes.
+*/
+int cSoftOsd::FlushRects(cPixmapMemory ** pms, const VideoOsdRect * rects,
+    int n)
+{
+    int bytes;
+    int i;
+
+    if (!n) {
+	return 0;
+    }
+    OsdDrawRects(rects, n);
+    bytes = 0;
+    for (i = 0; i < n; ++i) {
+	bytes += rects[i].Width * rects[i].Height * sizeof(tColor);
+#if APIVERSNUM >= 20110
+	DestroyPixmap(pms[i]);
+#else
+	delete pms[i];
+#endif
+    }
+    return bytes;
+}
+
 /**
 **	Actually commits all data to the OSD hardware.
 */
 void cSoftOsd::Flush(void)
 {
     cPixmapMemory *pm;
+    cPixmapMemory *pms[MAXOSDPIXMAPS];
+    VideoOsdRect rects[MAXOSDPIXMAPS];
+    int width;
+    int height;
+    double video_aspect;
+    int bytes;
+    int n;
+    int i;
 
 #ifdef OSD_DEBUG
     Debug(3, "[softhddev]%s: level %d active %d\n", __FUNCTION__, OsdLevel,
@@ -506,9 +913,6 @@ void cSoftOsd::Flush(void)
 #endif
 
     if (!IsTrueColor()) {
-	cBitmap *bitmap;
-	int i;
-
 #ifdef OSD_DEBUG
 	static char warned;
 
@@ -518,104 +922,19 @@ void cSoftOsd::Flush(void)
 	    warned = 1;
 	}
 #endif
-	// draw all bitmaps
-	for (i = 0; (bitmap = GetBitmap(i)); ++i) {
-	    uint8_t *argb;
-	    int xs;
-	    int ys;
-	    int x;
-	    int y;
-	    int w;
-	    int h;
-	    int x1;
-	    int y1;
-	    int x2;
-	    int y2;
-
-	    // get dirty bounding box
-	    if (Dirty) {		// forced complete update
-		x1 = 0;
-		y1 = 0;
-		x2 = bitmap->Width() - 1;
-		y2 = bitmap->Height() - 1;
-	    } else if (!bitmap->Dirty(x1, y1, x2, y2)) {
-		continue;		// nothing dirty continue
-	    }
-	    // convert and upload only visible dirty areas
-	    xs = bitmap->X0() + Left();
-	    ys = bitmap->Y0() + Top();
-	    // FIXME: negtative position bitmaps
-	    w = x2 - x1 + 1;
-	    h = y2 - y1 + 1;
-	    // clip to screen
-	    if (1) {			// just for the case it makes trouble
-		int width;
-		int height;
-		double video_aspect;
-
-		if (xs < 0) {
-		    if (xs + x1 < 0) {
-			x1 -= xs + x1;
-			w += xs + x1;
-			if (w <= 0) {
-			    continue;
-			}
-		    }
-		    xs = 0;
-		}
-		if (ys < 0) {
-		    if (ys + y1 < 0) {
-			y1 -= ys + y1;
-			h += ys + y1;
-			if (h <= 0) {
-			    continue;
-			}
-		    }
-		    ys = 0;
-		}
-		::GetOsdSize(&width, &height, &video_aspect);
-		if (w > width - xs - x1) {
-		    w = width - xs - x1;
-		    if (w <= 0) {
-			continue;
-		    }
-		    x2 = x1 + w - 1;
-		}
-		if (h > height - ys - y1) {
-		    h = height - ys - y1;
-		    if (h <= 0) {
-			continue;
-		    }
-		    y2 = y1 + h - 1;
-		}
-	    }
-#ifdef DEBUG
-	    if (w > bitmap->Width() || h > bitmap->Height()) {
-		Error(tr("[softhddev]: dirty area too big\n"));
-		abort();
-	    }
-#endif
-	    argb = (uint8_t *) malloc(w * h * sizeof(uint32_t));
-	    for (y = y1; y <= y2; ++y) {
-		for (x = x1; x <= x2; ++x) {
-		    ((uint32_t *) argb)[x - x1 + (y - y1) * w] =
-			bitmap->GetColor(x, y);
-		}
-	    }
-#ifdef OSD_DEBUG
-	    Debug(3, "[softhddev]%s: draw %dx%d%+d%+d bm\n", __FUNCTION__, w, h,
-		xs + x1, ys + y1);
-#endif
-	    OsdDrawARGB(0, 0, w, h, w * sizeof(uint32_t), argb, xs + x1,
-		ys + y1);
-
-	    bitmap->Clean();
-	    // FIXME: reuse argb
-	    free(argb);
-	}
+	FlushBitmaps();
 	Dirty = 0;
 	return;
     }
+    // at most one presentation per display frame
+    if (cOsdFlushPacer::Defer(this)) {
+	return;
+    }
+
+    // clip to screen once for all pixmaps
+    ::GetOsdSize(&width, &height, &video_aspect);
+    n = 0;
+    bytes = 0;
 
     LOCK_PIXMAPS;
     while ((pm = (dynamic_cast < cPixmapMemory * >(RenderPixmaps())))) {
@@ -659,42 +978,73 @@ void cSoftOsd::Flush(void)
 	y += Top();
 
 	// clip to screen
-	if (1) {			// just for the case it makes trouble
-	    // and it can happen!
-	    int width;
-	    int height;
-	    double video_aspect;
-
-	    if (x < 0) {
-		w += x;
-		xp += -x;
-		x = 0;
-	    }
-	    if (y < 0) {
-		h += y;
-		yp += -y;
-		y = 0;
-	    }
-
-	    ::GetOsdSize(&width, &height, &video_aspect);
-	    if (w > width - x) {
-		w = width - x;
-	    }
-	    if (h > height - y) {
-		h = height - y;
-	    }
+	if (x < 0) {
+	    w += x;
+	    xp += -x;
+	    x = 0;
+	}
+	if (y < 0) {
+	    h += y;
+	    yp += -y;
+	    y = 0;
+	}
+	if (w > width - x) {
+	    w = width - x;
+	}
+	if (h > height - y) {
+	    h = height - y;
+	}
+	if (w <= 0 || h <= 0) {
+#if APIVERSNUM >= 20110
+	    DestroyPixmap(pm);
+#else
+	    delete pm;
+#endif
+	    continue;
 	}
 #ifdef OSD_DEBUG
 	Debug(3, "[softhddev]%s: draw %dx%d%+d%+d*%d -> %+d%+d %p\n",
 	    __FUNCTION__, w, h, xp, yp, stride, x, y, pm->Data());
 #endif
-	OsdDrawARGB(xp, yp, w, h, stride, pm->Data(), x, y);
-
+	// drop earlier areas completely covered by this one
+	for (i = 0; i < n;) {
+	    if (rects[i].X >= x && rects[i].Y >= y
+		&& rects[i].X + rects[i].Width <= x + w
+		&& rects[i].Y + rects[i].Height <= y + h) {
 #if APIVERSNUM >= 20110
-	DestroyPixmap(pm);
+		DestroyPixmap(pms[i]);
 #else
-	delete pm;
+		delete pms[i];
+#endif
+		--n;
+		memmove(pms + i, pms + i + 1, (n - i) * sizeof(*pms));
+		memmove(rects + i, rects + i + 1, (n - i) * sizeof(*rects));
+		continue;
+	    }
+	    ++i;
+	}
+	if (n == MAXOSDPIXMAPS) {	// full, upload what we have
+	    bytes += FlushRects(pms, rects, n);
+	    n = 0;
+	}
+
+	pms[n] = pm;
+	rects[n].Xi = xp;
+	rects[n].Yi = yp;
+	rects[n].Width = w;
+	rects[n].Height = h;
+	rects[n].Pitch = stride;
+	rects[n].Argb = pm->Data();
+	rects[n].X = x;
+	rects[n].Y = y;
+	++n;
+    }
+    bytes += FlushRects(pms, rects, n);
+#ifdef OSD_DEBUG
+    Debug(3, "[softhddev]%s: uploaded %d bytes\n", __FUNCTION__, bytes);
 #endif
+    if (bytes) {
+	OsdFlushPresented();
     }
     Dirty = 0;
 }
@@ -748,6 +1098,7 @@ class cSoftOsdProvider:public cOsdProvider
 {
   private:
     static cOsd *Osd;			///< single OSD
+    cOsdFlushPacer *FlushPacer;		///< coalesces osd flushes
 #ifdef USE_OPENGLOSD
     static std::shared_ptr<cOglThread> oglThread;
     static bool StartOpenGlThread(void);
@@ -760,6 +1111,7 @@ protected:
     virtual bool ProvidesTrueColor(void);
 #ifdef USE_OPENGLOSD
     static void StopOpenGlThread(void);
+    static cString OpenGlThreadStats(void);
     static const cImage *GetImageData(int ImageHandle);
     static void OsdSizeChanged(void);
 #endif
@@ -874,6 +1226,13 @@ void cSoftOsdProvider::StopOpenGlThread(void) {
     oglThread.reset();
     dsyslog("[softhddev]OpenGL Worker Thread stopped");
 }
+
+cString cSoftOsdProvider::OpenGlThreadStats(void) {
+    if (oglThread) {
+        return oglThread->Stats();
+    }
+    return "OpenGL Worker Thread not running";
+}
 #endif
 
 /**
@@ -885,6 +1244,7 @@ cSoftOsdProvider::cSoftOsdProvider(void)
 #ifdef OSD_DEBUG
     Debug(3, "[softhddev]%s:\n", __FUNCTION__);
 #endif
+    FlushPacer = new cOsdFlushPacer;
 #ifdef USE_OPENGLOSD
     StopOpenGlThread();
     VideoSetVideoEventCallback(&OsdSizeChanged);
@@ -902,6 +1262,7 @@ cSoftOsdProvider::~cSoftOsdProvider()
 #ifdef USE_OPENGLOSD
     StopOpenGlThread();
 #endif
+    delete FlushPacer;
 }
 
 
@@ -936,6 +1297,8 @@ class cMenuSetupSoft:public cMenuSetupPage
     int StudioLevels;
     int _60HzMode;
     int SoftStartSync;
+    int FastStart;
+    int Presenter;
     int BlackPicture;
     int ClearOnSwitch;
 
@@ -961,6 +1324,11 @@ class cMenuSetupSoft:public cMenuSetupPage
     int AutoCropDelay;
     int AutoCropTolerance;
 
+    int GrabRate;
+    int GrabWidth;
+    int PreviewRate;
+    int PreviewWidth;
+
     int Audio;
     int AudioDelay;
     int AudioDrift;
@@ -978,6 +1346,7 @@ class cMenuSetupSoft:public cMenuSetupPage
     int AudioStereoDescent;
     int AudioBufferTime;
     int AudioAutoAES;
+    int LowLatency;
 
 #ifdef USE_PIP
     int Pip;
@@ -997,6 +1366,8 @@ class cMenuSetupSoft:public cMenuSetupPage
     int PipAltVideoY;
     int PipAltVideoWidth;
     int PipAltVideoHeight;
+    int PipDecode[RESOLUTIONS];
+    int PipLowRateWidth;
 #endif
 
 #ifdef USE_SCREENSAVER
@@ -1073,6 +1444,12 @@ void cMenuSetupSoft::Create(void)
     static const char *const resolution[RESOLUTIONS] = {
 	"576i", "720p", "fake 1080i", "1080i", "UHD"
     };
+#ifdef USE_PIP
+    static const char *const pip_decode[] = {
+	tr("full"), tr("no loop filter"), tr("no B-frames"),
+	tr("reference only")
+    };
+#endif
     int current;
     int i;
     const char* *scaling;
@@ -1162,6 +1539,10 @@ void cMenuSetupSoft::Create(void)
 		trVDR("no"), trVDR("yes")));
 	Add(new cMenuEditBoolItem(tr("Soft start a/v sync"), &SoftStartSync,
 		trVDR("no"), trVDR("yes")));
+	Add(new cMenuEditBoolItem(tr("Fast start of new streams"),
+		&FastStart, trVDR("no"), trVDR("yes")));
+	Add(new cMenuEditBoolItem(tr("Pts scheduled presenter"), &Presenter,
+		trVDR("no"), trVDR("yes")));
 	Add(new cMenuEditBoolItem(tr("Black during channel switch"),
 		&BlackPicture, trVDR("no"), trVDR("yes")));
 	Add(new cMenuEditBoolItem(tr("Clear decoder on channel switch"),
@@ -1240,6 +1621,18 @@ void cMenuSetupSoft::Create(void)
 		&AutoCropDelay, 0, 200));
 	Add(new cMenuEditIntItem(tr("Autocrop tolerance (pixel)"),
 		&AutoCropTolerance, 0, 32));
+	//
+	//  grab
+	//
+	Add(SeparatorItem(tr("Grab")));
+	Add(new cMenuEditIntItem(tr("Grab rate (Hz)"), &GrabRate, 0, 50,
+		tr("off")));
+	Add(new cMenuEditIntItem(tr("Grab width (pixel)"), &GrabWidth, 256,
+		1920));
+	Add(new cMenuEditIntItem(tr("Preview stream rate (fps)"),
+		&PreviewRate, 1, 25));
+	Add(new cMenuEditIntItem(tr("Preview stream width (pixel)"),
+		&PreviewWidth, 64, 1920));
     }
     //
     //	audio
@@ -1282,6 +1675,8 @@ void cMenuSetupSoft::Create(void)
 		&AudioBufferTime, 0, 1000));
 	Add(new cMenuEditBoolItem(tr("Enable automatic AES"), &AudioAutoAES,
 		trVDR("no"), trVDR("yes")));
+	Add(new cMenuEditBoolItem(tr("Latency profile"), &LowLatency,
+		tr("default"), tr("low latency")));
     }
 #ifdef USE_PIP
     //
@@ -1316,6 +1711,12 @@ void cMenuSetupSoft::Create(void)
 		&PipAltVideoWidth, 0, 100));
 	Add(new cMenuEditIntItem(tr("Alternative Video Height (%)"),
 		&PipAltVideoHeight, 0, 100));
+	for (i = 0; i < RESOLUTIONS; ++i) {
+	    Add(new cMenuEditStraItem(*cString::sprintf(tr("%s decoding"),
+			resolution[i]), &PipDecode[i], 4, pip_decode));
+	}
+	Add(new cMenuEditIntItem(tr("Half frame rate below width (%)"),
+		&PipLowRateWidth, 0, 100, tr("off")));
     }
 #endif
 
@@ -1457,6 +1858,8 @@ cMenuSetupSoft::cMenuSetupSoft(void)
     StudioLevels = ConfigVideoStudioLevels;
     _60HzMode = ConfigVideo60HzMode;
     SoftStartSync = ConfigVideoSoftStartSync;
+    FastStart = ConfigVideoFastStart;
+    Presenter = ConfigVideoPresenter;
     BlackPicture = ConfigVideoBlackPicture;
     ClearOnSwitch = ConfigVideoClearOnSwitch;
 
@@ -1489,6 +1892,14 @@ cMenuSetupSoft::cMenuSetupSoft(void)
     AutoCropDelay = ConfigAutoCropDelay;
     AutoCropTolerance = ConfigAutoCropTolerance;
 
+    //
+    //	grab
+    //
+    GrabRate = ConfigGrabRate;
+    GrabWidth = ConfigGrabWidth;
+    PreviewRate = ConfigPreviewRate;
+    PreviewWidth = ConfigPreviewWidth;
+
     //
     //	audio
     //
@@ -1509,6 +1920,7 @@ cMenuSetupSoft::cMenuSetupSoft(void)
     AudioStereoDescent = ConfigAudioStereoDescent;
     AudioBufferTime = ConfigAudioBufferTime;
     AudioAutoAES = ConfigAudioAutoAES;
+    LowLatency = ConfigLowLatency;
 
 #ifdef USE_PIP
     //
@@ -1531,6 +1943,10 @@ cMenuSetupSoft::cMenuSetupSoft(void)
     PipAltVideoY = ConfigPipAltVideoY;
     PipAltVideoWidth = ConfigPipAltVideoWidth;
     PipAltVideoHeight = ConfigPipAltVideoHeight;
+    for (i = 0; i < RESOLUTIONS; ++i) {
+	PipDecode[i] = ConfigPipDecode[i];
+    }
+    PipLowRateWidth = ConfigPipLowRateWidth;
 #endif
 
 #ifdef USE_SCREENSAVER
@@ -1616,6 +2032,10 @@ void cMenuSetupSoft::Store(void)
     VideoSet60HzMode(ConfigVideo60HzMode);
     SetupStore("SoftStartSync", ConfigVideoSoftStartSync = SoftStartSync);
     VideoSetSoftStartSync(ConfigVideoSoftStartSync);
+    SetupStore("FastStart", ConfigVideoFastStart = FastStart);
+    VideoSetFastStart(ConfigVideoFastStart);
+    SetupStore("Presenter", ConfigVideoPresenter = Presenter);
+    VideoSetPresenter(ConfigVideoPresenter);
     SetupStore("BlackPicture", ConfigVideoBlackPicture = BlackPicture);
     VideoSetBlackPicture(ConfigVideoBlackPicture);
     SetupStore("ClearOnSwitch", ConfigVideoClearOnSwitch = ClearOnSwitch);
@@ -1679,6 +2099,13 @@ void cMenuSetupSoft::Store(void)
 	ConfigAutoCropTolerance);
     ConfigAutoCropEnabled = ConfigAutoCropInterval != 0;
 
+    SetupStore("Grab.Rate", ConfigGrabRate = GrabRate);
+    SetupStore("Grab.Width", ConfigGrabWidth = GrabWidth);
+    VideoSetGrabRate(ConfigGrabRate, ConfigGrabWidth);
+    SetupStore("Preview.Rate", ConfigPreviewRate = PreviewRate);
+    SetupStore("Preview.Width", ConfigPreviewWidth = PreviewWidth);
+    PreviewSetRate(ConfigPreviewRate, ConfigPreviewWidth);
+
     SetupStore("AudioDelay", ConfigVideoAudioDelay = AudioDelay);
     VideoSetAudioDelay(ConfigVideoAudioDelay);
     SetupStore("AudioDrift", ConfigAudioDrift = AudioDrift);
@@ -1719,6 +2146,11 @@ void cMenuSetupSoft::Store(void)
     SetupStore("AudioBufferTime", ConfigAudioBufferTime = AudioBufferTime);
     SetupStore("AudioAutoAES", ConfigAudioAutoAES = AudioAutoAES);
     AudioSetAutoAES(ConfigAudioAutoAES);
+    if (ConfigLowLatency != LowLatency) {	// keep adapted buffers
+	AudioSetLowLatency(LowLatency);
+	VideoSetLowLatency(LowLatency);
+    }
+    SetupStore("LowLatency", ConfigLowLatency = LowLatency);
 
 #ifdef USE_PIP
     SetupStore("pip.X", ConfigPipX = PipX);
@@ -1739,6 +2171,15 @@ void cMenuSetupSoft::Store(void)
 	PipAltVideoWidth);
     SetupStore("pip.Alt.VideoHeight", ConfigPipAltVideoHeight =
 	PipAltVideoHeight);
+    for (i = 0; i < RESOLUTIONS; ++i) {
+	char buf[128];
+
+	snprintf(buf, sizeof(buf), "pip.%s.Decode", Resolution[i]);
+	SetupStore(buf, ConfigPipDecode[i] = PipDecode[i]);
+    }
+    CodecSetVideoReducedModes(ConfigPipDecode);
+    SetupStore("pip.LowRateWidth", ConfigPipLowRateWidth = PipLowRateWidth);
+    PipSetLowRate(ConfigPipLowRateWidth);
 #endif
 
 #ifdef USE_SCREENSAVER
@@ -1851,6 +2292,7 @@ cSoftHdControl::~cSoftHdControl()
 #ifdef USE_PIP
 
 extern "C" void DelPip(void);		///< remove PIP
+extern "C" void DelMosaic(void);	///< remove mosaic
 static int PipAltPosition;		///< flag alternative position
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1860,10 +2302,16 @@ static int PipAltPosition;		///< flag alternative position
 #include <vdr/receiver.h>
 
 /**
-**	Receiver class for PIP mode.
+**	Receiver class for PIP and mosaic mode.
 */
 class cSoftReceiver:public cReceiver
 {
+  private:
+    int Tile;				///< mosaic tile, -1 for PIP
+    uint8_t *PesBuf;			///< pes packet buffer
+    int PesSize;			///< size of pes packet buffer
+    int PesIndex;			///< used bytes of pes packet buffer
+    void PesParse(const uint8_t *, int, int);
   protected:
     virtual void Activate(bool);
 #if APIVERSNUM >= 20301
@@ -1872,7 +2320,7 @@ class cSoftReceiver:public cReceiver
     virtual void Receive(uchar *, int);
 #endif
   public:
-     cSoftReceiver(const cChannel *);	///< receiver constructor
+     cSoftReceiver(const cChannel *, int = -1);	///< receiver constructor
      virtual ~ cSoftReceiver();		///< receiver destructor
 };
 
@@ -1880,10 +2328,16 @@ class cSoftReceiver:public cReceiver
 **	Receiver constructor.
 **
 **	@param channel	channel to receive
+**	@param tile	mosaic tile to feed, -1 feeds PIP
 */
-cSoftReceiver::cSoftReceiver(const cChannel * channel):cReceiver(NULL,
+cSoftReceiver::cSoftReceiver(const cChannel * channel, int tile):cReceiver(NULL,
     MINPRIORITY)
 {
+    Tile = tile;
+    PesBuf = NULL;
+    // tiles have a small video, the buffer grows for larger packets
+    PesSize = tile < 0 ? 500 * 1024 * 1024 : 1024 * 1024;
+    PesIndex = 0;
     // cReceiver::channelID not setup, this can cause trouble
     // we want video only
     AddPid(channel->Vpid());
@@ -1895,6 +2349,7 @@ cSoftReceiver::cSoftReceiver(const cChannel * channel):cReceiver(NULL,
 cSoftReceiver::~cSoftReceiver()
 {
     Detach();
+    free(PesBuf);
 }
 
 /**
@@ -1904,6 +2359,9 @@ cSoftReceiver::~cSoftReceiver()
 */
 void cSoftReceiver::Activate(bool on)
 {
+    if (Tile >= 0) {			// mosaic tiles are started by NewMosaic
+	return;
+    }
     if (on) {
 	int width;
 	int height;
@@ -1944,60 +2402,50 @@ void cSoftReceiver::Activate(bool on)
 ///	@param size	number of payload data bytes
 ///	@param is_start flag, start of pes packet
 ///
-static void PipPesParse(const uint8_t * data, int size, int is_start)
+void cSoftReceiver::PesParse(const uint8_t * data, int size, int is_start)
 {
-    static uint8_t *pes_buf;
-    static int pes_size;
-    static int pes_index;
-
-    if (!data) {
-	if (pes_buf) {
-	    free(pes_buf);
-	    pes_buf = NULL;
-	}
-	return;
-    }
     // FIXME: quick&dirty
 
-    if (!pes_buf) {
-	pes_size = 500 * 1024 * 1024;
-	pes_buf = (uint8_t *) malloc(pes_size);
-	if (!pes_buf) {			// out of memory, should never happen
+    if (!PesBuf) {
+	PesBuf = (uint8_t *) malloc(PesSize);
+	if (!PesBuf) {			// out of memory, should never happen
 	    return;
 	}
-	pes_index = 0;
+	PesIndex = 0;
     }
     if (is_start) {			// start of pes packet
-	if (pes_index) {
+	if (PesIndex) {
 	    if (0) {
-		fprintf(stderr, "pip: PES packet %8d %02x%02x\n", pes_index,
-		    pes_buf[2], pes_buf[3]);
+		fprintf(stderr, "pip: PES packet %8d %02x%02x\n", PesIndex,
+		    PesBuf[2], PesBuf[3]);
 	    }
-	    if (pes_buf[0] || pes_buf[1] || pes_buf[2] != 0x01) {
+	    if (PesBuf[0] || PesBuf[1] || PesBuf[2] != 0x01) {
 		// FIXME: first should always fail
 		Error(tr("[softhddev]pip: invalid PES packet %d\n"),
-		    pes_index);
-	    } else {
-		PipPlayVideo(pes_buf, pes_index);
+		    PesIndex);
+	    } else if (Tile < 0) {
+		PipPlayVideo(PesBuf, PesIndex);
 		// FIXME: buffer full: pes packet is dropped
+	    } else {
+		MosaicPlayVideo(Tile, PesBuf, PesIndex);
 	    }
-	    pes_index = 0;
+	    PesIndex = 0;
 	}
     }
 
-    if (pes_index + size > pes_size) {
+    if (PesIndex + size > PesSize) {
 	Error(tr("[softhddev]pip: pes buffer too small\n"));
-	pes_size *= 2;
-	if (pes_index + size > pes_size) {
-	    pes_size = (pes_index + size) * 2;
+	PesSize *= 2;
+	if (PesIndex + size > PesSize) {
+	    PesSize = (PesIndex + size) * 2;
 	}
-	void *res = (uint8_t *) realloc(pes_buf, pes_size);
+	void *res = (uint8_t *) realloc(PesBuf, PesSize);
 	if (!res) {			// out of memory, should never happen
 	    return;
-	} else pes_buf = (uint8_t *)res;
+	} else PesBuf = (uint8_t *)res;
     }
-    memcpy(pes_buf + pes_index, data, size);
-    pes_index += size;
+    memcpy(PesBuf + PesIndex, data, size);
+    PesIndex += size;
 }
 
     /// Transport stream packet size
@@ -2059,7 +2507,7 @@ void cSoftReceiver::Receive(uchar * data, int size)
 		break;
 	}
 
-	PipPesParse(p + payload, TS_PACKET_SIZE - payload, p[1] & 0x40);
+	PesParse(p + payload, TS_PACKET_SIZE - payload, p[1] & 0x40);
 
       next_packet:
 	p += TS_PACKET_SIZE;
@@ -2080,7 +2528,6 @@ extern "C" void DelPip(void)
 {
     delete PipReceiver;
 
-    PipPesParse(NULL, 0, 0);
     PipReceiver = NULL;
     PipChannel = NULL;
 }
@@ -2112,6 +2559,7 @@ static void NewPip(int channel_nr)
 	&& (device = cDevice::GetDevice(channel, 0, false, false))) {
 
 	DelPip();
+	DelMosaic();			// pip and mosaic share the decoders
 
 	device->SwitchChannel(channel, false);
 	receiver = new cSoftReceiver(channel);
@@ -2235,6 +2683,89 @@ static void SwapPipPosition(void)
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+//	Mosaic
+//////////////////////////////////////////////////////////////////////////////
+
+static cSoftReceiver *MosaicReceivers[MOSAIC_TILES_MAX];	///< tile receivers
+static int MosaicReceiverN;		///< number of tile receivers
+
+/**
+**	Stop mosaic.
+*/
+extern "C" void DelMosaic(void)
+{
+    int i;
+
+    for (i = 0; i < MosaicReceiverN; ++i) {
+	delete MosaicReceivers[i];
+
+	MosaicReceivers[i] = NULL;
+    }
+    if (MosaicReceiverN) {
+	MosaicReceiverN = 0;
+	MosaicStop();
+    }
+}
+
+/**
+**	Prepare new mosaic.
+**
+**	Each tile gets its own receiver on a device, which can receive the
+**	channel without detaching other receivers.  Channels without free
+**	device are skipped, as are the tiles the video backend has no
+**	decoder for.
+**
+**	@param channel_nrs	channel numbers of the tiles
+**	@param n		number of tiles
+**
+**	@returns number of running tiles.
+*/
+static int NewMosaic(const int *channel_nrs, int n)
+{
+    int tiles;
+    int i;
+
+    DelPip();
+    DelMosaic();
+
+    tiles = 0;
+    {
+	LOCK_CHANNELS_READ;
+	for (i = 0; i < n; ++i) {
+	    const cChannel *channel;
+	    cDevice *device;
+	    bool ndr;
+
+	    if ((channel = Channels MURKS GetByNumber(channel_nrs[i]))
+		&& (device = cDevice::GetDevice(channel, 0, false, true))
+		&& device->ProvidesChannel(channel, 0, &ndr) && !ndr) {
+		cSoftReceiver *receiver;
+
+		device->SwitchChannel(channel, false);
+		receiver = new cSoftReceiver(channel, tiles);
+		device->AttachReceiver(receiver);
+		MosaicReceivers[tiles++] = receiver;
+	    } else {
+		Warning(tr
+		    ("[softhddev]mosaic: no free device for channel %d\n"),
+		    channel_nrs[i]);
+	    }
+	}
+    }
+
+    // tiles are fed after start, the packets before are dropped
+    n = tiles ? MosaicStart(tiles) : 0;
+    for (i = n; i < tiles; ++i) {	// out of decoders
+	delete MosaicReceivers[i];
+
+	MosaicReceivers[i] = NULL;
+    }
+    MosaicReceiverN = n;
+
+    return n;
+}
+
 #endif
 
 //////////////////////////////////////////////////////////////////////////////
@@ -2316,6 +2847,62 @@ void cSoftHdMenu::Create(void)
 	cOsdItem(cString::sprintf(tr
 		(" Frames missed(%d) duped(%d) dropped(%d) total(%d)"), missed,
 		duped, dropped, counter), osUnknown, false));
+    {
+	int flushes;
+	int bytes;
+	int average;
+
+	VideoGetOsdStats(&flushes, &bytes, &average);
+	Add(new
+	    cOsdItem(cString::sprintf(tr
+		    (" OSD uploads(%d) last(%dKiB) average(%dKiB)"), flushes,
+		    bytes / 1024, average / 1024), osUnknown, false));
+    }
+    {
+	int requested;
+	int presented;
+
+	OsdGetFlushRates(&requested, &presented);
+	Add(new
+	    cOsdItem(cString::sprintf(tr
+		    (" OSD flushes requested(%d/s) presented(%d/s)"),
+		    requested, presented), osUnknown, false));
+    }
+    if (ConfigVideoPresenter) {
+	const char *cadence;
+	int period;
+	int judder;
+	int resyncs;
+
+	if (GetPresenterStats(&cadence, &period, &judder, &resyncs)) {
+	    Add(new
+		cOsdItem(cString::sprintf(tr
+			(" Presenter cadence(%s) vsync(%d.%03dms) judder(%d) resyncs(%d)"),
+			cadence, period / 1000, period % 1000, judder, resyncs),
+		    osUnknown, false));
+	}
+    }
+    if (ConfigLowLatency) {
+	int buffer_time;
+	int delay;
+	int underruns;
+
+	AudioGetLatency(&buffer_time, &delay, &underruns);
+	Add(new
+	    cOsdItem(cString::sprintf(tr
+		    (" Latency buffer(%dms) delay(~%dms) underruns(%d)"),
+		    buffer_time, delay, underruns), osUnknown, false));
+    }
+    if (ConfigGrabRate) {
+	int grabbed;
+	int served;
+
+	VideoGetGrabStats(&grabbed, &dropped, &served);
+	Add(new
+	    cOsdItem(cString::sprintf(tr
+		    (" Grabs total(%d) dropped(%d) served(%d)"), grabbed,
+		    dropped, served), osUnknown, false));
+    }
 
     SetCurrent(Get(current));		// restore selected menu entry
     Display();				// display build menu
@@ -2820,14 +3407,14 @@ void cSoftHdDevice::TrickSpeed(int speed, bool forward)
 {
     Debug(3, "[softhddev]%s: %d %d\n", __FUNCTION__, speed, forward);
 
-    ::TrickSpeed(speed);
+    ::TrickSpeed(speed, forward);
 }
 #else
 void cSoftHdDevice::TrickSpeed(int speed)
 {
     Debug(3, "[softhddev]%s: %d\n", __FUNCTION__, speed);
 
-    ::TrickSpeed(speed);
+    ::TrickSpeed(speed, 1);
 }
 #endif
 
@@ -3472,6 +4059,14 @@ bool cPluginSoftHdDevice::SetupParse(const char *name, const char *value)
 	VideoSetSoftStartSync(ConfigVideoSoftStartSync = atoi(value));
 	return true;
     }
+    if (!strcasecmp(name, "FastStart")) {
+	VideoSetFastStart(ConfigVideoFastStart = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "Presenter")) {
+	VideoSetPresenter(ConfigVideoPresenter = atoi(value));
+	return true;
+    }
     if (!strcasecmp(name, "BlackPicture")) {
 	VideoSetBlackPicture(ConfigVideoBlackPicture = atoi(value));
 	return true;
@@ -3584,6 +4179,23 @@ bool cPluginSoftHdDevice::SetupParse(const char *name, const char *value)
 	return true;
     }
 
+    if (!strcasecmp(name, "Grab.Rate")) {
+	VideoSetGrabRate(ConfigGrabRate = atoi(value), ConfigGrabWidth);
+	return true;
+    }
+    if (!strcasecmp(name, "Grab.Width")) {
+	VideoSetGrabRate(ConfigGrabRate, ConfigGrabWidth = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "Preview.Rate")) {
+	PreviewSetRate(ConfigPreviewRate = atoi(value), ConfigPreviewWidth);
+	return true;
+    }
+    if (!strcasecmp(name, "Preview.Width")) {
+	PreviewSetRate(ConfigPreviewRate, ConfigPreviewWidth = atoi(value));
+	return true;
+    }
+
     if (!strcasecmp(name, "AudioDelay")) {
 	VideoSetAudioDelay(ConfigVideoAudioDelay = atoi(value));
 	return true;
@@ -3648,6 +4260,12 @@ bool cPluginSoftHdDevice::SetupParse(const char *name, const char *value)
 	AudioSetAutoAES(ConfigAudioAutoAES);
 	return true;
     }
+    if (!strcasecmp(name, "LowLatency")) {
+	ConfigLowLatency = atoi(value);
+	AudioSetLowLatency(ConfigLowLatency);
+	VideoSetLowLatency(ConfigLowLatency);
+	return true;
+    }
 #ifdef USE_PIP
     if (!strcasecmp(name, "pip.X")) {
 	ConfigPipX = atoi(value);
@@ -3713,6 +4331,20 @@ bool cPluginSoftHdDevice::SetupParse(const char *name, const char *value)
 	ConfigPipAltVideoHeight = atoi(value);
 	return true;
     }
+    for (i = 0; i < RESOLUTIONS; ++i) {
+	char buf[128];
+
+	snprintf(buf, sizeof(buf), "pip.%s.Decode", Resolution[i]);
+	if (!strcasecmp(name, buf)) {
+	    ConfigPipDecode[i] = atoi(value);
+	    CodecSetVideoReducedModes(ConfigPipDecode);
+	    return true;
+	}
+    }
+    if (!strcasecmp(name, "pip.LowRateWidth")) {
+	PipSetLowRate(ConfigPipLowRateWidth = atoi(value));
+	return true;
+    }
 #endif
 
 #ifdef USE_SCREENSAVER
@@ -3785,6 +4417,23 @@ bool cPluginSoftHdDevice::Service(const char *id, void *data)
 	return true;
     }
 
+    if (strcmp(id, ZAP_TIMES_SERVICE) == 0) {
+	SoftHDDevice_ZapTimesService_v1_0_t *r;
+	int times[VIDEO_ZAP_MAX];
+	int i;
+
+	if (!data) {
+	    return true;
+	}
+
+	r = (SoftHDDevice_ZapTimesService_v1_0_t *) data;
+	r->Zaps = VideoGetZapTimes(times);
+	for (i = 0; i < ZAP_TIME_MAX; ++i) {
+	    r->Times[i] = i < VIDEO_ZAP_MAX ? times[i] : -1;
+	}
+	return true;
+    }
+
     if (strcmp(id, ATMO1_GRAB_SERVICE) == 0) {
 	SoftHDDevice_AtmoGrabService_v1_1_t *r;
 
@@ -3873,6 +4522,35 @@ static const char *SVDRPHelpText[] = {
     "RAIS\n" "\040   Raise softhddevice window\n\n"
 	"    If Xserver is not started by softhddevice, the window which\n"
 	"    contains the softhddevice frontend will be raised to the front.\n",
+#ifdef USE_PIP
+    "MOSA channel...\n" "    Start mosaic of up to 9 channels.\n\n"
+	"    Each channel is shown in an own tile of a grid over the screen.\n"
+	"    The first tile has the focus.  All tiles except the focused\n"
+	"    are decoded with reduced cost and half frame rate.\n",
+    "MOSF tile\n" "    Set focus to mosaic tile (0 = first tile).\n",
+    "MOSS\n" "\040   Stop mosaic.\n",
+#endif
+    "ZAPT\n" "\040   Display zap times of the last channel switch.\n\n"
+	"    Times in ms after the switch, when the first TS packet, the\n"
+	"    first PES packet, the opened codec, the first decoded frame,\n"
+	"    the first displayed frame, the first played audio sample and\n"
+	"    the audio/video lock were reached.  '-' not reached yet.\n"
+	"    Count and average time of codec reopens and reuses.\n",
+    "TRCE [ON|OFF|DUMP [file]]\n" "    Record and export event trace.\n\n"
+	"    ON starts and OFF stops recording timestamped events of the\n"
+	"    video, audio and osd threads into a ring for each thread.\n"
+	"    DUMP (default) replies the recorded events as chrome trace json\n"
+	"    or writes them into file, view them with chrome://tracing or\n"
+	"    https://ui.perfetto.dev.\n",
+    "METR\n" "\040   Display metrics in prometheus text format.\n\n"
+	"    Counters, gauges and histograms of demuxer, codec, video sync,\n"
+	"    audio and osd.  With -S the preview socket answers\n"
+	"    'GET /metrics' with the same text.\n",
+#ifdef USE_OPENGLOSD
+    "OGLQ\n" "\040   Display OpenGL OSD command queue statistics.\n\n"
+	"    Histograms of the queue depth seen by new commands and of the\n"
+	"    execution time of commands in us, '<n:count' per bucket.\n",
+#endif
     NULL
 };
 
@@ -4060,6 +4738,132 @@ cString cPluginSoftHdDevice::SVDRPCommand(const char *command,
 	VideoSetOsd3DMode(2);
 	return "3d tb";
     }
+#ifdef USE_PIP
+    if (!strcasecmp(command, "MOSA")) {
+	int channel_nrs[MOSAIC_TILES_MAX];
+	const char *s;
+	char *e;
+	int n;
+
+	n = 0;
+	s = option;
+	while (n < MOSAIC_TILES_MAX) {
+	    channel_nrs[n] = strtol(s, &e, 0);
+	    if (e == s) {
+		break;
+	    }
+	    ++n;
+	    s = e;
+	}
+	if (!n) {
+	    reply_code = 501;
+	    return "missing channel numbers";
+	}
+	n = NewMosaic(channel_nrs, n);
+	return cString::sprintf("mosaic with %d tiles started", n);
+    }
+    if (!strcasecmp(command, "MOSF")) {
+	char *e;
+	int tile;
+
+	tile = strtol(option, &e, 0);
+	if (e == option || *skipspace(e) || MosaicSetFocus(tile)) {
+	    reply_code = 501;
+	    return "invalid mosaic tile";
+	}
+	return "mosaic focus set";
+    }
+    if (!strcasecmp(command, "MOSS")) {
+	DelMosaic();
+	return "mosaic stopped";
+    }
+#endif
+
+    if (!strcasecmp(command, "ZAPT")) {
+	static const char *const names[VIDEO_ZAP_MAX] = {
+	    "switch", "ts", "pes", "codec", "decoded", "displayed", "audio",
+	    "synced"
+	};
+	int times[VIDEO_ZAP_MAX];
+	cString reply;
+	int zaps;
+	int reopens;
+	int reopen_us;
+	int reuses;
+	int reuse_us;
+	int i;
+
+	zaps = VideoGetZapTimes(times);
+	if (!zaps) {
+	    return "no channel switch timed yet";
+	}
+	reply = cString::sprintf("zap %d:", zaps);
+	for (i = 1; i < VIDEO_ZAP_MAX; ++i) {
+	    if (times[i] < 0) {
+		reply = cString::sprintf("%s %s -", *reply, names[i]);
+	    } else {
+		reply = cString::sprintf("%s %s %dms", *reply, names[i],
+		    times[i]);
+	    }
+	}
+	VideoGetZapCodecStats(&reopens, &reopen_us, &reuses, &reuse_us);
+	reply = cString::sprintf("%s\ncodec reopened %d avg %dus,"
+	    " reused %d avg %dus", *reply, reopens, reopen_us, reuses, reuse_us);
+	return reply;
+    }
+
+    if (!strcasecmp(command, "TRCE")) {
+	const char *file;
+	char *json;
+
+	if (!strcasecmp(option, "ON")) {
+	    TraceEnable(1);
+	    return "trace started";
+	}
+	if (!strcasecmp(option, "OFF")) {
+	    TraceEnable(0);
+	    return "trace stopped";
+	}
+	file = NULL;
+	if (!strncasecmp(option, "DUMP", 4)) {
+	    file = skipspace(option + 4);
+	    if (!*file) {
+		file = NULL;
+	    }
+	}
+	if (!(json = TraceExport())) {
+	    reply_code = 451;
+	    return "trace export failed";
+	}
+	if (file) {
+	    FILE *f;
+
+	    if (!(f = fopen(file, "w"))) {
+		free(json);
+		reply_code = 550;
+		return cString::sprintf("can't write trace to '%s'", file);
+	    }
+	    fputs(json, f);
+	    fclose(f);
+	    free(json);
+	    return cString::sprintf("trace written to '%s'", file);
+	}
+	return cString(json, true);
+    }
+    if (!strcasecmp(command, "METR")) {
+	char *text;
+
+	if (!(text = MetricsExport())) {
+	    reply_code = 451;
+	    return "metrics export failed";
+	}
+	return cString(text, true);
+    }
+#ifdef USE_OPENGLOSD
+    if (!strcasecmp(command, "OGLQ")) {
+	return cSoftOsdProvider::OpenGlThreadStats();
+    }
+#endif
 
     if (!strcasecmp(command, "RAIS")) {
 	if (!ConfigStartX11Server) {
@@ -19,3 +19,32 @@
 ///
 ///	$Id$
 //////////////////////////////////////////////////////////////////////////////
+
+#include <vdr/thread.h>
+#include <vdr/osd.h>
+
+/**
+**	OSD flush pacer.
+**
+**	Coalesces the flushes of the skins to at most one presentation
+**	per display frame.  A deferred flush is done by the pacer thread,
+**	when the frame is due.
+*/
+class cOsdFlushPacer:private cThread
+{
+  private:
+    static cOsdFlushPacer *Pacer;	///< single pacer
+    cMutex mutex;			///< protects pending osds
+    cMutex flushMutex;			///< held while flushing a pending osd
+    cCondVar wakeup;			///< new flush deferred
+    cVector < cOsd * >pending;		///< osds with deferred flush
+    uint32_t due;			///< ticks of the deferred flush
+    tThreadId threadId;			///< id of the pacer thread
+    virtual void Action(void);
+  public:
+     cOsdFlushPacer(void);		///< pacer constructor
+     virtual ~ cOsdFlushPacer(void);	///< pacer destructor
+    /// defer osd flush, if a frame was already presented
+    static bool Defer(cOsd *);
+    static void Forget(cOsd *);		///< forget deferred osd flush
+};
@@ -25,6 +25,7 @@
 #define ATMO_GRAB_SERVICE	"SoftHDDevice-AtmoGrabService-v1.0"
 #define ATMO1_GRAB_SERVICE	"SoftHDDevice-AtmoGrabService-v1.1"
 #define OSD_3DMODE_SERVICE	"SoftHDDevice-Osd3DModeService-v1.0"
+#define ZAP_TIMES_SERVICE	"SoftHDDevice-ZapTimesService-v1.0"
 
 enum
 { GRAB_IMG_RGBA_FORMAT_B8G8R8A8 };
@@ -63,3 +64,24 @@ typedef struct
 
     void *img;
 } SoftHDDevice_AtmoGrabService_v1_1_t;
+
+enum
+{
+    ZAP_TIME_SWITCH,			// play mode set, always 0
+    ZAP_TIME_TS,			// first TS packet
+    ZAP_TIME_PES,			// first PES packet
+    ZAP_TIME_CODEC,			// video codec opened
+    ZAP_TIME_DECODED,			// first decoded frame
+    ZAP_TIME_DISPLAYED,			// first displayed frame
+    ZAP_TIME_AUDIO,			// first audio sample played
+    ZAP_TIME_SYNCED,			// audio/video locked
+    ZAP_TIME_MAX
+};
+
+typedef struct
+{
+    // reply data
+
+    int Zaps;				// number of timed channel switches
+    int Times[ZAP_TIME_MAX];		// ms after switch, -1 not reached
+} SoftHDDevice_ZapTimesService_v1_0_t;
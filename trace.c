@@ -0,0 +1,524 @@
+///
+///	@file trace.c	@brief Event trace module
+///
+///	Copyright (c) 2026 by the softhddevice contributors.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	@defgroup Trace The event trace module.
+///
+///	Records timestamped binary events into a ring for each thread.
+///
+///	Only the owning thread writes its ring, it publishes each event
+///	with a release store of the write counter.  The reader copies the
+///	rings without lock and drops the events, which could have been
+///	overwritten while copying.  A disabled trace costs one flag test.
+///	The rings are never freed.  When a thread exits, its ring is given
+///	to the next new thread, which starts behind the old events.
+///
+///	The rings are exported in the chrome trace event json format, which
+///	can be viewed with chrome://tracing or https://ui.perfetto.dev.
+///
+///	Build the benchmark with 'make trace_test'.
+///
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <pthread.h>
+
+#include <libintl.h>
+#define _(str) gettext(str)		///< gettext shortcut
+#define _N(str) str			///< gettext_noop shortcut
+
+#include "misc.h"
+#include "trace.h"
+
+#define TRACE_EVENTS	8192		///< events per thread, power of 2
+#define TRACE_THREADS	32		///< maximal number of traced threads
+
+    /// recorded event
+typedef struct _trace_event_
+{
+    uint64_t Time;			///< monotonic time in ns
+    int32_t Arg;			///< event argument
+    uint16_t Id;			///< event id
+    uint16_t Phase;			///< event phase
+} TraceRecord;
+
+    /// event ring of one thread
+typedef struct _trace_ring_
+{
+    unsigned Write;			///< events written, owner only
+    unsigned Start;			///< first event of the owner
+    int Tid;				///< kernel thread id
+    char Name[16];			///< thread name
+    char Free;				///< flag owner thread exited
+    TraceRecord Events[TRACE_EVENTS];	///< event ring
+} TraceRing;
+
+volatile char TraceEnabled;		///< flag record events
+
+static pthread_mutex_t TraceMutex = PTHREAD_MUTEX_INITIALIZER;	///< ring list lock
+static pthread_once_t TraceOnce = PTHREAD_ONCE_INIT;	///< key init once
+static pthread_key_t TraceKey;		///< key to release ring at thread exit
+static TraceRing *TraceRings[TRACE_THREADS];	///< rings of all threads
+static int TraceRingN;			///< number of rings
+static __thread TraceRing *TraceThreadRing;	///< ring of this thread
+static __thread char TraceThreadFull;	///< no ring left for this thread
+
+    /// event names
+static const char *const TraceNames[TRACE_EVENT_MAX] = {
+    "packet", "decode", "surface", "vsync", "frame", "frame dup",
+    "audio enqueue", "audio write", "osd draw", "osd flush"
+};
+
+    /// event argument names, NULL no argument
+static const char *const TraceArgNames[TRACE_EVENT_MAX] = {
+    "packets", "packets", "surfaces", NULL, "surfaces", "surfaces",
+    "bytes", "bytes", "rects", NULL
+};
+
+    /// event categories
+static const char *const TraceCategories[TRACE_EVENT_MAX] = {
+    "video", "video", "video", "video", "video", "video",
+    "audio", "audio", "osd", "osd"
+};
+
+///
+///	Release ring of exiting thread for the next new thread.
+///
+///	@param ring	ring of exiting thread
+///
+static void TraceThreadExit(void *ring)
+{
+    pthread_mutex_lock(&TraceMutex);
+    ((TraceRing *) ring)->Free = 1;
+    pthread_mutex_unlock(&TraceMutex);
+}
+
+///
+///	Create key to release rings at thread exit.
+///
+static void TraceKeyInit(void)
+{
+    pthread_key_create(&TraceKey, TraceThreadExit);
+}
+
+///
+///	Get event ring for calling thread, reuse a free or allocate a new one.
+///
+///	@returns ring, NULL if out of rings.
+///
+static TraceRing *TraceRingNew(void)
+{
+    static char warned;
+    TraceRing *ring;
+    int i;
+
+    pthread_once(&TraceOnce, TraceKeyInit);
+
+    ring = NULL;
+    pthread_mutex_lock(&TraceMutex);
+    for (i = 0; i < TraceRingN; ++i) {
+	if (TraceRings[i]->Free) {
+	    ring = TraceRings[i];
+	    ring->Free = 0;
+	    // the events before belong to the exited thread
+	    ring->Start = ring->Write;
+	    ring->Name[0] = '\0';
+	    break;
+	}
+    }
+    if (!ring && TraceRingN < TRACE_THREADS
+	&& (ring = calloc(1, sizeof(*ring)))) {
+	TraceRings[TraceRingN] = ring;
+	__atomic_store_n(&TraceRingN, TraceRingN + 1, __ATOMIC_RELEASE);
+    }
+    if (ring) {
+	ring->Tid = syscall(SYS_gettid);
+#ifdef HAVE_PTHREAD_NAME
+	pthread_getname_np(pthread_self(), ring->Name, sizeof(ring->Name));
+#endif
+	if (!ring->Name[0]) {
+	    snprintf(ring->Name, sizeof(ring->Name), "thread %d", ring->Tid);
+	}
+    } else if (!warned) {
+	warned = 1;
+	Warning(_("trace: all %d rings in use, thread not traced\n"),
+	    TRACE_THREADS);
+    }
+    pthread_mutex_unlock(&TraceMutex);
+
+    if (ring) {
+	pthread_setspecific(TraceKey, ring);
+    }
+    return ring;
+}
+
+///
+///	Record event in ring of calling thread.
+///
+///	Use #TraceMark, #TraceBegin and #TraceEnd, they test the enable flag
+///	inline.
+///
+///	@param id	event id (TRACE_...)
+///	@param phase	event phase (TRACE_INSTANT, TRACE_BEGIN, TRACE_END)
+///	@param arg	event argument
+///
+void TraceEvent(int id, int phase, int arg)
+{
+    TraceRing *ring;
+    TraceRecord *event;
+    struct timespec ts;
+    unsigned write;
+
+    if (!(ring = TraceThreadRing)) {
+	if (TraceThreadFull) {
+	    return;
+	}
+	if (!(ring = TraceThreadRing = TraceRingNew())) {
+	    TraceThreadFull = 1;
+	    return;
+	}
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    write = ring->Write;
+    event = &ring->Events[write & (TRACE_EVENTS - 1)];
+    event->Time = ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+    event->Arg = arg;
+    event->Id = id;
+    event->Phase = phase;
+    __atomic_store_n(&ring->Write, write + 1, __ATOMIC_RELEASE);
+}
+
+///
+///	Start or stop recording events.
+///
+///	Recorded events are kept, until they are overwritten.
+///
+///	@param on	flag record events
+///
+void TraceEnable(int on)
+{
+    TraceEnabled = on != 0;
+}
+
+    /// growing string buffer of the json export
+typedef struct _trace_buffer_
+{
+    char *Data;				///< string, NULL out of memory
+    size_t Used;			///< used bytes without terminator
+    size_t Size;			///< allocated bytes
+} TraceBuffer;
+
+///
+///	Append formatted text to export buffer.
+///
+///	@param buffer	export buffer
+///	@param fmt	printf format
+///
+static void TracePrintf(TraceBuffer * buffer, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    if (!buffer->Data) {
+	return;
+    }
+    for (;;) {
+	va_start(ap, fmt);
+	n = vsnprintf(buffer->Data + buffer->Used, buffer->Size - buffer->Used,
+	    fmt, ap);
+	va_end(ap);
+	if (n < 0) {
+	    return;
+	}
+	if (buffer->Used + n < buffer->Size) {
+	    buffer->Used += n;
+	    return;
+	}
+	buffer->Size = (buffer->Used + n + 1) * 2;
+	if (!(buffer->Data = realloc(buffer->Data, buffer->Size))) {
+	    return;
+	}
+    }
+}
+
+///
+///	Export ring of one thread.
+///
+///	@param buffer	export buffer
+///	@param ring	event ring
+///	@param events	copy buffer of #TRACE_EVENTS events
+///
+static void TraceExportRing(TraceBuffer * buffer, const TraceRing * ring,
+    TraceRecord * events)
+{
+    unsigned write;
+    unsigned first;
+    unsigned start;
+    unsigned i;
+    char name[sizeof(ring->Name)];
+    int tid;
+    int pid;
+
+    // a new thread can take the ring of an exited thread
+    pthread_mutex_lock(&TraceMutex);
+    start = ring->Start;
+    tid = ring->Tid;
+    memcpy(name, ring->Name, sizeof(name));
+    pthread_mutex_unlock(&TraceMutex);
+    name[sizeof(name) - 1] = '\0';
+
+    pid = getpid();
+    TracePrintf(buffer,
+	",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+	"\"args\":{\"name\":\"%s\"}}", pid, tid, name);
+
+    write = __atomic_load_n(&ring->Write, __ATOMIC_ACQUIRE);
+    first = write - start > TRACE_EVENTS ? write - TRACE_EVENTS : start;
+    for (i = first; i != write; ++i) {
+	events[i & (TRACE_EVENTS - 1)] = ring->Events[i & (TRACE_EVENTS - 1)];
+    }
+    // drop events, which the owner overwrote while copying
+    i = __atomic_load_n(&ring->Write, __ATOMIC_ACQUIRE);
+    if (i - first >= TRACE_EVENTS) {
+	first = i - TRACE_EVENTS + 1;
+    }
+
+    for (i = first; (int)(write - i) > 0; ++i) {
+	const TraceRecord *event;
+	const char *arg;
+
+	event = &events[i & (TRACE_EVENTS - 1)];
+	if (event->Id >= TRACE_EVENT_MAX) {
+	    continue;
+	}
+	TracePrintf(buffer,
+	    ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%"
+	    PRIu64 ".%03u,\"pid\":%d,\"tid\":%d", TraceNames[event->Id],
+	    TraceCategories[event->Id],
+	    event->Phase == TRACE_BEGIN ? 'B' : event->Phase ==
+	    TRACE_END ? 'E' : 'i', event->Time / 1000,
+	    (unsigned)(event->Time % 1000), pid, tid);
+	if (event->Phase == TRACE_INSTANT) {
+	    TracePrintf(buffer, ",\"s\":\"t\"");
+	}
+	if ((arg = TraceArgNames[event->Id])) {
+	    TracePrintf(buffer, ",\"args\":{\"%s\":%d}", arg, event->Arg);
+	}
+	TracePrintf(buffer, "}");
+    }
+}
+
+///
+///	Export recorded events as chrome trace json.
+///
+///	Can be called from any thread, while the events are recorded.
+///
+///	@returns malloced json string, must be freed by the caller, NULL
+///	if out of memory.
+///
+char *TraceExport(void)
+{
+    TraceBuffer buffer;
+    TraceRecord *events;
+    int n;
+    int i;
+
+    if (!(events = malloc(TRACE_EVENTS * sizeof(*events)))) {
+	return NULL;
+    }
+    buffer.Used = 0;
+    buffer.Size = 64 * 1024;
+    if ((buffer.Data = malloc(buffer.Size))) {
+	buffer.Data[0] = '\0';
+    }
+
+    TracePrintf(&buffer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+	"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+	"\"args\":{\"name\":\"softhddevice\"}}", getpid());
+    n = __atomic_load_n(&TraceRingN, __ATOMIC_ACQUIRE);
+    for (i = 0; i < n; ++i) {
+	TraceExportRing(&buffer, TraceRings[i], events);
+    }
+    TracePrintf(&buffer, "\n]}\n");
+
+    free(events);
+    return buffer.Data;
+}
+
+#ifdef TRACE_TEST
+
+//----------------------------------------------------------------------------
+//	Benchmark
+//----------------------------------------------------------------------------
+
+#include <getopt.h>
+
+int LogLevel;				///< our local log level
+
+static int BenchEvents;			///< events per writer thread
+
+///
+///	Monotonic time in ns.
+///
+static int64_t BenchTime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+}
+
+///
+///	Writer thread, records decode spans like the video thread.
+///
+static void *BenchWriter(void *arg)
+{
+    int i;
+
+    for (i = 0; i < BenchEvents; ++i) {
+	TraceBegin(TRACE_DECODE, i);
+	TraceEnd(TRACE_DECODE, i);
+	TraceMark(TRACE_FRAME, i);
+    }
+    return arg;
+}
+
+///
+///	Count json events of export.
+///
+static int BenchCount(const char *json)
+{
+    int n;
+
+    for (n = 0; (json = strstr(json, "\"ph\":")); ++json) {
+	++n;
+    }
+    return n;
+}
+
+///
+///	Print usage.
+///
+static void PrintUsage(void)
+{
+    printf("Usage: trace_test [-?h] [-n events] [-t threads]\n"
+	"\t-n events\tevents per thread (default 1000000)\n"
+	"\t-t threads\twriter threads (default 4)\n");
+}
+
+///
+///	Main entry point.
+///
+int main(int argc, char *const argv[])
+{
+    pthread_t threads[TRACE_THREADS];
+    int64_t start;
+    int64_t t;
+    char *json;
+    int thread_n;
+    int exports;
+    int failed;
+    int n;
+    int i;
+
+    BenchEvents = 1000000;
+    thread_n = 4;
+    for (;;) {
+	switch (getopt(argc, argv, "hn:t:")) {
+	    case 'n':
+		BenchEvents = strtol(optarg, NULL, 0);
+		continue;
+	    case 't':
+		thread_n = strtol(optarg, NULL, 0);
+		continue;
+	    case EOF:
+		break;
+	    case 'h':
+	    default:
+		PrintUsage();
+		return 0;
+	}
+	break;
+    }
+    if (thread_n < 1 || thread_n > TRACE_THREADS - 1) {
+	thread_n = 4;
+    }
+    failed = 0;
+
+    // disabled: only the flag test
+    start = BenchTime();
+    BenchWriter(NULL);
+    t = BenchTime() - start;
+    printf("%-10s %8.2f ns/event\n", "disabled", t / (BenchEvents * 3.0));
+
+    TraceEnable(1);
+    start = BenchTime();
+    BenchWriter(NULL);
+    t = BenchTime() - start;
+    printf("%-10s %8.2f ns/event\n", "enabled", t / (BenchEvents * 3.0));
+
+    // concurrent writers while exporting
+    exports = 0;
+    for (i = 0; i < thread_n; ++i) {
+	pthread_create(&threads[i], NULL, BenchWriter, NULL);
+    }
+    start = BenchTime();
+    for (i = 0; i < 10; ++i) {
+	json = TraceExport();
+	failed |= !json;
+	if (json) {
+	    ++exports;
+	    free(json);
+	}
+    }
+    t = BenchTime() - start;
+    for (i = 0; i < thread_n; ++i) {
+	pthread_join(threads[i], NULL);
+    }
+    printf("%-10s %8.2f ms/export while %d threads write\n", "export",
+	exports ? t / (exports * 1000000.0) : 0.0, thread_n);
+
+    json = TraceExport();
+    n = json ? BenchCount(json) : 0;
+    // process and thread names + full rings, the oldest event of each
+    // ring could be overwritten by a running writer and is dropped.
+    // exited writers hand their ring to writers started later.
+    if (n != 1 + TraceRingN * TRACE_EVENTS || TraceRingN > thread_n + 1) {
+	printf("export has %d events of %d rings, expected %d\n", n,
+	    TraceRingN, 1 + TraceRingN * TRACE_EVENTS);
+	failed = 1;
+    }
+    free(json);
+
+    return failed;
+}
+
+#endif
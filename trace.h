@@ -0,0 +1,101 @@
+///
+///	@file trace.h	@brief Event trace module header file
+///
+///	Copyright (c) 2026 by the softhddevice contributors.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+/// @addtogroup Trace
+/// @{
+
+    /// traced events
+enum TraceEventIds
+{
+    TRACE_PACKET,			///< video packet enqueued
+    TRACE_DECODE,			///< video packet decoded
+    TRACE_SURFACE,			///< decoded surface queued
+    TRACE_VSYNC,			///< output surface presented
+    TRACE_FRAME,			///< next video frame shown
+    TRACE_FRAME_DUP,			///< video frame shown again
+    TRACE_AUDIO_ENQUEUE,		///< audio samples enqueued
+    TRACE_AUDIO_WRITE,			///< audio samples written to device
+    TRACE_OSD_DRAW,			///< osd areas drawn
+    TRACE_OSD_FLUSH,			///< osd flush presented
+    TRACE_EVENT_MAX
+};
+
+    /// phases of traced events
+enum TracePhases
+{
+    TRACE_INSTANT,			///< event without duration
+    TRACE_BEGIN,			///< begin of event with duration
+    TRACE_END,				///< end of event with duration
+};
+
+    /// flag record events
+extern volatile char TraceEnabled;
+
+    /// record event in ring of calling thread
+extern void TraceEvent(int, int, int);
+
+    /// start or stop recording events
+extern void TraceEnable(int);
+
+    /// export recorded events as chrome trace json
+extern char *TraceExport(void);
+
+///
+///	Record instant trace event, if tracing is enabled.
+///
+///	@param id	event id (TRACE_...)
+///	@param arg	event argument
+///
+static inline void TraceMark(int id, int arg)
+{
+    if (TraceEnabled) {
+	TraceEvent(id, TRACE_INSTANT, arg);
+    }
+}
+
+///
+///	Record begin of trace event, if tracing is enabled.
+///
+///	@param id	event id (TRACE_...)
+///	@param arg	event argument
+///
+static inline void TraceBegin(int id, int arg)
+{
+    if (TraceEnabled) {
+	TraceEvent(id, TRACE_BEGIN, arg);
+    }
+}
+
+///
+///	Record end of trace event, if tracing is enabled.
+///
+///	@param id	event id (TRACE_...)
+///	@param arg	event argument
+///
+static inline void TraceEnd(int id, int arg)
+{
+    if (TraceEnabled) {
+	TraceEvent(id, TRACE_END, arg);
+    }
+}
+
+/// @}
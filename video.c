@@ -207,8 +207,11 @@ typedef enum
 #include "iatomic.h"			// portable atomic_t
 #include "misc.h"
 #include "video.h"
+#include "presenter.h"
 #include "audio.h"
 #include "codec.h"
+#include "trace.h"
+#include "metrics.h"
 
 #define ARRAY_ELEMS(array) (sizeof(array)/sizeof(array[0]))
 
@@ -314,6 +317,8 @@ typedef struct _video_module_
     /// draw OSD ARGB area
     void (*const OsdDrawARGB) (int, int, int, int, int, const uint8_t *, int,
 	int);
+    /// draw OSD ARGB areas with one upload (optional)
+    void (*const OsdDrawRects) (const VideoOsdRect *, int);
     void (*const OsdInit) (int, int);	///< initialize OSD
     void (*const OsdExit) (void);	///< cleanup OSD
 
@@ -355,6 +360,8 @@ typedef struct _video_config_values_
 #define FIELD_SURFACES_MAX	POSTPROC_SURFACES_MAX / 2	///< video postprocessing surfaces for queue
 #define OUTPUT_SURFACES_MAX	4	///< output surfaces for flip page
 
+#define VIDEO_DECODERS_MAX	11	///< main, pip and 9 mosaic tiles
+
 //----------------------------------------------------------------------------
 //	Variables
 //----------------------------------------------------------------------------
@@ -435,6 +442,9 @@ static VideoConfigValues CuvidConfigStde =
 #endif
 
 char VideoIgnoreRepeatPict;		///< disable repeat pict warning
+char VideoGrabTest;			///< noop module fills grab ring with bars
+char VideoNoopDecode;			///< noop module decodes in software
+char VideoFastStart;			///< first key frame and motion at once
 
 static const char *VideoDriverName;	///< video output device
 static Display *XlibDisplay;		///< Xlib X11 display
@@ -519,7 +529,14 @@ static VideoZoomModes VideoOtherZoomMode;
 
 static char Video60HzMode;		///< handle 60hz displays
 static char VideoSoftStartSync;		///< soft start sync audio/video
-static const int VideoSoftStartFrames = 100;	///< soft start frames
+static int VideoSoftStartFrames = 100;	///< soft start frames
+static char VideoPresenterEnabled;	///< pts scheduled frame presenter
+
+static const VideoHwDecoder *VideoZapDecoder;	///< decoder timed for zap
+static uint32_t VideoZapTicks[VIDEO_ZAP_MAX];	///< ticks of zap stages
+static int VideoZapCounter;		///< number of timed zaps
+static int VideoZapCodecCount[2];	///< codec reopened, reused
+static uint64_t VideoZapCodecUs[2];	///< sum of codec reopen, reuse us
 static char VideoShowBlackPicture;	///< flag show black picture
 
 static xcb_atom_t WmDeleteWindowAtom;	///< WM delete message atom
@@ -562,6 +579,9 @@ static int OsdDirtyX;			///< osd dirty area x
 static int OsdDirtyY;			///< osd dirty area y
 static int OsdDirtyWidth;		///< osd dirty area width
 static int OsdDirtyHeight;		///< osd dirty area height
+static int OsdUploadFlushes;		///< number of osd uploads
+static int OsdUploadBytes;		///< bytes of last osd upload
+static int64_t OsdUploadTotal;		///< bytes of all osd uploads
 
 #ifdef USE_OPENGLOSD
 static void (*VideoEventCallback)(void) = NULL;  /// callback function to notify VDR about Video Events
@@ -679,6 +699,33 @@ static void VideoSetPts(int64_t * pts_p, int interlaced,
     }
 }
 
+///
+///	Sync a progressive stream with the pts scheduled presenter.
+///
+///	@param presenter	frame presenter of the decoder
+///	@param frame_time	time of the last displayed frame
+///	@param audio_clock	audio clock
+///	@param filled		filled surfaces incl. the displayed surface
+///
+///	@returns number of frames to advance, -1 use threshold sync.
+///
+static int VideoPresenterSync(VideoPresenter * presenter,
+    const struct timespec *frame_time, int64_t audio_clock, int filled)
+{
+    struct timespec nowtime;
+
+    if (!VideoPresenterEnabled || audio_clock == (int64_t) AV_NOPTS_VALUE) {
+	return -1;
+    }
+    PresenterVsync(presenter,
+	frame_time->tv_sec * INT64_C(1000000000) + frame_time->tv_nsec);
+    clock_gettime(CLOCK_MONOTONIC, &nowtime);
+
+    return PresenterDecide(presenter,
+	nowtime.tv_sec * INT64_C(1000000000) + nowtime.tv_nsec,
+	audio_clock + VideoAudioDelay, filled);
+}
+
 ///
 ///	Update output for new size or aspect ratio.
 ///
@@ -856,6 +903,14 @@ static GLuint OsdGlTextures[2];		///< gl texture for OSD
 static GLuint OsdGlTexture = 0;		///< texture for openglosd
 static int OsdIndex;			///< index into OsdGlTextures
 
+#define GLX_OSD_PBOS	3		///< pixel unpack buffers for OSD
+
+static GLuint GlxOsdPbos[GLX_OSD_PBOS];	///< pixel unpack buffer ring
+static int GlxOsdPboIndex;		///< next pixel unpack buffer
+static int GlxOsdUploads;		///< number of osd texture uploads
+static int64_t GlxOsdUploadBytes;	///< bytes of osd texture uploads
+static int64_t GlxOsdUploadTime;	///< us spent in osd texture uploads
+
 ///
 ///	GLX extension functions
 ///@{
@@ -972,27 +1027,78 @@ static inline void GlxRenderTexture(GLuint texture, int x, int y, int width,
 ///
 ///	Upload OSD texture.
 ///
+///	The rows are taken directly from the caller's image with
+///	GL_UNPACK_ROW_LENGTH.  With pixel buffer objects the image is
+///	copied into the next buffer of a ring, which is orphaned before, so
+///	the texture upload doesn't stall on a buffer still used by the GPU.
+///
 ///	@param x	x coordinate texture
 ///	@param y	y coordinate texture
 ///	@param width	argb image width
 ///	@param height	argb image height
+///	@param pitch	pitch of argb image
 ///	@param argb	argb image
 ///
 static void GlxUploadOsdTexture(int x, int y, int width, int height,
-    const uint8_t * argb)
+    int pitch, const uint8_t * argb)
 {
-    // FIXME: use other / faster uploads
-    // ARB_pixelbuffer_object GL_PIXEL_UNPACK_BUFFER glBindBufferARB()
-    // glMapBuffer() glUnmapBuffer()
+    const uint8_t *data;
+    uint32_t start;
+    int row_length;
+
+    start = GetUsTicks();
+    data = argb;
+    row_length = pitch / 4;
+
+    if (GlxOsdPbos[0]) {
+	uint8_t *dst;
+	int size;
+
+	// narrow areas are packed, else the rows are copied with the pitch
+	if (width * 8 < pitch) {
+	    row_length = width;
+	}
+	size = (height - 1) * row_length * 4 + width * 4;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GlxOsdPbos[GlxOsdPboIndex]);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	if ((dst = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY))) {
+	    if (row_length == width) {
+		int i;
+
+		for (i = 0; i < height; ++i) {
+		    memcpy(dst + i * width * 4, argb + i * pitch, width * 4);
+		}
+	    } else {
+		memcpy(dst, argb, size);
+	    }
+	    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	    data = NULL;		// offset into the bound buffer
+	    GlxOsdPboIndex = (GlxOsdPboIndex + 1) % GLX_OSD_PBOS;
+	} else {
+	    Debug(3, "video/glx: can't map osd pixel buffer\n");
+	    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	    row_length = pitch / 4;
+	}
+    }
 
     glEnable(GL_TEXTURE_2D);		// upload 2d texture
 
     glBindTexture(GL_TEXTURE_2D, OsdGlTextures[OsdIndex]);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
     glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_BGRA,
-	GL_UNSIGNED_BYTE, argb);
+	GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
     glBindTexture(GL_TEXTURE_2D, 0);
 
     glDisable(GL_TEXTURE_2D);
+    if (GlxOsdPbos[0]) {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    ++GlxOsdUploads;
+    GlxOsdUploadBytes += width * height * 4;
+    GlxOsdUploadTime += GetUsTicks() - start;
 }
 
 ///
@@ -1003,6 +1109,7 @@ static void GlxUploadOsdTexture(int x, int y, int width, int height,
 ///
 static void GlxOsdInit(int width, int height)
 {
+    const char *extensions;
     int i;
     // not init with openglosd
     if (OsdGlTexture) return;
@@ -1039,6 +1146,18 @@ static void GlxOsdInit(int width, int height)
 
     glBindTexture(GL_TEXTURE_2D, 0);
     glDisable(GL_TEXTURE_2D);
+
+    //
+    //	create pixel unpack buffers for asynchronous uploads.
+    //
+    extensions = (const char *)glGetString(GL_EXTENSIONS);
+    if (extensions && strstr(extensions, "GL_ARB_pixel_buffer_object")) {
+	glGenBuffers(GLX_OSD_PBOS, GlxOsdPbos);
+	GlxOsdPboIndex = 0;
+	Debug(3, "video/glx: osd uploads with %d pixel buffers\n",
+	    GLX_OSD_PBOS);
+    }
+    GlxCheck();
 }
 
 ///
@@ -1052,31 +1171,35 @@ static void GlxOsdExit(void)
 	OsdGlTextures[0] = 0;
 	OsdGlTextures[1] = 0;
     }
+    if (GlxOsdPbos[0]) {
+	glDeleteBuffers(GLX_OSD_PBOS, GlxOsdPbos);
+	memset(GlxOsdPbos, 0, sizeof(GlxOsdPbos));
+    }
+    if (GlxOsdUploads) {
+	Debug(3, "video/glx: %d osd uploads %" PRId64 " bytes %" PRId64
+	    "us\n", GlxOsdUploads, GlxOsdUploadBytes, GlxOsdUploadTime);
+    }
 }
 
 ///
-///	Upload ARGB image to texture.
+///	Upload ARGB areas to texture.
 ///
-///	@param xi	x-coordinate in argb image
-///	@param yi	y-coordinate in argb image
-///	@paran height	height in pixel in argb image
-///	@paran width	width in pixel in argb image
-///	@param pitch	pitch of argb image
-///	@param argb	32bit ARGB image data
-///	@param x	x-coordinate on screen of argb image
-///	@param y	y-coordinate on screen of argb image
+///	The context is switched only once for all areas.
+///
+///	@param rects	damaged areas with their ARGB image data
+///	@param n	number of areas
 ///
 ///	@note looked by caller
 ///
-static void GlxOsdDrawARGB(int xi, int yi, int width, int height, int pitch,
-    const uint8_t * argb, int x, int y)
+static void GlxOsdDrawRects(const VideoOsdRect * rects, int n)
 {
-    uint8_t *tmp;
-
 #ifdef DEBUG
     uint32_t start;
     uint32_t end;
+    int uploads;
+    int64_t time;
 #endif
+    int i;
 
     if (!GlxEnabled) {
 	Debug(3, "video/glx: %s called without glx enabled\n", __FUNCTION__);
@@ -1084,6 +1207,8 @@ static void GlxOsdDrawARGB(int xi, int yi, int width, int height, int pitch,
     }
 #ifdef DEBUG
     start = GetMsTicks();
+    uploads = GlxOsdUploads;
+    time = GlxOsdUploadTime;
     Debug(3, "video/glx: osd context %p <-> %p\n", glXGetCurrentContext(),
 	GlxContext);
 #endif
@@ -1093,29 +1218,52 @@ static void GlxOsdDrawARGB(int xi, int yi, int width, int height, int pitch,
 	Error(_("video/glx: can't make glx context current\n"));
 	return;
     }
-    // FIXME: faster way
-    tmp = malloc(width * height * 4);
-    if (tmp) {
-	int i;
 
-	for (i = 0; i < height; ++i) {
-	    memcpy(tmp + i * width * 4, argb + xi * 4 + (i + yi) * pitch,
-		width * 4);
-	}
-
-	GlxUploadOsdTexture(x, y, width, height, tmp);
-	glXMakeCurrent(XlibDisplay, None, NULL);
-
-	free(tmp);
+    for (i = 0; i < n; ++i) {
+	GlxUploadOsdTexture(rects[i].X, rects[i].Y, rects[i].Width,
+	    rects[i].Height, rects[i].Pitch,
+	    rects[i].Argb + rects[i].Xi * 4 + rects[i].Yi * rects[i].Pitch);
     }
+    glXMakeCurrent(XlibDisplay, None, NULL);
+
 #ifdef DEBUG
     end = GetMsTicks();
 
-    Debug(3, "video/glx: osd upload %dx%d%+d%+d %dms %d\n", width, height, x,
-	y, end - start, width * height * 4);
+    Debug(3, "video/glx: osd upload %d areas %dms, %dus in %d uploads\n", n,
+	end - start, (int)(GlxOsdUploadTime - time), GlxOsdUploads - uploads);
 #endif
 }
 
+///
+///	Upload ARGB image to texture.
+///
+///	@param xi	x-coordinate in argb image
+///	@param yi	y-coordinate in argb image
+///	@paran height	height in pixel in argb image
+///	@paran width	width in pixel in argb image
+///	@param pitch	pitch of argb image
+///	@param argb	32bit ARGB image data
+///	@param x	x-coordinate on screen of argb image
+///	@param y	y-coordinate on screen of argb image
+///
+///	@note looked by caller
+///
+static void GlxOsdDrawARGB(int xi, int yi, int width, int height, int pitch,
+    const uint8_t * argb, int x, int y)
+{
+    VideoOsdRect rect;
+
+    rect.Xi = xi;
+    rect.Yi = yi;
+    rect.Width = width;
+    rect.Height = height;
+    rect.Pitch = pitch;
+    rect.Argb = argb;
+    rect.X = x;
+    rect.Y = y;
+    GlxOsdDrawRects(&rect, 1);
+}
+
 ///
 ///	Clear OSD texture.
 ///
@@ -1145,7 +1293,7 @@ static void GlxOsdClear(void)
     }
 
     texbuf = calloc(OsdWidth * OsdHeight, 4);
-    GlxUploadOsdTexture(0, 0, OsdWidth, OsdHeight, texbuf);
+    GlxUploadOsdTexture(0, 0, OsdWidth, OsdHeight, OsdWidth * 4, texbuf);
     glXMakeCurrent(XlibDisplay, None, NULL);
 
     free(texbuf);
@@ -1813,6 +1961,7 @@ struct _vaapi_decoder_
     int Closing;			///< flag about closing current stream
     int SyncOnAudio;			///< flag sync to audio
     int64_t PTS;			///< video PTS clock
+    VideoPresenter Presenter;		///< pts scheduled frame presenter
 
     int LastAVDiff;			///< last audio - video difference
     int SyncCounter;			///< counter to sync frames
@@ -1838,7 +1987,7 @@ struct _vaapi_decoder_
     int vpp_saturation_idx;		///< video postprocessing saturation buffer index
 };
 
-static VaapiDecoder *VaapiDecoders[1];	///< open decoder streams
+static VaapiDecoder *VaapiDecoders[VIDEO_DECODERS_MAX];	///< open decoder streams
 static int VaapiDecoderN;		///< number of decoder streams
 
     /// forward display back surface
@@ -2297,19 +2446,23 @@ static void VaapiInitSurfaceFlags(VaapiDecoder * decoder)
 ///
 ///	Allocate new VA-API decoder.
 ///
-///	@returns a new prepared VA-API hardware decoder.
+///	@returns a new prepared VA-API hardware decoder, NULL if out of
+///	decoders.
 ///
 static VaapiDecoder *VaapiNewHwDecoder(VideoStream * stream)
 {
     VaapiDecoder *decoder;
     int i;
 
-    if (VaapiDecoderN == 1) {
-	Fatal(_("video/vaapi: out of decoders\n"));
+    if ((unsigned)VaapiDecoderN >=
+	sizeof(VaapiDecoders) / sizeof(*VaapiDecoders)) {
+	Error(_("video/vaapi: out of decoders\n"));
+	return NULL;
     }
 
     if (!(decoder = calloc(1, sizeof(*decoder)))) {
-	Fatal(_("video/vaapi: out of memory\n"));
+	Error(_("video/vaapi: out of memory\n"));
+	return NULL;
     }
     decoder->VaDisplay = VaDisplay;
     decoder->Window = VideoWindow;
@@ -2418,6 +2571,7 @@ static VaapiDecoder *VaapiNewHwDecoder(VideoStream * stream)
 	decoder->SyncOnAudio = 1;
     }
     decoder->Closing = -300 - 1;
+    PresenterInit(&decoder->Presenter);
 
     decoder->PTS = AV_NOPTS_VALUE;
 
@@ -2570,6 +2724,7 @@ static void VaapiCleanup(VaapiDecoder * decoder)
     decoder->FrameCounter = 0;
     decoder->FramesDisplayed = 0;
     decoder->StartCounter = 0;
+    PresenterReset(&decoder->Presenter);
     decoder->Closing = 0;
     decoder->PTS = AV_NOPTS_VALUE;
     VideoDeltaPTS = 0;
@@ -2588,8 +2743,10 @@ static void VaapiDelHwDecoder(VaapiDecoder * decoder)
     for (i = 0; i < VaapiDecoderN; ++i) {
 	if (VaapiDecoders[i] == decoder) {
 	    VaapiDecoders[i] = NULL;
-	    VaapiDecoderN--;
-	    // FIXME: must copy last slot into empty slot and --
+	    // copy last slot into empty slot
+	    if (i < --VaapiDecoderN) {
+		VaapiDecoders[i] = VaapiDecoders[VaapiDecoderN];
+	    }
 	    break;
 	}
     }
@@ -4934,6 +5091,7 @@ static void VaapiQueueSurface(VaapiDecoder * decoder, VASurfaceID surface,
     if (1) {				// can't wait for output queue empty
 	if (atomic_read(&decoder->SurfacesFilled) >= VIDEO_SURFACES_MAX - 1) {
 	    ++decoder->FramesDropped;
+	    MetricsInc(METRIC_FRAMES_DROPPED);
 	    Warning(_("video: output buffer full, dropping frame (%d/%d)\n"),
 		decoder->FramesDropped, decoder->FrameCounter);
 	    if (!(decoder->FramesDisplayed % 300)) {
@@ -5037,6 +5195,7 @@ static void VaapiQueueSurface(VaapiDecoder * decoder, VASurfaceID surface,
     decoder->SurfaceWrite = (decoder->SurfaceWrite + 1) % VIDEO_SURFACES_MAX;
     decoder->SurfaceField = decoder->TopFieldFirst ? 0 : 1;
     atomic_inc(&decoder->SurfacesFilled);
+    TraceMark(TRACE_SURFACE, atomic_read(&decoder->SurfacesFilled));
 
     /* Run postprocessing twice for top & bottom fields */
     if (decoder->Interlaced) {
@@ -6336,10 +6495,12 @@ static void VaapiAdvanceDecoderFrame(VaapiDecoder * decoder)
     if (filled <= 1) {
         // keep use of last surface
         ++decoder->FramesDuped;
+        MetricsInc(METRIC_FRAMES_DUPED);
         // FIXME: don't warn after stream start, don't warn during pause
         Debug(4,"video: display buffer empty, duping frame (%d/%d) %d\n",
 		decoder->FramesDuped, decoder->FrameCounter,
 		VideoGetBuffers(decoder->Stream));
+        TraceMark(TRACE_FRAME_DUP, filled);
         return;
     }
     // wait for rendering finished
@@ -6350,6 +6511,7 @@ static void VaapiAdvanceDecoderFrame(VaapiDecoder * decoder)
 
     decoder->SurfaceRead = (decoder->SurfaceRead + 1) % VIDEO_SURFACES_MAX;
     atomic_dec(&decoder->SurfacesFilled);
+    TraceMark(TRACE_FRAME, filled - 1);
 }
 
 ///
@@ -6393,6 +6555,7 @@ static void VaapiDisplayFrame(void)
 
 	decoder = VaapiDecoders[i];
 	decoder->FramesDisplayed++;
+	MetricsInc(METRIC_FRAMES_DISPLAYED);
 	decoder->StartCounter++;
 
 #ifdef VA_EXP
@@ -6429,6 +6592,7 @@ static void VaapiDisplayFrame(void)
 	}
 
 	surface = decoder->SurfacesRb[decoder->SurfaceRead];
+	VideoZapMark((VideoHwDecoder *) decoder, VIDEO_ZAP_DISPLAYED);
 #ifdef VA_EXP
 	decoder->LastSurface = surface;
 #endif
@@ -6500,6 +6664,7 @@ static void VaapiDisplayFrame(void)
 #endif
 
 	decoder->FrameTime = nowtime;
+	TraceMark(TRACE_VSYNC, 0);
     }
 
 #ifdef USE_GLX
@@ -6575,6 +6740,7 @@ static void VaapiSetClosing(VaapiDecoder * decoder)
 static void VaapiResetStart(VaapiDecoder * decoder)
 {
     decoder->StartCounter = 0;
+    PresenterReset(&decoder->Presenter);
 }
 
 ///
@@ -6642,6 +6808,42 @@ static void VaapiSyncDecoder(VaapiDecoder * decoder)
     }
     video_clock = VaapiGetClock(decoder);
     filled = atomic_read(&decoder->SurfacesFilled);
+    if (!decoder->TrickSpeed && audio_clock != (int64_t) AV_NOPTS_VALUE
+	&& video_clock != (int64_t) AV_NOPTS_VALUE) {
+	MetricsObserve(METRIC_AV_DIFF,
+	    (video_clock - audio_clock - VideoAudioDelay) / 90);
+    }
+
+    // progressive: pts scheduled presenter replaces 60Hz mode and
+    // the dup/drop thresholds
+    if (!decoder->TrickSpeed && !decoder->Interlaced) {
+	int n;
+
+	n = VideoPresenterSync(&decoder->Presenter, &decoder->FrameTime,
+	    audio_clock, filled);
+	if (n >= 0) {
+	    if (decoder->Presenter.Locked) {
+		VideoZapMark((VideoHwDecoder *) decoder, VIDEO_ZAP_SYNCED);
+	    }
+	    if (decoder->Presenter.Starved && !decoder->Closing) {
+		++decoder->FramesDuped;
+		MetricsInc(METRIC_FRAMES_DUPED);
+		// pip and mosaic tiles dup by design, only the stream synced
+		// on audio feeds the latency profile
+		if (decoder->SyncOnAudio) {
+		    AudioVideoUnderrun();
+		}
+	    }
+	    if (n > 1) {
+		decoder->FramesDropped += n - 1;
+		MetricsAdd(METRIC_FRAMES_DROPPED, n - 1);
+	    }
+	    while (n--) {
+		VaapiAdvanceDecoderFrame(decoder);
+	    }
+	    goto out;
+	}
+    }
 
     // 60Hz: repeat every 5th field
     if (Video60HzMode && !(decoder->FramesDisplayed % 6)) {
@@ -6668,7 +6870,9 @@ static void VaapiSyncDecoder(VaapiDecoder * decoder)
     }
     // at start of new video stream, soft or hard sync video to audio
     // FIXME: video waits for audio, audio for video
-    if (!VideoSoftStartSync && decoder->StartCounter < VideoSoftStartFrames
+    // fast start: video moves at once, dup/drop catch up with audio
+    if (!VideoSoftStartSync && !VideoFastStart
+	&& decoder->StartCounter < VideoSoftStartFrames
 	&& video_clock != (int64_t) AV_NOPTS_VALUE
 	&& (audio_clock == (int64_t) AV_NOPTS_VALUE
 	    || video_clock > audio_clock + VideoAudioDelay + 120 * 90)) {
@@ -6700,6 +6904,7 @@ static void VaapiSyncDecoder(VaapiDecoder * decoder)
 	    // FIXME: this quicker sync step, did not work with new code!
 	    err = VaapiMessage(3, "video: slow down video, duping frame\n");
 	    ++decoder->FramesDuped;
+	    MetricsInc(METRIC_FRAMES_DUPED);
 	    if (VideoSoftStartSync) {
 		decoder->SyncCounter = diff > 100 * 90 ? diff % 2 : 1; //softsync :)
 	    }
@@ -6707,17 +6912,22 @@ static void VaapiSyncDecoder(VaapiDecoder * decoder)
 	} else if (diff > 55 * 90) {
 	    err = VaapiMessage(3, "video: slow down video, duping frame\n");
 	    ++decoder->FramesDuped;
+	    MetricsInc(METRIC_FRAMES_DUPED);
 		decoder->SyncCounter = 1;
 		goto out;
 	} else if (diff < lower_limit * 90 && filled > 1 + 2 * decoder->Interlaced) {
 	    err = VaapiMessage(3, "video: speed up video, droping frame\n");
 	    ++decoder->FramesDropped;
+	    MetricsInc(METRIC_FRAMES_DROPPED);
 	    VaapiAdvanceDecoderFrame(decoder);
 		decoder->SyncCounter = 1;
 	} else if (diff < lower_limit * 90 && !filled) {
 		err = VaapiMessage(3, "video: speed up audio, delay audio\n");
 		AudioDelayms(-diff / 90);
 	}
+	if (!decoder->SyncCounter && abs(diff) <= 55 * 90) {
+	    VideoZapMark((VideoHwDecoder *) decoder, VIDEO_ZAP_SYNCED);
+	}
 #if defined(DEBUG) || defined(AV_INFO)
 	if (!decoder->SyncCounter && decoder->StartCounter < 1000) {
 #ifdef DEBUG
@@ -6737,6 +6947,11 @@ static void VaapiSyncDecoder(VaapiDecoder * decoder)
     if (decoder->SurfaceField && filled <= 1) {
 	if (filled == 1) {
 	    ++decoder->FramesDuped;
+	    MetricsInc(METRIC_FRAMES_DUPED);
+	    if (!decoder->Closing && !decoder->TrickSpeed
+		&& decoder->SyncOnAudio) {
+		AudioVideoUnderrun();
+	    }
 	    // FIXME: don't warn after stream start, don't warn during pause
 	    err =
 		VaapiMessage(3,
@@ -6862,6 +7077,7 @@ static void VaapiSyncRenderFrame(VaapiDecoder * decoder,
 
     if (!decoder->Closing) {
 	VideoSetPts(&decoder->PTS, decoder->Interlaced, video_ctx, frame);
+	PresenterFrame(&decoder->Presenter, decoder->PTS);
     }
     VaapiRenderFrame(decoder, video_ctx, frame);
 #ifdef USE_AUTOCROP
@@ -6924,6 +7140,7 @@ static void VaapiSetOutputPosition(VaapiDecoder * decoder, int x, int y,
 static void VaapiDisplayHandlerThread(void)
 {
     int i;
+    int n;
     int err;
     int allfull;
     int decoded;
@@ -6947,6 +7164,15 @@ static void VaapiDisplayHandlerThread(void)
 	    // fetch+decode or reopen
 	    allfull = 0;
 	    err = VideoDecodeInput(decoder->Stream);
+	    // focused mosaic tile decodes more packets each round
+	    for (n = VideoGetPriority(decoder->Stream) - 1; !err && n > 0;
+		--n) {
+		if (atomic_read(&decoder->SurfacesFilled) >=
+		    VIDEO_SURFACES_MAX - 1
+		    || VideoDecodeInput(decoder->Stream)) {
+		    break;
+		}
+	    }
 	} else {
 	    err = VideoPollInput(decoder->Stream);
 	}
@@ -7051,8 +7277,9 @@ static void VaapiOsdClear(void)
 }
 
 ///
-///	Upload ARGB to subpicture image.
+///	Copy ARGB into the mapped subpicture image.
 ///
+///	@param image_buffer	mapped osd image
 ///	@param xi	x-coordinate in argb image
 ///	@param yi	y-coordinate in argb image
 ///	@paran height	height in pixel in argb image
@@ -7062,24 +7289,12 @@ static void VaapiOsdClear(void)
 ///	@param x	x-coordinate on screen of argb image
 ///	@param y	y-coordinate on screen of argb image
 ///
-///	@note looked by caller
-///
-static void VaapiOsdDrawARGB(int xi, int yi, int width, int height, int pitch,
-    const uint8_t * argb, int x, int y)
+static void VaapiOsdCopyARGB(uint8_t * image_buffer, int xi, int yi,
+    int width, int height, int pitch, const uint8_t * argb, int x, int y)
 {
-#ifdef DEBUG
-    uint32_t start;
-    uint32_t end;
-#endif
-    void *image_buffer;
     int o;
     int copywidth, copyheight;
 
-    // osd image available?
-    if (VaOsdImage.image_id == VA_INVALID_ID) {
-	return;
-    }
-
     if (VaOsdImage.width < width + x || VaOsdImage.height < height + y) {
 	Error("video/vaapi: OSD will not fit (w: %d+%d, w-avail: %d, h: %d+%d, h-avail: %d\n",
 	      width, x, VaOsdImage.width, height, y, VaOsdImage.height);
@@ -7094,6 +7309,38 @@ static void VaapiOsdDrawARGB(int xi, int yi, int width, int height, int pitch,
     if (VaOsdImage.height < height + y)
 	copyheight = VaOsdImage.height - y;
 
+    // FIXME: convert image from ARGB to subpicture format, if not argb
+
+    // copy argb to image
+    for (o = 0; o < copyheight; ++o) {
+	memcpy(image_buffer + x * 4 + (y + o) * VaOsdImage.pitches[0],
+	    argb + xi * 4 + (o + yi) * pitch, copywidth * 4);
+    }
+}
+
+///
+///	Upload ARGB areas to subpicture image.
+///
+///	The osd image is mapped only once for all areas.
+///
+///	@param rects	damaged areas with their ARGB image data
+///	@param n	number of areas
+///
+///	@note looked by caller
+///
+static void VaapiOsdDrawRects(const VideoOsdRect * rects, int n)
+{
+#ifdef DEBUG
+    uint32_t start;
+    uint32_t end;
+#endif
+    void *image_buffer;
+    int i;
+
+    // osd image available?
+    if (VaOsdImage.image_id == VA_INVALID_ID) {
+	return;
+    }
 #ifdef DEBUG
     start = GetMsTicks();
 #endif
@@ -7103,12 +7350,11 @@ static void VaapiOsdDrawARGB(int xi, int yi, int width, int height, int pitch,
 	Error(_("video/vaapi: can't map osd image buffer\n"));
 	return;
     }
-    // FIXME: convert image from ARGB to subpicture format, if not argb
 
-    // copy argb to image
-    for (o = 0; o < copyheight; ++o) {
-	memcpy(image_buffer + x * 4 + (y + o) * VaOsdImage.pitches[0],
-	    argb + xi * 4 + (o + yi) * pitch, copywidth * 4);
+    for (i = 0; i < n; ++i) {
+	VaapiOsdCopyARGB(image_buffer, rects[i].Xi, rects[i].Yi,
+	    rects[i].Width, rects[i].Height, rects[i].Pitch, rects[i].Argb,
+	    rects[i].X, rects[i].Y);
     }
 
     if (vaUnmapBuffer(VaDisplay, VaOsdImage.buf) != VA_STATUS_SUCCESS) {
@@ -7117,11 +7363,40 @@ static void VaapiOsdDrawARGB(int xi, int yi, int width, int height, int pitch,
 #ifdef DEBUG
     end = GetMsTicks();
 
-    Debug(3, "video/vaapi: osd upload %dx%d%+d%+d %dms %d\n", width, height, x,
-	y, end - start, width * height * 4);
+    Debug(3, "video/vaapi: osd upload %d areas %dms\n", n, end - start);
 #endif
 }
 
+///
+///	Upload ARGB to subpicture image.
+///
+///	@param xi	x-coordinate in argb image
+///	@param yi	y-coordinate in argb image
+///	@paran height	height in pixel in argb image
+///	@paran width	width in pixel in argb image
+///	@param pitch	pitch of argb image
+///	@param argb	32bit ARGB image data
+///	@param x	x-coordinate on screen of argb image
+///	@param y	y-coordinate on screen of argb image
+///
+///	@note looked by caller
+///
+static void VaapiOsdDrawARGB(int xi, int yi, int width, int height, int pitch,
+    const uint8_t * argb, int x, int y)
+{
+    VideoOsdRect rect;
+
+    rect.Xi = xi;
+    rect.Yi = yi;
+    rect.Width = width;
+    rect.Height = height;
+    rect.Pitch = pitch;
+    rect.Argb = argb;
+    rect.X = x;
+    rect.Y = y;
+    VaapiOsdDrawRects(&rect, 1);
+}
+
 ///
 ///	VA-API initialize OSD.
 ///
@@ -7285,6 +7560,7 @@ static const VideoModule VaapiModule = {
     .DisplayHandlerThread = VaapiDisplayHandlerThread,
     .OsdClear = VaapiOsdClear,
     .OsdDrawARGB = VaapiOsdDrawARGB,
+    .OsdDrawRects = VaapiOsdDrawRects,
     .OsdInit = VaapiOsdInit,
     .OsdExit = VaapiOsdExit,
     .Init = VaapiInit,
@@ -7329,6 +7605,7 @@ static const VideoModule VaapiGlxModule = {
     .DisplayHandlerThread = VaapiDisplayHandlerThread,
     .OsdClear = GlxOsdClear,
     .OsdDrawARGB = GlxOsdDrawARGB,
+    .OsdDrawRects = GlxOsdDrawRects,
     .OsdInit = GlxOsdInit,
     .OsdExit = GlxOsdExit,
     .Init = VaapiGlxInit,
@@ -7417,6 +7694,7 @@ typedef struct _vdpau_decoder_
     int Closing;			///< flag about closing current stream
     int SyncOnAudio;			///< flag sync to audio
     int64_t PTS;			///< video PTS clock
+    VideoPresenter Presenter;		///< pts scheduled frame presenter
 
     int LastAVDiff;			///< last audio - video difference
     int SyncCounter;			///< counter to sync frames
@@ -7430,7 +7708,7 @@ typedef struct _vdpau_decoder_
 
 static volatile char VdpauPreemption;	///< flag preemption happened.
 
-static VdpauDecoder *VdpauDecoders[2];	///< open decoder streams
+static VdpauDecoder *VdpauDecoders[VIDEO_DECODERS_MAX];	///< open decoder streams
 static int VdpauDecoderN;		///< number of decoder streams
 
 static VdpDevice VdpauDevice;		///< VDPAU device
@@ -8106,6 +8384,7 @@ static VdpauDecoder *VdpauNewHwDecoder(VideoStream * stream)
 	decoder->SyncOnAudio = 1;
     }
     decoder->Closing = -300 - 1;
+    PresenterInit(&decoder->Presenter);
 
     decoder->PTS = AV_NOPTS_VALUE;
 
@@ -8163,6 +8442,7 @@ static void VdpauCleanup(VdpauDecoder * decoder)
     decoder->FrameCounter = 0;
     decoder->FramesDisplayed = 0;
     decoder->StartCounter = 0;
+    PresenterReset(&decoder->Presenter);
     decoder->Closing = 0;
     decoder->PTS = AV_NOPTS_VALUE;
     VideoDeltaPTS = 0;
@@ -9838,6 +10118,7 @@ static void VdpauQueueSurface(VdpauDecoder * decoder, VdpVideoSurface surface,
 
     if (1) {				// can't wait for output queue empty
 	if (atomic_read(&decoder->SurfacesFilled) >= VIDEO_SURFACES_MAX) {
+	    MetricsInc(METRIC_FRAMES_DROPPED);
 	    Warning(_
 		("video/vdpau: output buffer full, dropping frame (%d/%d)\n"),
 		++decoder->FramesDropped, decoder->FrameCounter);
@@ -9877,6 +10158,7 @@ static void VdpauQueueSurface(VdpauDecoder * decoder, VdpVideoSurface surface,
     decoder->SurfaceWrite = (decoder->SurfaceWrite + 1)
 	% VIDEO_SURFACES_MAX;
     atomic_inc(&decoder->SurfacesFilled);
+    TraceMark(TRACE_SURFACE, atomic_read(&decoder->SurfacesFilled));
 }
 
 ///
@@ -10454,14 +10736,17 @@ static void VdpauAdvanceDecoderFrame(VdpauDecoder * decoder)
 	if (filled <  1 + 2 * decoder->Interlaced) {
 	    // keep use of last surface
 	    ++decoder->FramesDuped;
+	    MetricsInc(METRIC_FRAMES_DUPED);
 	    // FIXME: don't warn after stream start, don't warn during pause
 	    Debug(4,"video: display buffer empty, duping frame (%d/%d) %d\n",
 		decoder->FramesDuped, decoder->FrameCounter,
 		VideoGetBuffers(decoder->Stream));
+	    TraceMark(TRACE_FRAME_DUP, filled);
 	    return;
 	}
 	decoder->SurfaceRead = (decoder->SurfaceRead + 1) % VIDEO_SURFACES_MAX;
 	atomic_dec(&decoder->SurfacesFilled);
+	TraceMark(TRACE_FRAME, filled - 1);
 	decoder->SurfaceField = !decoder->Interlaced;
 	return;
     }
@@ -10528,6 +10813,7 @@ static void VdpauDisplayFrame(void)
 	// FIXME: can be more than 1 frame long shown
 	for (i = 0; i < VdpauDecoderN; ++i) {
 	    VdpauDecoders[i]->FramesMissed++;
+	    MetricsInc(METRIC_FRAMES_MISSED);
 	    VdpauMessage(2, _("video/vdpau: missed frame (%d/%d)\n"),
 		VdpauDecoders[i]->FramesMissed,
 		VdpauDecoders[i]->FrameCounter);
@@ -10544,6 +10830,7 @@ static void VdpauDisplayFrame(void)
 
 	decoder = VdpauDecoders[i];
 	decoder->FramesDisplayed++;
+	MetricsInc(METRIC_FRAMES_DISPLAYED);
 	decoder->StartCounter++;
 
 	filled = atomic_read(&decoder->SurfacesFilled);
@@ -10571,6 +10858,9 @@ static void VdpauDisplayFrame(void)
 #endif
 	}
 
+	if (filled) {
+	    VideoZapMark((VideoHwDecoder *) decoder, VIDEO_ZAP_DISPLAYED);
+	}
 	VdpauMixVideo(decoder, i);
     }
 
@@ -10592,6 +10882,7 @@ static void VdpauDisplayFrame(void)
     }
     // FIXME: CLOCK_MONOTONIC_RAW
     clock_gettime(CLOCK_MONOTONIC, &VdpauFrameTime);
+    TraceMark(TRACE_VSYNC, 0);
     for (i = 0; i < VdpauDecoderN; ++i) {
 	// remember time of last shown surface
 	VdpauDecoders[i]->FrameTime = VdpauFrameTime;
@@ -10661,6 +10952,7 @@ static void VdpauSetClosing(VdpauDecoder * decoder)
 static void VdpauResetStart(VdpauDecoder * decoder)
 {
     decoder->StartCounter = 0;
+    PresenterReset(&decoder->Presenter);
 }
 
 ///
@@ -10734,6 +11026,42 @@ static void VdpauSyncDecoder(VdpauDecoder * decoder)
 	max_mutex_delay = GetMsTicks() - mutex_start_time;
 	Debug(3, "video: mutex delay: %"PRIu32"ms\n", max_mutex_delay);
     }
+    if (!decoder->TrickSpeed && audio_clock != (int64_t) AV_NOPTS_VALUE
+	&& video_clock != (int64_t) AV_NOPTS_VALUE) {
+	MetricsObserve(METRIC_AV_DIFF,
+	    (video_clock - audio_clock - VideoAudioDelay) / 90);
+    }
+
+    // progressive: pts scheduled presenter replaces 60Hz mode and
+    // the dup/drop thresholds
+    if (!decoder->TrickSpeed && !decoder->Interlaced) {
+	int n;
+
+	n = VideoPresenterSync(&decoder->Presenter, &decoder->FrameTime,
+	    audio_clock, filled);
+	if (n >= 0) {
+	    if (decoder->Presenter.Locked) {
+		VideoZapMark((VideoHwDecoder *) decoder, VIDEO_ZAP_SYNCED);
+	    }
+	    if (decoder->Presenter.Starved && !decoder->Closing) {
+		++decoder->FramesDuped;
+		MetricsInc(METRIC_FRAMES_DUPED);
+		// pip and mosaic tiles dup by design, only the stream synced
+		// on audio feeds the latency profile
+		if (decoder->SyncOnAudio) {
+		    AudioVideoUnderrun();
+		}
+	    }
+	    if (n > 1) {
+		decoder->FramesDropped += n - 1;
+		MetricsAdd(METRIC_FRAMES_DROPPED, n - 1);
+	    }
+	    while (n--) {
+		VdpauAdvanceDecoderFrame(decoder);
+	    }
+	    goto out;
+	}
+    }
 
     // 60Hz: repeat every 5th field
     if (Video60HzMode && !(decoder->FramesDisplayed % 6)) {
@@ -10759,7 +11087,9 @@ static void VdpauSyncDecoder(VdpauDecoder * decoder)
 	goto skip_sync;
     }
     // at start of new video stream, soft or hard sync video to audio
-    if (!VideoSoftStartSync && decoder->StartCounter < VideoSoftStartFrames
+    // fast start: video moves at once, dup/drop catch up with audio
+    if (!VideoSoftStartSync && !VideoFastStart
+	&& decoder->StartCounter < VideoSoftStartFrames
 	&& video_clock != (int64_t) AV_NOPTS_VALUE
 	&& (audio_clock == (int64_t) AV_NOPTS_VALUE
 	    || video_clock > audio_clock + VideoAudioDelay + 120 * 90)) {
@@ -10791,6 +11121,7 @@ static void VdpauSyncDecoder(VdpauDecoder * decoder)
 	    // FIXME: this quicker sync step, did not work with new code!
 	    err = VdpauMessage(3, "video: slow down video, duping frame\n");
 	    ++decoder->FramesDuped;
+	    MetricsInc(METRIC_FRAMES_DUPED);
 	    if (VideoSoftStartSync) {
 		decoder->SyncCounter = diff > 100 * 90 ? diff % 2 : 1; //softsync :)
 	    }
@@ -10798,17 +11129,22 @@ static void VdpauSyncDecoder(VdpauDecoder * decoder)
 	} else if (diff > 55 * 90) {
 	    err = VdpauMessage(3, "video: slow down video, duping frame\n");
 	    ++decoder->FramesDuped;
+	    MetricsInc(METRIC_FRAMES_DUPED);
 		decoder->SyncCounter = 1;
 		goto out;
 	} else if (diff < lower_limit * 90 && filled > 1 + 2 * decoder->Interlaced) {
 	    err = VdpauMessage(3, "video: speed up video, droping frame\n");
 	    ++decoder->FramesDropped;
+	    MetricsInc(METRIC_FRAMES_DROPPED);
 	    VdpauAdvanceDecoderFrame(decoder);
 		decoder->SyncCounter = 1;
 	} else if (diff < lower_limit * 90 && !filled) {
 		err = VdpauMessage(3, "video: speed up audio, delay audio\n");
 		AudioDelayms(-diff / 90);
 	}
+	if (!decoder->SyncCounter && abs(diff) <= 55 * 90) {
+	    VideoZapMark((VideoHwDecoder *) decoder, VIDEO_ZAP_SYNCED);
+	}
 #if defined(DEBUG) || defined(AV_INFO)
 	if (!decoder->SyncCounter && decoder->StartCounter < 1000) {
 #ifdef DEBUG
@@ -10828,6 +11164,11 @@ static void VdpauSyncDecoder(VdpauDecoder * decoder)
     if (decoder->SurfaceField && filled <= 1 + 2 * decoder->Interlaced) {
 	if (filled == 1 + 2 * decoder->Interlaced) {
 	    ++decoder->FramesDuped;
+	    MetricsInc(METRIC_FRAMES_DUPED);
+	    if (!decoder->Closing && !decoder->TrickSpeed
+		&& decoder->SyncOnAudio) {
+		AudioVideoUnderrun();
+	    }
 	    // FIXME: don't warn after stream start, don't warn during pause
 	    err =
 		VdpauMessage(3,
@@ -10976,6 +11317,7 @@ static void VdpauSyncRenderFrame(VdpauDecoder * decoder,
 
     if (!decoder->Closing) {
 	VideoSetPts(&decoder->PTS, decoder->Interlaced, video_ctx, frame);
+	PresenterFrame(&decoder->Presenter, decoder->PTS);
     }
     VdpauRenderFrame(decoder, video_ctx, frame);
 }
@@ -11076,6 +11418,7 @@ static void VdpauSetVideoMode(void)
 static void VdpauDisplayHandlerThread(void)
 {
     int i;
+    int n;
     int err;
     int allfull;
     int decoded;
@@ -11099,6 +11442,15 @@ static void VdpauDisplayHandlerThread(void)
 	    // fetch+decode or reopen
 	    allfull = 0;
 	    err = VideoDecodeInput(decoder->Stream);
+	    // focused mosaic tile decodes more packets each round
+	    for (n = VideoGetPriority(decoder->Stream) - 1; !err && n > 0;
+		--n) {
+		if (atomic_read(&decoder->SurfacesFilled) >
+		    1 + 2 * decoder->Interlaced
+		    || VideoDecodeInput(decoder->Stream)) {
+		    break;
+		}
+	    }
 	} else {
 	    err = VideoPollInput(decoder->Stream);
 	}
@@ -11558,6 +11910,7 @@ typedef struct _cuvid_decoder_
     int Closing;			///< flag about closing current stream
     int SyncOnAudio;			///< flag sync to audio
     int64_t PTS;			///< video PTS clock
+    VideoPresenter Presenter;		///< pts scheduled frame presenter
 
     int LastAVDiff;			///< last audio - video difference
     int SyncCounter;			///< counter to sync frames
@@ -11569,7 +11922,7 @@ typedef struct _cuvid_decoder_
     int FramesDisplayed;		///< number of frames displayed
 } CuvidDecoder;
 
-static CuvidDecoder *CuvidDecoders[2];	///< open decoder streams
+static CuvidDecoder *CuvidDecoders[VIDEO_DECODERS_MAX];	///< open decoder streams
 static int CuvidDecoderN;		///< number of decoder streams
 static CudaFunctions *cu;
 static CUdevice CuvidDevice;
@@ -11967,6 +12320,7 @@ static CuvidDecoder *CuvidNewHwDecoder(VideoStream * stream)
 	decoder->SyncOnAudio = 1;
     }
     decoder->Closing = -300 - 1;
+    PresenterInit(&decoder->Presenter);
 
     decoder->PTS = AV_NOPTS_VALUE;
 
@@ -12011,6 +12365,7 @@ static void CuvidCleanup(CuvidDecoder * decoder)
     decoder->FrameCounter = 0;
     decoder->FramesDisplayed = 0;
     decoder->StartCounter = 0;
+    PresenterReset(&decoder->Presenter);
     decoder->Closing = 0;
     decoder->PTS = AV_NOPTS_VALUE;
     VideoDeltaPTS = 0;
@@ -12306,6 +12661,8 @@ static uint8_t *CuvidGrabOutputSurfaceLocked(int *ret_size, int *ret_width, int
     GLubyte *pixels;
     double scalew, scaleh;
     unsigned char* ptr;
+    uint32_t window_width;
+    uint32_t window_height;
 
     typedef struct {
         uint32_t x0;
@@ -12370,7 +12727,11 @@ static uint8_t *CuvidGrabOutputSurfaceLocked(int *ret_size, int *ret_width, int
 	    return NULL;
 	}
 
-	pixels = malloc(VideoWindowWidth * VideoWindowHeight * 4 * sizeof(GLubyte));
+	// window can be resized meanwhile, read and copy the same size
+	window_width = VideoWindowWidth;
+	window_height = VideoWindowHeight;
+
+	pixels = malloc(window_width * window_height * 4 * sizeof(GLubyte));
 	if (!pixels) {
 	    Error(_("video/cuvid: grab out of memory\n"));
 	    free(base);
@@ -12381,32 +12742,41 @@ static uint8_t *CuvidGrabOutputSurfaceLocked(int *ret_size, int *ret_width, int
 	GlxCheck();
 
 	glBindBuffer(GL_PIXEL_PACK_BUFFER, grab_buffer);
-	glBufferData(GL_PIXEL_PACK_BUFFER, VideoWindowWidth * VideoWindowHeight * 4 * sizeof(GLubyte), NULL, GL_STREAM_READ);
+	glBufferData(GL_PIXEL_PACK_BUFFER, window_width * window_height * 4 * sizeof(GLubyte), NULL, GL_STREAM_READ);
 
+	// lock only to start the read into the pack buffer, the video
+	// thread must not wait for the download below
 	pthread_mutex_lock(&VideoLockMutex);
 
 	/* Get BGRA to align to 32 bits instead of just 24 for RGB */
-	glReadPixels(source_rect.x0, source_rect.y0, VideoWindowWidth, VideoWindowHeight, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+	glReadPixels(source_rect.x0, source_rect.y0, window_width, window_height, GL_BGRA, GL_UNSIGNED_BYTE, 0);
 
 	pthread_mutex_unlock(&VideoLockMutex);
 
 	ptr = (unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
 	if (NULL != ptr) {
-	    memcpy(pixels, ptr, VideoWindowWidth * VideoWindowHeight * 4 * sizeof(GLubyte));
+	    memcpy(pixels, ptr, window_width * window_height * 4 * sizeof(GLubyte));
 	    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	} else {
+	    Error(_("video/cuvid: grab can't map pixel buffer\n"));
 	}
 
 	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 	glXMakeCurrent(XlibDisplay, None, NULL);
 	GlxCheck();
+	if (!ptr) {
+	    free(pixels);
+	    free(base);
+	    return NULL;
+	}
 
-	scalew = (double)VideoWindowWidth / width;
-	scaleh = (double)VideoWindowHeight / height;
+	scalew = (double)window_width / width;
+	scaleh = (double)window_height / height;
 
 	// convert 32 -> 24 and simple scale
 	for (i = 0; i < height; i++) {
 	    for (j = 0; j < width; j++) {
-	        cur_gl  = 4 * (VideoWindowWidth * (int)(scaleh * (height - i - 1)) + (int)(scalew * j));
+	        cur_gl  = 4 * (window_width * (int)(scaleh * (height - i - 1)) + (int)(scalew * j));
 	        cur_rgb = 4 * (width * i + j);
 	            for (k = 0; k < 4; k++)
 	                (base)[cur_rgb + k] = (pixels)[cur_gl + k];
@@ -12441,10 +12811,9 @@ static uint8_t *CuvidGrabOutputSurface(int *ret_size, int *ret_width,  int *ret_
         return NULL;			// cuvid video module not yet initialized
     }
 
+    // VideoLockMutex is taken inside, only while the read is started
     pthread_mutex_lock(&CuvidGrabMutex);
-//	pthread_mutex_lock(&VideoLockMutex);
     img = CuvidGrabOutputSurfaceLocked(ret_size, ret_width, ret_height);
-//	pthread_mutex_unlock(&VideoLockMutex);
     pthread_mutex_unlock(&CuvidGrabMutex);
     return img;
 }
@@ -12663,6 +13032,7 @@ static void CuvidQueueSurface(CuvidDecoder * decoder, int surface,
 
     if (1) {				// can't wait for output queue empty
 	if (atomic_read(&decoder->SurfacesFilled) >= (VIDEO_SURFACES_MAX * 2)) {
+	    MetricsInc(METRIC_FRAMES_DROPPED);
 	    Warning(_
 		("video/cuvid: output buffer full, dropping frame (%d/%d)\n"),
 		++decoder->FramesDropped, decoder->FrameCounter);
@@ -12702,6 +13072,7 @@ static void CuvidQueueSurface(CuvidDecoder * decoder, int surface,
     decoder->SurfaceWrite = (decoder->SurfaceWrite + 1)
 	% (VIDEO_SURFACES_MAX * 2);
     atomic_inc(&decoder->SurfacesFilled);
+    TraceMark(TRACE_SURFACE, atomic_read(&decoder->SurfacesFilled));
 }
 
 ///
@@ -12952,14 +13323,17 @@ static void CuvidAdvanceDecoderFrame(CuvidDecoder * decoder)
 	if (filled < 1 + 2 * decoder->Interlaced) {
 	    // keep use of last surface
 	    ++decoder->FramesDuped;
+	    MetricsInc(METRIC_FRAMES_DUPED);
 	    // FIXME: don't warn after stream start, don't warn during pause
 	    Debug(4,"video: display buffer empty, duping frame (%d/%d) %d\n",
 		decoder->FramesDuped, decoder->FrameCounter,
 		VideoGetBuffers(decoder->Stream));
+	    TraceMark(TRACE_FRAME_DUP, filled);
 	    return;
 	}
 	decoder->SurfaceRead = (decoder->SurfaceRead + 1) % (VIDEO_SURFACES_MAX * 2);
 	atomic_dec(&decoder->SurfacesFilled);
+	TraceMark(TRACE_FRAME, filled - 1);
 	decoder->SurfaceField = !decoder->Interlaced;
 	return;
     }
@@ -12998,6 +13372,7 @@ static void CuvidDisplayFrame(void)
 	// FIXME: can be more than 1 frame long shown
 	for (i = 0; i < CuvidDecoderN; ++i) {
 	    CuvidDecoders[i]->FramesMissed++;
+	    MetricsInc(METRIC_FRAMES_MISSED);
 	    CuvidMessage(2, _("video/cuvid: missed frame (%d/%d)\n"),
 		CuvidDecoders[i]->FramesMissed,
 		CuvidDecoders[i]->FrameCounter);
@@ -13014,6 +13389,7 @@ static void CuvidDisplayFrame(void)
 
 	decoder = CuvidDecoders[i];
 	decoder->FramesDisplayed++;
+	MetricsInc(METRIC_FRAMES_DISPLAYED);
 	decoder->StartCounter++;
 
 	filled = atomic_read(&decoder->SurfacesFilled);
@@ -13041,6 +13417,9 @@ static void CuvidDisplayFrame(void)
 #endif
 	}
 
+	if (filled) {
+	    VideoZapMark((VideoHwDecoder *) decoder, VIDEO_ZAP_DISPLAYED);
+	}
 	CuvidMixVideo(decoder, i);
     }
 
@@ -13069,6 +13448,7 @@ static void CuvidDisplayFrame(void)
 
     // FIXME: CLOCK_MONOTONIC_RAW
     clock_gettime(CLOCK_MONOTONIC, &CuvidFrameTime);
+    TraceMark(TRACE_VSYNC, 0);
     for (i = 0; i < CuvidDecoderN; ++i) {
 	// remember time of last shown surface
 	CuvidDecoders[i]->FrameTime = CuvidFrameTime;
@@ -13137,6 +13517,7 @@ static void CuvidSetClosing(CuvidDecoder * decoder)
 static void CuvidResetStart(CuvidDecoder * decoder)
 {
     decoder->StartCounter = 0;
+    PresenterReset(&decoder->Presenter);
 }
 
 ///
@@ -13210,6 +13591,42 @@ static void CuvidSyncDecoder(CuvidDecoder * decoder)
 	max_mutex_delay = GetMsTicks() - mutex_start_time;
 	Debug(3, "video: mutex delay: %"PRIu32"ms\n", max_mutex_delay);
     }
+    if (!decoder->TrickSpeed && audio_clock != (int64_t) AV_NOPTS_VALUE
+	&& video_clock != (int64_t) AV_NOPTS_VALUE) {
+	MetricsObserve(METRIC_AV_DIFF,
+	    (video_clock - audio_clock - VideoAudioDelay) / 90);
+    }
+
+    // progressive: pts scheduled presenter replaces 60Hz mode and
+    // the dup/drop thresholds
+    if (!decoder->TrickSpeed && !decoder->Interlaced) {
+	int n;
+
+	n = VideoPresenterSync(&decoder->Presenter, &decoder->FrameTime,
+	    audio_clock, filled);
+	if (n >= 0) {
+	    if (decoder->Presenter.Locked) {
+		VideoZapMark((VideoHwDecoder *) decoder, VIDEO_ZAP_SYNCED);
+	    }
+	    if (decoder->Presenter.Starved && !decoder->Closing) {
+		++decoder->FramesDuped;
+		MetricsInc(METRIC_FRAMES_DUPED);
+		// pip and mosaic tiles dup by design, only the stream synced
+		// on audio feeds the latency profile
+		if (decoder->SyncOnAudio) {
+		    AudioVideoUnderrun();
+		}
+	    }
+	    if (n > 1) {
+		decoder->FramesDropped += n - 1;
+		MetricsAdd(METRIC_FRAMES_DROPPED, n - 1);
+	    }
+	    while (n--) {
+		CuvidAdvanceDecoderFrame(decoder);
+	    }
+	    goto out;
+	}
+    }
 
     // 60Hz: repeat every 5th field
     if (Video60HzMode && !(decoder->FramesDisplayed % 6)) {
@@ -13235,7 +13652,9 @@ static void CuvidSyncDecoder(CuvidDecoder * decoder)
 	goto skip_sync;
     }
     // at start of new video stream, soft or hard sync video to audio
-    if (!VideoSoftStartSync && decoder->StartCounter < VideoSoftStartFrames
+    // fast start: video moves at once, dup/drop catch up with audio
+    if (!VideoSoftStartSync && !VideoFastStart
+	&& decoder->StartCounter < VideoSoftStartFrames
 	&& video_clock != (int64_t) AV_NOPTS_VALUE
 	&& (audio_clock == (int64_t) AV_NOPTS_VALUE
 	    || video_clock > audio_clock + VideoAudioDelay + 120 * 90)) {
@@ -13267,6 +13686,7 @@ static void CuvidSyncDecoder(CuvidDecoder * decoder)
 	    // FIXME: this quicker sync step, did not work with new code!
 	    err = CuvidMessage(3, "video: slow down video, duping frame\n");
 	    ++decoder->FramesDuped;
+	    MetricsInc(METRIC_FRAMES_DUPED);
 	    if (VideoSoftStartSync) {
 		decoder->SyncCounter = diff > 100 * 90 ? diff % 2 : 1; //softsync :)
 	    }
@@ -13274,17 +13694,22 @@ static void CuvidSyncDecoder(CuvidDecoder * decoder)
 	} else if (diff > 55 * 90) {
 	    err = CuvidMessage(3, "video: slow down video, duping frame\n");
 	    ++decoder->FramesDuped;
+	    MetricsInc(METRIC_FRAMES_DUPED);
 		decoder->SyncCounter = 1;
 		goto out;
 	} else if (diff < lower_limit * 90 && filled > 1 + 2 * decoder->Interlaced) {
 	    err = CuvidMessage(3, "video: speed up video, droping frame\n");
 	    ++decoder->FramesDropped;
+	    MetricsInc(METRIC_FRAMES_DROPPED);
 	    CuvidAdvanceDecoderFrame(decoder);
 		decoder->SyncCounter = 1;
 	} else if (diff < lower_limit * 90 && !filled) {
 		err = CuvidMessage(3, "video: speed up audio, delay audio\n");
 		AudioDelayms(-diff / 90);
 	}
+	if (!decoder->SyncCounter && abs(diff) <= 55 * 90) {
+	    VideoZapMark((VideoHwDecoder *) decoder, VIDEO_ZAP_SYNCED);
+	}
 #if defined(DEBUG) || defined(AV_INFO)
 	if (!decoder->SyncCounter && decoder->StartCounter < 1000) {
 #ifdef DEBUG
@@ -13304,6 +13729,11 @@ static void CuvidSyncDecoder(CuvidDecoder * decoder)
     if (decoder->SurfaceField && filled <= 1 + 2 * decoder->Interlaced) {
 	if (filled == 1 + 2 * decoder->Interlaced) {
 	    ++decoder->FramesDuped;
+	    MetricsInc(METRIC_FRAMES_DUPED);
+	    if (!decoder->Closing && !decoder->TrickSpeed
+		&& decoder->SyncOnAudio) {
+		AudioVideoUnderrun();
+	    }
 	    // FIXME: don't warn after stream start, don't warn during pause
 	    err =
 		CuvidMessage(3,
@@ -13443,6 +13873,7 @@ static void CuvidSyncRenderFrame(CuvidDecoder * decoder,
 
     if (!decoder->Closing) {
 	VideoSetPts(&decoder->PTS, decoder->Interlaced, video_ctx, frame);
+	PresenterFrame(&decoder->Presenter, decoder->PTS);
     }
     CuvidRenderFrame(decoder, video_ctx, frame);
 }
@@ -13485,6 +13916,7 @@ static void CuvidSetVideoMode(void)
 static void CuvidDisplayHandlerThread(void)
 {
     int i;
+    int n;
     int err;
     int allfull;
     int decoded;
@@ -13508,6 +13940,15 @@ static void CuvidDisplayHandlerThread(void)
 	    // fetch+decode or reopen
 	    allfull = 0;
 	    err = VideoDecodeInput(decoder->Stream);
+	    // focused mosaic tile decodes more packets each round
+	    for (n = VideoGetPriority(decoder->Stream) - 1; !err && n > 0;
+		--n) {
+		if (atomic_read(&decoder->SurfacesFilled) >
+		    1 + 2 * decoder->Interlaced
+		    || VideoDecodeInput(decoder->Stream)) {
+		    break;
+		}
+	    }
 	} else {
 	    err = VideoPollInput(decoder->Stream);
 	}
@@ -13656,6 +14097,7 @@ static const VideoModule CuvidModule = {
     .DisplayHandlerThread = CuvidDisplayHandlerThread,
     .OsdClear = GlxOsdClear,
     .OsdDrawARGB = GlxOsdDrawARGB,
+    .OsdDrawRects = GlxOsdDrawRects,
     .OsdInit = GlxOsdInit,
     .OsdExit = GlxOsdExit,
     .Init = CuvidInit,
@@ -13669,49 +14111,178 @@ static const VideoModule CuvidModule = {
 //----------------------------------------------------------------------------
 
 ///
-///	Allocate new noop decoder.
-///
-///	@param stream	video stream
+///	Noop decoder.
 ///
-///	@returns always NULL.
+///	Decodes in software and shows nothing, enabled with the workaround
+///	noop-decode.  This allows to test many streams without a gpu.
 ///
-static VideoHwDecoder *NoopNewHwDecoder(
-    __attribute__ ((unused)) VideoStream * stream)
+typedef struct _noop_decoder_
 {
-    return NULL;
-}
+    VideoStream *Stream;		///< video stream
+    int VideoX;				///< video base x coordinate
+    int VideoY;				///< video base y coordinate
+    int VideoWidth;			///< video base width
+    int VideoHeight;			///< video base height
+    int64_t PTS;			///< video PTS clock
+    int FrameCounter;			///< number of frames decoded
+} NoopDecoder;
 
-///
-///	Release a surface.
-///
-///	Can be called while exit.
-///
-///	@param decoder	noop hw decoder
-///	@param surface	surface no longer used
-///
-static void NoopReleaseSurface(
-    __attribute__ ((unused)) VideoHwDecoder * decoder, __attribute__ ((unused))
-    unsigned surface)
-{
-}
+static NoopDecoder *NoopDecoders[VIDEO_DECODERS_MAX];	///< open decoder streams
+static int NoopDecoderN;		///< number of decoder streams
 
 ///
-///	Set noop decoder video clock.
+///	Allocate new noop decoder.
 ///
-///	Can be called while exiting.
+///	@param stream	video stream
 ///
-///	@param decoder	noop hardware decoder
-///	@param pts	audio presentation timestamp
+///	@returns a new decoder with workaround noop-decode, otherwise NULL.
 ///
-void NoopSetClock(__attribute__ ((unused)) VideoHwDecoder * decoder,
-    __attribute__ ((unused)) int64_t pts)
+static NoopDecoder *NoopNewHwDecoder(VideoStream * stream)
 {
-}
+    NoopDecoder *decoder;
 
-///
-///	Set noop decoder closing stream flag.
-///
-///	Can be called while exiting.
+    if (!VideoNoopDecode) {
+	return NULL;
+    }
+    if ((unsigned)NoopDecoderN >=
+	sizeof(NoopDecoders) / sizeof(*NoopDecoders)) {
+	Error(_("video/noop: out of decoders\n"));
+	return NULL;
+    }
+    if (!(decoder = calloc(1, sizeof(*decoder)))) {
+	Error(_("video/noop: out of memory\n"));
+	return NULL;
+    }
+    decoder->Stream = stream;
+    decoder->VideoWidth = VideoWindowWidth;
+    decoder->VideoHeight = VideoWindowHeight;
+    decoder->PTS = AV_NOPTS_VALUE;
+
+    NoopDecoders[NoopDecoderN++] = decoder;
+
+    return decoder;
+}
+
+///
+///	Destroy a noop decoder.
+///
+///	@param decoder	noop decoder
+///
+static void NoopDelHwDecoder(NoopDecoder * decoder)
+{
+    int i;
+
+    for (i = 0; i < NoopDecoderN; ++i) {
+	if (NoopDecoders[i] == decoder) {
+	    NoopDecoders[i] = NULL;
+	    // copy last slot into empty slot
+	    if (i < --NoopDecoderN) {
+		NoopDecoders[i] = NoopDecoders[NoopDecoderN];
+	    }
+	    Debug(3, "video/noop: %d frames decoded\n", decoder->FrameCounter);
+	    free(decoder);
+
+	    return;
+	}
+    }
+    Error(_("video/noop: decoder not in decoder list.\n"));
+}
+
+///
+///	Callback to negotiate the PixelFormat.
+///
+///	Noop decoder always decodes in software.
+///
+///	@param decoder		noop decoder
+///	@param video_ctx	ffmpeg video codec context
+///	@param fmt		is the list of formats which are supported by
+///				the codec
+///
+static enum AVPixelFormat Noop_get_format( __attribute__ ((unused))
+    NoopDecoder * decoder, AVCodecContext * video_ctx,
+    const enum AVPixelFormat *fmt)
+{
+    VideoDecoder *ist = video_ctx->opaque;
+
+    video_ctx->hwaccel_context = NULL;
+    ist->hwaccel_pix_fmt = AV_PIX_FMT_NONE;
+    ist->GetFormatDone = 1;
+    return avcodec_default_get_format(video_ctx, fmt);
+}
+
+///
+///	Render a ffmpeg frame.
+///
+///	Only the clock and the frame counter are updated.
+///
+///	@param decoder		noop decoder
+///	@param video_ctx	ffmpeg video codec context
+///	@param frame		frame to display
+///
+static void NoopRenderFrame(NoopDecoder * decoder,
+    const AVCodecContext * video_ctx, const AVFrame * frame)
+{
+    VideoSetPts(&decoder->PTS, 0, video_ctx, frame);
+    decoder->FrameCounter++;
+    TraceMark(TRACE_FRAME, 0);
+    MetricsInc(METRIC_FRAMES_DISPLAYED);
+    VideoZapMark((VideoHwDecoder *) decoder, VIDEO_ZAP_DISPLAYED);
+}
+
+///
+///	Get hwaccel context for ffmpeg.
+///
+///	@param decoder	noop decoder
+///
+///	@returns always NULL, noop decodes in software.
+///
+static void *NoopGetHwAccelContext( __attribute__ ((unused))
+    NoopDecoder * decoder)
+{
+    return NULL;
+}
+
+///
+///	Release a surface.
+///
+///	Can be called while exit.
+///
+///	@param decoder	noop hw decoder
+///	@param surface	surface no longer used
+///
+static void NoopReleaseSurface(
+    __attribute__ ((unused)) VideoHwDecoder * decoder, __attribute__ ((unused))
+    unsigned surface)
+{
+}
+
+///
+///	Set noop decoder video clock.
+///
+///	Can be called while exiting.
+///
+///	@param decoder	noop hardware decoder
+///	@param pts	audio presentation timestamp
+///
+void NoopSetClock(NoopDecoder * decoder, int64_t pts)
+{
+    decoder->PTS = pts;
+}
+
+///
+///	Get noop decoder video clock.
+///
+///	@param decoder	noop hardware decoder
+///
+static int64_t NoopGetClock(const NoopDecoder * decoder)
+{
+    return decoder->PTS;
+}
+
+///
+///	Set noop decoder closing stream flag.
+///
+///	Can be called while exiting.
 ///
 ///	@param decoder	noop hw decoder
 ///
@@ -13730,6 +14301,36 @@ static void NoopResetStart(__attribute__ ((unused)) VideoHwDecoder * decoder)
 {
 }
 
+///
+///	Set noop decoder trick speed.
+///
+///	@param decoder	noop decoder
+///	@param speed	trick speed (0 = normal)
+///
+static void NoopSetTrickSpeed( __attribute__ ((unused))
+    const NoopDecoder * decoder, __attribute__ ((unused))
+    int speed)
+{
+}
+
+///
+///	Get noop decoder statistics.
+///
+///	@param decoder		noop decoder
+///	@param[out] missed	missed frames
+///	@param[out] duped	duped frames
+///	@param[out] dropped	dropped frames
+///	@param[out] counter	number of decoded frames
+///
+static void NoopGetStats(NoopDecoder * decoder, int *missed, int *duped,
+    int *dropped, int *counter)
+{
+    *missed = 0;
+    *duped = 0;
+    *dropped = 0;
+    *counter = decoder->FrameCounter;
+}
+
 ///
 ///	Set noop background color.
 ///
@@ -13790,23 +14391,117 @@ static int NoopInit(const char *display_name)
     return 1;
 }
 
+#ifdef USE_GRAB
+
+///
+///	Grab noop test surface.
+///
+///	Without hardware, produce moving software color bars.  This allows
+///	to test the grab ring without GPU.  The noop module has no
+///	GrabOutput, the bars are only put into the grab ring and marked as
+///	synthetic, a real grab request fails.
+///
+///	@param ret_size[out]		size of allocated surface copy
+///	@param ret_width[in,out]	width of output
+///	@param ret_height[in,out]	height of output
+///
+static uint8_t *NoopGrabTestSurface(int *ret_size, int *ret_width,
+    int *ret_height)
+{
+    static const uint32_t bars[8] = {
+	0xFFFFFFFF, 0xFFFFFF00, 0xFF00FFFF, 0xFF00FF00,
+	0xFFFF00FF, 0xFFFF0000, 0xFF0000FF, 0xFF000000
+    };
+    static unsigned counter;
+    uint8_t *base;
+    int width;
+    int height;
+    int x;
+    int y;
+
+    if (!VideoGrabTest) {
+	return NULL;
+    }
+
+    width = *ret_width > 0 ? *ret_width : (int)VideoWindowWidth;
+    height = *ret_height > 0 ? *ret_height : (int)VideoWindowHeight;
+    if (width <= 0 || height <= 0) {
+	width = 1920;
+	height = 1080;
+    }
+
+    base = malloc(width * height * 4);
+    if (!base) {
+	Error(_("video/noop: grab out of memory\n"));
+	return NULL;
+    }
+    // bars move one bar width every 64 grabs
+    ++counter;
+    for (y = 0; y < height; ++y) {
+	uint32_t *line;
+
+	line = (uint32_t *) (base + y * width * 4);
+	for (x = 0; x < width; ++x) {
+	    line[x] = bars[((x * 8) / width + counter / 64) & 7];
+	}
+    }
+
+    *ret_size = width * height * 4;
+    *ret_width = width;
+    *ret_height = height;
+
+    return base;
+}
+
+#endif
+
 #ifdef USE_VIDEO_THREAD
 
 ///
 ///	Handle a noop display.
 ///
+///	Streams with higher priority (f.e. the focused mosaic tile) decode
+///	more packets each round, when the cpu can't keep up with all.
+///
 static void NoopDisplayHandlerThread(void)
 {
-    // avoid 100% cpu use
-    usleep(20 * 1000);
+    int i;
+    int decoded;
+
+    if (!NoopDecoderN) {
+	// avoid 100% cpu use
+	usleep(20 * 1000);
 #if 0
-    // this can't be canceled
-    if (XlibDisplay) {
-	XEvent event;
+	// this can't be canceled
+	if (XlibDisplay) {
+	    XEvent event;
 
-	XPeekEvent(XlibDisplay, &event);
-    }
+	    XPeekEvent(XlibDisplay, &event);
+	}
 #endif
+	return;
+    }
+
+    decoded = 0;
+    pthread_mutex_lock(&VideoLockMutex);
+    for (i = 0; i < NoopDecoderN; ++i) {
+	VideoStream *stream;
+	int n;
+
+	stream = NoopDecoders[i]->Stream;
+	for (n = VideoGetPriority(stream); n > 0; --n) {
+	    // decoder can be invalid here
+	    if (VideoDecodeInput(stream)) {
+		break;
+	    }
+	    decoded = 1;
+	}
+    }
+    pthread_mutex_unlock(&VideoLockMutex);
+
+    if (!decoded) {			// nothing decoded, sleep
+	usleep(1 * 1000);
+    }
 }
 
 #else
@@ -13828,35 +14523,29 @@ static void NoopVoid(void)
 static const VideoModule NoopModule = {
     .Name = "noop",
     .Enabled = 1,
-    .NewHwDecoder = NoopNewHwDecoder,
+    .NewHwDecoder =
+	(VideoHwDecoder * (*const)(VideoStream *)) NoopNewHwDecoder,
+    .DelHwDecoder = (void (*const) (VideoHwDecoder *))NoopDelHwDecoder,
 #if 0
-    // can't be called:
-    .DelHwDecoder = NoopDelHwDecoder,
+    // can't be called, noop decodes in software:
     .GetSurface = (unsigned (*const) (VideoHwDecoder *,
 	    const AVCodecContext *))NoopGetSurface,
 #endif
     .ReleaseSurface = NoopReleaseSurface,
-#if 0
     .get_format = (enum AVPixelFormat(*const) (VideoHwDecoder *,
 	    AVCodecContext *, const enum AVPixelFormat *))Noop_get_format,
     .RenderFrame = (void (*const) (VideoHwDecoder *,
-	    const AVCodecContext *, const AVFrame *))NoopSyncRenderFrame,
+	    const AVCodecContext *, const AVFrame *))NoopRenderFrame,
     .GetHwAccelContext = (void *(*const)(VideoHwDecoder *))
-	DummyGetHwAccelContext,
-#endif
+	NoopGetHwAccelContext,
     .SetClock = (void (*const) (VideoHwDecoder *, int64_t))NoopSetClock,
-#if 0
     .GetClock = (int64_t(*const) (const VideoHwDecoder *))NoopGetClock,
-#endif
     .SetClosing = (void (*const) (const VideoHwDecoder *))NoopSetClosing,
     .ResetStart = (void (*const) (const VideoHwDecoder *))NoopResetStart,
-#if 0
     .SetTrickSpeed =
 	(void (*const) (const VideoHwDecoder *, int))NoopSetTrickSpeed,
-    .GrabOutput = NoopGrabOutputSurface,
     .GetStats = (void (*const) (VideoHwDecoder *, int *, int *, int *,
 	    int *))NoopGetStats,
-#endif
     .SetBackground = NoopSetBackground,
     .SetVideoMode = NoopVoid,
     .ResetAutoCrop = NoopVoid,
@@ -13908,35 +14597,102 @@ void VideoOsdClear(void)
 void VideoOsdDrawARGB(int xi, int yi, int width, int height, int pitch,
     const uint8_t * argb, int x, int y)
 {
+    VideoOsdRect rect;
+
+    rect.Xi = xi;
+    rect.Yi = yi;
+    rect.Width = width;
+    rect.Height = height;
+    rect.Pitch = pitch;
+    rect.Argb = argb;
+    rect.X = x;
+    rect.Y = y;
+    VideoOsdDrawRects(&rect, 1);
+}
+
+///
+///	Draw OSD ARGB areas of one flush.
+///
+///	The areas are uploaded in the given order, later areas overwrite
+///	earlier ones.  Modules with #VideoModule::OsdDrawRects upload all
+///	areas at once.
+///
+///	@param rects	damaged areas with their ARGB image data
+///	@param n	number of areas
+///
+void VideoOsdDrawRects(const VideoOsdRect * rects, int n)
+{
+    int bytes;
+    int i;
+
     VideoThreadLock();
-    // update dirty area
-    if (x < OsdDirtyX) {
-	if (OsdDirtyWidth) {
-	    OsdDirtyWidth += OsdDirtyX - x;
+    bytes = 0;
+    for (i = 0; i < n; ++i) {
+	int x;
+	int y;
+	int width;
+	int height;
+
+	x = rects[i].X;
+	y = rects[i].Y;
+	width = rects[i].Width;
+	height = rects[i].Height;
+	// update dirty area
+	if (x < OsdDirtyX) {
+	    if (OsdDirtyWidth) {
+		OsdDirtyWidth += OsdDirtyX - x;
+	    }
+	    OsdDirtyX = x;
 	}
-	OsdDirtyX = x;
-    }
-    if (y < OsdDirtyY) {
-	if (OsdDirtyHeight) {
-	    OsdDirtyHeight += OsdDirtyY - y;
+	if (y < OsdDirtyY) {
+	    if (OsdDirtyHeight) {
+		OsdDirtyHeight += OsdDirtyY - y;
+	    }
+	    OsdDirtyY = y;
 	}
-	OsdDirtyY = y;
-    }
-    if (x + width > OsdDirtyX + OsdDirtyWidth) {
-	OsdDirtyWidth = x + width - OsdDirtyX;
-    }
-    if (y + height > OsdDirtyY + OsdDirtyHeight) {
-	OsdDirtyHeight = y + height - OsdDirtyY;
+	if (x + width > OsdDirtyX + OsdDirtyWidth) {
+	    OsdDirtyWidth = x + width - OsdDirtyX;
+	}
+	if (y + height > OsdDirtyY + OsdDirtyHeight) {
+	    OsdDirtyHeight = y + height - OsdDirtyY;
+	}
+	Debug(4, "video: osd dirty %dx%d%+d%+d -> %dx%d%+d%+d\n", width,
+	    height, x, y, OsdDirtyWidth, OsdDirtyHeight, OsdDirtyX, OsdDirtyY);
+	bytes += width * height * 4;
     }
-    Debug(4, "video: osd dirty %dx%d%+d%+d -> %dx%d%+d%+d\n", width, height, x,
-	y, OsdDirtyWidth, OsdDirtyHeight, OsdDirtyX, OsdDirtyY);
 
-    VideoUsedModule->OsdDrawARGB(xi, yi, width, height, pitch, argb, x, y);
+    if (VideoUsedModule->OsdDrawRects) {
+	VideoUsedModule->OsdDrawRects(rects, n);
+    } else {
+	for (i = 0; i < n; ++i) {
+	    VideoUsedModule->OsdDrawARGB(rects[i].Xi, rects[i].Yi,
+		rects[i].Width, rects[i].Height, rects[i].Pitch, rects[i].Argb,
+		rects[i].X, rects[i].Y);
+	}
+    }
     OsdShown = 1;
 
+    ++OsdUploadFlushes;
+    OsdUploadBytes = bytes;
+    OsdUploadTotal += bytes;
+
     VideoThreadUnlock();
 }
 
+///
+///	Get OSD upload statistics.
+///
+///	@param[out] flushes	number of osd uploads
+///	@param[out] bytes	bytes of the last upload
+///	@param[out] average	average bytes per upload
+///
+void VideoGetOsdStats(int *flushes, int *bytes, int *average)
+{
+    *flushes = OsdUploadFlushes;
+    *bytes = OsdUploadBytes;
+    *average = OsdUploadFlushes ? OsdUploadTotal / OsdUploadFlushes : 0;
+}
+
 void ActivateOsd(void) {
     OsdShown = 1;
 }
@@ -14370,6 +15126,7 @@ struct _video_hw_decoder_
 #ifdef USE_CUVID
 	CuvidDecoder Cuvid;		///< cuvid decoder structure
 #endif
+	NoopDecoder Noop;		///< noop decoder structure
     };
 };
 
@@ -14488,6 +15245,7 @@ void VideoRenderFrame(VideoHwDecoder * hw_decoder,
 	Warning(_("video: repeated pict %d found, but not handled\n"),
 	    frame->repeat_pict);
     }
+    VideoZapMark(hw_decoder, VIDEO_ZAP_DECODED);
     VideoUsedModule->RenderFrame(hw_decoder, video_ctx, frame);
 }
 
@@ -14632,6 +15390,427 @@ void VideoSetTrickSpeed(VideoHwDecoder * hw_decoder, int speed)
     VideoUsedModule->SetTrickSpeed(hw_decoder, speed);
 }
 
+#ifdef USE_GRAB
+
+//----------------------------------------------------------------------------
+//	Grab ring
+//----------------------------------------------------------------------------
+
+///
+///	The grab ring decouples the consumers of grabbed images (ambilight
+///	services, SVDRP GRAB, previews) from the hardware readback.  A thread
+///	grabs downscaled images with the configured rate into a small ring of
+///	reference counted buffers, all consumers share the newest buffer.
+///
+
+#define VIDEO_GRAB_RING_MAX	4	///< number of grab ring buffers
+#define VIDEO_GRAB_IDLE_TIME	3000	///< ms without consumer, stop grabbing
+#define VIDEO_GRAB_MAX_AGE	500	///< ms oldest image served to consumer
+#define VIDEO_GRAB_WAIT_TIME	100	///< ms consumer waits for fresh image
+
+static int VideoGrabRate;		///< grab rate in Hz (0 = disabled)
+static int VideoGrabWidth = 512;	///< width of grab ring images
+
+    /// grab ring buffers
+static VideoGrabBuffer VideoGrabRing[VIDEO_GRAB_RING_MAX];
+static int VideoGrabNewest = -1;	///< index of newest grab buffer
+static uint32_t VideoGrabSequence;	///< sequence number of newest grab
+static uint32_t VideoGrabLastUse;	///< ms ticks of last consumer request
+
+static pthread_t VideoGrabThread;	///< grab ring thread
+static char VideoGrabThreadStop;	///< flag stop grab ring thread
+    /// grab ring lock mutex
+static pthread_mutex_t VideoGrabMutex = PTHREAD_MUTEX_INITIALIZER;
+    /// wakeup grab ring thread
+static pthread_cond_t VideoGrabWakeupCond;
+    /// new image in grab ring
+static pthread_cond_t VideoGrabReadyCond;
+    /// init grab ring conditions once
+static pthread_once_t VideoGrabOnce = PTHREAD_ONCE_INIT;
+
+static int VideoGrabCounter;		///< number of ring grabs
+static int VideoGrabDropped;		///< grabs dropped, all buffers used
+static int VideoGrabServed;		///< images served from ring
+
+///
+///	Init grab ring conditions, they wait on the monotonic clock.
+///
+static void VideoGrabCondInit(void)
+{
+    pthread_condattr_t condattr;
+
+    pthread_condattr_init(&condattr);
+    pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&VideoGrabWakeupCond, &condattr);
+    pthread_cond_init(&VideoGrabReadyCond, &condattr);
+    pthread_condattr_destroy(&condattr);
+}
+
+///
+///	Calculate absolute timeout for pthread_cond_timedwait.
+///
+///	The grab ring conditions use the monotonic clock.
+///
+///	@param abstime[out]	absolute time
+///	@param ms		timeout in ms
+///
+static void VideoGrabTimeout(struct timespec *abstime, int ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, abstime);
+    abstime->tv_sec += ms / 1000;
+    abstime->tv_nsec += (ms % 1000) * 1000 * 1000;
+    if (abstime->tv_nsec >= 1000 * 1000 * 1000) {
+	abstime->tv_nsec -= 1000 * 1000 * 1000;
+	abstime->tv_sec++;
+    }
+}
+
+///
+///	Grab one image into the grab ring.
+///
+///	The readback itself runs without holding the ring lock.  Buffers hold
+///	by consumers are never overwritten, if all are used the image is
+///	dropped.
+///
+static void VideoGrabRingUpdate(void)
+{
+    uint8_t *(*grab)(int *, int *, int *);
+    uint8_t *data;
+    int size;
+    int width;
+    int height;
+    int i;
+
+    grab = VideoUsedModule->GrabOutput;
+    if (VideoUsedModule == &NoopModule && VideoGrabTest) {
+	grab = NoopGrabTestSurface;
+    }
+    if (!grab || !VideoWindowWidth) {
+	return;
+    }
+    width = VideoGrabWidth;
+    height = (width * VideoWindowHeight) / VideoWindowWidth;
+    data = grab(&size, &width, &height);
+    if (!data) {
+	return;
+    }
+
+    pthread_mutex_lock(&VideoGrabMutex);
+    for (i = 0; i < VIDEO_GRAB_RING_MAX; ++i) {
+	if (i != VideoGrabNewest && !VideoGrabRing[i].RefCount) {
+	    break;
+	}
+    }
+    if (i == VIDEO_GRAB_RING_MAX) {
+	VideoGrabDropped++;
+	pthread_mutex_unlock(&VideoGrabMutex);
+	free(data);
+	return;
+    }
+    free(VideoGrabRing[i].Data);
+    VideoGrabRing[i].Data = data;
+    VideoGrabRing[i].Size = size;
+    VideoGrabRing[i].Width = width;
+    VideoGrabRing[i].Height = height;
+    VideoGrabRing[i].Tick = GetMsTicks();
+    VideoGrabRing[i].Sequence = ++VideoGrabSequence;
+    VideoGrabRing[i].Synthetic = grab != VideoUsedModule->GrabOutput;
+    VideoGrabNewest = i;
+    VideoGrabCounter++;
+    pthread_cond_broadcast(&VideoGrabReadyCond);
+    pthread_mutex_unlock(&VideoGrabMutex);
+}
+
+///
+///	Grab ring thread.
+///
+///	Grabs with the configured rate, sleeps while no consumer requested
+///	images for some time.
+///
+static void *VideoGrabHandlerThread(void *dummy)
+{
+    Debug(3, "video: grab thread started\n");
+
+    for (;;) {
+	struct timespec abstime;
+	uint32_t start;
+	int interval;
+
+	start = GetMsTicks();
+	pthread_mutex_lock(&VideoGrabMutex);
+	if (!VideoGrabRate
+	    || start - VideoGrabLastUse > VIDEO_GRAB_IDLE_TIME) {
+	    // idle: no consumer, wait for next request
+	    pthread_cond_wait(&VideoGrabWakeupCond, &VideoGrabMutex);
+	}
+	if (VideoGrabThreadStop) {
+	    pthread_mutex_unlock(&VideoGrabMutex);
+	    break;
+	}
+	interval = VideoGrabRate ? 1000 / VideoGrabRate : 0;
+	pthread_mutex_unlock(&VideoGrabMutex);
+
+	VideoGrabRingUpdate();
+
+	// sleep remaining interval, consumers may wakeup us earlier
+	interval -= GetMsTicks() - start;
+	if (interval > 0) {
+	    VideoGrabTimeout(&abstime, interval);
+	    pthread_mutex_lock(&VideoGrabMutex);
+	    if (!VideoGrabThreadStop) {
+		pthread_cond_timedwait(&VideoGrabWakeupCond, &VideoGrabMutex,
+		    &abstime);
+	    }
+	    pthread_mutex_unlock(&VideoGrabMutex);
+	}
+    }
+
+    Debug(3, "video: grab thread stopped\n");
+    return dummy;
+}
+
+///
+///	Stop grab ring thread and free grab ring buffers.
+///
+///	@note buffers still hold by consumers are leaked, can't happen during
+///	exit.
+///
+static void VideoGrabExit(void)
+{
+    int i;
+
+    pthread_once(&VideoGrabOnce, VideoGrabCondInit);
+    pthread_mutex_lock(&VideoGrabMutex);
+    if (VideoGrabThread) {
+	pthread_t thread;
+
+	VideoGrabThreadStop = 1;
+	pthread_cond_signal(&VideoGrabWakeupCond);
+	thread = VideoGrabThread;
+	pthread_mutex_unlock(&VideoGrabMutex);
+
+	pthread_join(thread, NULL);
+
+	pthread_mutex_lock(&VideoGrabMutex);
+	VideoGrabThread = 0;
+	VideoGrabThreadStop = 0;
+    }
+    for (i = 0; i < VIDEO_GRAB_RING_MAX; ++i) {
+	if (!VideoGrabRing[i].RefCount) {
+	    free(VideoGrabRing[i].Data);
+	    memset(&VideoGrabRing[i], 0, sizeof(VideoGrabRing[i]));
+	}
+    }
+    VideoGrabNewest = -1;
+    pthread_mutex_unlock(&VideoGrabMutex);
+}
+
+///
+///	Get newest buffer of the grab ring.
+///
+///	Starts the grab thread on demand.  If the ring has no fresh image,
+///	the grab thread is woken and the caller waits a short time for it.
+///
+///	@returns referenced grab buffer, must be given back with
+///	VideoGrabRelease(), or NULL if no fresh image is available.
+///
+VideoGrabBuffer *VideoGrabAcquire(void)
+{
+    VideoGrabBuffer *buf;
+    uint32_t tick;
+
+    pthread_once(&VideoGrabOnce, VideoGrabCondInit);
+    pthread_mutex_lock(&VideoGrabMutex);
+    if (!VideoGrabRate) {
+	pthread_mutex_unlock(&VideoGrabMutex);
+	return NULL;
+    }
+    if (!VideoGrabThread) {
+	pthread_create(&VideoGrabThread, NULL, VideoGrabHandlerThread, NULL);
+	pthread_setname_np(VideoGrabThread, "softhddev grab");
+    }
+
+    tick = GetMsTicks();
+    VideoGrabLastUse = tick;
+    if (VideoGrabNewest < 0
+	|| tick - VideoGrabRing[VideoGrabNewest].Tick >
+	2000U / VideoGrabRate) {
+	struct timespec abstime;
+
+	// ring was idle, wakeup grab thread and wait for new image
+	pthread_cond_signal(&VideoGrabWakeupCond);
+	VideoGrabTimeout(&abstime, VIDEO_GRAB_WAIT_TIME);
+	pthread_cond_timedwait(&VideoGrabReadyCond, &VideoGrabMutex,
+	    &abstime);
+	tick = GetMsTicks();
+    }
+
+    buf = NULL;
+    if (VideoGrabNewest >= 0
+	&& tick - VideoGrabRing[VideoGrabNewest].Tick <= VIDEO_GRAB_MAX_AGE) {
+	buf = &VideoGrabRing[VideoGrabNewest];
+	buf->RefCount++;
+	VideoGrabServed++;
+    }
+    pthread_mutex_unlock(&VideoGrabMutex);
+
+    return buf;
+}
+
+///
+///	Give back a grab ring buffer.
+///
+///	@param buf	grab buffer from VideoGrabAcquire()
+///
+void VideoGrabRelease(VideoGrabBuffer * buf)
+{
+    if (buf) {
+	pthread_mutex_lock(&VideoGrabMutex);
+	buf->RefCount--;
+	pthread_mutex_unlock(&VideoGrabMutex);
+    }
+}
+
+///
+///	Copy and scale newest grab ring image.
+///
+///	Same semantic as the GrabOutput module functions: a width <= -64 is
+///	an Atmo grab service request, height is then the clipped overscan in
+///	per mill.
+///
+///	@param ret_size[out]		size of allocated image copy
+///	@param ret_width[in,out]	width of image
+///	@param ret_height[in,out]	height of image
+///
+///	@returns allocated BGRA image or NULL, if the request can't be
+///	served from the grab ring.
+///
+static uint8_t *VideoGrabRingCopy(int *ret_size, int *ret_width,
+    int *ret_height)
+{
+    VideoGrabBuffer *buf;
+    uint8_t *data;
+    int width;
+    int height;
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+    int x;
+    int y;
+
+    if (!(buf = VideoGrabAcquire())) {
+	return NULL;
+    }
+    if (buf->Synthetic) {		// test bars aren't a grab
+	VideoGrabRelease(buf);
+	return NULL;
+    }
+
+    x0 = 0;
+    y0 = 0;
+    x1 = buf->Width;
+    y1 = buf->Height;
+    if (*ret_width <= -64) {		// Atmo grab service request
+	width = -*ret_width;
+	height = (width * buf->Height) / buf->Width;
+	if (*ret_height > 0 && *ret_height <= 200) {
+	    x0 = (x1 * *ret_height) / 1000;
+	    x1 -= x0;
+	    y0 = (y1 * *ret_height) / 1000;
+	    y1 -= y0;
+	}
+    } else {
+	width = *ret_width > 0 ? *ret_width : buf->Width;
+	height = *ret_height > 0 ? *ret_height : buf->Height;
+    }
+    if (width > buf->Width || height > buf->Height) {
+	// larger than ring images, needs a full readback
+	VideoGrabRelease(buf);
+	return NULL;
+    }
+
+    data = malloc(width * height * 4);
+    if (!data) {
+	Error(_("video: grab out of memory\n"));
+	VideoGrabRelease(buf);
+	return NULL;
+    }
+    // simple nearest neighbor scaler
+    for (y = 0; y < height; ++y) {
+	const uint32_t *src;
+	uint32_t *dst;
+
+	src = (const uint32_t *)(buf->Data +
+	    (y0 + (y * (y1 - y0)) / height) * buf->Width * 4);
+	dst = (uint32_t *) (data + y * width * 4);
+	for (x = 0; x < width; ++x) {
+	    dst[x] = src[x0 + (x * (x1 - x0)) / width];
+	}
+    }
+    VideoGrabRelease(buf);
+
+    *ret_size = width * height * 4;
+    *ret_width = width;
+    *ret_height = height;
+    return data;
+}
+
+#endif
+
+///
+///	Set grab ring rate and image width.
+///
+///	@param rate	grab rate in Hz (0 = disable ring, synchronous grab)
+///	@param width	width of grab ring images
+///
+void VideoSetGrabRate(int rate, int width)
+{
+#ifdef USE_GRAB
+    if (rate < 0) {
+	rate = 0;
+    } else if (rate > 50) {
+	rate = 50;
+    }
+    // atmo service needs up to 256 pixel
+    if (width < 256) {
+	width = 256;
+    }
+
+    pthread_once(&VideoGrabOnce, VideoGrabCondInit);
+    pthread_mutex_lock(&VideoGrabMutex);
+    VideoGrabRate = rate;
+    VideoGrabWidth = width;
+    pthread_cond_signal(&VideoGrabWakeupCond);
+    pthread_mutex_unlock(&VideoGrabMutex);
+#else
+    (void)rate;
+    (void)width;
+#endif
+}
+
+///
+///	Get grab ring statistics.
+///
+///	@param[out] grabbed	number of images grabbed into the ring
+///	@param[out] dropped	grabs dropped, all buffers hold by consumers
+///	@param[out] served	number of images served from the ring
+///
+void VideoGetGrabStats(int *grabbed, int *dropped, int *served)
+{
+#ifdef USE_GRAB
+    pthread_mutex_lock(&VideoGrabMutex);
+    *grabbed = VideoGrabCounter;
+    *dropped = VideoGrabDropped;
+    *served = VideoGrabServed;
+    pthread_mutex_unlock(&VideoGrabMutex);
+#else
+    *grabbed = 0;
+    *dropped = 0;
+    *served = 0;
+#endif
+}
+
 ///
 ///	Grab full screen image.
 ///
@@ -14662,7 +15841,14 @@ uint8_t *VideoGrab(int *size, int *width, int *height, int write_header)
 	scale_width = *width;
 	scale_height = *height;
 	n = 0;
-	data = VideoUsedModule->GrabOutput(size, width, height);
+	data = NULL;
+	if (scale_width > 0 && scale_height > 0) {
+	    // small images are served from the grab ring without readback
+	    data = VideoGrabRingCopy(size, width, height);
+	}
+	if (!data) {
+	    data = VideoUsedModule->GrabOutput(size, width, height);
+	}
 	if (data == NULL)
 	    return NULL;
 
@@ -14764,6 +15950,12 @@ uint8_t *VideoGrabService(int *size, int *width, int *height)
 
 #ifdef USE_GRAB
     if (VideoUsedModule->GrabOutput) {
+	uint8_t *data;
+
+	// ambilight polls with high rate, share the grab ring images
+	if ((data = VideoGrabRingCopy(size, width, height))) {
+	    return data;
+	}
 	return VideoUsedModule->GrabOutput(size, width, height);
     } else
 #endif
@@ -14792,6 +15984,159 @@ void VideoGetStats(VideoHwDecoder * hw_decoder, int *missed, int *duped,
     VideoUsedModule->GetStats(hw_decoder, missed, duped, dropped, counter);
 }
 
+///
+///	Start timing of a channel switch.
+///
+///	Only stages reached by this decoder are recorded, so a running
+///	pip stream doesn't disturb the zap times.
+///
+///	@param hw_decoder	video hardware decoder of the new stream
+///
+void VideoZapStart(const VideoHwDecoder * hw_decoder)
+{
+    int i;
+
+    VideoZapDecoder = hw_decoder;
+    for (i = 1; i < VIDEO_ZAP_MAX; ++i) {
+	VideoZapTicks[i] = 0;
+    }
+    VideoZapTicks[VIDEO_ZAP_SWITCH] = GetMsTicks();
+    VideoZapCounter++;
+}
+
+///
+///	Mark a reached zap stage.
+///
+///	Cheap enough to be called for every packet or frame, only the
+///	first call after a channel switch records the time.
+///
+///	@param hw_decoder	video hardware decoder reaching the stage
+///	@param stage		zap stage (VIDEO_ZAP_...)
+///
+void VideoZapMark(const VideoHwDecoder * hw_decoder, int stage)
+{
+    uint32_t tick;
+
+    if (VideoZapTicks[stage] || hw_decoder != VideoZapDecoder
+	|| !VideoZapCounter) {
+	return;
+    }
+    // frames of the old stream are still in the pipeline
+    if (stage > VIDEO_ZAP_CODEC && !VideoZapTicks[VIDEO_ZAP_CODEC]) {
+	return;
+    }
+    tick = GetMsTicks();
+    VideoZapTicks[stage] = tick ? tick : 1;
+}
+
+///
+///	Account time to get the codec ready for a new stream.
+///
+///	@param hw_decoder	video hardware decoder of the codec
+///	@param reused		flag codec context reused, not reopened
+///	@param us		time in us
+///
+void VideoZapCodec(const VideoHwDecoder * hw_decoder, int reused, int us)
+{
+    if (hw_decoder != VideoZapDecoder || !VideoZapCounter) {
+	return;
+    }
+    reused = reused != 0;
+    VideoZapCodecCount[reused]++;
+    VideoZapCodecUs[reused] += us;
+}
+
+///
+///	Get codec reopen and reuse statistics of the channel switches.
+///
+///	@param[out] reopens	number of codec reopens
+///	@param[out] reopen_us	average reopen time in us
+///	@param[out] reuses	number of codec reuses
+///	@param[out] reuse_us	average reuse time in us
+///
+void VideoGetZapCodecStats(int *reopens, int *reopen_us, int *reuses,
+    int *reuse_us)
+{
+    *reopens = VideoZapCodecCount[0];
+    *reopen_us = *reopens ? (int)(VideoZapCodecUs[0] / *reopens) : 0;
+    *reuses = VideoZapCodecCount[1];
+    *reuse_us = *reuses ? (int)(VideoZapCodecUs[1] / *reuses) : 0;
+}
+
+///
+///	Get zap stage times of the last channel switch.
+///
+///	@param[out] times	VIDEO_ZAP_MAX times in ms after switch,
+///				-1 if the stage isn't reached yet
+///
+///	@returns number of channel switches timed.
+///
+int VideoGetZapTimes(int *times)
+{
+    uint32_t start;
+    uint32_t tick;
+    int i;
+
+    start = VideoZapTicks[VIDEO_ZAP_SWITCH];
+    times[VIDEO_ZAP_SWITCH] = 0;
+    for (i = 1; i < VIDEO_ZAP_MAX; ++i) {
+	tick = VideoZapTicks[i];
+	if (i == VIDEO_ZAP_AUDIO) {	// audio keeps its own time
+	    tick = AudioGetPlayTick();
+	}
+	// stage of a previous switch: not yet reached
+	times[i] = tick && (int32_t) (tick - start) >= 0 ? (int)(tick - start)
+	    : -1;
+    }
+    return VideoZapCounter;
+}
+
+///
+///	Get presenter statistics.
+///
+///	@param hw_decoder	video hardware decoder
+///	@param[out] cadence	detected cadence
+///	@param[out] period	fitted vsync period in us
+///	@param[out] judder	frames shown outside of the cadence
+///	@param[out] resyncs	number of phase resyncs
+///
+///	@returns false, if presenter isn't used.
+///
+int VideoGetPresenterStats(VideoHwDecoder * hw_decoder, const char **cadence,
+    int *period, int *judder, int *resyncs)
+{
+    const VideoPresenter *presenter;
+
+    presenter = NULL;
+#ifdef USE_VDPAU
+    if (VideoUsedModule == &VdpauModule) {
+	presenter = &hw_decoder->Vdpau.Presenter;
+    }
+#endif
+#ifdef USE_VAAPI
+#ifdef USE_GLX
+    if (VideoUsedModule == &VaapiModule || VideoUsedModule == &VaapiGlxModule) {
+#else
+    if (VideoUsedModule == &VaapiModule) {
+#endif
+	presenter = &hw_decoder->Vaapi.Presenter;
+    }
+#endif
+#ifdef USE_CUVID
+    if (VideoUsedModule == &CuvidModule) {
+	presenter = &hw_decoder->Cuvid.Presenter;
+    }
+#endif
+    if (!VideoPresenterEnabled || !presenter) {
+	return 0;
+    }
+    *cadence = PresenterCadence(presenter);
+    *period = presenter->VsyncPeriod / 1000;
+    *judder = presenter->Judder;
+    *resyncs = presenter->Resyncs;
+    return 1;
+}
+
 ///
 ///	Get decoder video stream size.
 ///
@@ -15185,6 +16530,38 @@ void VideoSet60HzMode(int onoff)
     Video60HzMode = onoff;
 }
 
+///
+///	Set low latency profile.
+///
+///	@param onoff	enable / disable shorter soft start.
+///
+void VideoSetLowLatency(int onoff)
+{
+    VideoSoftStartFrames = onoff ? 25 : 100;
+}
+
+///
+///	Set fast start.
+///
+///	@param onoff	show first decoded key frame at once, don't drop
+///			it while waiting for a clean stream start, and
+///			don't hold video back for the initial audio sync.
+///
+void VideoSetFastStart(int onoff)
+{
+    VideoFastStart = onoff;
+}
+
+///
+///	Set pts scheduled frame presenter.
+///
+///	@param onoff	enable / disable presenter for progressive streams.
+///
+void VideoSetPresenter(int onoff)
+{
+    VideoPresenterEnabled = onoff;
+}
+
 ///
 ///	Set soft start audio/video sync.
 ///
@@ -15661,6 +17038,13 @@ void VideoSetOutputPosition(VideoHwDecoder * hw_decoder, int x, int y,
 	VideoThreadUnlock();
     }
 #endif
+    if (VideoUsedModule == &NoopModule) {
+	// nothing shown, only remember the window
+	hw_decoder->Noop.VideoX = x;
+	hw_decoder->Noop.VideoY = y;
+	hw_decoder->Noop.VideoWidth = width;
+	hw_decoder->Noop.VideoHeight = height;
+    }
     (void)hw_decoder;
 }
 
@@ -16500,6 +17884,9 @@ void VideoExit(void)
     X11DPMSReenable(Connection);
     X11SuspendScreenSaver(Connection, 0);
 
+#ifdef USE_GRAB
+    VideoGrabExit();
+#endif
 #ifdef USE_VIDEO_THREAD
     VideoThreadExit();
     // VDPAU cleanup hangs in XLockDisplay every 100 exits
@@ -16581,6 +17968,11 @@ int VideoDecodeInput( __attribute__ ((unused)) VideoStream * stream)
     return -1;
 }
 
+int VideoGetPriority( __attribute__ ((unused)) const VideoStream * stream)
+{
+    return 1;
+}
+
 ///
 ///	Print version.
 ///
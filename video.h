@@ -33,6 +33,32 @@ typedef struct _video_hw_decoder_ VideoHwDecoder;
     /// Video output stream typedef
 typedef struct __video_stream__ VideoStream;
 
+    /// Video OSD ARGB area typedef
+typedef struct _video_osd_rect_
+{
+    int Xi;				///< x-coordinate in argb image
+    int Yi;				///< y-coordinate in argb image
+    int Width;				///< width in pixel
+    int Height;				///< height in pixel
+    int Pitch;				///< pitch of argb image
+    const uint8_t *Argb;		///< 32bit ARGB image data
+    int X;				///< x-coordinate on screen
+    int Y;				///< y-coordinate on screen
+} VideoOsdRect;
+
+    /// Video grab ring buffer typedef
+typedef struct _video_grab_buffer_
+{
+    uint8_t *Data;			///< BGRA image data
+    int Size;				///< size of image data
+    int Width;				///< image width
+    int Height;				///< image height
+    uint32_t Tick;			///< ms ticks when grabbed
+    uint32_t Sequence;			///< grab sequence number
+    int RefCount;			///< number of consumers holding buffer
+    char Synthetic;			///< test image, no video output grabbed
+} VideoGrabBuffer;
+
 //----------------------------------------------------------------------------
 //	Variables
 //----------------------------------------------------------------------------
@@ -51,8 +77,25 @@ enum VideoOutParameters {
     stde,
 };
 
+/// Zap stages, timed from channel switch.
+enum VideoZapStages
+{
+    VIDEO_ZAP_SWITCH,			///< play mode set, new stream
+    VIDEO_ZAP_TS,			///< first TS packet
+    VIDEO_ZAP_PES,			///< first PES packet
+    VIDEO_ZAP_CODEC,			///< video codec opened
+    VIDEO_ZAP_DECODED,			///< first decoded frame
+    VIDEO_ZAP_DISPLAYED,		///< first displayed frame
+    VIDEO_ZAP_AUDIO,			///< first audio sample played
+    VIDEO_ZAP_SYNCED,			///< audio/video locked
+    VIDEO_ZAP_MAX
+};
+
 extern enum VideoHardwareDecoderMode VideoHardwareDecoder;	///< flag use hardware decoder
 extern char VideoIgnoreRepeatPict;	///< disable repeat pict warning
+extern char VideoGrabTest;		///< noop module grabs software frames
+extern char VideoNoopDecode;		///< noop module decodes in software
+extern char VideoFastStart;		///< first key frame and motion at once
 extern int VideoAudioDelay;		///< audio/video delay
 extern char ConfigStartX11Server;	///< flag start the x11 server
 
@@ -125,6 +168,15 @@ extern void VideoSet60HzMode(int);
     /// Set soft start audio/video sync.
 extern void VideoSetSoftStartSync(int);
 
+    /// Set low latency profile.
+extern void VideoSetLowLatency(int);
+
+    /// Set fast start, show first decoded key frame at once.
+extern void VideoSetFastStart(int);
+
+    /// Set pts scheduled frame presenter.
+extern void VideoSetPresenter(int);
+
     /// Set show black picture during channel switch.
 extern void VideoSetBlackPicture(int);
 
@@ -232,6 +284,12 @@ extern void VideoOsdClear(void);
 extern void VideoOsdDrawARGB(int, int, int, int, int, const uint8_t *, int,
     int);
 
+    /// Draw OSD ARGB areas of one flush.
+extern void VideoOsdDrawRects(const VideoOsdRect *, int);
+
+    /// Get OSD upload statistics.
+extern void VideoGetOsdStats(int *, int *, int *);
+
     /// Activate displaying OSD
 void ActivateOsd(void);
 #ifdef USE_VDPAU
@@ -278,9 +336,40 @@ extern uint8_t *VideoGrab(int *, int *, int *, int);
     /// Grab screen raw.
 extern uint8_t *VideoGrabService(int *, int *, int *);
 
+    /// Set grab ring rate and image width.
+extern void VideoSetGrabRate(int, int);
+
+    /// Get newest buffer of the grab ring.
+extern VideoGrabBuffer *VideoGrabAcquire(void);
+
+    /// Give back a grab ring buffer.
+extern void VideoGrabRelease(VideoGrabBuffer *);
+
+    /// Get grab ring statistics.
+extern void VideoGetGrabStats(int *, int *, int *);
+
     /// Get decoder statistics.
 extern void VideoGetStats(VideoHwDecoder *, int *, int *, int *, int *);
 
+    /// Get presenter statistics.
+extern int VideoGetPresenterStats(VideoHwDecoder *, const char **, int *,
+    int *, int *);
+
+    /// Start timing of a channel switch.
+extern void VideoZapStart(const VideoHwDecoder *);
+
+    /// Mark a reached zap stage.
+extern void VideoZapMark(const VideoHwDecoder *, int);
+
+    /// Account codec reopen or reuse time of a channel switch.
+extern void VideoZapCodec(const VideoHwDecoder *, int, int);
+
+    /// Get zap stage times of the last channel switch.
+extern int VideoGetZapTimes(int *);
+
+    /// Get codec reopen and reuse statistics of the channel switches.
+extern void VideoGetZapCodecStats(int *, int *, int *, int *);
+
     /// Get video stream size
 extern void VideoGetVideoSize(VideoHwDecoder *, int *, int *, int *, int *);
 
@@ -302,6 +391,9 @@ extern int VideoDecodeInput(VideoStream *);
     /// Get number of input buffers.
 extern int VideoGetBuffers(const VideoStream *);
 
+    /// Get decode priority of video stream.
+extern int VideoGetPriority(const VideoStream *);
+
     /// Set DPMS at Blackscreen switch
 extern void SetDPMSatBlackScreen(int);
 